@@ -0,0 +1,139 @@
+// Drives remote TCP detection workers through the scheduler and balancer and
+// reports how the load was spread. Start workers first, e.g. on localhost:
+//   python python/detection_server.py --serve --listen 127.0.0.1:7601
+// With --cascade the requests go through a small model first and only
+// uncertain ones reach the large model; the escalation rate is reported.
+// With --roi only the given regions of the image are inferred (RoiMask::parse
+// syntax for camera 0, e.g. "0: 0.1 0.1 0.3 0.5").
+// Usage: bench_balancer <image> <host:port,...> [--requests N] [--workers W] [--batch B]
+//                       [--cascade SMALL,LARGE] [--crops] [--roi SPEC]
+#include "worker_balancer.h"
+#include "detection_scheduler.h"
+#include "cascade_executor.h"
+#include "roi_executor.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::fprintf(stderr, "Usage: %s <image> <host:port,...> [--requests N] [--workers W] [--batch B] "
+                             "[--cascade SMALL,LARGE] [--crops] [--roi SPEC]\n", argv[0]);
+        return 1;
+    }
+
+    int requestCount = 200;
+    int workers = 0;
+    size_t maxBatch = 4;
+    std::string cascadeModels;
+    bool crops = false;
+    std::string roi;
+    for (int i = 3; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--requests") && i + 1 < argc) {
+            requestCount = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--workers") && i + 1 < argc) {
+            workers = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--batch") && i + 1 < argc) {
+            maxBatch = static_cast<size_t>(std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--cascade") && i + 1 < argc) {
+            cascadeModels = argv[++i];
+        } else if (!std::strcmp(argv[i], "--crops")) {
+            crops = true;
+        } else if (!std::strcmp(argv[i], "--roi") && i + 1 < argc) {
+            roi = argv[++i];
+        }
+    }
+
+    std::vector<WorkerEndpoint> endpoints = WorkerBalancer::parseEndpoints(argv[2]);
+    if (endpoints.empty()) {
+        std::fprintf(stderr, "No valid endpoints in '%s'\n", argv[2]);
+        return 1;
+    }
+    if (workers <= 0) {
+        // Two batches per endpoint keeps every worker busy while the next batch uploads
+        workers = 2 * static_cast<int>(endpoints.size());
+    }
+
+    WorkerBalancer balancer(endpoints);
+    RoiExecutor regions([&balancer](int workerIndex, const std::vector<DetectionRequest>& batch) {
+        return balancer.runBatch(workerIndex, batch);
+    });
+    regions.setMask(0, RoiMask::parse(roi)[0]);
+    CascadeExecutor cascade([&regions](int workerIndex, const std::vector<DetectionRequest>& batch) {
+        return regions.runBatch(workerIndex, batch);
+    });
+    size_t comma = cascadeModels.find(',');
+    if (comma != std::string::npos) {
+        CascadeConfig config;
+        config.smallModel = cascadeModels.substr(0, comma);
+        config.largeModel = cascadeModels.substr(comma + 1);
+        config.escalateCrops = crops;
+        cascade.setConfig(config);
+        cascade.setEnabled(true);
+    }
+    DetectionScheduler scheduler(
+        [&cascade](int workerIndex, const std::vector<DetectionRequest>& batch) {
+            return cascade.runBatch(workerIndex, batch);
+        },
+        workers, maxBatch);
+    scheduler.addStream(0, 1.0, static_cast<size_t>(requestCount), DetectionPriority::Bulk);
+
+    std::atomic<int> completed(0);
+    std::atomic<int> failed(0);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < requestCount; ++i) {
+        DetectionRequest request;
+        request.imagePath = argv[1];
+        request.confidenceThreshold = 0.5;
+        request.iouThreshold = 0.45;
+        request.modelName = "yolov5s";
+        request.saveAnnotated = false;
+        scheduler.submit(0, request,
+            [&completed](const DetectionResult&) { completed++; },
+            [&failed](const std::string& error) {
+                if (failed++ == 0) std::fprintf(stderr, "first failure: %s\n", error.c_str());
+            });
+    }
+    while (completed + failed < requestCount) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%d requests in %.2f s (%.1f/s) over %zu endpoint(s), %d scheduler worker(s), batch <= %zu: "
+                "%d done, %d failed\n", requestCount, seconds, requestCount / seconds, endpoints.size(),
+                workers, maxBatch, completed.load(), failed.load());
+    for (const EndpointStats& stats : balancer.getStats()) {
+        std::printf("  %s: %s, %llu answered, %llu failures, %llu failovers, batch round trip %.1f ms\n",
+                    stats.address.c_str(), stats.healthy ? "up" : "down",
+                    static_cast<unsigned long long>(stats.completed), static_cast<unsigned long long>(stats.failures),
+                    static_cast<unsigned long long>(stats.failovers), stats.meanLatencyMs);
+    }
+    for (const RoiStats& stats : regions.getStats()) {
+        std::printf("  roi: %zu region(s), %llu of %llu frames cropped into %llu crops, %.1f%% of the frame inferred, "
+                    "%llu detections outside dropped\n", stats.regions,
+                    static_cast<unsigned long long>(stats.croppedFrames), static_cast<unsigned long long>(stats.frames),
+                    static_cast<unsigned long long>(stats.crops), stats.inferredArea * 100,
+                    static_cast<unsigned long long>(stats.dropped));
+    }
+    if (cascade.isEnabled()) {
+        CascadeStats stats = cascade.getStats();
+        std::printf("  cascade %s: %.1f%% of %llu frames escalated (%llu uncertain, %llu scene changed, %llu crops, "
+                    "%llu failed), %.1f frames/s, per frame small %.1f ms, large %.1f ms\n",
+                    cascadeModels.c_str(), stats.escalationRate * 100, static_cast<unsigned long long>(stats.frames),
+                    static_cast<unsigned long long>(stats.uncertainEscalations),
+                    static_cast<unsigned long long>(stats.countEscalations),
+                    static_cast<unsigned long long>(stats.escalatedCrops),
+                    static_cast<unsigned long long>(stats.escalationFailures), stats.fps, stats.meanSmallMs,
+                    stats.meanLargeMs);
+    }
+
+    scheduler.shutdown();
+    balancer.shutdown();
+    return 0;
+}
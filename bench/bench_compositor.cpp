@@ -0,0 +1,181 @@
+// Display composition cost per frame: camera frames fitted into typical
+// display sizes with 20 boxes drawn. Compares a straightforward per-pixel
+// area/bilinear resampler that derives its weights for every pixel, the
+// scaler's portable loops and its SSE2 loops, and checks that all three
+// produce the same image.
+// Usage: bench_compositor [frames]
+#include "frame_compositor.h"
+#include "image_scaler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Case {
+    int sourceWidth;
+    int sourceHeight;
+    int width;
+    int height;
+};
+
+const Case kCases[] = {
+    {1280, 720, 880, 495},      // 720p camera in the default window
+    {1920, 1080, 880, 495},
+    {1920, 1080, 1600, 900},    // Maximised on a 1080p screen
+    {640, 480, 880, 660},       // VGA camera, enlarged
+};
+
+std::vector<uint8_t> makeFrame(int width, int height)
+{
+    // Gradients plus noise, so the filter has detail to average
+    std::mt19937 rng(7);
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint8_t* p = &pixels[(static_cast<size_t>(y) * width + x) * 4];
+            p[0] = static_cast<uint8_t>((x * 255) / width);
+            p[1] = static_cast<uint8_t>((y * 255) / height);
+            p[2] = static_cast<uint8_t>(rng() & 0xFF);
+            p[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+// Weights of one output pixel along one axis, derived on the spot
+void pixelWeights(int i, int sourceSize, int size, std::vector<std::pair<int, double>>& weights)
+{
+    weights.clear();
+    double ratio = static_cast<double>(sourceSize) / size;
+    if (ratio >= 1.0) {
+        double begin = i * ratio;
+        double end = (i + 1) * ratio;
+        for (int j = static_cast<int>(begin); j < sourceSize && j < end; ++j) {
+            double covered = std::min<double>(end, j + 1) - std::max<double>(begin, j);
+            if (covered > 0.0) {
+                weights.push_back({j, covered / ratio});
+            }
+        }
+    } else {
+        double center = std::clamp((i + 0.5) * ratio - 0.5, 0.0, sourceSize - 1.0);
+        int left = static_cast<int>(center);
+        int right = std::min(left + 1, sourceSize - 1);
+        weights.push_back({left, 1.0 - (center - left)});
+        weights.push_back({right, center - left});
+    }
+}
+
+void naiveScale(const ImageView& source, uint8_t* out, int width, int height)
+{
+    std::vector<std::pair<int, double>> columns;
+    std::vector<std::pair<int, double>> rows;
+    for (int y = 0; y < height; ++y) {
+        pixelWeights(y, source.height, height, rows);
+        for (int x = 0; x < width; ++x) {
+            pixelWeights(x, source.width, width, columns);
+            for (int c = 0; c < 4; ++c) {
+                double sum = 0.0;
+                for (const auto& row : rows) {
+                    const uint8_t* line = source.pixels + static_cast<size_t>(row.first) * source.stride;
+                    for (const auto& column : columns) {
+                        sum += row.second * column.second * line[column.first * 4 + c];
+                    }
+                }
+                out[(static_cast<size_t>(y) * width + x) * 4 + c] =
+                    static_cast<uint8_t>(std::clamp(static_cast<int>(sum + 0.5), 0, 255));
+            }
+        }
+    }
+}
+
+int maxDifference(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b)
+{
+    int worst = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        worst = std::max(worst, std::abs(a[i] - b[i]));
+    }
+    return worst;
+}
+
+std::vector<Detection> makeDetections(int width, int height)
+{
+    std::vector<Detection> detections(20);
+    for (size_t i = 0; i < detections.size(); ++i) {
+        Detection& detection = detections[i];
+        detection.className = "object";
+        detection.classId = static_cast<int>(i);
+        detection.confidence = 0.8;
+        detection.bbox = {static_cast<int>(i * width / 24), static_cast<int>(i * height / 30), width / 6, height / 5};
+    }
+    return detections;
+}
+}
+
+int main(int argc, char** argv)
+{
+    int frames = argc > 1 ? std::atoi(argv[1]) : 200;
+    if (frames <= 0) frames = 200;
+
+    std::printf("SSE2 available: %s\n\n", ImageScaler::hasSimd() ? "yes" : "no");
+    std::printf("%-22s %10s %10s %10s %10s %8s\n", "case", "naive ms", "scalar ms", "simd ms", "compose ms",
+                "max diff");
+
+    for (const Case& c : kCases) {
+        std::vector<uint8_t> source = makeFrame(c.sourceWidth, c.sourceHeight);
+        ImageView view = {source.data(), c.sourceWidth, c.sourceHeight, c.sourceWidth * 4};
+        int stride = c.width * 4;
+        std::vector<uint8_t> naive(static_cast<size_t>(stride) * c.height);
+        std::vector<uint8_t> scalar(naive.size());
+        std::vector<uint8_t> simd(naive.size());
+
+        // The reference is slow; a few frames give a stable figure
+        int naiveFrames = std::max(1, frames / 20);
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < naiveFrames; ++i) {
+            naiveScale(view, naive.data(), c.width, c.height);
+        }
+        double naiveMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / naiveFrames;
+
+        ImageScaler scaler;
+        scaler.setSimdEnabled(false);
+        start = Clock::now();
+        for (int i = 0; i < frames; ++i) {
+            scaler.scale(view, scalar.data(), c.width, c.height, stride);
+        }
+        double scalarMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+
+        scaler.setSimdEnabled(true);
+        start = Clock::now();
+        for (int i = 0; i < frames; ++i) {
+            scaler.scale(view, simd.data(), c.width, c.height, stride);
+        }
+        double simdMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+
+        // The whole display path: fit, borders, boxes and the buffer swap
+        FrameCompositor compositor;
+        compositor.setOutputSize(c.width, c.height);
+        std::vector<Detection> detections = makeDetections(c.sourceWidth, c.sourceHeight);
+        for (int i = 0; i < frames; ++i) {
+            compositor.compose(view, detections);
+        }
+        CompositorStats stats = compositor.getStats();
+
+        int difference = std::max(maxDifference(naive, scalar), maxDifference(naive, simd));
+        char label[32];
+        std::snprintf(label, sizeof(label), "%dx%d -> %dx%d", c.sourceWidth, c.sourceHeight, c.width, c.height);
+        std::printf("%-22s %10.2f %10.2f %10.2f %10.2f %8d\n", label, naiveMs, scalarMs, simdMs,
+                    stats.meanComposeMs, difference);
+        if (stats.scaler.coefficientBuilds != 1) {
+            std::printf("  unexpected: %llu coefficient builds\n",
+                        static_cast<unsigned long long>(stats.scaler.coefficientBuilds));
+        }
+    }
+    return 0;
+}
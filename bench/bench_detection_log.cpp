@@ -0,0 +1,124 @@
+// Append and query throughput of the detection log.
+// Usage: bench_detection_log [rows] [directory]
+#include "detection_log.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+const int kStreams = 8;
+const int kClasses = 80;
+const size_t kRowsPerResult = 16;
+const int64_t kRowIntervalUs = 100;    // 10k detections per second across all streams
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000000ull;
+    std::string directory = argc > 2 ? argv[2]
+        : (std::filesystem::temp_directory_path() / "bench_detection_log").string();
+
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+
+    DetectionLog log(directory);
+    if (!log.open()) {
+        std::fprintf(stderr, "Cannot open log in %s\n", directory.c_str());
+        return 1;
+    }
+
+    // Results of a few detections each, as the pipeline appends them
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> classDist(0, kClasses - 1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<DetectionRecord> batch(kRowsPerResult);
+    const int64_t startUs = 1700000000000000;
+
+    Clock::time_point start = Clock::now();
+    for (uint64_t row = 0; row < rows; row += kRowsPerResult) {
+        size_t count = static_cast<size_t>(std::min<uint64_t>(kRowsPerResult, rows - row));
+        for (size_t i = 0; i < count; ++i) {
+            DetectionRecord& record = batch[i];
+            record.timestampUs = startUs + static_cast<int64_t>(row + i) * kRowIntervalUs;
+            record.streamId = static_cast<int32_t>((row / kRowsPerResult) % kStreams);
+            int classId = classDist(rng);
+            record.classId = static_cast<int16_t>(classId < kClasses / 4 ? 0 : classId);   // Skewed towards class 0
+            record.confidence = 0.25f + 0.75f * unit(rng);
+            record.x = 640.0f * unit(rng);
+            record.y = 480.0f * unit(rng);
+            record.width = 10.0f + 200.0f * unit(rng);
+            record.height = 10.0f + 200.0f * unit(rng);
+        }
+        log.append(batch.data(), count);
+    }
+    double appendSeconds = secondsSince(start);
+    DetectionLogStats stats = log.getStats();
+    std::printf("append:     %llu rows in %.2f s = %.1f M rows/s (%zu segments, %.0f MB)\n",
+                static_cast<unsigned long long>(stats.rows), appendSeconds, stats.rows / appendSeconds / 1e6,
+                stats.segments, stats.bytesMapped / 1048576.0);
+
+    int64_t endUs = startUs + static_cast<int64_t>(rows) * kRowIntervalUs;
+    auto runQuery = [&](const char* name, const DetectionQuery& query, int classId, bool aggregated) {
+        Clock::time_point queryStart = Clock::now();
+        uint64_t matches = 0;
+        size_t windows = 0;
+        if (aggregated) {
+            std::vector<WindowAggregate> result = log.aggregate(query);
+            windows = result.size();
+            for (const WindowAggregate& window : result) {
+                for (const ClassAggregate& aggregate : window.classes) {
+                    matches += aggregate.count;
+                }
+            }
+        } else {
+            matches = log.count(query, classId);
+        }
+        double seconds = secondsSince(queryStart);
+        double spanRows = static_cast<double>(std::min(query.toUs, endUs) - std::max(query.fromUs, startUs)) / kRowIntervalUs;
+        std::printf("%-11s %llu matches, %zu windows in %.3f s = %.0f M rows/s over the window\n",
+                    name, static_cast<unsigned long long>(matches), windows, seconds, spanRows / seconds / 1e6);
+    };
+
+    DetectionQuery all;
+    all.fromUs = startUs;
+    all.toUs = endUs;
+    runQuery("count:", all, kAnyClass, false);
+
+    DetectionQuery people = all;
+    people.streamId = 3;
+    people.minConfidence = 0.5f;
+    runQuery("class 0:", people, 0, false);
+
+    // "How many people per minute on camera 3", over the whole log and over one hour
+    DetectionQuery perMinute = people;
+    perMinute.windowUs = 60ll * 1000000;
+    runQuery("per-minute:", perMinute, kAnyClass, true);
+
+    DetectionQuery lastHour = perMinute;
+    lastHour.fromUs = std::max<int64_t>(startUs, endUs - 3600ll * 1000000);
+    runQuery("last hour:", lastHour, kAnyClass, true);
+
+    // Reopening maps the existing segments without reading them
+    log.close();
+    start = Clock::now();
+    DetectionLog reopened(directory);
+    reopened.open();
+    std::printf("reopen:     %llu rows in %.3f s\n",
+                static_cast<unsigned long long>(reopened.getStats().rows), secondsSince(start));
+    reopened.close();
+
+    std::filesystem::remove_all(directory, ec);
+    return 0;
+}
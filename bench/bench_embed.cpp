@@ -0,0 +1,113 @@
+// Embedding: the cost of handing a caller's frame to a worker, per frame,
+// up to the request line being ready to write. "jpeg file" encodes the frame
+// and writes it to a file the worker decodes, as a caller without a pixel
+// interface would; "shared" stages the rows in a SharedPixelPool slot the
+// worker maps, as the C API does for local workers; "inline" encodes the
+// rows into the request, as it does for remote workers.
+// Usage: bench_embed [--width W] [--height H] [--frames F]
+#include "shared_pixels.h"
+#include "worker_protocol.h"
+#include "jpeg_encoder.h"
+#include "frame_arena.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    int width = 1280;
+    int height = 720;
+    int frames = 100;
+};
+
+void run(const char* name, int frames, const std::function<size_t(int)>& handOff)
+{
+    size_t requestBytes = 0;
+    Clock::time_point start = Clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        requestBytes = handOff(frame);
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+    std::printf("%-10s %10.3f %14zu\n", name, ms, requestBytes);
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--width") && i + 1 < argc) options.width = std::max(16, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--height") && i + 1 < argc) options.height = std::max(16, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--frames") && i + 1 < argc) options.frames = std::max(1, std::atoi(argv[++i]));
+    }
+
+    // A BGRA frame with padded rows, as a capture API hands them out
+    int stride = options.width * 4 + 64;
+    std::vector<uint8_t> frame(static_cast<size_t>(stride) * options.height);
+    for (int y = 0; y < options.height; ++y) {
+        for (int x = 0; x < stride; ++x) {
+            frame[static_cast<size_t>(y) * stride + x] = static_cast<uint8_t>((x * 3 + y * 5) & 0xFF);
+        }
+    }
+    PixelImage pixels;
+    pixels.data = frame.data();
+    pixels.width = options.width;
+    pixels.height = options.height;
+    pixels.stride = stride;
+    pixels.format = PixelFormat::Bgra;
+
+    DetectionRequest base;
+    base.confidenceThreshold = 0.5;
+    base.iouThreshold = 0.45;
+    base.modelName = "yolov5s";
+    base.saveAnnotated = false;
+
+    ArenaPool arenas(8 << 20);
+    std::printf("%dx%d BGRA, %d frames\n", options.width, options.height, options.frames);
+    std::printf("%-10s %10s %14s\n", "hand-off", "ms/frame", "request bytes");
+
+    JpegEncoder encoder(90);
+    std::string jpeg;
+    std::filesystem::path file = std::filesystem::temp_directory_path() / "bench_embed_frame.jpg";
+    run("jpeg file", options.frames, [&](int) {
+        encoder.encode({frame.data(), options.width, options.height, stride}, jpeg);
+        std::ofstream(file, std::ios::binary).write(jpeg.data(), static_cast<std::streamsize>(jpeg.size()));
+        DetectionRequest request = base;
+        request.imagePath = file.string();
+        auto arena = arenas.acquire();
+        std::pmr::string line(arena->resource());
+        appendWorkerRequest(line, request);
+        return line.size();
+    });
+    std::filesystem::remove(file);
+
+    SharedPixelPool pool("", 2);
+    run("shared", options.frames, [&](int) {
+        PixelLease staged = pool.stage(pixels);
+        DetectionRequest request = base;
+        request.pixels = *staged;
+        auto arena = arenas.acquire();
+        std::pmr::string line(arena->resource());
+        appendWorkerRequest(line, request);
+        return line.size();
+    });
+
+    run("inline", options.frames, [&](int) {
+        DetectionRequest request = base;
+        request.pixels = pixels;
+        auto arena = arenas.acquire();
+        std::pmr::string line(arena->resource());
+        appendWorkerRequest(line, request);
+        return line.size();
+    });
+    return 0;
+}
@@ -0,0 +1,229 @@
+// Heap allocations per frame on the local worker path: request line built,
+// written to a persistent worker, responses read and parsed, as
+// DetectionClient::runBatch does, first directly and then through the
+// scheduler. The worker is this program started with --fake-worker, which
+// answers every request with a canned result of the given size.
+// Usage: bench_frame_alloc [--detections N] [--batch B] [--frames F] [--no-arena]
+#include "worker_process.h"
+#include "worker_protocol.h"
+#include "frame_arena.h"
+#include "detection_scheduler.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+std::atomic<unsigned long long> g_allocations(0);
+
+using Clock = std::chrono::steady_clock;
+
+const char* const kClassNames[] = {"person", "car", "traffic light", "bicycle", "dog", "cell phone", "motorcycle", "chair"};
+
+int runFakeWorker(int detections)
+{
+    std::string response = "{\"success\":true,\"detections\":[";
+    for (int i = 0; i < detections; ++i) {
+        if (i > 0) response += ",";
+        response += "{\"class\":\"" + std::string(kClassNames[i % 8]) + "\",\"class_id\":" + std::to_string(i) +
+                    ",\"confidence\":0.8734,\"bbox\":[101.25,57.5,88.75,201.0]}";
+    }
+    response += "],\"letterbox\":{\"source_width\":1280,\"source_height\":720,\"input_width\":640,"
+                "\"input_height\":384,\"scale_x\":0.5,\"scale_y\":0.5,\"pad_x\":0,\"pad_y\":12},"
+                "\"processing_time\":23,\"model_load_ms\":0,\"model_used\":\"yolov5s\"}\n";
+
+    std::ios::sync_with_stdio(false);
+    std::string request;
+    while (std::getline(std::cin, request)) {
+        for (size_t pos = 0; (pos = request.find("\"image_path\"", pos)) != std::string::npos; ++pos) {
+            std::cout << response;
+        }
+        std::cout.flush();
+    }
+    return 0;
+}
+
+// One batch round trip; the line is built the pre-arena way when arenas is null
+class BatchRunner {
+public:
+    BatchRunner(WorkerProcess& worker, ArenaPool* arenas) : m_worker(worker), m_arenas(arenas) {}
+
+    std::vector<DetectionResult> run(const std::vector<DetectionRequest>& requests)
+    {
+        bool written;
+        if (m_arenas) {
+            ArenaPool::Lease arena = m_arenas->acquire();
+            std::pmr::string line(arena->resource());
+            appendBatchRequest(line, requests);
+            written = m_worker.writeLine(line);
+        } else {
+            std::string line = "{\"batch\":[";
+            for (size_t i = 0; i < requests.size(); ++i) {
+                if (i > 0) line += ",";
+                line += createWorkerRequest(requests[i]);
+            }
+            line += "]}";
+            written = m_worker.writeLine(line);
+        }
+
+        std::vector<DetectionResult> results;
+        results.reserve(requests.size());
+        Clock::time_point deadline = Clock::now() + std::chrono::seconds(10);
+        std::string response;
+        while (written && results.size() < requests.size()) {
+            if (m_worker.readLineUntil(response, deadline) != WorkerProcess::ReadStatus::Line) {
+                break;
+            }
+            results.push_back(parseWorkerResponse(response));
+        }
+        return results;
+    }
+
+private:
+    WorkerProcess& m_worker;
+    ArenaPool* m_arenas;
+};
+}
+
+void* operator new(size_t size)
+{
+    g_allocations++;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 2 && !std::strcmp(argv[1], "--fake-worker")) {
+        return runFakeWorker(std::atoi(argv[2]));
+    }
+
+    int detections = 5;
+    size_t batchSize = 1;
+    int frames = 5000;
+    bool useArena = true;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--detections") && i + 1 < argc) {
+            detections = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--batch") && i + 1 < argc) {
+            batchSize = static_cast<size_t>(std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--no-arena")) {
+            useArena = false;
+        }
+    }
+    if (batchSize == 0 || frames <= 0) {
+        std::fprintf(stderr, "Usage: %s [--detections N] [--batch B] [--frames F] [--no-arena]\n", argv[0]);
+        return 1;
+    }
+
+    WorkerProcess worker;
+    if (!worker.start("\"" + std::string(argv[0]) + "\" --fake-worker " + std::to_string(detections))) {
+        std::fprintf(stderr, "Cannot start fake worker\n");
+        return 1;
+    }
+    ArenaPool arenas;
+    BatchRunner runner(worker, useArena ? &arenas : nullptr);
+
+    // A typical spooled webcam frame
+    DetectionRequest request;
+    request.imagePath = "C:\\Users\\operator\\AppData\\Local\\Temp\\yolo_frames\\cam0\\slot_3.jpg";
+    request.confidenceThreshold = 0.5;
+    request.iouThreshold = 0.45;
+    request.modelName = "yolov5s";
+    request.saveAnnotated = false;
+    std::vector<DetectionRequest> batch(batchSize, request);
+
+    std::printf("%d detections/frame, batch %zu, %s\n", detections, batchSize, useArena ? "arenas" : "no arenas");
+
+    // Warm up so buffers and arenas have reached their steady size
+    const int warmup = 100;
+    size_t answered = 0;
+    unsigned long long before = 0;
+    Clock::time_point start;
+    for (int i = 0; i < warmup + frames; ++i) {
+        if (i == warmup) {
+            before = g_allocations;
+            start = Clock::now();
+        }
+        answered += runner.run(batch).size();
+    }
+    unsigned long long allocations = g_allocations - before;
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::printf("  protocol:  %.2f allocations/frame, %.1f us/frame\n",
+                static_cast<double>(allocations) / (static_cast<double>(frames) * batchSize),
+                seconds * 1e6 / (static_cast<double>(frames) * batchSize));
+    if (answered != (warmup + static_cast<size_t>(frames)) * batchSize) {
+        std::fprintf(stderr, "Worker answered %zu of %zu requests\n", answered,
+                     (warmup + static_cast<size_t>(frames)) * batchSize);
+        return 1;
+    }
+
+    // Whole frames through the scheduler: submit, queue, batch, callback
+    DetectionScheduler scheduler(
+        [&runner](int, const std::vector<DetectionRequest>& requests) { return runner.run(requests); },
+        1, batchSize);
+    scheduler.addStream(0, 1.0, batchSize, DetectionPriority::Bulk);
+
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t completed = 0;
+    auto onComplete = [&](const DetectionResult&) {
+        std::lock_guard<std::mutex> lock(mutex);
+        completed++;
+        done.notify_one();
+    };
+    auto onError = [&](const std::string&) {
+        std::lock_guard<std::mutex> lock(mutex);
+        completed++;
+        done.notify_one();
+    };
+
+    size_t submitted = 0;
+    for (int i = 0; i < warmup + frames; ++i) {
+        if (i == warmup) {
+            before = g_allocations;
+            start = Clock::now();
+        }
+        for (size_t j = 0; j < batchSize; ++j) {
+            scheduler.submit(0, request, onComplete, onError);
+        }
+        submitted += batchSize;
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&]() { return completed == submitted; });
+    }
+    allocations = g_allocations - before;
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::printf("  scheduler: %.2f allocations/frame, %.1f us/frame\n",
+                static_cast<double>(allocations) / (static_cast<double>(frames) * batchSize),
+                seconds * 1e6 / (static_cast<double>(frames) * batchSize));
+
+    scheduler.shutdown();
+    if (useArena) {
+        ArenaPoolStats stats = arenas.getStats();
+        std::printf("  arenas: %zu created for %llu leases, %llu overflowed, largest %zu bytes\n", stats.arenas,
+                    static_cast<unsigned long long>(stats.leases), static_cast<unsigned long long>(stats.overflows),
+                    stats.largestArena);
+    }
+    return 0;
+}
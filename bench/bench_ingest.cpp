@@ -0,0 +1,253 @@
+// Bulk directory ingest: read throughput and queue occupancy of one file at
+// a time, the thread pool and io_uring, then a bulk job through the
+// scheduler with workers reading each image by path after dispatch (as
+// before) against images read ahead by ingest and sent inline.
+// Detection is a stub that holds a worker for --infer-ms per image, or real
+// workers with --remote (detection_server.py --serve --listen HOST:PORT).
+// --evict drops the files from the page cache before each run, so reads hit
+// storage; --make N first writes N synthetic files of --size-kb each.
+// Usage: bench_ingest <directory> [--make N] [--size-kb K] [--depth D] [--buffers B] [--evict]
+//                     [--infer-ms MS] [--workers W] [--batch B] [--remote host:port,...]
+#include "bulk_ingest.h"
+#include "detection_scheduler.h"
+#include "worker_balancer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string directory;
+    int make = 0;
+    int sizeKb = 200;
+    size_t depth = 32;
+    size_t buffers = 64;
+    bool evict = false;
+    double inferMs = 5.0;
+    int workers = 2;
+    size_t batch = 4;
+    std::string remote;
+};
+
+void makeFiles(const Options& options)
+{
+    std::filesystem::create_directories(options.directory);
+    std::mt19937 rng(11);
+    std::string bytes(static_cast<size_t>(options.sizeKb) * 1024, '\0');
+    for (int i = 0; i < options.make; ++i) {
+        for (char& c : bytes) {
+            c = static_cast<char>(rng());
+        }
+        char name[32];
+        std::snprintf(name, sizeof(name), "/img_%06d.jpg", i);
+        std::ofstream(options.directory + name, std::ios::binary).write(bytes.data(), bytes.size());
+    }
+}
+
+void evictFromCache(const std::vector<std::string>& paths)
+{
+#ifndef _WIN32
+    for (const std::string& path : paths) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            fdatasync(fd);
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+#else
+    (void)paths;
+#endif
+}
+
+void printIngest(const char* label, const BulkIngestStats& stats)
+{
+    std::printf("%-14s %-9s %8.1f %8.0f %9.1f %6zu %9.2f %8llu\n", label, stats.backend.c_str(),
+                stats.megabytesPerSecond, stats.filesPerSecond, stats.meanInFlight, stats.peakInFlight,
+                stats.meanReadMs, static_cast<unsigned long long>(stats.failures));
+}
+
+BulkIngestStats readOnly(const Options& options, const std::vector<std::string>& paths, BulkIngestConfig config)
+{
+    if (options.evict) {
+        evictFromCache(paths);
+    }
+    BulkIngest ingest(config);
+    return ingest.run(paths, [](IngestedImage&&) {});
+}
+
+// A stand-in worker: reads the image itself when it was not sent along,
+// then holds the worker for the inference time
+std::vector<DetectionResult> stubBatch(const std::vector<DetectionRequest>& batch, double inferMs)
+{
+    std::vector<DetectionResult> results;
+    for (const DetectionRequest& request : batch) {
+        DetectionResult result;
+        result.processingTime = 0;
+        result.success = true;
+        if (!request.imageData) {
+            std::ifstream file(request.imagePath, std::ios::binary);
+            std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            result.success = !bytes.empty();
+        }
+        results.push_back(result);
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(inferMs * batch.size()));
+    return results;
+}
+
+struct JobResult {
+    double seconds = 0.0;
+    int completed = 0;
+    int failed = 0;
+};
+
+JobResult runJob(const Options& options, const std::vector<std::string>& paths, bool ahead,
+                 BulkIngestStats* ingestStats)
+{
+    if (options.evict) {
+        evictFromCache(paths);
+    }
+    std::unique_ptr<WorkerBalancer> balancer;
+    if (!options.remote.empty()) {
+        balancer = std::make_unique<WorkerBalancer>(WorkerBalancer::parseEndpoints(options.remote));
+    }
+    double inferMs = options.inferMs;
+    DetectionScheduler scheduler(
+        [&balancer, inferMs](int workerIndex, const std::vector<DetectionRequest>& batch) {
+            return balancer ? balancer->runBatch(workerIndex, batch) : stubBatch(batch, inferMs);
+        },
+        options.workers, options.batch);
+    // Ingest's buffers bound what is queued; by path everything is queued at once
+    scheduler.addStream(0, 1.0, paths.size(), DetectionPriority::Bulk);
+
+    std::atomic<int> completed(0);
+    std::atomic<int> failed(0);
+    auto submit = [&](const std::string& path, std::shared_ptr<const std::string> bytes) {
+        DetectionRequest request;
+        request.imagePath = path;
+        request.imageData = std::move(bytes);
+        request.confidenceThreshold = 0.5;
+        request.iouThreshold = 0.45;
+        request.modelName = "yolov5s";
+        request.saveAnnotated = false;
+        scheduler.submit(0, request,
+            [&](const DetectionResult& result) { (result.success ? completed : failed)++; },
+            [&](const std::string&) { failed++; });
+    };
+
+    Clock::time_point start = Clock::now();
+    if (ahead) {
+        BulkIngestConfig config;
+        config.queueDepth = options.depth;
+        config.buffers = options.buffers;
+        BulkIngest ingest(config);
+        *ingestStats = ingest.run(paths, [&](IngestedImage&& image) {
+            if (image.bytes) {
+                submit(image.path, std::move(image.bytes));
+            } else {
+                failed++;
+            }
+        });
+    } else {
+        for (const std::string& path : paths) {
+            submit(path, nullptr);
+        }
+    }
+    while (completed + failed < static_cast<int>(paths.size())) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    JobResult result;
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.completed = completed;
+    result.failed = failed;
+    scheduler.shutdown();
+    if (balancer) {
+        balancer->shutdown();
+    }
+    return result;
+}
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <directory> [--make N] [--size-kb K] [--depth D] [--buffers B] [--evict]\n"
+                             "          [--infer-ms MS] [--workers W] [--batch B] [--remote host:port,...]\n", argv[0]);
+        return 1;
+    }
+    Options options;
+    options.directory = argv[1];
+    for (int i = 2; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--make") && i + 1 < argc) options.make = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--size-kb") && i + 1 < argc) options.sizeKb = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--depth") && i + 1 < argc) options.depth = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--buffers") && i + 1 < argc) options.buffers = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--evict")) options.evict = true;
+        else if (!std::strcmp(argv[i], "--infer-ms") && i + 1 < argc) options.inferMs = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--workers") && i + 1 < argc) options.workers = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--batch") && i + 1 < argc) options.batch = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--remote") && i + 1 < argc) options.remote = argv[++i];
+    }
+
+    if (options.make > 0) {
+        makeFiles(options);
+    }
+    std::vector<std::string> paths = BulkIngest::listImages(options.directory);
+    if (paths.empty()) {
+        std::fprintf(stderr, "No images in %s\n", options.directory.c_str());
+        return 1;
+    }
+    std::printf("%zu images in %s, queue depth %zu, %zu buffers%s\n\n", paths.size(), options.directory.c_str(),
+                options.depth, options.buffers, options.evict ? ", page cache evicted before each run" : "");
+
+    std::printf("%-14s %-9s %8s %8s %9s %6s %9s %8s\n", "reads", "backend", "MB/s", "files/s", "in flight", "peak",
+                "read ms", "failed");
+    BulkIngestConfig oneAtATime;
+    oneAtATime.queueDepth = 1;
+    oneAtATime.buffers = 1;
+    oneAtATime.useIoUring = false;
+    printIngest("one at a time", readOnly(options, paths, oneAtATime));
+
+    BulkIngestConfig config;
+    config.queueDepth = options.depth;
+    config.buffers = options.buffers;
+    config.useIoUring = false;
+    printIngest("thread pool", readOnly(options, paths, config));
+    config.useIoUring = true;
+    printIngest("io_uring", readOnly(options, paths, config));
+
+    char inference[64];
+    std::snprintf(inference, sizeof(inference), "stub inference %.1f ms/image", options.inferMs);
+    std::printf("\nbulk job: %d workers, batch <= %zu, %s\n", options.workers, options.batch,
+                options.remote.empty() ? inference : options.remote.c_str());
+    JobResult byPath = runJob(options, paths, false, nullptr);
+    BulkIngestStats ingestStats = BulkIngestStats();
+    JobResult ahead = runJob(options, paths, true, &ingestStats);
+    std::printf("  read by worker  %7.2f s  %7.1f images/s  (%d done, %d failed)\n", byPath.seconds,
+                paths.size() / byPath.seconds, byPath.completed, byPath.failed);
+    std::printf("  ingest ahead    %7.2f s  %7.1f images/s  (%d done, %d failed)\n", ahead.seconds,
+                paths.size() / ahead.seconds, ahead.completed, ahead.failed);
+    std::printf("  ingest: %s, %.1f MB/s, %.1f reads in flight on average (peak %zu), %llu waits for a buffer, "
+                "%zu buffers up to %zu KB\n", ingestStats.backend.c_str(), ingestStats.megabytesPerSecond,
+                ingestStats.meanInFlight, ingestStats.peakInFlight,
+                static_cast<unsigned long long>(ingestStats.bufferWaits), ingestStats.buffers,
+                ingestStats.largestBuffer / 1024);
+    return 0;
+}
@@ -0,0 +1,144 @@
+// Interactive stills against saturated workers: cameras keep the workers
+// busy while a still is opened every --still-ms, and the scheduler caps
+// camera batches at each --limits value while the interactive stream is
+// registered. Reports how long stills waited for a worker and what the
+// cameras got. The stub worker takes --infer-ms for a batch's first frame
+// and --marginal of that for each further frame, as batched inference does.
+// Usage: bench_interactive [--cameras N] [--workers N] [--batch B] [--limits 8,2,1]
+//                          [--infer-ms MS] [--marginal F] [--still-ms MS] [--seconds S]
+#include "detection_scheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    int cameras = 4;
+    int workers = 1;
+    size_t batch = 8;
+    std::vector<int> limits = {8, 2, 1};
+    double inferMs = 40.0;
+    double marginal = 0.6;
+    int stillMs = 500;
+    double seconds = 10.0;
+};
+
+const int kStillStream = -1;
+const auto kCameraPeriod = std::chrono::milliseconds(33);
+
+std::vector<int> parseList(const char* text)
+{
+    std::vector<int> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        values.push_back(std::max(1, std::atoi(item.c_str())));
+    }
+    return values;
+}
+
+void run(const Options& options, size_t limit)
+{
+    DetectionScheduler scheduler(
+        [&options](int, const std::vector<DetectionRequest>& batch) {
+            double ms = options.inferMs * (1.0 + options.marginal * static_cast<double>(batch.size() - 1));
+            std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms));
+            std::vector<DetectionResult> results(batch.size());
+            for (DetectionResult& result : results) {
+                result.success = true;
+                result.processingTime = static_cast<int>(options.inferMs);
+            }
+            return results;
+        },
+        options.workers, options.batch);
+    scheduler.addStream(kStillStream, 1.0, 4, DetectionPriority::Interactive);
+    scheduler.setInteractiveBatchLimit(limit);
+    for (int camera = 0; camera < options.cameras; ++camera) {
+        scheduler.addStream(camera, 1.0, 4);
+    }
+
+    DetectionRequest request;
+    request.modelName = "yolov5s";
+    request.imagePath = "frame.jpg";
+
+    std::atomic<bool> running(true);
+    std::thread cameras([&]() {
+        Clock::time_point next = Clock::now();
+        while (running) {
+            for (int camera = 0; camera < options.cameras; ++camera) {
+                scheduler.submit(camera, request, nullptr, nullptr);
+            }
+            next += kCameraPeriod;
+            std::this_thread::sleep_until(next);
+        }
+    });
+
+    Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.seconds));
+    // The first second fills the queues
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    while (Clock::now() < end) {
+        scheduler.submit(kStillStream, request, nullptr, nullptr);
+        std::this_thread::sleep_for(std::chrono::milliseconds(options.stillMs));
+    }
+    running = false;
+    cameras.join();
+
+    double cameraFps = 0.0;
+    double batchSum = 0.0;
+    StreamStats still = {};
+    std::vector<StreamStats> streams = scheduler.getStreamStats();
+    for (const StreamStats& stats : streams) {
+        if (stats.streamId == kStillStream) {
+            still = stats;
+        } else {
+            cameraFps += stats.fps;
+            batchSum += stats.meanBatchSize;
+        }
+    }
+    scheduler.shutdown();
+    std::printf("%5zu %11.0f %10.0f %14.0f %11.1f %10.1f\n", limit, still.meanWaitMs, still.maxWaitMs,
+                still.meanLatencyMs, cameraFps, batchSum / std::max(1, options.cameras));
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        const char* value = argv[i + 1];
+        if (name == "--cameras") options.cameras = std::max(1, std::atoi(value));
+        else if (name == "--workers") options.workers = std::max(1, std::atoi(value));
+        else if (name == "--batch") options.batch = static_cast<size_t>(std::max(1, std::atoi(value)));
+        else if (name == "--limits") options.limits = parseList(value);
+        else if (name == "--infer-ms") options.inferMs = std::max(1.0, std::atof(value));
+        else if (name == "--marginal") options.marginal = std::max(0.0, std::atof(value));
+        else if (name == "--still-ms") options.stillMs = std::max(10, std::atoi(value));
+        else if (name == "--seconds") options.seconds = std::max(2.0, std::atof(value));
+        else {
+            std::fprintf(stderr, "Usage: %s [--cameras N] [--workers N] [--batch B] [--limits 8,2,1]\n"
+                                 "          [--infer-ms MS] [--marginal F] [--still-ms MS] [--seconds S]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::printf("%d cameras at 30 fps on %d worker(s), batches up to %zu, %.0f ms per inference "
+                "(+%.0f%% per extra frame), a still every %d ms\n\n", options.cameras, options.workers,
+                options.batch, options.inferMs, options.marginal * 100.0, options.stillMs);
+    std::printf("%5s %11s %10s %14s %11s %10s\n", "limit", "still wait", "max wait", "still latency",
+                "camera fps", "mean batch");
+    for (int limit : options.limits) {
+        run(options, static_cast<size_t>(limit));
+    }
+    return 0;
+}
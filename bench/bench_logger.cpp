@@ -0,0 +1,161 @@
+// Logging cost on the calling thread: a log call timed one by one, with
+// records going to a file. "stream sync" writes and flushes a std::ofstream
+// per record, as std::cerr << ... << std::endl does; "stdio sync" is
+// fprintf + fflush; "async" hands the record to Logger; "rate limited" and
+// "filtered" are calls Logger turns away at the rate limit and the level.
+// Producers log in bursts of --burst records, then pause 1 ms, as a capture
+// loop would.
+// Usage: bench_logger [--calls N] [--threads 1,4] [--burst B] [--output path]
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    int calls = 20000;
+    std::vector<int> threads = {1, 4};
+    int burst = 50;
+    std::string output = (std::filesystem::temp_directory_path() / "bench_logger.log").string();
+};
+
+// One producer's call; returns after the record is handed off
+using LogCall = std::function<void(int thread, int call)>;
+
+void run(const char* name, const Options& options, int threads, const LogCall& call,
+         const std::function<uint64_t()>& dropped = nullptr)
+{
+    std::vector<std::vector<double>> latencies(threads);
+    std::vector<std::thread> producers;
+    Clock::time_point start = Clock::now();
+    for (int t = 0; t < threads; ++t) {
+        producers.emplace_back([&, t]() {
+            std::vector<double>& samples = latencies[t];
+            samples.reserve(options.calls);
+            for (int i = 0; i < options.calls; ++i) {
+                Clock::time_point before = Clock::now();
+                call(t, i);
+                samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - before).count());
+                if ((i + 1) % options.burst == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        });
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> all;
+    for (const auto& samples : latencies) {
+        all.insert(all.end(), samples.begin(), samples.end());
+    }
+    std::sort(all.begin(), all.end());
+    double mean = 0.0;
+    for (double value : all) {
+        mean += value;
+    }
+    mean /= all.size();
+    auto percentile = [&all](double p) { return all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))]; };
+    std::printf("%-13s %7d %10.0f %9.0f %9.0f %11.0f %9.2f %8llu\n", name, threads, mean, percentile(0.5),
+                percentile(0.99), all.back(), elapsed,
+                static_cast<unsigned long long>(dropped ? dropped() : 0));
+}
+
+std::vector<int> parseList(const char* text)
+{
+    std::vector<int> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        values.push_back(std::max(1, std::atoi(item.c_str())));
+    }
+    return values;
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--calls") && i + 1 < argc) options.calls = std::max(100, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) options.threads = parseList(argv[++i]);
+        else if (!std::strcmp(argv[i], "--burst") && i + 1 < argc) options.burst = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--output") && i + 1 < argc) options.output = argv[++i];
+    }
+
+    std::printf("%d calls per thread in bursts of %d, to %s\n", options.calls, options.burst, options.output.c_str());
+    std::printf("%-13s %7s %10s %9s %9s %11s %9s %8s\n", "logging", "threads", "mean ns", "p50 ns", "p99 ns",
+                "max ns", "seconds", "dropped");
+    const char* path = "/frames/camera_0/slot_3.jpg";
+
+    for (int threads : options.threads) {
+        {
+            std::ofstream stream(options.output, std::ios::trunc);
+            std::mutex mutex;   // std::cerr is shared the same way
+            run("stream sync", options, threads, [&](int thread, int call) {
+                std::lock_guard<std::mutex> lock(mutex);
+                stream << "Frame " << call << " from camera " << thread << " saved to " << path << std::endl;
+            });
+        }
+        {
+            std::FILE* file = std::fopen(options.output.c_str(), "w");
+            run("stdio sync", options, threads, [&](int thread, int call) {
+                std::fprintf(file, "Frame %d from camera %d saved to %s\n", call, thread, path);
+                std::fflush(file);
+            });
+            std::fclose(file);
+        }
+        {
+            LogConfig config;
+            config.path = options.output;
+            config.perSitePerSecond = 0;
+            Logger logger(config);
+            LogSite site{__FILE__, __LINE__};
+            run("async", options, threads, [&](int thread, int call) {
+                logger.write(site, LogLevel::Info, thread, static_cast<uint64_t>(call) + 1,
+                             "Frame saved to %s", path);
+            }, [&logger]() { return logger.getStats().dropped; });
+            logger.flush();
+        }
+        {
+            LogConfig config;
+            config.path = options.output;
+            config.perSitePerSecond = 20;
+            Logger logger(config);
+            LogSite site{__FILE__, __LINE__};
+            run("rate limited", options, threads, [&](int thread, int call) {
+                logger.write(site, LogLevel::Info, thread, static_cast<uint64_t>(call) + 1,
+                             "Frame saved to %s", path);
+            });
+        }
+        {
+            LogConfig config;
+            config.path = options.output;
+            config.minLevel = LogLevel::Warning;
+            Logger logger(config);
+            LogSite site{__FILE__, __LINE__};
+            run("filtered", options, threads, [&](int thread, int call) {
+                if (logger.enabled(LogLevel::Debug)) {
+                    logger.write(site, LogLevel::Debug, thread, static_cast<uint64_t>(call) + 1,
+                                 "Frame saved to %s", path);
+                }
+            });
+        }
+    }
+    std::filesystem::remove(options.output);
+    return 0;
+}
@@ -0,0 +1,265 @@
+// Browser preview: JPEG encode cost, then a synthetic camera streamed to
+// local viewers through MjpegServer. Each frame is encoded once and shared
+// ("shared"), or encoded once per viewer as a server encoding for each
+// connection would ("per viewer"). Fast viewers read as fast as they can;
+// --slow S of them read at --slow-kbps, and skip to the newest frame.
+// Usage: bench_mjpeg [--width W] [--height H] [--quality Q] [--fps F] [--seconds S]
+//                    [--viewers 1,4,16] [--slow S] [--slow-kbps K]
+#include "mjpeg_server.h"
+#include "jpeg_encoder.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    int width = 1280;
+    int height = 720;
+    int quality = 70;
+    double fps = 30.0;
+    double seconds = 3.0;
+    std::vector<int> viewers = {1, 4, 16};
+    int slow = 1;
+    int slowKbps = 2000;
+};
+
+// A gradient with sensor noise and a moving block, so successive frames differ
+class SyntheticCamera {
+public:
+    SyntheticCamera(int width, int height)
+        : m_width(width), m_height(height), m_pixels(static_cast<size_t>(width) * height * 4), m_rng(5)
+    {
+    }
+
+    ImageView next(int frame)
+    {
+        int blockX = (frame * 7) % std::max(1, m_width - 64);
+        for (int y = 0; y < m_height; ++y) {
+            uint8_t* row = m_pixels.data() + static_cast<size_t>(y) * m_width * 4;
+            for (int x = 0; x < m_width; ++x) {
+                int noise = static_cast<int>(m_rng() % 9) - 4;
+                bool block = x >= blockX && x < blockX + 64 && y >= 100 && y < 164;
+                row[x * 4 + 0] = static_cast<uint8_t>(std::clamp(x * 255 / m_width + noise, 0, 255));
+                row[x * 4 + 1] = static_cast<uint8_t>(std::clamp(y * 255 / m_height + noise, 0, 255));
+                row[x * 4 + 2] = static_cast<uint8_t>(block ? 230 : 90 + noise);
+                row[x * 4 + 3] = 255;
+            }
+        }
+        return {m_pixels.data(), m_width, m_height, m_width * 4};
+    }
+
+private:
+    int m_width;
+    int m_height;
+    std::vector<uint8_t> m_pixels;
+    std::minstd_rand m_rng;
+};
+
+#ifdef _WIN32
+using Socket = SOCKET;
+void closeClient(Socket socket) { closesocket(socket); }
+#else
+using Socket = int;
+void closeClient(Socket socket) { ::close(socket); }
+#endif
+
+struct ViewerResult {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+};
+
+// Reads /stream/0 and counts whole parts until stopped
+void watch(int port, int bytesPerSecond, const std::atomic<bool>& stop, ViewerResult& result)
+{
+    Socket socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        closeClient(socket);
+        return;
+    }
+#ifdef _WIN32
+    DWORD timeout = 100;
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+#else
+    timeval timeout = {0, 100000};
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+    const char request[] = "GET /stream/0 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    send(socket, request, static_cast<int>(sizeof(request) - 1), 0);
+
+    std::string buffer;
+    char chunk[16384];
+    while (!stop) {
+        auto received = recv(socket, chunk, bytesPerSecond > 0 ? 4096 : sizeof(chunk), 0);
+        if (received == 0) {
+            break;
+        }
+        if (received < 0) {
+            continue;
+        }
+        result.bytes += static_cast<uint64_t>(received);
+        buffer.append(chunk, static_cast<size_t>(received));
+        for (;;) {
+            size_t length = buffer.find("Content-Length: ");
+            size_t body = buffer.find("\r\n\r\n", length);
+            if (length == std::string::npos || body == std::string::npos) {
+                break;
+            }
+            size_t end = body + 4 + std::strtoull(buffer.c_str() + length + 16, nullptr, 10) + 2;
+            if (buffer.size() < end) {
+                break;
+            }
+            buffer.erase(0, end);
+            result.frames++;
+        }
+        if (bytesPerSecond > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(received * 1000000LL / bytesPerSecond));
+        }
+    }
+    closeClient(socket);
+}
+
+void stream(const Options& options, int viewers, bool perViewer)
+{
+    MjpegServer server;
+    if (!server.start(0)) {
+        std::fprintf(stderr, "Could not start the server\n");
+        std::exit(1);
+    }
+
+    std::atomic<bool> stop(false);
+    std::vector<ViewerResult> results(viewers);
+    std::vector<std::thread> threads;
+    int slow = std::min(options.slow, viewers - 1);
+    for (int i = 0; i < viewers; ++i) {
+        int rate = i < slow ? options.slowKbps * 1000 / 8 : 0;
+        threads.emplace_back(watch, server.getPort(), rate, std::cref(stop), std::ref(results[i]));
+    }
+    Clock::time_point waitUntil = Clock::now() + std::chrono::seconds(2);
+    while (server.getViewerCount(0) < static_cast<size_t>(viewers) && Clock::now() < waitUntil) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    SyntheticCamera camera(options.width, options.height);
+    JpegEncoder encoder(options.quality);
+    int frames = static_cast<int>(options.fps * options.seconds);
+    auto interval = std::chrono::duration<double>(1.0 / options.fps);
+    double encodeMs = 0.0;
+    uint64_t encodes = 0;
+    Clock::time_point start = Clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        ImageView image = camera.next(frame);
+        auto jpeg = std::make_shared<std::string>();
+        Clock::time_point encodeStart = Clock::now();
+        for (int copy = 0; copy < (perViewer ? viewers : 1); ++copy) {
+            encoder.encode(image, *jpeg);
+            encodes++;
+        }
+        encodeMs += std::chrono::duration<double, std::milli>(Clock::now() - encodeStart).count();
+        server.publish(0, std::move(jpeg));
+        std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(interval * (frame + 1)));
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    // Let viewers finish the frame they are on
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    stop = true;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    MjpegServerStats stats = server.getStats();
+    server.stop();
+
+    double fastFrames = 0.0;
+    double slowFrames = 0.0;
+    for (int i = 0; i < viewers; ++i) {
+        (i < slow ? slowFrames : fastFrames) += static_cast<double>(results[i].frames);
+    }
+    int fast = viewers - slow;
+    char slowText[32] = "-";
+    if (slow > 0) {
+        std::snprintf(slowText, sizeof(slowText), "%.1f", slowFrames / slow / elapsed);
+    }
+    std::printf("%7d  %-10s %8.2f %12.1f %9.1f %9s %9llu %10.1f\n", viewers, perViewer ? "per viewer" : "shared",
+                static_cast<double>(encodes) / frames, encodeMs / elapsed, fast > 0 ? fastFrames / fast / elapsed : 0.0,
+                slowText, static_cast<unsigned long long>(stats.framesSkipped),
+                stats.bytesSent / elapsed / (1024.0 * 1024.0));
+}
+
+std::vector<int> parseList(const char* text)
+{
+    std::vector<int> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        values.push_back(std::max(1, std::atoi(item.c_str())));
+    }
+    return values;
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--width") && i + 1 < argc) options.width = std::max(16, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--height") && i + 1 < argc) options.height = std::max(16, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--quality") && i + 1 < argc) options.quality = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--fps") && i + 1 < argc) options.fps = std::max(1.0, std::atof(argv[++i]));
+        else if (!std::strcmp(argv[i], "--seconds") && i + 1 < argc) options.seconds = std::max(0.5, std::atof(argv[++i]));
+        else if (!std::strcmp(argv[i], "--viewers") && i + 1 < argc) options.viewers = parseList(argv[++i]);
+        else if (!std::strcmp(argv[i], "--slow") && i + 1 < argc) options.slow = std::max(0, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--slow-kbps") && i + 1 < argc) options.slowKbps = std::max(1, std::atoi(argv[++i]));
+    }
+
+    SyntheticCamera camera(options.width, options.height);
+    JpegEncoder encoder(options.quality);
+    std::string jpeg;
+    const int runs = 20;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < runs; ++i) {
+        encoder.encode(camera.next(i), jpeg);
+    }
+    // Generating the frames is timed separately and taken off
+    Clock::time_point generated = Clock::now();
+    for (int i = 0; i < runs; ++i) {
+        camera.next(i);
+    }
+    double generateMs = std::chrono::duration<double, std::milli>(Clock::now() - generated).count();
+    double encodeMs = (std::chrono::duration<double, std::milli>(generated - start).count() - generateMs) / runs;
+    std::printf("encode %dx%d q%d: %.2f ms per frame, %zu KB\n\n", options.width, options.height,
+                options.quality, encodeMs, jpeg.size() / 1024);
+
+    std::printf("%d fps for %.1f s; %d slow viewer(s) at %d kbit/s\n", static_cast<int>(options.fps),
+                options.seconds, options.slow, options.slowKbps);
+    std::printf("%7s  %-10s %8s %12s %9s %9s %9s %10s\n", "viewers", "encoding", "enc/frm", "encode ms/s",
+                "fast fps", "slow fps", "skipped", "sent MB/s");
+    for (int viewers : options.viewers) {
+        stream(options, viewers, false);
+        stream(options, viewers, true);
+    }
+    return 0;
+}
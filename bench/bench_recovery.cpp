@@ -0,0 +1,231 @@
+// Worker recovery: how long a batch takes when its worker crashes (SIGKILL)
+// or hangs (SIGSTOP) halfway through, with a new worker cold-started in its
+// place against a warm standby promoted into it. The workers are this
+// program started with --fake-worker: a persistent worker speaking the
+// detection_server.py protocol that takes --load-ms to start (interpreter
+// start and model load) and --infer-ms per request, with heartbeats.
+// Usage: bench_recovery [--rounds N] [--batch N] [--load-ms MS] [--infer-ms MS]
+//                       [--heartbeat-ms MS]
+#include "worker_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    int rounds = 5;
+    int batch = 4;
+    int loadMs = 3000;
+    int inferMs = 30;
+    int heartbeatMs = 250;
+};
+
+double msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int runFakeWorker(int loadMs, int inferMs, int heartbeatMs)
+{
+    std::mutex writeMutex;
+    auto writeLine = [&writeMutex](const std::string& line) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        std::fwrite(line.data(), 1, line.size(), stdout);
+        std::fputc('\n', stdout);
+        std::fflush(stdout);
+    };
+    if (heartbeatMs > 0) {
+        std::thread([&writeLine, heartbeatMs]() {
+            for (long beat = 1;; ++beat) {
+                writeLine("{\"heartbeat\":" + std::to_string(beat) + "}");
+                std::this_thread::sleep_for(std::chrono::milliseconds(heartbeatMs));
+            }
+        }).detach();
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(loadMs + inferMs));
+    writeLine("{\"ready\":true,\"startup_ms\":" + std::to_string(loadMs) + ",\"warmup_ms\":" +
+              std::to_string(inferMs) + "}");
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        size_t requests = 0;
+        for (size_t at = line.find("\"model_name\""); at != std::string::npos; at = line.find("\"model_name\"", at + 1)) {
+            requests++;
+        }
+        for (size_t i = 0; i < requests; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(inferMs));
+            writeLine("{\"success\":true,\"processing_time\":" + std::to_string(inferMs) + ",\"detections\":[]}");
+        }
+    }
+    return 0;
+}
+
+#ifndef _WIN32
+// This process's worker started first; the standby, when there is one, is
+// always the newer of the two
+int oldestChild()
+{
+    int oldest = -1;
+    unsigned long long oldestStart = 0;
+    DIR* proc = opendir("/proc");
+    if (!proc) {
+        return -1;
+    }
+    while (dirent* entry = readdir(proc)) {
+        int pid = std::atoi(entry->d_name);
+        if (pid <= 0) {
+            continue;
+        }
+        std::ifstream file("/proc/" + std::to_string(pid) + "/stat");
+        std::string stat;
+        std::getline(file, stat);
+        size_t end = stat.rfind(')');
+        if (end == std::string::npos) {
+            continue;
+        }
+        // Fields after the name: state, ppid, ... starttime is the 20th
+        std::istringstream fields(stat.substr(end + 2));
+        std::string field;
+        std::vector<std::string> values;
+        while (fields >> field && values.size() < 20) {
+            values.push_back(field);
+        }
+        if (values.size() < 20 || values[0] == "Z" || std::atoi(values[1].c_str()) != getpid()) {
+            continue;
+        }
+        unsigned long long start = std::strtoull(values[19].c_str(), nullptr, 10);
+        if (oldest < 0 || start < oldestStart) {
+            oldest = pid;
+            oldestStart = start;
+        }
+    }
+    closedir(proc);
+    return oldest;
+}
+
+struct Outcome {
+    std::vector<double> batchMs;
+    int failedRequests = 0;
+};
+
+void report(const char* name, const char* failure, const Outcome& outcome, const WorkerPoolStats& stats)
+{
+    std::vector<double> sorted = outcome.batchMs;
+    std::sort(sorted.begin(), sorted.end());
+    double mean = 0.0;
+    for (double value : sorted) {
+        mean += value;
+    }
+    mean /= std::max<size_t>(1, sorted.size());
+    std::printf("%-9s %-7s %10.0f %9.0f %8d %9llu %12.0f %11.0f\n", name, failure, mean,
+                sorted.empty() ? 0.0 : sorted.back(), outcome.failedRequests,
+                static_cast<unsigned long long>(stats.redispatched), stats.lastRecoveryMs, stats.maxRecoveryMs);
+}
+
+void runMode(const char* name, bool warmStandby, const std::string& program, const Options& options)
+{
+    WorkerConfig config;
+    config.preloadModels.push_back("yolov5s");
+    config.heartbeatMs = options.heartbeatMs;
+    config.warmStandby = warmStandby;
+
+    DetectionRequest request;
+    request.modelName = "yolov5s";
+    request.imagePath = "frame.jpg";
+    request.confidenceThreshold = 0.5f;
+    request.iouThreshold = 0.45f;
+    std::vector<DetectionRequest> batch(options.batch, request);
+
+    for (int signal : {SIGKILL, SIGSTOP}) {
+        WorkerPool pool("\"" + program + "\"",
+                        "--fake-worker=" + std::to_string(options.loadMs) + "," + std::to_string(options.inferMs));
+        pool.setWorkerConfig(config);
+        pool.setWorkerCount(1);
+        pool.runBatch(0, batch);
+
+        Outcome outcome;
+        for (int round = 0; round < options.rounds; ++round) {
+            while (warmStandby && !pool.getStats().standbyReady) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+            int victim = oldestChild();
+            // Fails the worker once the batch is under way
+            std::thread failer([victim, signal, &options]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(options.inferMs * options.batch / 2));
+                kill(victim, signal);
+            });
+            Clock::time_point start = Clock::now();
+            std::vector<DetectionResult> results = pool.runBatch(0, batch);
+            outcome.batchMs.push_back(msSince(start));
+            failer.join();
+            for (const DetectionResult& result : results) {
+                outcome.failedRequests += result.success ? 0 : 1;
+            }
+            if (signal == SIGSTOP) {
+                kill(victim, SIGKILL);
+            }
+        }
+        report(name, signal == SIGKILL ? "crash" : "hang", outcome, pool.getStats());
+    }
+}
+#endif
+}
+
+int main(int argc, char** argv)
+{
+    int loadMs = 0;
+    int inferMs = 0;
+    if (argc > 1 && std::sscanf(argv[1], "--fake-worker=%d,%d", &loadMs, &inferMs) == 2) {
+        int heartbeatMs = 0;
+        for (int i = 2; i + 1 < argc; ++i) {
+            if (!std::strcmp(argv[i], "--heartbeat-ms")) heartbeatMs = std::atoi(argv[i + 1]);
+        }
+        return runFakeWorker(loadMs, inferMs, heartbeatMs);
+    }
+
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        const char* value = argv[i + 1];
+        if (name == "--rounds") options.rounds = std::max(1, std::atoi(value));
+        else if (name == "--batch") options.batch = std::max(1, std::atoi(value));
+        else if (name == "--load-ms") options.loadMs = std::max(0, std::atoi(value));
+        else if (name == "--infer-ms") options.inferMs = std::max(1, std::atoi(value));
+        else if (name == "--heartbeat-ms") options.heartbeatMs = std::max(10, std::atoi(value));
+        else {
+            std::fprintf(stderr, "Usage: %s [--rounds N] [--batch N] [--load-ms MS] [--infer-ms MS]\n"
+                                 "          [--heartbeat-ms MS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+#ifndef _WIN32
+    std::printf("Worker start %d ms, %d ms per request, batches of %d, heartbeat every %d ms, %d rounds\n\n",
+                options.loadMs, options.inferMs, options.batch, options.heartbeatMs, options.rounds);
+    std::printf("%-9s %-7s %10s %9s %8s %9s %12s %11s\n", "recovery", "failure", "mean ms", "max ms", "failed",
+                "resent", "recovered ms", "max rec ms");
+    runMode("cold", false, argv[0], options);
+    runMode("standby", true, argv[0], options);
+#else
+    std::printf("bench_recovery fails workers with POSIX signals and does not run on Windows\n");
+#endif
+    return 0;
+}
@@ -0,0 +1,139 @@
+// Replays a recording through the detection scheduler with the recorded
+// results standing in for the model, so pipeline changes can be measured on
+// identical input without a camera or Python.
+// Usage: bench_replay <recording> [--speed S] [--workers N] [--batch B] [--max-age MS] [--no-latency]
+#include "recording.h"
+#include "replay_source.h"
+#include "detection_scheduler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <recording> [--speed S] [--workers N] [--batch B] [--max-age MS] [--no-latency]\n", argv[0]);
+        return 1;
+    }
+
+    double speed = 1.0;
+    int workers = 1;
+    size_t maxBatch = 8;
+    bool simulateLatency = true;
+    int maxAgeMs = 0;
+    for (int i = 2; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--speed") && i + 1 < argc) {
+            speed = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--workers") && i + 1 < argc) {
+            workers = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--batch") && i + 1 < argc) {
+            maxBatch = static_cast<size_t>(std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--max-age") && i + 1 < argc) {
+            maxAgeMs = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--no-latency")) {
+            simulateLatency = false;
+        }
+    }
+
+    std::string error;
+    std::shared_ptr<Recording> recording = Recording::open(argv[1], &error);
+    if (!recording) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::printf("recording: %llu frames, %llu results, %zu streams, %.1f s\n",
+                static_cast<unsigned long long>(recording->getFrameCount()),
+                static_cast<unsigned long long>(recording->getResultCount()),
+                recording->getStreamIds().size(), recording->getDurationUs() / 1e6);
+
+    ReplayBackend backend(recording, simulateLatency);
+    DetectionScheduler scheduler(
+        [&backend](int workerIndex, const std::vector<DetectionRequest>& batch) {
+            return backend.runBatch(workerIndex, batch);
+        },
+        workers, maxBatch);
+
+    std::filesystem::path frameRoot = std::filesystem::temp_directory_path() / "bench_replay";
+    std::vector<std::unique_ptr<ReplaySource>> sources;
+    for (int streamId : recording->getStreamIds()) {
+        scheduler.addStream(streamId, 1.0);
+        sources.push_back(std::make_unique<ReplaySource>(
+            recording, streamId, (frameRoot / ("stream_" + std::to_string(streamId))).string()));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto& source : sources) {
+        ReplaySource* replay = source.get();
+        replay->setSpeed(speed);
+        replay->startReplay(
+            [&scheduler, replay, maxAgeMs](const FrameLease& frame) {
+                DetectionRequest request;
+                request.imagePath = frame->path;
+                request.confidenceThreshold = 0.5;
+                request.iouThreshold = 0.45;
+                request.modelName = "yolov5s";
+                request.saveAnnotated = false;
+                request.streamId = replay->getStreamId();
+                if (maxAgeMs > 0) {
+                    request.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(maxAgeMs);
+                }
+                // The callbacks hold the lease until the result is in, as the UI does
+                scheduler.submit(replay->getStreamId(), request,
+                    [frame](const DetectionResult&) {},
+                    [frame](const std::string&) {});
+            },
+            [](const std::string& message) { std::fprintf(stderr, "%s\n", message.c_str()); });
+    }
+    for (auto& source : sources) {
+        source->waitUntilFinished();
+    }
+    // Let the last queued frames finish
+    while (true) {
+        size_t queued = 0;
+        for (int streamId : recording->getStreamIds()) {
+            queued += scheduler.getQueueDepth(streamId);
+        }
+        bool inFlight = false;
+        for (auto& source : sources) {
+            inFlight = inFlight || source->getFramePoolStats().inUse > 0;
+        }
+        if (queued == 0 && !inFlight) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("replayed in %.2f s (speed %s, %d worker(s), batch <= %zu, latency %s)\n", seconds,
+                speed > 0.0 ? std::to_string(speed).c_str() : "max", workers, maxBatch,
+                simulateLatency ? "simulated" : "off");
+
+    std::vector<StreamStats> streams = scheduler.getStreamStats();
+    for (size_t i = 0; i < sources.size(); ++i) {
+        ReplayStats replay = sources[i]->getStats();
+        const StreamStats& stats = streams[i];
+        std::printf("stream %d: delivered %llu/%llu, skipped %llu | done %llu, failed %llu, timed out %llu, replaced %llu | "
+                    "%.1f fps, latency mean %.1f ms p95 %.1f ms, batch %.2f\n",
+                    sources[i]->getStreamId(),
+                    static_cast<unsigned long long>(replay.delivered), static_cast<unsigned long long>(replay.total),
+                    static_cast<unsigned long long>(replay.skipped),
+                    static_cast<unsigned long long>(stats.completed), static_cast<unsigned long long>(stats.failed),
+                    static_cast<unsigned long long>(stats.timedOut), static_cast<unsigned long long>(stats.dropped),
+                    stats.fps, stats.meanLatencyMs, stats.p95LatencyMs, stats.meanBatchSize);
+    }
+
+    ReplayBackendStats backendStats = backend.getStats();
+    std::printf("backend: %llu recorded results served, %llu frames without one\n",
+                static_cast<unsigned long long>(backendStats.hits), static_cast<unsigned long long>(backendStats.misses));
+
+    scheduler.shutdown();
+    sources.clear();
+    std::error_code ec;
+    std::filesystem::remove_all(frameRoot, ec);
+    return 0;
+}
@@ -0,0 +1,291 @@
+// Worker thread budgets: detection workers as they start by default (one
+// intra-op thread per core each, unpinned, so several workers oversubscribe
+// the machine) against the planned budget (each worker pinned to its own
+// cores with one thread per core, capture on the cores left over).
+// The workers are this program started with --fake-worker: a persistent
+// pool that runs each request as layers of parallel work with a spinning
+// barrier between layers, the way torch runs a network's operators.
+// Capture threads wake at 30 fps and do a millisecond of work; their
+// lateness shows what the workers leave for them.
+// Usage: bench_thread_budget [--workers N] [--seconds S] [--layers N]
+//                            [--work N] [--captures N] [--default-threads N]
+#include "thread_budget.h"
+#include "worker_process.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// About what an OpenMP runtime spins before it sleeps
+const int kSpinIterations = 200000;
+const auto kCapturePeriod = std::chrono::microseconds(33333);
+const auto kCaptureWork = std::chrono::milliseconds(1);
+
+class SpinBarrier {
+public:
+    explicit SpinBarrier(int count) : m_count(count), m_waiting(0), m_generation(0) {}
+
+    void arriveAndWait()
+    {
+        unsigned generation = m_generation.load(std::memory_order_acquire);
+        if (m_waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == m_count) {
+            m_waiting.store(0, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_generation.fetch_add(1, std::memory_order_release);
+            }
+            m_wake.notify_all();
+            return;
+        }
+        for (int i = 0; i < kSpinIterations; ++i) {
+            if (m_generation.load(std::memory_order_acquire) != generation) {
+                return;
+            }
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [&] { return m_generation.load(std::memory_order_acquire) != generation; });
+    }
+
+private:
+    const int m_count;
+    std::atomic<int> m_waiting;
+    std::atomic<unsigned> m_generation;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+};
+
+float compute(long long units, float seed)
+{
+    float x = seed;
+    for (long long i = 0; i < units; ++i) {
+        x = x * 0.9999f + 0.5f;
+    }
+    return x;
+}
+
+int runFakeWorker(int threads, int layers, long long work)
+{
+    threads = std::max(threads, 1);
+    SpinBarrier barrier(threads);
+    std::atomic<bool> stopping(false);
+    std::vector<float> sinks(static_cast<size_t>(threads) * 16);   // A cache line apart
+    long long share = work / threads;
+
+    auto runLayers = [&](int index) {
+        for (int layer = 0; layer < layers; ++layer) {
+            sinks[static_cast<size_t>(index) * 16] += compute(share, static_cast<float>(layer));
+            barrier.arriveAndWait();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; ++i) {
+        pool.emplace_back([&, i] {
+            for (;;) {
+                barrier.arriveAndWait();
+                if (stopping) {
+                    return;
+                }
+                runLayers(i);
+            }
+        });
+    }
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        barrier.arriveAndWait();
+        runLayers(0);
+        std::printf("{\"sink\":%g}\n", sinks[0]);
+        std::fflush(stdout);
+    }
+    stopping = true;
+    barrier.arriveAndWait();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    return 0;
+}
+
+double percentile(std::vector<double> values, double fraction)
+{
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(fraction * (values.size() - 1) + 0.5);
+    return values[std::min(index, values.size() - 1)];
+}
+
+struct Options {
+    int workers = 2;
+    double seconds = 10.0;
+    int layers = 30;
+    long long work = 2000000;
+    int captures = 2;
+    int defaultThreads = 0;
+};
+
+struct ModeResult {
+    double requestsPerSecond = 0.0;
+    double p50Ms = 0.0;
+    double p99Ms = 0.0;
+    double captureLateP99Ms = 0.0;
+    bool ok = true;
+};
+
+ModeResult runMode(const std::string& program, const Options& options, const std::vector<WorkerThreadBudget>& budgets,
+                   const std::vector<int>& captureCpus)
+{
+    ModeResult result;
+    std::vector<std::unique_ptr<WorkerProcess>> workers;
+    for (const WorkerThreadBudget& budget : budgets) {
+        std::string command = "\"" + program + "\" --fake-worker " + std::to_string(budget.intraOpThreads) + " " +
+                              std::to_string(options.layers) + " " + std::to_string(options.work);
+        workers.push_back(std::make_unique<WorkerProcess>());
+        std::string line;
+        // One request first, so thread start-up is not timed
+        if (!workers.back()->start(command, budget.cpus) || !workers.back()->writeLine("go") ||
+            !workers.back()->readLine(line)) {
+            result.ok = false;
+            return result;
+        }
+    }
+
+    std::atomic<bool> running(true);
+    std::mutex resultMutex;
+    std::vector<double> latencies;
+    std::vector<double> lateness;
+
+    std::vector<std::thread> captures;
+    for (int i = 0; i < options.captures; ++i) {
+        captures.emplace_back([&] {
+            pinCurrentThread(captureCpus);
+            std::vector<double> late;
+            Clock::time_point next = Clock::now() + kCapturePeriod;
+            while (running) {
+                std::this_thread::sleep_until(next);
+                Clock::time_point woke = Clock::now();
+                late.push_back(std::chrono::duration<double, std::milli>(woke - next).count());
+                while (Clock::now() - woke < kCaptureWork) {
+                }
+                next += kCapturePeriod;
+                if (next < Clock::now()) {
+                    next = Clock::now() + kCapturePeriod;
+                }
+            }
+            std::lock_guard<std::mutex> lock(resultMutex);
+            lateness.insert(lateness.end(), late.begin(), late.end());
+        });
+    }
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.seconds));
+    std::vector<std::thread> clients;
+    for (auto& worker : workers) {
+        clients.emplace_back([&, process = worker.get()] {
+            std::vector<double> own;
+            std::string line;
+            while (Clock::now() < end) {
+                Clock::time_point sent = Clock::now();
+                if (!process->writeLine("go") || !process->readLine(line)) {
+                    break;
+                }
+                own.push_back(std::chrono::duration<double, std::milli>(Clock::now() - sent).count());
+            }
+            std::lock_guard<std::mutex> lock(resultMutex);
+            latencies.insert(latencies.end(), own.begin(), own.end());
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    running = false;
+    for (auto& capture : captures) {
+        capture.join();
+    }
+    for (auto& worker : workers) {
+        worker->stop();
+    }
+
+    result.requestsPerSecond = latencies.size() / elapsed;
+    result.p50Ms = percentile(latencies, 0.50);
+    result.p99Ms = percentile(latencies, 0.99);
+    result.captureLateP99Ms = percentile(lateness, 0.99);
+    return result;
+}
+
+std::string describeBudget(const WorkerThreadBudget& budget)
+{
+    return "intra-op " + std::to_string(budget.intraOpThreads) + " on " +
+           (budget.cpus.empty() ? std::string("any CPU") : "CPUs " + formatCpuList(budget.cpus));
+}
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 4 && !std::strcmp(argv[1], "--fake-worker")) {
+        return runFakeWorker(std::atoi(argv[2]), std::atoi(argv[3]), std::atoll(argv[4]));
+    }
+
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        const char* value = argv[i + 1];
+        if (name == "--workers") options.workers = std::max(1, std::atoi(value));
+        else if (name == "--seconds") options.seconds = std::max(1.0, std::atof(value));
+        else if (name == "--layers") options.layers = std::max(1, std::atoi(value));
+        else if (name == "--work") options.work = std::max(1000ll, std::atoll(value));
+        else if (name == "--captures") options.captures = std::max(0, std::atoi(value));
+        else if (name == "--default-threads") options.defaultThreads = std::max(1, std::atoi(value));
+        else {
+            std::fprintf(stderr, "Usage: %s [--workers N] [--seconds S] [--layers N] [--work N] [--captures N]\n"
+                                 "          [--default-threads N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    CpuTopology topology = CpuTopology::detect();
+    std::printf("%zu physical cores, %zu logical CPUs; %d workers, %d capture threads\n\n", topology.cores.size(),
+                topology.logicalCpuCount(), options.workers, options.captures);
+
+    // torch's default: one intra-op thread per physical core, in every worker
+    WorkerThreadBudget unpinned;
+    unpinned.intraOpThreads = options.defaultThreads > 0 ? options.defaultThreads
+                                                         : std::max<int>(1, static_cast<int>(topology.cores.size()));
+    std::vector<WorkerThreadBudget> defaults(options.workers, unpinned);
+    ThreadBudgetPlan plan = planThreadBudget(topology, options.workers);
+
+    std::printf("default: every worker %s\n", describeBudget(unpinned).c_str());
+    for (size_t i = 0; i < plan.workers.size(); ++i) {
+        std::printf("planned: worker %zu %s\n", i, describeBudget(plan.workers[i]).c_str());
+    }
+    std::printf("planned: capture on %s\n\n",
+                plan.captureCpus.empty() ? "any CPU" : ("CPUs " + formatCpuList(plan.captureCpus)).c_str());
+
+    std::printf("%-8s %10s %10s %10s %18s\n", "budget", "req/s", "p50 ms", "p99 ms", "capture late p99");
+    ModeResult baseline = runMode(argv[0], options, defaults, {});
+    ModeResult planned = runMode(argv[0], options, plan.workers, plan.captureCpus);
+    if (!baseline.ok || !planned.ok) {
+        std::fprintf(stderr, "Could not start the fake workers\n");
+        return 1;
+    }
+    std::printf("%-8s %10.2f %10.1f %10.1f %15.2f ms\n", "default", baseline.requestsPerSecond, baseline.p50Ms,
+                baseline.p99Ms, baseline.captureLateP99Ms);
+    std::printf("%-8s %10.2f %10.1f %10.1f %15.2f ms\n", "planned", planned.requestsPerSecond, planned.p50Ms,
+                planned.p99Ms, planned.captureLateP99Ms);
+    return 0;
+}
@@ -0,0 +1,550 @@
+// Soak test of the live path for drift and leaks that only show after hours.
+// Synthetic cameras write frames into pooled slot files at a paced rate; the
+// frames go through the scheduler, the cascade and ROI executors and a
+// WorkerPool to stub workers (this program started with --stub-worker=...),
+// and results are composed for display as the window does. --crash-every
+// makes each stub worker exit after that many requests, so the pool's
+// supervisor, warm standby and resent requests run as well. Process
+// resources and latency percentiles are sampled at a fixed interval; after
+// the warm-up a least-squares slope per hour is fitted to each series and
+// the run fails when one exceeds its limit or an interval completes nothing.
+// --restart-every tears the whole pipeline down mid-request and builds it
+// again, as closing and reopening the window does.
+//
+// Usage: soak_pipeline [--duration S] [--cameras N] [--fps F] [--latency MS] [--detections N]
+//                      [--sample S] [--warmup S] [--restart-every S] [--csv FILE]
+//                      [--crash-every N] [--standby 0|1]
+//                      [--max-rss-mb-h X] [--max-handles-h X] [--max-threads-h X]
+//                      [--max-temp-mb-h X] [--max-p95-ms-h X]
+#include "cascade_executor.h"
+#include "detection_scheduler.h"
+#include "frame_compositor.h"
+#include "frame_pacer.h"
+#include "frame_pool.h"
+#include "process_stats.h"
+#include "result_mailbox.h"
+#include "roi_executor.h"
+#include "worker_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+const int kFrameWidth = 1280;
+const int kFrameHeight = 720;
+const size_t kFrameFileBytes = 96 * 1024;       // A typical 720p JPEG
+const size_t kFrameSlots = 4;
+const uint64_t kFrameByteBudget = 64ull * 1024 * 1024;
+const size_t kMaxBatchSize = 8;
+const auto kFrameMaxAge = std::chrono::milliseconds(2000);
+const int kResponseTimeoutMs = 10000;
+const int kHeartbeatMs = 250;
+const int kDisplayHz = 60;
+
+struct Options {
+    double durationSeconds = 3600.0;
+    int cameras = 2;
+    double fps = 10.0;
+    int latencyMs = 40;
+    int detections = 5;
+    double sampleSeconds = 10.0;
+    double warmupSeconds = -1.0;        // Default: a tenth of the run
+    double restartSeconds = 0.0;
+    std::string csvPath;
+    int crashEvery = 0;                 // Requests a stub worker answers before exiting; 0 = never
+    bool warmStandby = true;
+    double maxRssMbPerHour = 64.0;
+    double maxHandlesPerHour = 16.0;
+    double maxThreadsPerHour = 4.0;
+    double maxTempMbPerHour = 16.0;
+    double maxP95MsPerHour = 50.0;
+};
+
+// Speaks the detection_server.py --serve protocol: a ready line, heartbeats
+// from a thread of its own and one response per request in the batch
+int runStubWorker(int latencyMs, int detections, int crashEvery, int heartbeatMs)
+{
+    std::string response = "{\"success\":true,\"detections\":[";
+    for (int i = 0; i < detections; ++i) {
+        if (i > 0) response += ",";
+        response += "{\"class\":\"person\",\"class_id\":" + std::to_string(i % 80) + ",\"confidence\":0.87,\"bbox\":[" +
+                    std::to_string(40 + i * 110) + ",120.5,96.0,210.0]}";
+    }
+    response += "],\"letterbox\":{\"source_width\":" + std::to_string(kFrameWidth) + ",\"source_height\":" +
+                std::to_string(kFrameHeight) + ",\"input_width\":640,\"input_height\":384,\"scale_x\":0.5,"
+                "\"scale_y\":0.5,\"pad_x\":0,\"pad_y\":12},\"processing_time\":" + std::to_string(latencyMs) +
+                ",\"model_load_ms\":0,\"model_used\":\"yolov5s\"}\n";
+
+    std::mutex writeMutex;
+    auto write = [&writeMutex](const std::string& text) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        std::fwrite(text.data(), 1, text.size(), stdout);
+        std::fflush(stdout);
+    };
+    if (heartbeatMs > 0) {
+        std::thread([&write, heartbeatMs]() {
+            for (long beat = 1;; ++beat) {
+                write("{\"heartbeat\":" + std::to_string(beat) + "}\n");
+                std::this_thread::sleep_for(std::chrono::milliseconds(heartbeatMs));
+            }
+        }).detach();
+    }
+    write("{\"ready\":true,\"startup_ms\":0,\"warmup_ms\":0}\n");
+
+    // Inference time varies by a fifth either way
+    std::mt19937 rng(std::random_device{}());
+    std::uniform_real_distribution<double> jitter(0.8, 1.2);
+    std::string request;
+    int answered = 0;
+    while (std::getline(std::cin, request)) {
+        for (size_t at = request.find("\"model_name\""); at != std::string::npos;
+             at = request.find("\"model_name\"", at + 1)) {
+            if (crashEvery > 0 && answered++ >= crashEvery) {
+                std::_Exit(3);
+            }
+            std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(latencyMs * jitter(rng)));
+            write(response);
+        }
+    }
+    // The heartbeat thread is still running
+    std::_Exit(0);
+}
+
+// Latencies and outcomes since the last sample
+class Outcomes {
+public:
+    void completed(double latencyMs)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_latencies.push_back(latencyMs);
+    }
+
+    void failed(bool timedOut)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        (timedOut ? m_timedOut : m_failed)++;
+    }
+
+    void take(std::vector<double>& latencies, uint64_t& failedCount, uint64_t& timedOutCount)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        latencies.swap(m_latencies);
+        m_latencies.clear();
+        failedCount = m_failed;
+        timedOutCount = m_timedOut;
+        m_failed = 0;
+        m_timedOut = 0;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<double> m_latencies;
+    uint64_t m_failed = 0;
+    uint64_t m_timedOut = 0;
+};
+
+// One window session: cameras, scheduler, executors, workers and display
+class SoakPipeline {
+public:
+    SoakPipeline(const Options& options, const std::string& program, const std::string& frameDirectory,
+                 Outcomes& outcomes, WorkerPoolStats& workerTotals)
+        : m_outcomes(outcomes)
+        , m_workerTotals(workerTotals)
+        , m_pool("\"" + program + "\"", "--stub-worker=" + std::to_string(options.latencyMs) + "," +
+                 std::to_string(options.detections) + "," + std::to_string(options.crashEvery))
+        , m_roi([this](int worker, const std::vector<DetectionRequest>& batch) {
+              return m_pool.runBatch(worker, batch);
+          })
+        , m_cascade([this](int worker, const std::vector<DetectionRequest>& batch) {
+              return m_roi.runBatch(worker, batch);
+          })
+        , m_scheduler([this](int worker, const std::vector<DetectionRequest>& batch) {
+              return m_cascade.runBatch(worker, batch);
+          }, 1, kMaxBatchSize)
+        , m_running(true)
+    {
+        WorkerConfig config;
+        config.preloadModels.push_back("yolov5s");
+        config.responseTimeoutMs = kResponseTimeoutMs;
+        config.heartbeatMs = kHeartbeatMs;
+        config.warmStandby = options.warmStandby;
+        m_pool.setWorkerConfig(config);
+        m_pool.setWorkerCount(1);
+
+        m_compositor.setOutputSize(880, 495);
+        for (int i = 0; i < options.cameras; ++i) {
+            auto camera = std::make_shared<Camera>(options.fps);
+            camera->streamId = i;
+            std::string directory = frameDirectory + "/camera_" + std::to_string(i);
+            camera->pool = std::make_unique<FramePool>(directory, kFrameSlots, kFrameByteBudget);
+            camera->pixels.resize(static_cast<size_t>(kFrameWidth) * kFrameHeight * 4);
+            for (size_t p = 0; p < camera->pixels.size(); ++p) {
+                camera->pixels[p] = static_cast<uint8_t>(p * (i + 3));
+            }
+            m_cameras.push_back(camera);
+            m_scheduler.addStream(camera->streamId, 1.0);
+        }
+        for (const auto& camera : m_cameras) {
+            camera->pacer.reset();
+            camera->thread = std::thread(&SoakPipeline::captureLoop, this, camera);
+        }
+        m_displayThread = std::thread(&SoakPipeline::displayLoop, this);
+    }
+
+    // Stops mid-request, in the order OnStopWebcam and ~MainWindow use
+    ~SoakPipeline()
+    {
+        for (const auto& camera : m_cameras) {
+            camera->pacer.stop();
+            if (camera->thread.joinable()) {
+                camera->thread.join();
+            }
+            m_scheduler.removeStream(camera->streamId);
+            camera->inFlight.cancel();
+        }
+        m_running = false;
+        if (m_displayThread.joinable()) {
+            m_displayThread.join();
+        }
+        m_scheduler.shutdown();
+
+        WorkerPoolStats stats = m_pool.getStats();
+        m_workerTotals.exits += stats.exits;
+        m_workerTotals.hangs += stats.hangs;
+        m_workerTotals.promotions += stats.promotions;
+        m_workerTotals.coldStarts += stats.coldStarts;
+        m_workerTotals.redispatched += stats.redispatched;
+        m_workerTotals.maxRecoveryMs = std::max(m_workerTotals.maxRecoveryMs, stats.maxRecoveryMs);
+    }
+
+private:
+    struct Camera {
+        explicit Camera(double fps) : pacer(fps) {}
+
+        int streamId = 0;
+        FramePacer pacer;
+        std::unique_ptr<FramePool> pool;
+        std::vector<uint8_t> pixels;
+        std::mutex overlayMutex;
+        std::vector<Detection> overlay;
+        CancellationHandle inFlight;
+        std::thread thread;
+    };
+
+    void captureLoop(std::shared_ptr<Camera> camera)
+    {
+        std::vector<char> frameBytes(kFrameFileBytes, 'x');
+        uint64_t sequence = 0;
+        while (camera->pacer.waitForNextFrame()) {
+            FrameLease frame = camera->pool->acquire();
+            if (!frame) {
+                continue;
+            }
+            std::snprintf(frameBytes.data(), frameBytes.size(), "frame %llu", static_cast<unsigned long long>(sequence++));
+            if (FILE* file = std::fopen(frame->path.c_str(), "wb")) {
+                std::fwrite(frameBytes.data(), 1, frameBytes.size(), file);
+                std::fclose(file);
+            }
+            camera->pool->commit(frame);
+
+            if (camera->streamId == 0) {
+                std::lock_guard<std::mutex> lock(camera->overlayMutex);
+                m_compositor.compose({camera->pixels.data(), kFrameWidth, kFrameHeight, kFrameWidth * 4},
+                                     camera->overlay);
+            }
+
+            DetectionRequest request;
+            request.imagePath = frame->path;
+            request.confidenceThreshold = 0.5;
+            request.iouThreshold = 0.45;
+            request.modelName = "yolov5s";
+            request.saveAnnotated = false;
+            request.streamId = camera->streamId;
+            request.inferenceSize = kDefaultInferenceSize;
+            request.deadline = Clock::now() + kFrameMaxAge;
+
+            Clock::time_point submitted = Clock::now();
+            Clock::time_point deadline = request.deadline;
+            camera->inFlight = m_scheduler.submit(camera->streamId, request,
+                [this, camera, frame, submitted](const DetectionResult& result) {
+                    m_outcomes.completed(std::chrono::duration<double, std::milli>(Clock::now() - submitted).count());
+                    {
+                        std::lock_guard<std::mutex> lock(camera->overlayMutex);
+                        camera->overlay = result.detections;
+                    }
+                    m_results.post(result);
+                },
+                [this, camera, frame, deadline](const std::string&) {
+                    m_outcomes.failed(Clock::now() >= deadline);
+                });
+        }
+    }
+
+    // The UI thread: drain at display rate, blit when a new frame was composed
+    void displayLoop()
+    {
+        std::vector<uint8_t> surface;
+        uint64_t shown = 0;
+        DetectionResult result;
+        while (m_running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1000 / kDisplayHz));
+            m_results.take(result);
+            uint64_t sequence = m_compositor.getSequence();
+            if (sequence == shown) {
+                continue;
+            }
+            shown = sequence;
+            m_compositor.drawFront([&surface](const ImageView& image) {
+                surface.assign(image.pixels, image.pixels + static_cast<size_t>(image.stride) * image.height);
+            });
+        }
+    }
+
+    Outcomes& m_outcomes;
+    WorkerPoolStats& m_workerTotals;
+    WorkerPool m_pool;
+    RoiExecutor m_roi;
+    CascadeExecutor m_cascade;
+    DetectionScheduler m_scheduler;
+    FrameCompositor m_compositor;
+    LatestMailbox<DetectionResult> m_results;
+    std::vector<std::shared_ptr<Camera>> m_cameras;
+    std::atomic<bool> m_running;
+    std::thread m_displayThread;
+};
+
+struct Sample {
+    double seconds;
+    ProcessStats process;
+    uint64_t tempBytes;
+    size_t completed;
+    uint64_t failed;
+    uint64_t timedOut;
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+};
+
+double percentile(std::vector<double>& values, double fraction)
+{
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(std::ceil(fraction * values.size()));
+    index = std::clamp<size_t>(index, 1, values.size()) - 1;
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+// Least-squares slope of value over time, per hour
+double slopePerHour(const std::vector<Sample>& samples, double (*value)(const Sample&))
+{
+    double n = static_cast<double>(samples.size());
+    double meanT = 0.0;
+    double meanV = 0.0;
+    for (const Sample& sample : samples) {
+        meanT += sample.seconds / n;
+        meanV += value(sample) / n;
+    }
+    double covariance = 0.0;
+    double variance = 0.0;
+    for (const Sample& sample : samples) {
+        covariance += (sample.seconds - meanT) * (value(sample) - meanV);
+        variance += (sample.seconds - meanT) * (sample.seconds - meanT);
+    }
+    return variance > 0.0 ? covariance / variance * 3600.0 : 0.0;
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char* value = argv[++i];
+        if (arg == "--duration") options.durationSeconds = std::atof(value);
+        else if (arg == "--cameras") options.cameras = std::atoi(value);
+        else if (arg == "--fps") options.fps = std::atof(value);
+        else if (arg == "--latency") options.latencyMs = std::atoi(value);
+        else if (arg == "--detections") options.detections = std::atoi(value);
+        else if (arg == "--sample") options.sampleSeconds = std::atof(value);
+        else if (arg == "--warmup") options.warmupSeconds = std::atof(value);
+        else if (arg == "--restart-every") options.restartSeconds = std::atof(value);
+        else if (arg == "--csv") options.csvPath = value;
+        else if (arg == "--crash-every") options.crashEvery = std::atoi(value);
+        else if (arg == "--standby") options.warmStandby = std::atoi(value) != 0;
+        else if (arg == "--max-rss-mb-h") options.maxRssMbPerHour = std::atof(value);
+        else if (arg == "--max-handles-h") options.maxHandlesPerHour = std::atof(value);
+        else if (arg == "--max-threads-h") options.maxThreadsPerHour = std::atof(value);
+        else if (arg == "--max-temp-mb-h") options.maxTempMbPerHour = std::atof(value);
+        else if (arg == "--max-p95-ms-h") options.maxP95MsPerHour = std::atof(value);
+        else return false;
+    }
+    if (options.warmupSeconds < 0.0) {
+        options.warmupSeconds = options.durationSeconds / 10.0;
+    }
+    return options.durationSeconds > 0.0 && options.cameras > 0 && options.fps > 0.0 && options.sampleSeconds > 0.0;
+}
+}
+
+int main(int argc, char** argv)
+{
+    int latencyMs = 0;
+    int detections = 0;
+    int crashEvery = 0;
+    if (argc > 1 && std::sscanf(argv[1], "--stub-worker=%d,%d,%d", &latencyMs, &detections, &crashEvery) == 3) {
+        int heartbeatMs = 0;
+        for (int i = 2; i + 1 < argc; ++i) {
+            if (!std::strcmp(argv[i], "--heartbeat-ms")) heartbeatMs = std::atoi(argv[i + 1]);
+        }
+        return runStubWorker(latencyMs, detections, crashEvery, heartbeatMs);
+    }
+
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+            "Usage: %s [--duration S] [--cameras N] [--fps F] [--latency MS] [--detections N]\n"
+            "          [--sample S] [--warmup S] [--restart-every S] [--csv FILE]\n"
+            "          [--crash-every N] [--standby 0|1]\n"
+            "          [--max-rss-mb-h X] [--max-handles-h X] [--max-threads-h X]\n"
+            "          [--max-temp-mb-h X] [--max-p95-ms-h X]\n", argv[0]);
+        return 2;
+    }
+
+    std::string frameDirectory = (std::filesystem::temp_directory_path() / "soak_pipeline").string();
+    std::error_code ec;
+    std::filesystem::remove_all(frameDirectory, ec);
+
+    FILE* csv = options.csvPath.empty() ? nullptr : std::fopen(options.csvPath.c_str(), "w");
+    if (csv) {
+        std::fprintf(csv, "seconds,rss_bytes,handles,threads,temp_bytes,completed,failed,timed_out,p50_ms,p95_ms,p99_ms\n");
+    }
+
+    std::printf("%d camera(s) at %.1f fps, stub inference %d ms, %.0f s (warm-up %.0f s)%s\n", options.cameras,
+                options.fps, options.latencyMs, options.durationSeconds, options.warmupSeconds,
+                options.restartSeconds > 0.0 ? ", restarting the pipeline periodically" : "");
+    std::printf("%8s %9s %8s %8s %9s %8s %6s %6s %8s %8s %8s\n", "time s", "rss MB", "handles", "threads", "temp KB",
+                "results", "failed", "late", "p50 ms", "p95 ms", "p99 ms");
+
+    Outcomes outcomes;
+    WorkerPoolStats workerTotals = {};
+    auto pipeline = std::make_unique<SoakPipeline>(options, argv[0], frameDirectory, outcomes, workerTotals);
+    std::vector<Sample> samples;
+    bool stalled = false;
+    Clock::time_point start = Clock::now();
+    Clock::time_point lastRestart = start;
+    for (int tick = 1; ; ++tick) {
+        Clock::time_point due = start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(tick * options.sampleSeconds));
+        std::this_thread::sleep_until(due);
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+        Sample sample;
+        sample.seconds = elapsed;
+        sample.process = sampleProcessStats();
+        sample.tempBytes = directorySize(frameDirectory);
+        std::vector<double> latencies;
+        outcomes.take(latencies, sample.failed, sample.timedOut);
+        sample.completed = latencies.size();
+        sample.p50Ms = percentile(latencies, 0.50);
+        sample.p95Ms = percentile(latencies, 0.95);
+        sample.p99Ms = percentile(latencies, 0.99);
+        samples.push_back(sample);
+        if (sample.completed == 0) {
+            stalled = true;
+        }
+
+        std::printf("%8.0f %9.1f %8zu %8zu %9.0f %8zu %6llu %6llu %8.1f %8.1f %8.1f\n", sample.seconds,
+                    sample.process.residentBytes / 1048576.0, sample.process.openHandles, sample.process.threads,
+                    sample.tempBytes / 1024.0, sample.completed, static_cast<unsigned long long>(sample.failed),
+                    static_cast<unsigned long long>(sample.timedOut), sample.p50Ms, sample.p95Ms, sample.p99Ms);
+        std::fflush(stdout);
+        if (csv) {
+            std::fprintf(csv, "%.1f,%llu,%zu,%zu,%llu,%zu,%llu,%llu,%.2f,%.2f,%.2f\n", sample.seconds,
+                         static_cast<unsigned long long>(sample.process.residentBytes), sample.process.openHandles,
+                         sample.process.threads, static_cast<unsigned long long>(sample.tempBytes), sample.completed,
+                         static_cast<unsigned long long>(sample.failed),
+                         static_cast<unsigned long long>(sample.timedOut), sample.p50Ms, sample.p95Ms, sample.p99Ms);
+            std::fflush(csv);
+        }
+
+        if (elapsed >= options.durationSeconds) {
+            break;
+        }
+        // Between samples, so every sample sees a running pipeline
+        if (options.restartSeconds > 0.0 &&
+            std::chrono::duration<double>(Clock::now() - lastRestart).count() >= options.restartSeconds) {
+            pipeline.reset();
+            pipeline = std::make_unique<SoakPipeline>(options, argv[0], frameDirectory, outcomes, workerTotals);
+            lastRestart = Clock::now();
+        }
+    }
+    pipeline.reset();
+    std::printf("\nWorkers: %llu exited, %llu hung, %llu standby promotions, %llu cold starts, "
+                "%llu requests resent, longest recovery %.0f ms\n",
+                static_cast<unsigned long long>(workerTotals.exits), static_cast<unsigned long long>(workerTotals.hangs),
+                static_cast<unsigned long long>(workerTotals.promotions),
+                static_cast<unsigned long long>(workerTotals.coldStarts),
+                static_cast<unsigned long long>(workerTotals.redispatched), workerTotals.maxRecoveryMs);
+    if (csv) {
+        std::fclose(csv);
+    }
+
+    std::vector<Sample> steady;
+    for (const Sample& sample : samples) {
+        if (sample.seconds >= options.warmupSeconds) {
+            steady.push_back(sample);
+        }
+    }
+    if (steady.size() < 3) {
+        std::fprintf(stderr, "Too few samples after the warm-up to fit trends; run longer or sample more often\n");
+        return 2;
+    }
+
+    struct Check {
+        const char* name;
+        const char* unit;
+        double (*value)(const Sample&);
+        double limit;
+    };
+    const Check checks[] = {
+        {"resident memory", "MB", [](const Sample& s) { return s.process.residentBytes / 1048576.0; },
+         options.maxRssMbPerHour},
+        {"open handles", "", [](const Sample& s) { return static_cast<double>(s.process.openHandles); },
+         options.maxHandlesPerHour},
+        {"threads", "", [](const Sample& s) { return static_cast<double>(s.process.threads); },
+         options.maxThreadsPerHour},
+        {"frame directory", "MB", [](const Sample& s) { return s.tempBytes / 1048576.0; }, options.maxTempMbPerHour},
+        {"p95 latency", "ms", [](const Sample& s) { return s.p95Ms; }, options.maxP95MsPerHour},
+    };
+
+    bool passed = !stalled;
+    std::printf("Trends after the warm-up (%zu samples):\n", steady.size());
+    for (const Check& check : checks) {
+        double slope = slopePerHour(steady, check.value);
+        bool ok = slope <= check.limit;
+        passed = passed && ok;
+        std::printf("  %-16s %+10.2f %s/h (limit %.2f) %s\n", check.name, slope, check.unit, check.limit,
+                    ok ? "ok" : "FAIL");
+    }
+    if (stalled) {
+        std::printf("  FAIL: at least one interval completed no frames\n");
+    }
+    std::printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -8,16 +8,19 @@ import sys
 import cv2
 import os
 import time
+from log_setup import get_logger
+
+log = get_logger('capture_frame')
 
 def capture_frame(device_id, output_path):
     """Capture a single frame from webcam"""
     try:
-        print(f"Capturing frame from device {device_id} to {output_path}", file=sys.stderr)
+        log.debug(f"Capturing frame from device {device_id} to {output_path}")
         
         # Open camera
         cap = cv2.VideoCapture(device_id)
         if not cap.isOpened():
-            print(f"Error: Could not open camera {device_id}", file=sys.stderr)
+            log.error(f"Could not open camera {device_id}")
             return False
         
         # Set camera properties for better performance
@@ -32,14 +35,14 @@ def capture_frame(device_id, output_path):
         for i in range(3):
             ret, frame = cap.read()
             if not ret:
-                print(f"Warning: Could not read frame {i+1}", file=sys.stderr)
+                log.warning(f"Could not read frame {i+1}")
                 time.sleep(0.1)
                 continue
         
         # Capture final frame
         ret, frame = cap.read()
         if not ret:
-            print("Error: Could not read final frame", file=sys.stderr)
+            log.error("Could not read final frame")
             cap.release()
             return False
         
@@ -48,14 +51,14 @@ def capture_frame(device_id, output_path):
         cap.release()
         
         if success:
-            print(f"Frame saved successfully: {output_path}", file=sys.stderr)
+            log.debug(f"Frame saved successfully: {output_path}")
             return True
         else:
-            print(f"Error: Could not save frame to {output_path}", file=sys.stderr)
+            log.error(f"Could not save frame to {output_path}")
             return False
             
     except Exception as e:
-        print(f"Exception in capture_frame: {str(e)}", file=sys.stderr)
+        log.error(f"Exception in capture_frame: {str(e)}")
         return False
 
 def main():
@@ -71,25 +74,25 @@ def main():
         os.makedirs(os.path.dirname(output_path), exist_ok=True)
         
         # Test OpenCV availability
-        print(f"OpenCV version: {cv2.__version__}", file=sys.stderr)
+        log.debug(f"OpenCV version: {cv2.__version__}")
         
         success = capture_frame(device_id, output_path)
         
         if success:
-            print("Frame capture SUCCESSFUL", file=sys.stderr)
+            log.debug("Frame capture SUCCESSFUL")
             sys.exit(0)
         else:
-            print("Frame capture FAILED", file=sys.stderr)
+            log.error("Frame capture FAILED")
             sys.exit(1)
         
     except ValueError:
-        print("Error: device_id must be an integer", file=sys.stderr)
+        log.error("device_id must be an integer")
         sys.exit(1)
     except ImportError as e:
-        print(f"Error: OpenCV not available - {str(e)}", file=sys.stderr)
+        log.error(f"OpenCV not available - {str(e)}")
         sys.exit(1)
     except Exception as e:
-        print(f"Error: {str(e)}", file=sys.stderr)
+        log.error(f"{str(e)}")
         sys.exit(1)
 
 if __name__ == '__main__':
@@ -2,110 +2,531 @@
 """
 YOLO Detection Server
 Handles object detection requests from the C++ UI
+
+One-shot:   python detection_server.py <json_request>
+Persistent: python detection_server.py --serve [--model-budget-mb N] [--preload a,b]
+                [--warmup] [--heartbeat-ms N]
+                [--intra-op-threads N] [--inter-op-threads N] [--cpus 0-3,8]
+            Reads one JSON request per line on stdin and writes one JSON
+            response per line on stdout. A line of the form
+            {"batch": [request, ...]} is inferred as one batch and answered
+            with one response line per request, in order.
+            {"command": "status"} reports the resident models.
+            {"ready": true, ...} is written once the preloaded models are
+            loaded (and, with --warmup, have run once), and with
+            --heartbeat-ms {"heartbeat": n} every N ms from a thread of its
+            own, between responses, so the client can tell a busy worker
+            from a hung one.
+Network:    python detection_server.py --serve --listen HOST:PORT [...]
+            Same protocol over TCP, one message stream per connection, so
+            several capture hosts can share this machine's inference. Batches
+            from all connections run one at a time; status is answered at
+            once even while a batch is running.
+
+The thread options bound torch's (and OpenCV's) thread pools so several
+workers on one host do not oversubscribe its cores; --cpus pins the worker
+to those CPUs where the OS allows it (the C++ client pins its own workers).
+
+A request names its image by "image_path", or carries the encoded bytes
+base64 in "image_data" when the worker runs on another machine. Raw pixels
+from the embedding library come as "pixels": {"width", "height", "stride",
+"format" (bgr, rgb, bgra, rgba, gray)} with either "shm", the path of a file
+the client staged them in, which is mapped and read in place, or "data",
+the rows base64.
+
+Requests may set "inference_size" (longest model input side, 0 = pick from
+the source) and "crop" ([x, y, width, height] in image pixels) to infer only
+that region. Boxes are returned in model input pixels together with the
+"letterbox" transform that maps them back to the source image; for a crop
+it includes the region's origin as "crop_x"/"crop_y".
 """
 
+import os
 import sys
+import gc
 import json
 import time
+import mmap
+import base64
+import argparse
+import threading
+import socketserver
+from collections import OrderedDict
 import torch
 import cv2
 import numpy as np
 from pathlib import Path
+from preprocess import DEFAULT_INFERENCE_SIZE, InputBuffers, load_letterboxed
+from log_setup import get_logger
+
+log = get_logger('detection_server')
+
+def parse_cpu_list(text):
+    """'0-3,8' -> [0, 1, 2, 3, 8]"""
+    cpus = []
+    for part in text.split(','):
+        part = part.strip()
+        if not part:
+            continue
+        first, _, last = part.partition('-')
+        cpus.extend(range(int(first), int(last or first) + 1))
+    return cpus
+
+def apply_thread_budget(intra_op_threads, inter_op_threads, cpus):
+    """Bound the thread pools before the first model runs; 0 keeps the library default"""
+    if cpus and hasattr(os, 'sched_setaffinity'):
+        os.sched_setaffinity(0, cpus)
+    if inter_op_threads > 0:
+        torch.set_num_interop_threads(inter_op_threads)
+    if intra_op_threads > 0:
+        torch.set_num_threads(intra_op_threads)
+        cv2.setNumThreads(intra_op_threads)
+
+def thread_report():
+    report = {
+        'intra_op': torch.get_num_threads(),
+        'inter_op': torch.get_num_interop_threads(),
+    }
+    if hasattr(os, 'sched_getaffinity'):
+        report['cpus'] = sorted(os.sched_getaffinity(0))
+    return report
+
+def encode_response(response):
+    """Compact JSON: the C++ client matches '"key":value' without spaces"""
+    return json.dumps(response, separators=(',', ':'))
+
+def save_annotated(image_path, rendered, letterbox_info):
+    """Write the rendered detections at the source resolution, padding removed"""
+    pad_x, pad_y = letterbox_info['pad_x'], letterbox_info['pad_y']
+    scaled_width = int(round(letterbox_info['source_width'] * letterbox_info['scale_x']))
+    scaled_height = int(round(letterbox_info['source_height'] * letterbox_info['scale_y']))
+    content = rendered[pad_y:pad_y + scaled_height, pad_x:pad_x + scaled_width]
+    content = cv2.resize(content, (letterbox_info['source_width'], letterbox_info['source_height']))
+
+    annotated_path = str(Path(image_path).with_suffix('.annotated.jpg'))
+    cv2.imwrite(annotated_path, cv2.cvtColor(content, cv2.COLOR_RGB2BGR))
+    return annotated_path
+
+def model_size_bytes(model):
+    """Bytes held by a model's parameters and buffers"""
+    tensors = list(model.parameters()) + list(model.buffers())
+    return sum(t.numel() * t.element_size() for t in tensors)
+
+PIXEL_CHANNELS = {'bgr': 3, 'rgb': 3, 'bgra': 4, 'rgba': 4, 'gray': 1}
+PIXEL_TO_BGR = {
+    'rgb': cv2.COLOR_RGB2BGR,
+    'bgra': cv2.COLOR_BGRA2BGR,
+    'rgba': cv2.COLOR_RGBA2BGR,
+    'gray': cv2.COLOR_GRAY2BGR,
+}
+
+class SharedPixels:
+    """Raw pixel requests as BGR arrays, reading staged files in place
+
+    The client's slot files never shrink and a grown slot gets a new name,
+    so a mapping stays valid and is kept for the slot's next frames."""
+
+    def __init__(self, limit=64):
+        self.mappings = OrderedDict()
+        self.limit = limit
+
+    def mapping(self, path, size):
+        mapping = self.mappings.get(path)
+        if mapping is None or len(mapping) < size:
+            with open(path, 'rb') as f:
+                mapping = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+            self.mappings[path] = mapping
+            # Dropped, not closed: an array from the last batch may still view it
+            while len(self.mappings) > self.limit:
+                self.mappings.popitem(last=False)
+        self.mappings.move_to_end(path)
+        return mapping
+
+    def image(self, pixels):
+        width, height, stride = int(pixels['width']), int(pixels['height']), int(pixels['stride'])
+        pixel_format = pixels.get('format', 'bgr')
+        channels = PIXEL_CHANNELS.get(pixel_format)
+        if channels is None:
+            raise Exception(f"Unknown pixel format: {pixel_format}")
+        if width <= 0 or height <= 0 or stride < width * channels:
+            raise Exception(f"Bad pixel layout: {width}x{height}, stride {stride}")
+        size = stride * (height - 1) + width * channels
+        if 'shm' in pixels:
+            buffer = self.mapping(pixels['shm'], size)
+        else:
+            buffer = base64.b64decode(pixels['data'])
+        if len(buffer) < size:
+            raise Exception(f"Pixel buffer holds {len(buffer)} bytes, {size} expected")
+        rows = np.ndarray((height, width, channels), dtype=np.uint8, buffer=buffer, strides=(stride, channels, 1))
+        if pixel_format == 'bgr':
+            return rows
+        return cv2.cvtColor(rows, PIXEL_TO_BGR[pixel_format])
+
+class ModelResidencyManager:
+    """Keeps loaded models within a memory budget, evicting least recently used"""
+
+    def __init__(self, loader, budget_mb=1024):
+        self.loader = loader
+        self.budget_bytes = int(budget_mb * 1024 * 1024)
+        self.models = OrderedDict()   # name -> entry, least recently used first
+        self.known_sizes = {}         # sizes of models seen before, for evicting ahead of a load
+        self.hits = 0
+        self.misses = 0
+        self.evictions = 0
+        self.last_load_ms = 0
+
+    def resident_bytes(self):
+        return sum(entry['bytes'] for entry in self.models.values())
+
+    def get(self, model_name):
+        """Return a resident model, loading (and evicting) if needed"""
+        entry = self.models.get(model_name)
+        if entry is not None:
+            self.models.move_to_end(model_name)
+            entry['hits'] += 1
+            self.hits += 1
+            self.last_load_ms = 0
+            return entry['model']
+
+        self.misses += 1
+        # Make room before loading when the size is known, to avoid a transient peak
+        self.evict_to_fit(self.known_sizes.get(model_name, 0))
+
+        start_time = time.time()
+        model = self.loader(model_name)
+        load_ms = int((time.time() - start_time) * 1000)
+
+        size = model_size_bytes(model)
+        self.known_sizes[model_name] = size
+        self.models[model_name] = {
+            'model': model,
+            'bytes': size,
+            'load_ms': load_ms,
+            'hits': 0
+        }
+        self.last_load_ms = load_ms
+        self.evict_to_fit(0, keep=model_name)
+
+        log.info(f"Model {model_name} loaded in {load_ms} ms ({size / 1048576:.0f} MB); "
+                 f"resident: {list(self.models)} "
+                 f"{self.resident_bytes() / 1048576:.0f}/{self.budget_bytes / 1048576:.0f} MB")
+        return model
+
+    def evict_to_fit(self, incoming_bytes, keep=None):
+        """Drop least recently used models until incoming_bytes fits the budget"""
+        while self.models and self.resident_bytes() + incoming_bytes > self.budget_bytes:
+            victim = next((name for name in self.models if name != keep), None)
+            if victim is None:
+                break   # A single model larger than the budget stays resident
+            del self.models[victim]
+            self.evictions += 1
+            log.info(f"Evicted model {victim}")
+
+            gc.collect()
+            if torch.cuda.is_available():
+                torch.cuda.empty_cache()
+
+    def preload(self, model_names):
+        for model_name in model_names:
+            try:
+                self.get(model_name)
+            except Exception as e:
+                log.error(f"Preload of {model_name} failed: {str(e)}")
+
+    def report(self):
+        # Snapshot first: TCP workers answer status while a batch may be loading a model
+        models = list(self.models.items())
+        return {
+            'budget_mb': round(self.budget_bytes / 1048576, 1),
+            'resident_mb': round(sum(entry['bytes'] for _, entry in models) / 1048576, 1),
+            'models': [{
+                'name': name,
+                'mb': round(entry['bytes'] / 1048576, 1),
+                'load_ms': entry['load_ms'],
+                'hits': entry['hits']
+            } for name, entry in models],
+            'hits': self.hits,
+            'misses': self.misses,
+            'evictions': self.evictions
+        }
 
 class YOLODetectionServer:
-    def __init__(self):
-        self.models = {}
+    def __init__(self, model_budget_mb=1024):
         self.device = torch.device('cuda' if torch.cuda.is_available() else 'cpu')
-        print(f"Using device: {self.device}", file=sys.stderr)
-    
+        self.residency = ModelResidencyManager(self.create_model, model_budget_mb)
+        self.input_buffers = InputBuffers()
+        self.shared_pixels = SharedPixels()
+        # Held for a whole batch: models and input buffers are shared
+        self.inference_lock = threading.Lock()
+        log.info(f"Using device: {self.device}")
+
+    def create_model(self, model_name):
+        """Load a YOLO model from the hub cache onto the device"""
+        try:
+            log.info(f"Loading model: {model_name}")
+            model = torch.hub.load('ultralytics/yolov5', model_name, pretrained=True)
+            model.to(self.device)
+            model.eval()
+            return model
+        except Exception as e:
+            raise Exception(f"Failed to load model {model_name}: {str(e)}")
+
     def load_model(self, model_name='yolov5s'):
-        """Load YOLO model if not already loaded"""
-        if model_name not in self.models:
+        """Return the model, served from memory when it is resident"""
+        return self.residency.get(model_name)
+    
+    def prepare_image(self, request, slot):
+        """Decode the request's image straight into a letterboxed model input"""
+        inference_size = request.get('inference_size', DEFAULT_INFERENCE_SIZE)
+        crop = request.get('crop')
+        if 'pixels' in request:
+            image = self.shared_pixels.image(request['pixels'])
+            return load_letterboxed(request.get('image_path') or 'raw pixels', inference_size,
+                                    self.input_buffers, slot, crop=crop, image=image)
+        if 'image_data' in request:
+            data = np.frombuffer(base64.b64decode(request['image_data']), dtype=np.uint8)
+            return load_letterboxed(request.get('image_path', 'inline image'), inference_size,
+                                    self.input_buffers, slot, data=data, crop=crop)
+
+        image_path = request['image_path']
+        if not Path(image_path).exists():
+            raise Exception(f"Image file not found: {image_path}")
+
+        return load_letterboxed(image_path, inference_size, self.input_buffers, slot, crop=crop)
+
+    def detect_batch(self, requests):
+        """Run several requests, batching those that share model, thresholds and input size"""
+        responses = [None] * len(requests)
+        prepared = [None] * len(requests)
+        groups = {}
+        for index, request in enumerate(requests):
             try:
-                print(f"Loading model: {model_name}", file=sys.stderr)
-                model = torch.hub.load('ultralytics/yolov5', model_name, pretrained=True)
-                model.to(self.device)
-                model.eval()
-                self.models[model_name] = model
-                print(f"Model {model_name} loaded successfully", file=sys.stderr)
+                prepared[index] = self.prepare_image(request, index)
             except Exception as e:
-                raise Exception(f"Failed to load model {model_name}: {str(e)}")
-        
-        return self.models[model_name]
-    
+                responses[index] = {
+                    'success': False,
+                    'error': str(e),
+                    'processing_time': 0
+                }
+                continue
+
+            letterbox_info = prepared[index][1]
+            key = (request.get('model_name', 'yolov5s'),
+                   request.get('confidence_threshold', 0.5),
+                   request.get('iou_threshold', 0.45),
+                   max(letterbox_info['input_width'], letterbox_info['input_height']))
+            groups.setdefault(key, []).append(index)
+
+        for (model_name, confidence_threshold, iou_threshold, size), indices in groups.items():
+            try:
+                model = self.load_model(model_name)
+                model_load_ms = self.residency.last_load_ms
+                model.conf = confidence_threshold
+                model.iou = iou_threshold
+
+                # Inputs are already letterboxed to a stride multiple, so the
+                # model's own resize is a no-op and boxes come back in input pixels
+                start_time = time.time()
+                results = model([prepared[i][0] for i in indices], size=size)
+                processing_time = int((time.time() - start_time) * 1000)
+
+                for slot, i in enumerate(indices):
+                    letterbox_info = prepared[i][1]
+                    responses[i] = {
+                        'success': True,
+                        'detections': self.collect_detections(model, results.xyxy[slot]),
+                        'letterbox': letterbox_info,
+                        'processing_time': processing_time,
+                        'batch_size': len(indices),
+                        'model_load_ms': model_load_ms,
+                        'model_used': model_name,
+                        'device_used': str(self.device)
+                    }
+
+                # Only next to a local file; an inline image's path belongs to another machine
+                annotate = [i for i in indices
+                            if requests[i].get('save_annotated', False) and 'image_data' not in requests[i]
+                            and 'pixels' not in requests[i]
+                            and 'crop' not in requests[i]]
+                if annotate:
+                    rendered = results.render()
+                    for slot, i in enumerate(indices):
+                        if i in annotate:
+                            responses[i]['annotated_image_path'] = save_annotated(
+                                requests[i]['image_path'], rendered[slot], prepared[i][1])
+            except Exception as e:
+                for i in indices:
+                    responses[i] = {
+                        'success': False,
+                        'error': str(e),
+                        'processing_time': 0
+                    }
+
+        for request, response in zip(requests, responses):
+            if 'id' in request:
+                response['id'] = request['id']
+        return responses
+
+    def collect_detections(self, model, boxes):
+        """Convert one image's xyxy tensor to response dicts, in input pixels"""
+        detections = []
+        for *box, conf, cls in boxes.cpu().numpy():
+            x1, y1, x2, y2 = (float(v) for v in box)
+            detections.append({
+                'class': model.names[int(cls)],
+                'class_id': int(cls),
+                'confidence': float(conf),
+                'bbox': [round(x1, 2), round(y1, 2), round(x2 - x1, 2), round(y2 - y1, 2)]  # [x, y, width, height]
+            })
+        return detections
+
     def detect_objects(self, request):
         """Perform object detection on the given image"""
+        return self.detect_batch([request])[0]
+
+    def warm_up(self, model_names):
+        """One inference per model on a blank frame, so the first real
+        request does not pay for lazy initialisation; returns the ms taken"""
+        start_time = time.time()
+        width, height = DEFAULT_INFERENCE_SIZE, DEFAULT_INFERENCE_SIZE * 3 // 4
+        blank = base64.b64encode(bytes(width * height)).decode('ascii')
+        for model_name in model_names:
+            response = self.detect_objects({
+                'model_name': model_name,
+                'pixels': {'width': width, 'height': height, 'stride': width, 'format': 'gray', 'data': blank}
+            })
+            if not response['success']:
+                log.warning(f"Warm-up of {model_name} failed: {response['error']}")
+        return int((time.time() - start_time) * 1000)
+
+def handle_message(server, line):
+    """Response lines for one protocol line; empty for a blank line"""
+    line = line.strip()
+    if not line:
+        return []
+
+    try:
+        message = json.loads(line)
+    except json.JSONDecodeError as e:
+        return [{
+            'success': False,
+            'error': f'Invalid JSON request: {str(e)}'
+        }]
+
+    if message.get('command') == 'status':
+        return [{
+            'success': True,
+            'residency': server.residency.report(),
+            'threads': thread_report()
+        }]
+    with server.inference_lock:
+        if 'batch' in message:
+            return server.detect_batch(message['batch'])
+        return [server.detect_objects(message)]
+
+class WorkerConnectionHandler(socketserver.StreamRequestHandler):
+    """One client connection: protocol lines in, response lines out"""
+    def handle(self):
+        for raw in self.rfile:
+            responses = handle_message(self.server.detection_server, raw.decode('utf-8'))
+            try:
+                for response in responses:
+                    self.wfile.write((encode_response(response) + '\n').encode('utf-8'))
+                self.wfile.flush()
+            except OSError:
+                return  # Client went away mid-batch
+
+class WorkerTCPServer(socketserver.ThreadingTCPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+def listen(server, address):
+    """Serve the protocol to TCP clients until interrupted"""
+    host, _, port = address.rpartition(':')
+    with WorkerTCPServer((host or '0.0.0.0', int(port)), WorkerConnectionHandler) as tcp_server:
+        tcp_server.detection_server = server
+        log.info(f"Listening on {host or '0.0.0.0'}:{port}")
         try:
-            # Parse request
-            image_path = request['image_path']
-            confidence_threshold = request.get('confidence_threshold', 0.5)
-            iou_threshold = request.get('iou_threshold', 0.45)
-            model_name = request.get('model_name', 'yolov5s')
-            save_annotated = request.get('save_annotated', False)
-            
-            # Validate image path
-            if not Path(image_path).exists():
-                raise Exception(f"Image file not found: {image_path}")
-            
-            # Load model
-            model = self.load_model(model_name)
-            
-            # Configure model
-            model.conf = confidence_threshold
-            model.iou = iou_threshold
-            
-            # Start timing
-            start_time = time.time()
-            
-            # Run inference
-            results = model(image_path)
-            
-            # Process results
-            detections = []
-            for *box, conf, cls in results.xyxy[0].cpu().numpy():
-                x1, y1, x2, y2 = map(int, box)
-                class_name = model.names[int(cls)]
-                
-                detection = {
-                    'class': class_name,
-                    'confidence': float(conf),
-                    'bbox': [x1, y1, x2 - x1, y2 - y1]  # [x, y, width, height]
-                }
-                detections.append(detection)
-            
-            # Calculate processing time
-            processing_time = int((time.time() - start_time) * 1000)
-            
-            # Save annotated image if requested
-            annotated_path = None
-            if save_annotated:
-                annotated_path = str(Path(image_path).with_suffix('.annotated.jpg'))
-                results.save(save_dir=Path(annotated_path).parent, exist_ok=True)
-            
-            # Prepare response
-            response = {
-                'success': True,
-                'detections': detections,
-                'processing_time': processing_time,
-                'model_used': model_name,
-                'device_used': str(self.device)
-            }
-            
-            if annotated_path:
-                response['annotated_image_path'] = annotated_path
-            
-            return response
-            
-        except Exception as e:
-            return {
-                'success': False,
-                'error': str(e),
-                'processing_time': 0
-            }
+            tcp_server.serve_forever()
+        except KeyboardInterrupt:
+            pass
+
+def start_heartbeat(protocol_out, write_lock, interval_ms):
+    """Report in every interval from a daemon thread, which keeps beating
+    while inference runs but stops with a stopped or deadlocked process"""
+    def beat():
+        count = 0
+        while True:
+            time.sleep(interval_ms / 1000)
+            count += 1
+            with write_lock:
+                protocol_out.write(encode_response({'heartbeat': count}) + '\n')
+                protocol_out.flush()
+    threading.Thread(target=beat, name='heartbeat', daemon=True).start()
+
+def serve(args):
+    """Persistent worker loop: the model stays loaded between requests"""
+    started = time.time()
+    # Keep stdout for the protocol only; library chatter goes to stderr
+    protocol_out = sys.stdout
+    sys.stdout = sys.stderr
+
+    apply_thread_budget(args.intra_op_threads, args.inter_op_threads, parse_cpu_list(args.cpus))
+    # Lines from the heartbeat thread and the main loop must not interleave
+    write_lock = threading.Lock()
+    if args.heartbeat_ms > 0 and not args.listen:
+        start_heartbeat(protocol_out, write_lock, args.heartbeat_ms)
+
+    server = YOLODetectionServer(args.model_budget_mb)
+    models = [name for name in args.preload.split(',') if name]
+    if models:
+        server.residency.preload(models)
+    warmup_ms = server.warm_up(models) if args.warmup else 0
+
+    if args.listen:
+        listen(server, args.listen)
+        return
+
+    with write_lock:
+        protocol_out.write(encode_response({
+            'ready': True,
+            'startup_ms': int((time.time() - started) * 1000),
+            'warmup_ms': warmup_ms
+        }) + '\n')
+        protocol_out.flush()
+
+    for line in sys.stdin:
+        responses = handle_message(server, line)
+        with write_lock:
+            for response in responses:
+                protocol_out.write(encode_response(response) + '\n')
+            protocol_out.flush()
 
 def main():
+    if len(sys.argv) >= 2 and sys.argv[1] == '--serve':
+        parser = argparse.ArgumentParser(description='Persistent YOLO detection worker')
+        parser.add_argument('--serve', action='store_true')
+        parser.add_argument('--model-budget-mb', type=float, default=1024,
+                            help='memory budget for resident models (LRU eviction above it)')
+        parser.add_argument('--preload', default='',
+                            help='comma-separated models to load before the first request')
+        parser.add_argument('--warmup', action='store_true',
+                            help='run each preloaded model once before reporting ready')
+        parser.add_argument('--heartbeat-ms', type=int, default=0,
+                            help='write a heartbeat line this often; 0 = none')
+        parser.add_argument('--listen', default='',
+                            help='HOST:PORT to serve over TCP instead of stdin/stdout')
+        parser.add_argument('--intra-op-threads', type=int, default=0,
+                            help='threads inside one operator (torch.set_num_threads); 0 = default')
+        parser.add_argument('--inter-op-threads', type=int, default=0,
+                            help='threads running independent operators; 0 = default')
+        parser.add_argument('--cpus', default='',
+                            help='CPUs to run on, e.g. 0-3,8; empty = any')
+        serve(parser.parse_args())
+        return
+
     if len(sys.argv) != 2:
-        print(json.dumps({
+        print(encode_response({
             'success': False,
             'error': 'Usage: python detection_server.py <json_request>'
         }))
@@ -123,16 +544,16 @@ def main():
         response = server.detect_objects(request)
         
         # Output JSON response
-        print(json.dumps(response))
+        print(encode_response(response))
         
     except json.JSONDecodeError as e:
-        print(json.dumps({
+        print(encode_response({
             'success': False,
             'error': f'Invalid JSON request: {str(e)}'
         }))
         sys.exit(1)
     except Exception as e:
-        print(json.dumps({
+        print(encode_response({
             'success': False,
             'error': f'Server error: {str(e)}'
         }))
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""
+Logging for the Python scripts, matching the C++ side's logger: records are
+handed to a background thread that writes them to stderr, so a slow console
+never stalls inference or capture, and each call site may log at most
+YOLO_LOG_RATE records per second (0 = unlimited). YOLO_LOG_LEVEL (debug,
+info, warning, error, off) sets the lowest level written.
+"""
+
+import atexit
+import logging
+import logging.handlers
+import os
+import queue
+import sys
+import threading
+import time
+
+DEFAULT_RATE = 20
+
+
+class RateLimitFilter(logging.Filter):
+    """At most per_second records per call site in each one-second window;
+    the number held back is appended to the site's next record"""
+
+    def __init__(self, per_second):
+        super().__init__()
+        self.per_second = per_second
+        self.sites = {}
+        self.lock = threading.Lock()
+
+    def filter(self, record):
+        if self.per_second <= 0:
+            return True
+        key = (record.pathname, record.lineno)
+        now = time.monotonic()
+        with self.lock:
+            start, count, suppressed = self.sites.get(key, (now, 0, 0))
+            if now - start >= 1.0:
+                start, count = now, 0
+            if count >= self.per_second:
+                self.sites[key] = (start, count, suppressed + 1)
+                return False
+            self.sites[key] = (start, count + 1, 0)
+        if suppressed:
+            record.msg = f"{record.getMessage()} ({suppressed} more from here suppressed)"
+            record.args = None
+        return True
+
+
+_configured = False
+_lock = threading.Lock()
+
+
+def _configure():
+    global _configured
+    with _lock:
+        if _configured:
+            return
+        _configured = True
+
+        root = logging.getLogger('yolo')
+        root.propagate = False
+        level_name = os.environ.get('YOLO_LOG_LEVEL', 'info').lower()
+        if level_name == 'off':
+            root.setLevel(logging.CRITICAL + 1)
+        else:
+            root.setLevel(getattr(logging, 'WARNING' if level_name == 'warn' else level_name.upper(), logging.INFO))
+
+        try:
+            rate = int(os.environ.get('YOLO_LOG_RATE', DEFAULT_RATE))
+        except ValueError:
+            rate = DEFAULT_RATE
+
+        # Bound to the real stderr: the worker points sys.stdout at stderr
+        # to keep library chatter off its protocol stream
+        output = logging.StreamHandler(sys.stderr)
+        output.setFormatter(logging.Formatter(
+            '%(asctime)s.%(msecs)03d %(levelname)-7s [%(process)d] %(filename)s:%(lineno)d: %(message)s',
+            '%Y-%m-%d %H:%M:%S'))
+        records = queue.SimpleQueue()
+        handler = logging.handlers.QueueHandler(records)
+        handler.addFilter(RateLimitFilter(rate))
+        root.addHandler(handler)
+
+        listener = logging.handlers.QueueListener(records, output)
+        listener.start()
+        # Writes out what is queued before the interpreter exits
+        atexit.register(listener.stop)
+
+
+def get_logger(name):
+    """Logger under the shared 'yolo' hierarchy, configured on first use"""
+    _configure()
+    return logging.getLogger(f'yolo.{name}')
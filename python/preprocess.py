@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+"""
+Image preprocessing for the detection worker
+
+Turns an image file into a letterboxed model input. JPEGs are decoded with
+libjpeg-turbo's DCT-domain scaling (1/2, 1/4, 1/8, exposed by OpenCV as
+IMREAD_REDUCED_COLOR_*) at the smallest scale that still covers the model
+input, so a 12MP still never materialises at full resolution. The decoded
+image is resized straight into a reusable padded input buffer.
+"""
+
+import cv2
+import numpy as np
+
+INFERENCE_SIZES = (320, 416, 512, 640, 1280)
+DEFAULT_INFERENCE_SIZE = 640
+MODEL_STRIDE = 32
+PAD_VALUE = 114
+
+# Largest reduction first; 1 is a full decode
+JPEG_SCALES = (8, 4, 2, 1)
+REDUCED_FLAGS = {
+    1: cv2.IMREAD_COLOR,
+    2: cv2.IMREAD_REDUCED_COLOR_2,
+    4: cv2.IMREAD_REDUCED_COLOR_4,
+    8: cv2.IMREAD_REDUCED_COLOR_8,
+}
+
+# Start-of-frame markers carry the image size; DHT/JPG/DAC share the range
+SOF_MARKERS = {0xC0, 0xC1, 0xC2, 0xC3, 0xC5, 0xC6, 0xC7, 0xC9, 0xCA, 0xCB, 0xCD, 0xCE, 0xCF}
+
+def jpeg_size(data):
+    """(width, height) from a JPEG's frame header, or None if data is not a JPEG"""
+    if len(data) < 4 or data[0] != 0xFF or data[1] != 0xD8:
+        return None
+
+    pos = 2
+    while pos + 4 <= len(data):
+        if data[pos] != 0xFF:
+            return None
+        marker = data[pos + 1]
+        if marker == 0xFF:
+            pos += 1    # Fill byte
+            continue
+        if marker in (0xD8, 0x01) or 0xD0 <= marker <= 0xD7:
+            pos += 2    # Markers without a length
+            continue
+
+        length = (int(data[pos + 2]) << 8) | int(data[pos + 3])
+        if marker in SOF_MARKERS:
+            if pos + 9 > len(data):
+                return None
+            height = (int(data[pos + 5]) << 8) | int(data[pos + 6])
+            width = (int(data[pos + 7]) << 8) | int(data[pos + 8])
+            return (width, height) if width and height else None
+        if marker == 0xDA:
+            return None     # Scan data before any frame header
+        pos += 2 + length
+    return None
+
+def resolve_inference_size(requested, width, height):
+    """0 picks the smallest standard size covering the source; others round up to the stride"""
+    requested = int(requested or 0)
+    if requested <= 0:
+        longest = max(width, height)
+        return next((size for size in INFERENCE_SIZES if size >= longest), INFERENCE_SIZES[-1])
+    return max(MODEL_STRIDE, -(-requested // MODEL_STRIDE) * MODEL_STRIDE)
+
+def fit_size(width, height, inference_size):
+    """Scaled image size and padded input size for a source of width x height"""
+    ratio = inference_size / max(width, height)
+    scaled_width = max(1, int(round(width * ratio)))
+    scaled_height = max(1, int(round(height * ratio)))
+    input_width = -(-scaled_width // MODEL_STRIDE) * MODEL_STRIDE
+    input_height = -(-scaled_height // MODEL_STRIDE) * MODEL_STRIDE
+    return scaled_width, scaled_height, input_width, input_height
+
+def choose_jpeg_scale(width, height, scaled_width, scaled_height):
+    """Largest DCT reduction whose output still covers the scaled size"""
+    for scale in JPEG_SCALES:
+        if -(-width // scale) >= scaled_width and -(-height // scale) >= scaled_height:
+            return scale
+    return 1
+
+def clamp_crop(crop, width, height):
+    """(x, y, w, h) of a crop rectangle inside a width x height image; None for the whole image"""
+    if not crop:
+        return None
+    x, y, w, h = (int(round(float(v))) for v in crop)
+    x = min(max(x, 0), width)
+    y = min(max(y, 0), height)
+    w = min(w, width - x)
+    h = min(h, height - y)
+    return (x, y, w, h) if w > 0 and h > 0 else None
+
+class InputBuffers:
+    """Padded model inputs reused across requests, one per (shape, batch slot)"""
+
+    def __init__(self):
+        self.buffers = {}
+
+    def get(self, input_width, input_height, slot=0):
+        key = (input_height, input_width, slot)
+        buffer = self.buffers.get(key)
+        if buffer is None:
+            buffer = np.empty((input_height, input_width, 3), dtype=np.uint8)
+            self.buffers[key] = buffer
+        return buffer
+
+def load_letterboxed(image_path, requested_size, buffers=None, slot=0, reduced_decode=True, data=None, crop=None,
+                     image=None):
+    """Decode an image into an RGB letterboxed model input.
+
+    Returns the input array and the transform the client needs to map boxes
+    back to source pixels. The array belongs to buffers and is overwritten by
+    the next load into the same slot. When data (the encoded bytes as a
+    uint8 array) is given, image_path only names the image in errors. With
+    crop ([x, y, w, h] in image pixels) only that region is letterboxed and
+    the transform carries its origin as crop_x/crop_y. An image already in
+    memory (a BGR array, e.g. raw pixels from the client) is not decoded."""
+    header_size = None
+    scale = 1
+    if image is None:
+        if data is None:
+            data = np.fromfile(image_path, dtype=np.uint8)
+        header_size = jpeg_size(data)
+
+        if header_size is not None:
+            width, height = header_size
+            region = clamp_crop(crop, width, height)
+            if region is not None:
+                # The region, not the whole image, must keep enough pixels after a reduced decode
+                width, height = region[2], region[3]
+            inference_size = resolve_inference_size(requested_size, width, height)
+            scaled_width, scaled_height, _, _ = fit_size(width, height, inference_size)
+            scale = choose_jpeg_scale(width, height, scaled_width, scaled_height) if reduced_decode else 1
+
+        image = cv2.imdecode(data, REDUCED_FLAGS[scale])
+        if image is None:
+            raise Exception(f"Could not decode image: {image_path}")
+
+    decoded_height, decoded_width = image.shape[:2]
+    if header_size is None:
+        width, height = decoded_width, decoded_height
+    else:
+        width, height = header_size
+        if (decoded_width > decoded_height) != (width > height) and decoded_width != decoded_height:
+            width, height = height, width   # EXIF orientation rotated the image
+
+    # Crop coordinates are in the image as the client saw it, i.e. after any rotation
+    region = clamp_crop(crop, width, height)
+    if region is not None:
+        x, y, w, h = region
+        x0, x1 = x * decoded_width // width, -(-(x + w) * decoded_width // width)
+        y0, y1 = y * decoded_height // height, -(-(y + h) * decoded_height // height)
+        image = image[y0:y1, x0:x1]
+        decoded_height, decoded_width = image.shape[:2]
+        width, height = w, h
+
+    inference_size = resolve_inference_size(requested_size, width, height)
+    scaled_width, scaled_height, input_width, input_height = fit_size(width, height, inference_size)
+    pad_x = (input_width - scaled_width) // 2
+    pad_y = (input_height - scaled_height) // 2
+
+    if buffers is None:
+        padded = np.empty((input_height, input_width, 3), dtype=np.uint8)
+    else:
+        padded = buffers.get(input_width, input_height, slot)
+    padded[:pad_y] = PAD_VALUE
+    padded[pad_y + scaled_height:] = PAD_VALUE
+    padded[pad_y:pad_y + scaled_height, :pad_x] = PAD_VALUE
+    padded[pad_y:pad_y + scaled_height, pad_x + scaled_width:] = PAD_VALUE
+
+    # Resize straight into the padded buffer's content region
+    content = padded[pad_y:pad_y + scaled_height, pad_x:pad_x + scaled_width]
+    if (decoded_width, decoded_height) == (scaled_width, scaled_height):
+        np.copyto(content, image)
+    else:
+        shrinking = decoded_width > scaled_width
+        cv2.resize(image, (scaled_width, scaled_height), dst=content,
+                   interpolation=cv2.INTER_AREA if shrinking else cv2.INTER_LINEAR)
+
+    # The hub model expects RGB when given arrays; the gray padding is symmetric
+    cv2.cvtColor(padded, cv2.COLOR_BGR2RGB, dst=padded)
+
+    # Per-axis scale against the source: rounding the scaled size makes the two differ slightly
+    info = {
+        'source_width': width,
+        'source_height': height,
+        'input_width': input_width,
+        'input_height': input_height,
+        'scale_x': scaled_width / width,
+        'scale_y': scaled_height / height,
+        'pad_x': pad_x,
+        'pad_y': pad_y,
+        'decode_scale': scale
+    }
+    if region is not None:
+        info['crop_x'] = region[0]
+        info['crop_y'] = region[1]
+    return padded, info
@@ -7,16 +7,19 @@ Tests if a camera device is available
 import sys
 import cv2
 import time
+from log_setup import get_logger
+
+log = get_logger('test_camera')
 
 def test_camera(device_id):
     """Test if camera device is available"""
     try:
-        print(f"Testing camera device {device_id}...", file=sys.stderr)
+        log.info(f"Testing camera device {device_id}...")
         
         # Try to open camera
         cap = cv2.VideoCapture(device_id)
         if not cap.isOpened():
-            print(f"Failed to open camera device {device_id}", file=sys.stderr)
+            log.error(f"Failed to open camera device {device_id}")
             return False
         
         # Set basic properties
@@ -31,14 +34,14 @@ def test_camera(device_id):
         cap.release()
         
         if ret and frame is not None:
-            print(f"Camera device {device_id} is working", file=sys.stderr)
+            log.info(f"Camera device {device_id} is working")
             return True
         else:
-            print(f"Camera device {device_id} failed to capture frame", file=sys.stderr)
+            log.error(f"Camera device {device_id} failed to capture frame")
             return False
         
     except Exception as e:
-        print(f"Camera test error: {str(e)}", file=sys.stderr)
+        log.error(f"Camera test error: {str(e)}")
         return False
 
 def main():
@@ -50,25 +53,25 @@ def main():
         device_id = int(sys.argv[1])
         
         # Test OpenCV availability first
-        print(f"OpenCV version: {cv2.__version__}", file=sys.stderr)
+        log.info(f"OpenCV version: {cv2.__version__}")
         
         success = test_camera(device_id)
         
         if success:
-            print("Camera test PASSED", file=sys.stderr)
+            log.info("Camera test PASSED")
             sys.exit(0)
         else:
-            print("Camera test FAILED", file=sys.stderr)
+            log.error("Camera test FAILED")
             sys.exit(1)
         
     except ValueError:
-        print("Error: device_id must be an integer", file=sys.stderr)
+        log.error("device_id must be an integer")
         sys.exit(1)
     except ImportError as e:
-        print(f"Error: OpenCV not available - {str(e)}", file=sys.stderr)
+        log.error(f"OpenCV not available - {str(e)}")
         sys.exit(1)
     except Exception as e:
-        print(f"Error: {str(e)}", file=sys.stderr)
+        log.error(f"{str(e)}")
         sys.exit(1)
 
 if __name__ == '__main__':
@@ -0,0 +1,205 @@
+#include "adaptive_controller.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+namespace {
+const size_t kMaxDecisionHistory = 64;
+}
+
+AdaptiveRateController::AdaptiveRateController()
+    : AdaptiveRateController(AdaptiveControllerConfig())
+{
+}
+
+AdaptiveRateController::AdaptiveRateController(const AdaptiveControllerConfig& config)
+    : m_config(config)
+    , m_fps(config.minFps)
+    , m_modelIndex(0)
+    , m_smoothedLatency(0.0)
+    , m_hasSample(false)
+    , m_overloadStreak(0)
+    , m_underloadStreak(0)
+    , m_cooldown(0)
+    , m_decreaseCooldown(0)
+{
+}
+
+void AdaptiveRateController::reset(int initialFps, const std::string& initialModel)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fps = std::clamp(initialFps, m_config.minFps, m_config.maxFps);
+    m_modelIndex = std::max(0, findModelIndex(initialModel));
+    m_smoothedLatency = 0.0;
+    m_hasSample = false;
+    m_overloadStreak = 0;
+    m_underloadStreak = 0;
+    m_cooldown = 0;
+    m_decreaseCooldown = 0;
+    m_decisions.clear();
+}
+
+void AdaptiveRateController::setConfig(const AdaptiveControllerConfig& config)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_config = config;
+    m_fps = std::clamp(m_fps, m_config.minFps, m_config.maxFps);
+    if (m_config.modelLadder.empty()) {
+        m_modelIndex = 0;
+    } else {
+        m_modelIndex = std::min(m_modelIndex, static_cast<int>(m_config.modelLadder.size()) - 1);
+    }
+}
+
+AdaptiveControllerConfig AdaptiveRateController::getConfig() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_config;
+}
+
+void AdaptiveRateController::setDecisionCallback(DecisionCallback callback)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_decisionCallback = callback;
+}
+
+void AdaptiveRateController::recordSample(double latencyMs, int queueDepth)
+{
+    ControllerDecision decision;
+    DecisionCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Frames captured before the last FPS decrease say nothing about
+        // the new rate; they are skipped and the average starts afresh
+        if (m_decreaseCooldown > 0) {
+            m_decreaseCooldown--;
+            if (m_cooldown > 0) {
+                m_cooldown--;
+            }
+            return;
+        }
+
+        if (!m_hasSample) {
+            m_smoothedLatency = latencyMs;
+            m_hasSample = true;
+        } else {
+            m_smoothedLatency = m_config.smoothing * latencyMs + (1.0 - m_config.smoothing) * m_smoothedLatency;
+        }
+
+        if (m_cooldown > 0) {
+            m_cooldown--;
+        }
+
+        const int ladderSize = static_cast<int>(m_config.modelLadder.size());
+        const bool overloaded = m_smoothedLatency > m_config.latencySloMs || queueDepth > m_config.maxQueueDepth;
+        const bool underloaded = m_smoothedLatency < m_config.headroom * m_config.latencySloMs && queueDepth == 0;
+
+        std::ostringstream reason;
+        reason << std::fixed << std::setprecision(0);
+
+        if (overloaded) {
+            m_underloadStreak = 0;
+            m_overloadStreak++;
+
+            if (m_fps > m_config.minFps) {
+                // Multiplicative decrease, always at least one step, then
+                // hold until the frames in flight have drained
+                int reduced = static_cast<int>(m_fps * 0.7);
+                if (reduced >= m_fps) reduced = m_fps - 1;
+                m_fps = std::max(m_config.minFps, reduced);
+                m_decreaseCooldown = std::max(m_config.decreaseCooldownSamples, m_config.maxQueueDepth + 1);
+                m_hasSample = false;
+                reason << "overload (" << m_smoothedLatency << "ms, queue " << queueDepth << ") -> fps " << m_fps;
+            } else if (m_config.adaptModel && m_modelIndex > 0 &&
+                       m_overloadStreak >= m_config.hysteresisSamples && m_cooldown == 0) {
+                m_modelIndex--;
+                m_cooldown = m_config.cooldownSamples;
+                m_overloadStreak = 0;
+                m_hasSample = false;
+                reason << "overload at min fps (" << m_smoothedLatency << "ms) -> model "
+                       << m_config.modelLadder[m_modelIndex];
+            }
+        } else if (underloaded) {
+            m_overloadStreak = 0;
+            m_underloadStreak++;
+
+            if (m_fps < m_config.maxFps) {
+                // Additive increase
+                m_fps++;
+                reason << "headroom (" << m_smoothedLatency << "ms) -> fps " << m_fps;
+            } else if (m_config.adaptModel && m_modelIndex < ladderSize - 1 &&
+                       m_smoothedLatency < m_config.modelUpgradeHeadroom * m_config.latencySloMs &&
+                       m_underloadStreak >= m_config.hysteresisSamples && m_cooldown == 0) {
+                m_modelIndex++;
+                m_cooldown = m_config.cooldownSamples;
+                m_underloadStreak = 0;
+                m_hasSample = false;
+                reason << "headroom at max fps (" << m_smoothedLatency << "ms) -> model "
+                       << m_config.modelLadder[m_modelIndex];
+            }
+        } else {
+            // Inside the dead band between headroom and SLO: hold steady
+            m_overloadStreak = 0;
+            m_underloadStreak = 0;
+        }
+
+        if (reason.str().empty()) {
+            return;
+        }
+
+        decision.timestamp = std::chrono::steady_clock::now();
+        decision.fps = m_fps;
+        decision.model = ladderSize > 0 ? m_config.modelLadder[m_modelIndex] : std::string();
+        decision.smoothedLatencyMs = m_smoothedLatency;
+        decision.queueDepth = queueDepth;
+        decision.reason = reason.str();
+
+        m_decisions.push_back(decision);
+        if (m_decisions.size() > kMaxDecisionHistory) {
+            m_decisions.pop_front();
+        }
+        callback = m_decisionCallback;
+    }
+
+    if (callback) {
+        callback(decision);
+    }
+}
+
+int AdaptiveRateController::getTargetFps() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_fps;
+}
+
+std::string AdaptiveRateController::getCurrentModel() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_config.modelLadder.empty()) {
+        return "";
+    }
+    return m_config.modelLadder[m_modelIndex];
+}
+
+double AdaptiveRateController::getSmoothedLatency() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_smoothedLatency;
+}
+
+std::vector<ControllerDecision> AdaptiveRateController::getRecentDecisions() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::vector<ControllerDecision>(m_decisions.begin(), m_decisions.end());
+}
+
+int AdaptiveRateController::findModelIndex(const std::string& model) const
+{
+    for (size_t i = 0; i < m_config.modelLadder.size(); ++i) {
+        if (m_config.modelLadder[i] == model) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
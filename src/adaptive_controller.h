@@ -0,0 +1,77 @@
+#ifndef ADAPTIVE_CONTROLLER_H
+#define ADAPTIVE_CONTROLLER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <functional>
+
+struct AdaptiveControllerConfig {
+    int minFps = 1;
+    int maxFps = 10;
+    double latencySloMs = 1000.0;    // End-to-end latency target per frame
+    double headroom = 0.7;           // Increase FPS only below headroom * SLO
+    double smoothing = 0.3;          // EWMA weight of the newest latency sample
+    int maxQueueDepth = 0;           // Frames allowed to wait behind the one in flight
+    int decreaseCooldownSamples = 3; // Samples after an FPS decrease before another; at least the pipeline depth
+
+    bool adaptModel = false;
+    std::vector<std::string> modelLadder = {"yolov5s", "yolov5m", "yolov5l", "yolov5x"};
+    double modelUpgradeHeadroom = 0.4; // Step up a model only below this fraction of SLO
+    int hysteresisSamples = 5;        // Consecutive samples needed before a model step
+    int cooldownSamples = 10;         // Samples ignored for model steps after a change
+};
+
+struct ControllerDecision {
+    std::chrono::steady_clock::time_point timestamp;
+    int fps;
+    std::string model;
+    double smoothedLatencyMs;
+    int queueDepth;
+    std::string reason;
+};
+
+// Closed-loop controller that adjusts the capture frame rate (AIMD) and,
+// optionally, the model size so that end-to-end latency stays under the SLO.
+class AdaptiveRateController {
+public:
+    using DecisionCallback = std::function<void(const ControllerDecision&)>;
+
+    AdaptiveRateController();
+    explicit AdaptiveRateController(const AdaptiveControllerConfig& config);
+
+    void reset(int initialFps, const std::string& initialModel);
+    void setConfig(const AdaptiveControllerConfig& config);
+    AdaptiveControllerConfig getConfig() const;
+    void setDecisionCallback(DecisionCallback callback);
+
+    // Feed one completed frame: latency from capture to result, and how many
+    // frames were waiting (or had to be skipped) while it was in flight.
+    void recordSample(double latencyMs, int queueDepth);
+
+    int getTargetFps() const;
+    std::string getCurrentModel() const;
+    double getSmoothedLatency() const;
+    std::vector<ControllerDecision> getRecentDecisions() const;
+
+private:
+    int findModelIndex(const std::string& model) const;
+
+    mutable std::mutex m_mutex;
+    AdaptiveControllerConfig m_config;
+    DecisionCallback m_decisionCallback;
+
+    int m_fps;
+    int m_modelIndex;
+    double m_smoothedLatency;
+    bool m_hasSample;
+    int m_overloadStreak;
+    int m_underloadStreak;
+    int m_cooldown;
+    int m_decreaseCooldown;     // Frames captured at the old rate still draining
+    std::deque<ControllerDecision> m_decisions;
+};
+
+#endif // ADAPTIVE_CONTROLLER_H
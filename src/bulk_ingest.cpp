@@ -0,0 +1,702 @@
+#include "bulk_ingest.h"
+#include "logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define BULK_INGEST_IO_URING 1
+#include <linux/io_uring.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+const auto kBufferPoll = std::chrono::milliseconds(50);
+
+double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Blocking read of a whole file into buffer; empty on success, else the reason
+std::string readWholeFile(const std::string& path, std::string& buffer)
+{
+    // A directory opens fine but has no meaningful size
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(path, ec)) {
+        return ec ? "Cannot open " + path : "Not a regular file: " + path;
+    }
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return "Cannot open " + path + ": " + std::strerror(errno);
+    }
+    std::string error;
+    long size = std::fseek(file, 0, SEEK_END) == 0 ? std::ftell(file) : -1;
+    if (size <= 0 || std::fseek(file, 0, SEEK_SET) != 0) {
+        error = size == 0 ? "Empty file " + path : "Cannot size " + path;
+    } else {
+        buffer.resize(static_cast<size_t>(size));
+        buffer.resize(std::fread(&buffer[0], 1, buffer.size(), file));
+        if (buffer.empty()) {
+            error = "Cannot read " + path;
+        }
+    }
+    std::fclose(file);
+    return error;
+}
+
+#ifdef BULK_INGEST_IO_URING
+
+// The submission and completion rings of one io_uring instance, driven by a
+// single thread. Only what ingest needs: open, read, wait and reap.
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // False when the kernel has no io_uring, refuses it, or lacks async open and read
+    bool init(unsigned entries);
+
+    // Null when every submission entry is taken
+    io_uring_sqe* nextSqe();
+    // Submits prepared entries and waits for at least waitFor completions
+    bool submitAndWait(unsigned waitFor);
+
+    template <typename Handler>
+    void reap(Handler&& handler)
+    {
+        unsigned head = *m_cqHead;
+        unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            const io_uring_cqe& cqe = m_cqes[head & *m_cqMask];
+            handler(cqe.user_data, cqe.res);
+            __atomic_store_n(m_cqHead, ++head, __ATOMIC_RELEASE);
+            tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        }
+    }
+
+private:
+    bool supportsOperations();
+
+    int m_fd = -1;
+    void* m_sqRing = MAP_FAILED;
+    void* m_cqRing = MAP_FAILED;
+    size_t m_sqRingSize = 0;
+    size_t m_cqRingSize = 0;
+    io_uring_sqe* m_sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t m_sqesSize = 0;
+    unsigned m_sqEntries = 0;
+
+    unsigned* m_sqHead = nullptr;
+    unsigned* m_sqTail = nullptr;
+    unsigned* m_sqMask = nullptr;
+    unsigned* m_sqArray = nullptr;
+    unsigned* m_cqHead = nullptr;
+    unsigned* m_cqTail = nullptr;
+    unsigned* m_cqMask = nullptr;
+    io_uring_cqe* m_cqes = nullptr;
+
+    unsigned m_sqLocalTail = 0;     // Includes entries prepared but not yet published
+    unsigned m_pending = 0;         // Prepared, not yet taken by the kernel
+};
+
+IoUring::~IoUring()
+{
+    if (m_sqes != MAP_FAILED) munmap(m_sqes, m_sqesSize);
+    if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing) munmap(m_cqRing, m_cqRingSize);
+    if (m_sqRing != MAP_FAILED) munmap(m_sqRing, m_sqRingSize);
+    if (m_fd >= 0) close(m_fd);
+}
+
+bool IoUring::init(unsigned entries)
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    m_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (m_fd < 0) {
+        return false;
+    }
+
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap) {
+        m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+    }
+    m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+                    IORING_OFF_SQ_RING);
+    if (m_sqRing == MAP_FAILED) {
+        return false;
+    }
+    m_cqRing = singleMap ? m_sqRing
+                         : mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+                                IORING_OFF_CQ_RING);
+    if (m_cqRing == MAP_FAILED) {
+        return false;
+    }
+    m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes = static_cast<io_uring_sqe*>(mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                             m_fd, IORING_OFF_SQES));
+    if (m_sqes == MAP_FAILED) {
+        return false;
+    }
+
+    char* sq = static_cast<char*>(m_sqRing);
+    char* cq = static_cast<char*>(m_cqRing);
+    m_sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    m_sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    m_cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    m_sqEntries = params.sq_entries;
+    m_sqLocalTail = *m_sqTail;
+    return supportsOperations();
+}
+
+bool IoUring::supportsOperations()
+{
+    // Async open and read arrived in 5.6, as did the probe itself
+    const unsigned opCount = 256;
+    std::vector<char> storage(sizeof(io_uring_probe) + opCount * sizeof(io_uring_probe_op));
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    if (syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PROBE, probe, opCount) < 0) {
+        return false;
+    }
+    for (unsigned op : {static_cast<unsigned>(IORING_OP_OPENAT), static_cast<unsigned>(IORING_OP_READ)}) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+io_uring_sqe* IoUring::nextSqe()
+{
+    unsigned head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+    if (m_sqLocalTail - head >= m_sqEntries) {
+        return nullptr;
+    }
+    unsigned index = m_sqLocalTail & *m_sqMask;
+    io_uring_sqe* sqe = &m_sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    m_sqArray[index] = index;
+    m_sqLocalTail++;
+    m_pending++;
+    return sqe;
+}
+
+bool IoUring::submitAndWait(unsigned waitFor)
+{
+    // Entries become visible to the kernel only once filled in
+    __atomic_store_n(m_sqTail, m_sqLocalTail, __ATOMIC_RELEASE);
+    for (;;) {
+        unsigned flags = waitFor > 0 ? IORING_ENTER_GETEVENTS : 0;
+        long submitted = syscall(__NR_io_uring_enter, m_fd, m_pending, waitFor, flags, nullptr, 0);
+        if (submitted >= 0) {
+            m_pending -= std::min<unsigned>(m_pending, static_cast<unsigned>(submitted));
+            return true;
+        }
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+#endif
+}
+
+class BulkIngest::BufferPool : public std::enable_shared_from_this<BulkIngest::BufferPool> {
+public:
+    explicit BufferPool(size_t limit) : m_limit(std::max<size_t>(limit, 1)), m_largest(0) {}
+
+    // A free buffer, or a new one while under the limit; null when all are held
+    std::string* tryAcquire()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return takeLocked();
+    }
+
+    // Null when none was returned in time
+    std::string* acquire(Clock::duration timeout)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        std::string* buffer = nullptr;
+        m_available.wait_for(lock, timeout, [&] { return (buffer = takeLocked()) != nullptr; });
+        return buffer;
+    }
+
+    void release(std::string* buffer)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_largest = std::max(m_largest, buffer->capacity());
+            m_free.push_back(buffer);
+        }
+        m_available.notify_one();
+    }
+
+    // The buffer comes back when the last copy of the pointer is dropped,
+    // which may be after the ingest itself is gone
+    std::shared_ptr<const std::string> lease(std::string* buffer)
+    {
+        std::shared_ptr<BufferPool> self = shared_from_this();
+        return std::shared_ptr<const std::string>(buffer, [self, buffer](const std::string*) { self->release(buffer); });
+    }
+
+    void wake() { m_available.notify_all(); }
+
+    // Drops a buffer the kernel may still write into without freeing it,
+    // so a new one can be created in its place
+    void retire(std::string* buffer)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_buffers.begin(); it != m_buffers.end(); ++it) {
+            if (it->get() == buffer) {
+                it->release();
+                m_buffers.erase(it);
+                return;
+            }
+        }
+    }
+
+    size_t created() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_buffers.size();
+    }
+
+    size_t largest() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_largest;
+    }
+
+private:
+    std::string* takeLocked()
+    {
+        if (!m_free.empty()) {
+            std::string* buffer = m_free.back();
+            m_free.pop_back();
+            return buffer;
+        }
+        if (m_buffers.size() < m_limit) {
+            m_buffers.push_back(std::make_unique<std::string>());
+            return m_buffers.back().get();
+        }
+        return nullptr;
+    }
+
+    const size_t m_limit;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_available;
+    std::vector<std::unique_ptr<std::string>> m_buffers;
+    std::vector<std::string*> m_free;
+    size_t m_largest;
+};
+
+// Delivery counters and reads in flight integrated over time
+class BulkIngest::Meter {
+public:
+    Meter() : m_start(Clock::now()), m_lastChange(m_start) {}
+
+    void readStarted() { changeInFlight(1); }
+    void readFinished() { changeInFlight(-1); }
+
+    void bufferWait()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.bufferWaits++;
+    }
+
+    void delivered(const IngestedImage& image)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.files++;
+        if (image.bytes) {
+            m_stats.bytes += image.bytes->size();
+        } else {
+            m_stats.failures++;
+        }
+        m_readMsSum += image.readMs;
+    }
+
+    BulkIngestStats finish(const std::string& backend)
+    {
+        changeInFlight(0);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        BulkIngestStats stats = m_stats;
+        stats.backend = backend;
+        stats.elapsedSeconds = std::chrono::duration<double>(Clock::now() - m_start).count();
+        if (stats.elapsedSeconds > 0.0) {
+            stats.megabytesPerSecond = stats.bytes / (1024.0 * 1024.0) / stats.elapsedSeconds;
+            stats.filesPerSecond = stats.files / stats.elapsedSeconds;
+            stats.meanInFlight = m_inFlightSeconds / stats.elapsedSeconds;
+        }
+        stats.meanReadMs = stats.files > 0 ? m_readMsSum / static_cast<double>(stats.files) : 0.0;
+        return stats;
+    }
+
+private:
+    void changeInFlight(int delta)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Clock::time_point now = Clock::now();
+        m_inFlightSeconds += m_inFlight * std::chrono::duration<double>(now - m_lastChange).count();
+        m_lastChange = now;
+        m_inFlight += delta;
+        m_stats.peakInFlight = std::max(m_stats.peakInFlight, m_inFlight);
+    }
+
+    std::mutex m_mutex;
+    BulkIngestStats m_stats = BulkIngestStats();
+    Clock::time_point m_start;
+    Clock::time_point m_lastChange;
+    size_t m_inFlight = 0;
+    double m_inFlightSeconds = 0.0;
+    double m_readMsSum = 0.0;
+};
+
+BulkIngest::BulkIngest(const BulkIngestConfig& config)
+    : m_config(config)
+    , m_pool(std::make_shared<BufferPool>(config.buffers))
+    , m_stopping(false)
+{
+    m_config.queueDepth = std::max<size_t>(m_config.queueDepth, 1);
+}
+
+BulkIngest::~BulkIngest()
+{
+    stop();
+}
+
+void BulkIngest::stop()
+{
+    m_stopping = true;
+    m_pool->wake();
+}
+
+BulkIngestStats BulkIngest::run(const std::vector<std::string>& paths, const ImageCallback& onImage)
+{
+    m_stopping = false;
+    Meter meter;
+    std::string backend = "io_uring";
+    std::vector<size_t> remaining;
+    if (!m_config.useIoUring || !runIoUring(paths, onImage, meter, remaining)) {
+        backend = "threads";
+        remaining.resize(paths.size());
+        for (size_t i = 0; i < paths.size(); ++i) {
+            remaining[i] = i;
+        }
+    } else if (!remaining.empty()) {
+        backend = "io_uring+threads";
+    }
+    if (!remaining.empty()) {
+        runThreads(paths, remaining, onImage, meter);
+    }
+    BulkIngestStats stats = meter.finish(backend);
+    stats.buffers = m_pool->created();
+    stats.largestBuffer = m_pool->largest();
+    return stats;
+}
+
+#ifdef BULK_INGEST_IO_URING
+
+bool BulkIngest::runIoUring(const std::vector<std::string>& paths, const ImageCallback& onImage, Meter& meter,
+                            std::vector<size_t>& remaining)
+{
+    IoUring ring;
+    if (!ring.init(static_cast<unsigned>(m_config.queueDepth))) {
+        return false;
+    }
+
+    // One file per slot; each slot has one operation in flight at a time,
+    // so the rings can never overflow
+    struct Slot {
+        size_t index = 0;
+        std::string* buffer = nullptr;
+        int fd = -1;
+        size_t size = 0;
+        size_t done = 0;
+        Clock::time_point start;
+    };
+    std::vector<Slot> slots(m_config.queueDepth);
+    std::vector<size_t> freeSlots;
+    for (size_t i = slots.size(); i > 0; --i) {
+        freeSlots.push_back(i - 1);
+    }
+
+    auto submitRead = [&ring](size_t slotIndex, Slot& slot) {
+        io_uring_sqe* sqe = ring.nextSqe();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = slot.fd;
+        sqe->addr = reinterpret_cast<uint64_t>(&(*slot.buffer)[slot.done]);
+        sqe->len = static_cast<uint32_t>(std::min<size_t>(slot.size - slot.done, 1u << 30));
+        sqe->off = slot.done;
+        sqe->user_data = slotIndex;
+    };
+
+    size_t next = 0;
+    size_t inFlight = 0;
+    bool waitingForBuffer = false;
+
+    // Closes the file and hands the image on, or just recycles the slot when stopping
+    auto finish = [&](size_t slotIndex, std::string error) {
+        Slot& slot = slots[slotIndex];
+        if (slot.fd >= 0) {
+            close(slot.fd);
+            slot.fd = -1;
+        }
+        IngestedImage image;
+        image.index = slot.index;
+        image.path = paths[slot.index];
+        image.readMs = millisecondsSince(slot.start);
+        if (error.empty() && !m_stopping) {
+            slot.buffer->resize(slot.done);
+            image.bytes = m_pool->lease(slot.buffer);
+        } else {
+            m_pool->release(slot.buffer);
+            image.error = error;
+        }
+        slot.buffer = nullptr;
+        freeSlots.push_back(slotIndex);
+        inFlight--;
+        meter.readFinished();
+        if (!m_stopping) {
+            meter.delivered(image);
+            onImage(std::move(image));
+        }
+    };
+
+    auto complete = [&](uint64_t userData, int result) {
+        size_t slotIndex = static_cast<size_t>(userData);
+        Slot& slot = slots[slotIndex];
+        const std::string& path = paths[slot.index];
+        if (result < 0) {
+            finish(slotIndex, (slot.fd < 0 ? "Cannot open " : "Cannot read ") + path + ": " + std::strerror(-result));
+            return;
+        }
+        if (slot.fd < 0) {
+            slot.fd = result;
+            if (m_stopping) {
+                finish(slotIndex, "Stopped");
+                return;
+            }
+            struct stat info;
+            if (fstat(slot.fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+                finish(slotIndex, "Not a regular file: " + path);
+                return;
+            }
+            if (info.st_size == 0) {
+                finish(slotIndex, "Empty file " + path);
+                return;
+            }
+            slot.size = static_cast<size_t>(info.st_size);
+            slot.buffer->resize(slot.size);
+            submitRead(slotIndex, slot);
+            return;
+        }
+        slot.done += static_cast<size_t>(result);
+        // Zero bytes: the file shrank since it was sized; keep what was read
+        if (result > 0 && slot.done < slot.size && !m_stopping) {
+            submitRead(slotIndex, slot);
+            return;
+        }
+        finish(slotIndex, slot.done > 0 ? std::string() : "Cannot read " + path);
+    };
+
+    while (!m_stopping && (next < paths.size() || inFlight > 0)) {
+        // Keep the queue full while buffers are free; with every buffer held
+        // downstream and nothing in flight, wait for detection to return one
+        while (!m_stopping && next < paths.size() && !freeSlots.empty()) {
+            std::string* buffer = m_pool->tryAcquire();
+            if (!buffer) {
+                if (!waitingForBuffer) {
+                    meter.bufferWait();
+                    waitingForBuffer = true;
+                }
+                if (inFlight > 0 || !(buffer = m_pool->acquire(kBufferPoll))) {
+                    break;
+                }
+            }
+            waitingForBuffer = false;
+
+            size_t slotIndex = freeSlots.back();
+            freeSlots.pop_back();
+            Slot& slot = slots[slotIndex];
+            slot.index = next++;
+            slot.buffer = buffer;
+            slot.fd = -1;
+            slot.size = 0;
+            slot.done = 0;
+            slot.start = Clock::now();
+
+            io_uring_sqe* sqe = ring.nextSqe();
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<uint64_t>(paths[slot.index].c_str());
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            sqe->user_data = slotIndex;
+            inFlight++;
+            meter.readStarted();
+        }
+        if (inFlight == 0) {
+            continue;
+        }
+        if (!ring.submitAndWait(1)) {
+            // The ring is unusable and its reads in flight may never
+            // complete: the thread pool reads those files again along with
+            // the ones not started, into buffers of its own
+            YOLO_LOG(LogLevel::Warning, "io_uring_enter failed (%s); reading the remaining %zu file(s) with threads",
+                     std::strerror(errno), paths.size() - next + inFlight);
+            for (size_t slotIndex = 0; slotIndex < slots.size(); ++slotIndex) {
+                Slot& slot = slots[slotIndex];
+                if (!slot.buffer) {
+                    continue;
+                }
+                if (slot.fd >= 0) {
+                    close(slot.fd);
+                    slot.fd = -1;
+                }
+                remaining.push_back(slot.index);
+                m_pool->retire(slot.buffer);
+                slot.buffer = nullptr;
+                meter.readFinished();
+            }
+            for (; next < paths.size(); ++next) {
+                remaining.push_back(next);
+            }
+            return true;
+        }
+        ring.reap(complete);
+    }
+
+    // The kernel may still write into buffers of reads in flight, so they
+    // are only recycled once their completions arrive
+    m_stopping = true;
+    while (inFlight > 0 && ring.submitAndWait(1)) {
+        ring.reap(complete);
+    }
+    return true;
+}
+
+#else
+
+bool BulkIngest::runIoUring(const std::vector<std::string>&, const ImageCallback&, Meter&, std::vector<size_t>&)
+{
+    return false;
+}
+
+#endif
+
+void BulkIngest::runThreads(const std::vector<std::string>& paths, const std::vector<size_t>& indices,
+                            const ImageCallback& onImage, Meter& meter)
+{
+    // Readers hand finished images to this thread, which delivers them
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<IngestedImage> finished;
+    std::atomic<size_t> next(0);
+
+    size_t threadCount = m_config.fallbackThreads > 0 ? m_config.fallbackThreads : m_config.queueDepth;
+    threadCount = std::min(threadCount, std::max<size_t>(indices.size(), 1));
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < threadCount; ++t) {
+        readers.emplace_back([&] {
+            for (;;) {
+                std::string* buffer = m_pool->tryAcquire();
+                if (!buffer) {
+                    meter.bufferWait();
+                    while (!m_stopping && !(buffer = m_pool->acquire(kBufferPoll))) {
+                    }
+                }
+                size_t position = next++;
+                if (m_stopping || position >= indices.size()) {
+                    if (buffer) m_pool->release(buffer);
+                    return;
+                }
+                size_t index = indices[position];
+
+                IngestedImage image;
+                image.index = index;
+                image.path = paths[index];
+                Clock::time_point start = Clock::now();
+                meter.readStarted();
+                image.error = readWholeFile(image.path, *buffer);
+                meter.readFinished();
+                image.readMs = millisecondsSince(start);
+                if (image.error.empty()) {
+                    image.bytes = m_pool->lease(buffer);
+                } else {
+                    m_pool->release(buffer);
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    finished.push_back(std::move(image));
+                }
+                ready.notify_one();
+            }
+        });
+    }
+
+    size_t delivered = 0;
+    while (delivered < indices.size() && !m_stopping) {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait_for(lock, kBufferPoll, [&] { return !finished.empty(); });
+        while (!finished.empty() && !m_stopping) {
+            IngestedImage image = std::move(finished.front());
+            finished.pop_front();
+            lock.unlock();
+            meter.delivered(image);
+            onImage(std::move(image));
+            delivered++;
+            lock.lock();
+        }
+    }
+
+    m_stopping = true;
+    m_pool->wake();
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+}
+
+std::vector<std::string> BulkIngest::listImages(const std::string& directory)
+{
+    static const char* const kExtensions[] = {".jpg", ".jpeg", ".png", ".bmp", ".tif", ".tiff"};
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_regular_file(ec)) {
+            continue;
+        }
+        std::string extension = it->path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (std::find(std::begin(kExtensions), std::end(kExtensions), extension) != std::end(kExtensions)) {
+            paths.push_back(it->path().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
@@ -0,0 +1,85 @@
+#ifndef BULK_INGEST_H
+#define BULK_INGEST_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+
+struct BulkIngestConfig {
+    size_t queueDepth = 32;         // Reads in flight at once
+    size_t buffers = 64;            // Pooled image buffers: reads in flight plus images queued or in detection
+    bool useIoUring = true;         // Linux only; otherwise, or when the kernel refuses, a thread pool reads
+    size_t fallbackThreads = 0;     // Threads of the fallback pool; 0 = queueDepth
+};
+
+struct IngestedImage {
+    size_t index;                           // Position in the path list
+    std::string path;
+    std::shared_ptr<const std::string> bytes;   // Encoded file; null on error. Holding it keeps the buffer.
+    std::string error;
+    double readMs;                          // Open to last byte
+};
+
+struct BulkIngestStats {
+    std::string backend;        // "io_uring", "threads", or "io_uring+threads" when the ring failed mid-run
+    uint64_t files;             // Delivered, failures included
+    uint64_t failures;
+    uint64_t bytes;
+    double elapsedSeconds;
+    double megabytesPerSecond;
+    double filesPerSecond;
+    double meanInFlight;        // Reads in flight, averaged over the run: queue occupancy
+    size_t peakInFlight;
+    double meanReadMs;
+    uint64_t bufferWaits;       // Times a read waited for a buffer still held downstream
+    size_t buffers;             // Created so far
+    size_t largestBuffer;       // Bytes
+};
+
+// Reads many files ahead of the detection stage into pooled buffers. On
+// Linux a deep queue of asynchronous open/read requests is kept in flight
+// through io_uring, so storage latency, which dominates on network-backed
+// folders of small files, overlaps with itself and with inference. Where
+// io_uring is unavailable a thread pool does blocking reads instead.
+// Buffers return to the pool when the last copy of an image's bytes is
+// dropped, so the number of buffers bounds how far reading runs ahead.
+class BulkIngest {
+public:
+    using ImageCallback = std::function<void(IngestedImage&& image)>;
+
+    explicit BulkIngest(const BulkIngestConfig& config = BulkIngestConfig());
+    ~BulkIngest();
+
+    BulkIngest(const BulkIngest&) = delete;
+    BulkIngest& operator=(const BulkIngest&) = delete;
+
+    // Reads every path and calls onImage on the calling thread as each file
+    // completes, in completion order. Returns when all have been delivered
+    // or stop() was called; reads still in flight are then discarded.
+    BulkIngestStats run(const std::vector<std::string>& paths, const ImageCallback& onImage);
+
+    // From any thread
+    void stop();
+
+    // Image files (jpg, jpeg, png, bmp, tif, tiff) directly in the directory, sorted
+    static std::vector<std::string> listImages(const std::string& directory);
+
+private:
+    class BufferPool;
+    class Meter;
+
+    // False when io_uring is unavailable; paths it did not finish are left in remaining
+    bool runIoUring(const std::vector<std::string>& paths, const ImageCallback& onImage, Meter& meter,
+                    std::vector<size_t>& remaining);
+    void runThreads(const std::vector<std::string>& paths, const std::vector<size_t>& indices,
+                    const ImageCallback& onImage, Meter& meter);
+
+    BulkIngestConfig m_config;
+    std::shared_ptr<BufferPool> m_pool;
+    std::atomic<bool> m_stopping;
+};
+
+#endif // BULK_INGEST_H
@@ -0,0 +1,332 @@
+#include "cascade_executor.h"
+#include <algorithm>
+
+namespace {
+bool isUncertain(const CascadeConfig& config, double confidence)
+{
+    return confidence >= config.uncertainLow && confidence < config.uncertainHigh;
+}
+
+// One side of a crop: grown by the margin and to the minimum size, kept inside [0, limit]
+void expandSpan(int start, int length, double margin, int minLength, int limit, int& outStart, int& outLength)
+{
+    double grown = std::max<double>(length * (1.0 + 2.0 * margin), minLength);
+    double begin = start + length / 2.0 - grown / 2.0;
+    if (limit > 0) {
+        grown = std::min<double>(grown, limit);
+        begin = std::clamp(begin, 0.0, limit - grown);
+    }
+    outStart = static_cast<int>(begin);
+    outLength = static_cast<int>(grown + 0.5);
+}
+
+// Size of the whole image, which escalated crops are kept inside. The
+// letterbox only describes what was inferred: a region of the image when the
+// request was cropped, whose far edge is then as far as the image is known.
+void imageSize(const DetectionRequest& request, const DetectionResult& result, int& width, int& height)
+{
+    if (request.pixels.data && request.pixels.width > 0 && request.pixels.height > 0) {
+        width = request.pixels.width;
+        height = request.pixels.height;
+        return;
+    }
+    width = result.letterbox.sourceWidth > 0 ? result.letterbox.offsetX + result.letterbox.sourceWidth : 0;
+    height = result.letterbox.sourceHeight > 0 ? result.letterbox.offsetY + result.letterbox.sourceHeight : 0;
+}
+
+void removeBelow(DetectionResult& result, double confidenceThreshold)
+{
+    result.detections.erase(std::remove_if(result.detections.begin(), result.detections.end(),
+                                           [confidenceThreshold](const Detection& detection) {
+                                               return detection.confidence < confidenceThreshold;
+                                           }),
+                            result.detections.end());
+}
+}
+
+CascadeExecutor::CascadeExecutor(DetectionScheduler::BatchExecutor inner, const CascadeConfig& config)
+    : m_inner(std::move(inner))
+    , m_config(config)
+    , m_enabled(false)
+{
+    resetStats();
+}
+
+void CascadeExecutor::setEnabled(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_enabled = enabled;
+    // Scenes tracked before a pause are stale
+    m_scenes.clear();
+}
+
+bool CascadeExecutor::isEnabled() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_enabled;
+}
+
+void CascadeExecutor::setConfig(const CascadeConfig& config)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_config = config;
+}
+
+CascadeConfig CascadeExecutor::getConfig() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_config;
+}
+
+std::vector<DetectionResult> CascadeExecutor::runBatch(int workerIndex, const std::vector<DetectionRequest>& requests)
+{
+    CascadeConfig config;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_enabled) {
+            return m_inner(workerIndex, requests);
+        }
+        config = m_config;
+    }
+
+    // Stage 1: every frame on the small model, with the threshold lowered to the band
+    Clock::time_point start = Clock::now();
+    std::vector<DetectionRequest> smallRequests = requests;
+    for (DetectionRequest& request : smallRequests) {
+        request.modelName = config.smallModel;
+        request.confidenceThreshold = std::min(request.confidenceThreshold, config.uncertainLow);
+    }
+    std::vector<DetectionResult> results = m_inner(workerIndex, smallRequests);
+    if (results.size() != requests.size()) {
+        // The scheduler reports the mismatch
+        return results;
+    }
+    Clock::time_point smallDone = Clock::now();
+
+    // Stage 2: one batch with the escalated frames and crops of all frames
+    struct Escalated {
+        size_t frame;
+        Escalation kind;
+        size_t first;       // Index of its first request in the large batch
+        size_t count;
+    };
+    std::vector<Escalated> escalated;
+    std::vector<DetectionRequest> largeRequests;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < requests.size(); ++i) {
+            if (!results[i].success) {
+                continue;
+            }
+            std::vector<BoundingBox> crops;
+            Escalation kind = classify(config, requests[i], results[i], crops);
+            // Past its deadline the frame is discarded anyway
+            if (kind == Escalation::None || smallDone >= requests[i].deadline) {
+                continue;
+            }
+
+            escalated.push_back({i, kind, largeRequests.size(), kind == Escalation::Crops ? crops.size() : 1});
+            DetectionRequest request = requests[i];
+            request.modelName = config.largeModel;
+            request.saveAnnotated = false;
+            if (kind == Escalation::Frame) {
+                largeRequests.push_back(request);
+                continue;
+            }
+            // A crop is small, so the worker picks the smallest input size that covers it
+            request.inferenceSize = kInferenceSizeAuto;
+            for (const BoundingBox& crop : crops) {
+                request.crop = crop;
+                largeRequests.push_back(request);
+            }
+        }
+    }
+
+    size_t failures = 0;
+    size_t cropCount = 0;
+    Clock::time_point largeDone = smallDone;
+    if (!largeRequests.empty()) {
+        std::vector<DetectionResult> largeResults = m_inner(workerIndex, largeRequests);
+        largeDone = Clock::now();
+
+        for (const Escalated& entry : escalated) {
+            DetectionResult& result = results[entry.frame];
+            if (largeResults.size() != largeRequests.size()) {
+                failures++;
+                continue;
+            }
+            if (entry.kind == Escalation::Frame) {
+                const DetectionResult& large = largeResults[entry.first];
+                if (!large.success) {
+                    failures++;
+                    continue;
+                }
+                int smallTime = result.processingTime;
+                int smallLoad = result.modelLoadTime;
+                result = large;
+                result.processingTime += smallTime;
+                result.modelLoadTime += smallLoad;
+                continue;
+            }
+
+            std::vector<DetectionResult> cropResults(largeResults.begin() + entry.first,
+                                                     largeResults.begin() + entry.first + entry.count);
+            cropCount += entry.count;
+            for (const DetectionResult& crop : cropResults) {
+                if (!crop.success) {
+                    failures++;
+                    break;
+                }
+            }
+            mergeCrops(config, result, cropResults, requests[entry.frame].confidenceThreshold);
+        }
+    }
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        if (results[i].success) {
+            removeBelow(results[i], requests[i].confidenceThreshold);
+        }
+    }
+
+    double smallMs = std::chrono::duration<double, std::milli>(smallDone - start).count();
+    double largeMs = std::chrono::duration<double, std::milli>(largeDone - smallDone).count();
+    recordBatch(requests.size(), smallMs, escalated.size(), cropCount, largeMs, failures);
+    return results;
+}
+
+CascadeExecutor::Escalation CascadeExecutor::classify(const CascadeConfig& config, const DetectionRequest& request,
+                                                      const DetectionResult& result, std::vector<BoundingBox>& crops)
+{
+    // Called with m_mutex held
+    // Uncertain detections count towards the scene too, so an object whose
+    // confidence dips into the band is not also seen as having left it
+    SceneCounts counts;
+    std::vector<const Detection*> uncertain;
+    for (const Detection& detection : result.detections) {
+        if (detection.confidence < config.uncertainLow) {
+            continue;
+        }
+        counts[detection.classId]++;
+        if (isUncertain(config, detection.confidence)) {
+            uncertain.push_back(&detection);
+        }
+    }
+
+    // A stream seen for the first time has no scene yet, which counts as a change
+    auto scene = m_scenes.find(request.streamId);
+    bool changed = scene == m_scenes.end() || scene->second != counts;
+    m_scenes[request.streamId] = std::move(counts);
+
+    if (changed && config.escalateOnCountChange) {
+        m_stats.countEscalations++;
+        return Escalation::Frame;
+    }
+    if (uncertain.empty()) {
+        return Escalation::None;
+    }
+
+    m_stats.uncertainEscalations++;
+    if (!config.escalateCrops || uncertain.size() > config.maxCropsPerFrame) {
+        return Escalation::Frame;
+    }
+    int imageWidth = 0;
+    int imageHeight = 0;
+    imageSize(request, result, imageWidth, imageHeight);
+    for (const Detection* detection : uncertain) {
+        const BoundingBox& box = detection->bbox;
+        BoundingBox crop;
+        expandSpan(box.x, box.width, config.cropMargin, config.minCropSize, imageWidth, crop.x, crop.width);
+        expandSpan(box.y, box.height, config.cropMargin, config.minCropSize, imageHeight, crop.y, crop.height);
+        crops.push_back(crop);
+    }
+    return Escalation::Crops;
+}
+
+void CascadeExecutor::mergeCrops(const CascadeConfig& config, DetectionResult& result,
+                                 const std::vector<DetectionResult>& cropResults, double confidenceThreshold)
+{
+    // Confident detections stay. Each uncertain one is replaced by what the
+    // large model found in its crop, or kept when that crop failed.
+    std::vector<Detection> merged;
+    size_t cropIndex = 0;
+    for (const Detection& detection : result.detections) {
+        if (!isUncertain(config, detection.confidence)) {
+            merged.push_back(detection);
+        } else if (!cropResults[cropIndex++].success) {
+            merged.push_back(detection);
+        }
+    }
+
+    // Crops around nearby boxes overlap, and a crop can include part of a
+    // confident object, so a box the frame already has is not added twice
+    int largeTime = 0;
+    for (const DetectionResult& crop : cropResults) {
+        if (!crop.success) {
+            continue;
+        }
+        largeTime = std::max(largeTime, crop.processingTime);
+        for (const Detection& detection : crop.detections) {
+            if (detection.confidence < confidenceThreshold) {
+                continue;
+            }
+            bool duplicate = std::any_of(merged.begin(), merged.end(), [&detection](const Detection& kept) {
+                return kept.classId == detection.classId && intersectionOverUnion(kept.bbox, detection.bbox) >= 0.5;
+            });
+            if (!duplicate) {
+                merged.push_back(detection);
+            }
+        }
+    }
+
+    result.detections = std::move(merged);
+    result.processingTime += largeTime;
+}
+
+void CascadeExecutor::recordBatch(size_t frames, double smallMs, size_t escalatedFrames, size_t crops, double largeMs,
+                                  size_t failures)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.frames += frames;
+    m_stats.escalatedFrames += escalatedFrames;
+    m_stats.escalatedCrops += crops;
+    m_stats.escalationFailures += failures;
+    m_smallMsSum += smallMs;
+    m_largeMsSum += largeMs;
+
+    m_completions.push_back({Clock::now(), frames});
+    if (m_completions.size() > kRateWindow) {
+        m_completions.pop_front();
+    }
+}
+
+CascadeStats CascadeExecutor::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    CascadeStats stats = m_stats;
+    if (stats.frames > 0) {
+        double frames = static_cast<double>(stats.frames);
+        stats.escalationRate = static_cast<double>(stats.escalatedFrames) / frames;
+        stats.meanSmallMs = m_smallMsSum / frames;
+        stats.meanLargeMs = m_largeMsSum / frames;
+    }
+    if (m_completions.size() >= 2) {
+        double span = std::chrono::duration<double>(m_completions.back().first - m_completions.front().first).count();
+        size_t frames = 0;
+        for (size_t i = 1; i < m_completions.size(); ++i) {
+            frames += m_completions[i].second;
+        }
+        if (span > 0.0) {
+            stats.fps = static_cast<double>(frames) / span;
+        }
+    }
+    return stats;
+}
+
+void CascadeExecutor::resetStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats = CascadeStats();
+    m_smallMsSum = 0.0;
+    m_largeMsSum = 0.0;
+    m_completions.clear();
+}
@@ -0,0 +1,103 @@
+#ifndef CASCADE_EXECUTOR_H
+#define CASCADE_EXECUTOR_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include "detection_scheduler.h"
+
+struct CascadeConfig {
+    std::string smallModel = "yolov5s";
+    std::string largeModel = "yolov5l";
+
+    // A detection with confidence in [low, high) is uncertain. The small model
+    // runs with its threshold lowered to low so borderline objects show up.
+    double uncertainLow = 0.25;
+    double uncertainHigh = 0.6;
+    // Also escalate when the small model's per-class counts (detections at
+    // or above the band) differ from the previous frame of the same stream
+    bool escalateOnCountChange = true;
+
+    // Re-run only the regions around uncertain detections instead of the
+    // whole frame. A count change still escalates the whole frame.
+    bool escalateCrops = false;
+    double cropMargin = 0.25;       // Added on each side, as a fraction of the box size
+    int minCropSize = 96;           // Pixels; small boxes get some context
+    size_t maxCropsPerFrame = 4;    // More uncertain boxes than this escalate the whole frame
+};
+
+struct CascadeStats {
+    uint64_t frames;                // Answered by the small model
+    uint64_t escalatedFrames;       // Sent on to the large model, whole or in crops
+    uint64_t escalatedCrops;
+    uint64_t uncertainEscalations;  // Triggered by a detection in the confidence band
+    uint64_t countEscalations;      // Triggered by a changed scene
+    uint64_t escalationFailures;    // Large model failed; the small result was kept
+    double escalationRate;          // escalatedFrames / frames
+    double fps;                     // Frames through both stages per second over the recent window
+    double meanSmallMs;             // Time spent in each stage per frame, over all frames
+    double meanLargeMs;
+};
+
+// Runs each batch on a small model first and sends only uncertain frames
+// (or the uncertain regions of them) on to a large model, so most frames
+// cost a small-model inference. Wraps another BatchExecutor (a local worker
+// pool or the remote balancer) and is itself one. Disabled, it passes
+// requests through unchanged.
+class CascadeExecutor {
+public:
+    explicit CascadeExecutor(DetectionScheduler::BatchExecutor inner, const CascadeConfig& config = CascadeConfig());
+
+    CascadeExecutor(const CascadeExecutor&) = delete;
+    CascadeExecutor& operator=(const CascadeExecutor&) = delete;
+
+    // Overrides the requests' model while enabled
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    void setConfig(const CascadeConfig& config);
+    CascadeConfig getConfig() const;
+
+    std::vector<DetectionResult> runBatch(int workerIndex, const std::vector<DetectionRequest>& requests);
+
+    CascadeStats getStats() const;
+    void resetStats();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Escalation {
+        None,
+        Frame,
+        Crops,
+    };
+
+    // Per-class counts of detections at or above the band in the last frame of a stream
+    using SceneCounts = std::map<int, int>;
+
+    Escalation classify(const CascadeConfig& config, const DetectionRequest& request, const DetectionResult& result,
+                        std::vector<BoundingBox>& crops);
+    static void mergeCrops(const CascadeConfig& config, DetectionResult& result,
+                           const std::vector<DetectionResult>& cropResults, double confidenceThreshold);
+    void recordBatch(size_t frames, double smallMs, size_t escalatedFrames, size_t crops, double largeMs,
+                     size_t failures);
+
+    DetectionScheduler::BatchExecutor m_inner;
+
+    mutable std::mutex m_mutex;
+    CascadeConfig m_config;
+    bool m_enabled;
+    std::map<int, SceneCounts> m_scenes;
+
+    CascadeStats m_stats;
+    double m_smallMsSum;
+    double m_largeMsSum;
+    std::deque<std::pair<Clock::time_point, size_t>> m_completions;   // Batch end and its frame count
+
+    static const size_t kRateWindow = 64;
+};
+
+#endif // CASCADE_EXECUTOR_H
@@ -1,19 +1,55 @@
 #include "detection_client.h"
+#include "worker_pool.h"
+#include "worker_protocol.h"
 #include <windows.h>
 #include <iostream>
 #include <sstream>
+#include <cstdlib>
 #include <thread>
 #include <filesystem>
 
 DetectionClient::DetectionClient()
     : m_isProcessing(false)
+    , m_stopping(false)
 {
     m_pythonExecutable = findPythonExecutable();
     m_pythonScriptPath = getPythonScriptPath();
+    m_pool = std::make_unique<WorkerPool>(m_pythonExecutable, m_pythonScriptPath);
 }
 
 DetectionClient::~DetectionClient()
 {
+    // A request still running would call back into a destroyed client
+    m_stopping = true;
+    if (m_requestThread.joinable()) {
+        m_requestThread.join();
+    }
+}
+
+void DetectionClient::setWorkerCount(int count)
+{
+    m_pool->setWorkerCount(count);
+}
+
+void DetectionClient::setWorkerConfig(const WorkerConfig& config)
+{
+    m_workerConfig = config;
+    m_pool->setWorkerConfig(config);
+}
+
+int DetectionClient::getWorkerCount() const
+{
+    return m_pool->getWorkerCount();
+}
+
+WorkerPoolStats DetectionClient::getWorkerStats() const
+{
+    return m_pool->getStats();
+}
+
+std::vector<DetectionResult> DetectionClient::runBatch(int workerIndex, const std::vector<DetectionRequest>& requests)
+{
+    return m_pool->runBatch(workerIndex, requests);
 }
 
 void DetectionClient::detectObjects(const DetectionRequest& request, 
@@ -27,10 +63,14 @@ void DetectionClient::detectObjects(const DetectionRequest& request,
 
     m_isProcessing = true;
 
-    // Run detection in a separate thread
-    std::thread([this, request, onComplete, onError]() {
+    // Run detection in a separate thread. The previous one has finished (it
+    // cleared m_isProcessing), so joining it does not block.
+    if (m_requestThread.joinable()) {
+        m_requestThread.join();
+    }
+    m_requestThread = std::thread([this, request, onComplete, onError]() {
         try {
-            std::string jsonRequest = createRequestJson(request);
+            std::string jsonRequest = createWorkerRequest(request);
             
             // Escape quotes in JSON for command line
             std::string escapedJson = jsonRequest;
@@ -76,18 +116,40 @@ void DetectionClient::detectObjects(const DetectionRequest& request,
 
             CloseHandle(hWritePipe);
 
-            // Read output
+            // Read output until the process closes its end, polling so the
+            // request deadline (or the hang guard) can end the wait
+            auto hangDeadline = std::chrono::steady_clock::now() +
+                                std::chrono::milliseconds(m_workerConfig.responseTimeoutMs);
+            auto deadline = request.deadline < hangDeadline ? request.deadline : hangDeadline;
             std::string output;
             char buffer[4096];
             DWORD bytesRead;
-            while (ReadFile(hReadPipe, buffer, sizeof(buffer) - 1, &bytesRead, NULL) && bytesRead > 0) {
+            bool timedOut = false;
+            while (true) {
+                DWORD available = 0;
+                if (!PeekNamedPipe(hReadPipe, NULL, 0, NULL, &available, NULL)) {
+                    break;
+                }
+                if (available == 0) {
+                    if (std::chrono::steady_clock::now() >= deadline || m_stopping) {
+                        timedOut = true;
+                        break;
+                    }
+                    Sleep(5);
+                    continue;
+                }
+                if (!ReadFile(hReadPipe, buffer, sizeof(buffer) - 1, &bytesRead, NULL) || bytesRead == 0) {
+                    break;
+                }
                 buffer[bytesRead] = '\0';
                 output += buffer;
             }
 
             CloseHandle(hReadPipe);
 
-            // Wait for process to complete
+            if (timedOut) {
+                TerminateProcess(pi.hProcess, 1);
+            }
             WaitForSingleObject(pi.hProcess, INFINITE);
 
             DWORD exitCode;
@@ -98,13 +160,18 @@ void DetectionClient::detectObjects(const DetectionRequest& request,
 
             m_isProcessing = false;
 
+            if (timedOut) {
+                onError("Detection timed out; the Python process was stopped");
+                return;
+            }
+
             if (exitCode != 0) {
                 onError("Python process failed with exit code " + std::to_string(exitCode) + ": " + output);
                 return;
             }
 
             // Parse response
-            DetectionResult result = parseResponse(output);
+            DetectionResult result = parseWorkerResponse(output);
             if (result.success) {
                 onComplete(result);
             } else {
@@ -115,86 +182,7 @@ void DetectionClient::detectObjects(const DetectionRequest& request,
             m_isProcessing = false;
             onError("Exception: " + std::string(e.what()));
         }
-    }).detach();
-}
-
-std::string DetectionClient::createRequestJson(const DetectionRequest& request)
-{
-    std::ostringstream json;
-    json << "{";
-    json << "\"image_path\":\"" << request.imagePath << "\",";
-    json << "\"confidence_threshold\":" << request.confidenceThreshold << ",";
-    json << "\"iou_threshold\":" << request.iouThreshold << ",";
-    json << "\"model_name\":\"" << request.modelName << "\",";
-    json << "\"save_annotated\":" << (request.saveAnnotated ? "true" : "false");
-    json << "}";
-    return json.str();
-}
-
-DetectionResult DetectionClient::parseResponse(const std::string& response)
-{
-    DetectionResult result;
-    result.success = false;
-    result.processingTime = 0;
-
-    // Simple JSON parsing (for a full implementation, use a JSON library)
-    if (response.find("\"success\":true") != std::string::npos) {
-        result.success = true;
-        
-        // Extract processing time
-        size_t timePos = response.find("\"processing_time\":");
-        if (timePos != std::string::npos) {
-            timePos += 18; // Length of "processing_time":
-            size_t endPos = response.find(",", timePos);
-            if (endPos == std::string::npos) endPos = response.find("}", timePos);
-            if (endPos != std::string::npos) {
-                std::string timeStr = response.substr(timePos, endPos - timePos);
-                result.processingTime = std::stoi(timeStr);
-            }
-        }
-
-        // Extract detections (simplified parsing)
-        size_t detectionsPos = response.find("\"detections\":[");
-        if (detectionsPos != std::string::npos) {
-            // For simplicity, just count the number of detections
-            size_t count = 0;
-            size_t pos = detectionsPos;
-            while ((pos = response.find("{\"class\":", pos + 1)) != std::string::npos) {
-                count++;
-                
-                // Extract class name
-                size_t classStart = response.find("\"class\":\"", pos) + 9;
-                size_t classEnd = response.find("\"", classStart);
-                std::string className = response.substr(classStart, classEnd - classStart);
-                
-                // Extract confidence
-                size_t confStart = response.find("\"confidence\":", pos) + 13;
-                size_t confEnd = response.find(",", confStart);
-                double confidence = std::stod(response.substr(confStart, confEnd - confStart));
-                
-                Detection detection;
-                detection.className = className;
-                detection.confidence = confidence;
-                detection.bbox = {0, 0, 0, 0}; // Simplified for this example
-                
-                result.detections.push_back(detection);
-            }
-        }
-    } else {
-        // Extract error message
-        size_t errorPos = response.find("\"error\":\"");
-        if (errorPos != std::string::npos) {
-            errorPos += 9;
-            size_t endPos = response.find("\"", errorPos);
-            if (endPos != std::string::npos) {
-                result.errorMessage = response.substr(errorPos, endPos - errorPos);
-            }
-        } else {
-            result.errorMessage = "Unknown error occurred";
-        }
-    }
-
-    return result;
+    });
 }
 
 std::string DetectionClient::findPythonExecutable()
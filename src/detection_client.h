@@ -4,13 +4,22 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include "letterbox.h"
+#include "thread_budget.h"
+
+class WorkerPool;
+struct WorkerPoolStats;
 
 struct Detection {
     std::string className;
+    int classId = -1;   // Index into the model's class list
     double confidence;
-    struct {
-        int x, y, width, height;
-    } bbox;
+    BoundingBox bbox;   // Source image pixels
 };
 
 struct DetectionResult {
@@ -18,6 +27,35 @@ struct DetectionResult {
     int processingTime;
     bool success;
     std::string errorMessage;
+    int streamId = 0;
+    int modelLoadTime = 0;   // ms spent loading the model for this request; 0 when it was resident
+    LetterboxTransform letterbox;   // How the image was fitted into the model input
+    bool timedOut = false;          // No answer in time; the worker was restarted
+};
+
+enum class PixelFormat {
+    Bgr,
+    Rgb,
+    Bgra,
+    Rgba,
+    Gray,
+};
+
+inline int bytesPerPixel(PixelFormat format)
+{
+    return format == PixelFormat::Gray ? 1 : (format == PixelFormat::Bgra || format == PixelFormat::Rgba) ? 4 : 3;
+}
+
+// Uncompressed pixels in memory, inferred without encoding or a file
+struct PixelImage {
+    const uint8_t* data = nullptr;  // Not owned; must stay valid until the request completes
+    int width = 0;
+    int height = 0;
+    int stride = 0;                 // Bytes from one row to the next
+    PixelFormat format = PixelFormat::Bgr;
+    // File the rows were staged in (SharedPixelPool); a local worker maps
+    // it. Empty = the rows travel inline.
+    std::string sharedPath;
 };
 
 struct DetectionRequest {
@@ -26,6 +64,28 @@ struct DetectionRequest {
     double iouThreshold;
     std::string modelName;
     bool saveAnnotated;
+    int streamId = 0;
+    int inferenceSize = kDefaultInferenceSize;   // Longest model input side; kInferenceSizeAuto follows the source
+    BoundingBox crop = {0, 0, 0, 0};    // Infer only this region (image pixels); empty = whole image
+    // Encoded image already read, e.g. by bulk ingest; sent inline so the
+    // worker does not read imagePath again. Null = the worker reads the path.
+    std::shared_ptr<const std::string> imageData;
+    // Raw pixels instead of an encoded image; data null = not used
+    PixelImage pixels;
+    // The result is worthless after this point; max() = no deadline
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+};
+
+// Settings passed to each persistent worker when it starts
+struct WorkerConfig {
+    double modelBudgetMb = 1024;                // Resident models above this are evicted LRU
+    std::vector<std::string> preloadModels;     // Loaded before the first request
+    int responseTimeoutMs = 60000;              // A batch with no answer by then is a hung worker
+    std::vector<WorkerThreadBudget> threadBudgets;  // By worker index; missing = torch defaults, unpinned
+    int heartbeatMs = 1000;                     // Workers report in this often; 0 = no heartbeats
+    int missedHeartbeats = 3;                   // Silent for this many intervals = hung, and killed
+    bool warmStandby = false;                   // A spare worker, models loaded and warmed up, replaces a failed one
+    int maxRedispatch = 1;                      // Times unanswered requests are resent after their worker failed
 };
 
 class DetectionClient {
@@ -42,15 +102,28 @@ public:
 
     bool isProcessing() const { return m_isProcessing; }
 
+    // Persistent workers (WorkerPool) keep the interpreter and models loaded
+    // between requests. Each worker index must only be used by one thread at a time.
+    void setWorkerCount(int count);
+    // Applies to workers started after the call
+    void setWorkerConfig(const WorkerConfig& config);
+    const WorkerConfig& getWorkerConfig() const { return m_workerConfig; }
+    int getWorkerCount() const;
+    // Failures, recoveries and the warm standby (worker_pool.h)
+    WorkerPoolStats getWorkerStats() const;
+    std::vector<DetectionResult> runBatch(int workerIndex, const std::vector<DetectionRequest>& requests);
+
 private:
-    std::string createRequestJson(const DetectionRequest& request);
-    DetectionResult parseResponse(const std::string& response);
     std::string findPythonExecutable();
     std::string getPythonScriptPath();
 
-    bool m_isProcessing;
+    std::atomic<bool> m_isProcessing;
+    std::atomic<bool> m_stopping;       // Ends a one-shot request early when the client goes away
+    std::thread m_requestThread;        // The one-shot request; joined, never detached
     std::string m_pythonExecutable;
     std::string m_pythonScriptPath;
+    std::unique_ptr<WorkerPool> m_pool;
+    WorkerConfig m_workerConfig;
 };
 
 #endif // DETECTION_CLIENT_H
\ No newline at end of file
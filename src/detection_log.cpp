@@ -0,0 +1,423 @@
+#include "detection_log.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+
+namespace {
+const char kSegmentMagic[8] = {'D', 'E', 'T', 'L', 'O', 'G', '0', '1'};
+const uint32_t kSegmentVersion = 1;
+const size_t kColumnAlignment = 64;
+// Bucketed queries producing more windows than this return nothing
+const int64_t kMaxWindows = 1 << 20;
+
+struct SegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t blockRows;
+    uint32_t reserved;
+    uint64_t rowCount;      // Written after the row itself, so a torn append is never visible
+};
+
+struct BlockRange {
+    int64_t minUs;
+    int64_t maxUs;
+};
+
+size_t alignUp(size_t value)
+{
+    return (value + kColumnAlignment - 1) / kColumnAlignment * kColumnAlignment;
+}
+
+std::string segmentFileName(size_t index)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "segment_%06zu.dlog", index);
+    return name;
+}
+}
+
+// Column layout inside one mapped segment file:
+// header | block index | timestamps | streams | classes | confidences | x | y | width | height
+struct DetectionLog::Segment {
+    MappedFile file;
+    SegmentHeader* header;
+    BlockRange* blocks;
+    int64_t* timestamps;
+    int32_t* streams;
+    int16_t* classes;
+    float* confidences;
+    float* x;
+    float* y;
+    float* width;
+    float* height;
+
+    static size_t fileSize(uint32_t capacity)
+    {
+        size_t size = alignUp(sizeof(SegmentHeader));
+        size += alignUp(sizeof(BlockRange) * (capacity / kBlockRows));
+        size += alignUp(sizeof(int64_t) * capacity);
+        size += alignUp(sizeof(int32_t) * capacity);
+        size += alignUp(sizeof(int16_t) * capacity);
+        size += 5 * alignUp(sizeof(float) * capacity);
+        return size;
+    }
+
+    void bind()
+    {
+        uint32_t capacity = header->capacity;
+        char* cursor = static_cast<char*>(file.data()) + alignUp(sizeof(SegmentHeader));
+        auto take = [&cursor](size_t bytes) {
+            char* column = cursor;
+            cursor += alignUp(bytes);
+            return column;
+        };
+        blocks = reinterpret_cast<BlockRange*>(take(sizeof(BlockRange) * (capacity / kBlockRows)));
+        timestamps = reinterpret_cast<int64_t*>(take(sizeof(int64_t) * capacity));
+        streams = reinterpret_cast<int32_t*>(take(sizeof(int32_t) * capacity));
+        classes = reinterpret_cast<int16_t*>(take(sizeof(int16_t) * capacity));
+        confidences = reinterpret_cast<float*>(take(sizeof(float) * capacity));
+        x = reinterpret_cast<float*>(take(sizeof(float) * capacity));
+        y = reinterpret_cast<float*>(take(sizeof(float) * capacity));
+        width = reinterpret_cast<float*>(take(sizeof(float) * capacity));
+        height = reinterpret_cast<float*>(take(sizeof(float) * capacity));
+    }
+};
+
+DetectionLog::DetectionLog(const std::string& directory, uint32_t segmentRows)
+    : m_directory(directory)
+    , m_segmentRows(std::max(kBlockRows, (segmentRows + kBlockRows - 1) / kBlockRows * kBlockRows))
+{
+}
+
+DetectionLog::~DetectionLog()
+{
+    close();
+}
+
+int64_t DetectionLog::nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool DetectionLog::open()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_segments.clear();
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+
+    // Segments are numbered densely from zero
+    for (size_t index = 0;; ++index) {
+        std::filesystem::path path = std::filesystem::path(m_directory) / segmentFileName(index);
+        if (!std::filesystem::exists(path, ec)) {
+            break;
+        }
+        if (!openSegment(index)) {
+            return false;
+        }
+    }
+    return !m_segments.empty() || openSegment(0);
+}
+
+bool DetectionLog::openSegment(size_t index)
+{
+    std::string path = (std::filesystem::path(m_directory) / segmentFileName(index)).string();
+
+    // An existing segment keeps the capacity it was created with
+    uint32_t capacity = m_segmentRows;
+    std::error_code ec;
+    uint64_t existingSize = std::filesystem::exists(path, ec) ? std::filesystem::file_size(path, ec) : 0;
+    if (existingSize >= sizeof(SegmentHeader)) {
+        SegmentHeader existing;
+        FILE* file = std::fopen(path.c_str(), "rb");
+        bool read = file && std::fread(&existing, sizeof(existing), 1, file) == 1;
+        if (file) {
+            std::fclose(file);
+        }
+        if (!read || std::memcmp(existing.magic, kSegmentMagic, sizeof(kSegmentMagic)) != 0 ||
+            existing.version != kSegmentVersion || existing.blockRows != kBlockRows ||
+            existing.capacity == 0 || existing.capacity % kBlockRows != 0) {
+            return false;
+        }
+        capacity = existing.capacity;
+    }
+
+    auto segment = std::make_shared<Segment>();
+    if (!segment->file.open(path, Segment::fileSize(capacity))) {
+        return false;
+    }
+
+    segment->header = static_cast<SegmentHeader*>(segment->file.data());
+    if (existingSize < sizeof(SegmentHeader)) {
+        std::memcpy(segment->header->magic, kSegmentMagic, sizeof(kSegmentMagic));
+        segment->header->version = kSegmentVersion;
+        segment->header->capacity = capacity;
+        segment->header->blockRows = kBlockRows;
+        segment->header->rowCount = 0;
+    }
+    segment->header->rowCount = std::min<uint64_t>(segment->header->rowCount, capacity);
+    segment->bind();
+
+    m_segments.push_back(segment);
+    return true;
+}
+
+void DetectionLog::close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& segment : m_segments) {
+        segment->file.flush();
+    }
+    // Queries still holding a segment keep its mapping alive
+    m_segments.clear();
+}
+
+void DetectionLog::flush()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& segment : m_segments) {
+        segment->file.flush();
+    }
+}
+
+bool DetectionLog::append(const DetectionRecord& record)
+{
+    return append(&record, 1);
+}
+
+bool DetectionLog::append(const DetectionRecord* records, size_t count)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_segments.empty()) {
+        return false;
+    }
+
+    size_t written = 0;
+    while (written < count) {
+        Segment* segment = m_segments.back().get();
+        uint64_t row = segment->header->rowCount;
+        if (row >= segment->header->capacity) {
+            if (!openSegment(m_segments.size())) {
+                return false;
+            }
+            continue;
+        }
+
+        // Fill as much of the current segment as the batch needs
+        size_t batch = static_cast<size_t>(std::min<uint64_t>(count - written, segment->header->capacity - row));
+        for (size_t i = 0; i < batch; ++i) {
+            const DetectionRecord& record = records[written + i];
+            size_t at = static_cast<size_t>(row + i);
+            segment->timestamps[at] = record.timestampUs;
+            segment->streams[at] = record.streamId;
+            segment->classes[at] = record.classId;
+            segment->confidences[at] = record.confidence;
+            segment->x[at] = record.x;
+            segment->y[at] = record.y;
+            segment->width[at] = record.width;
+            segment->height[at] = record.height;
+
+            BlockRange& block = segment->blocks[at / kBlockRows];
+            if (at % kBlockRows == 0) {
+                block.minUs = record.timestampUs;
+                block.maxUs = record.timestampUs;
+            } else {
+                block.minUs = std::min(block.minUs, record.timestampUs);
+                block.maxUs = std::max(block.maxUs, record.timestampUs);
+            }
+        }
+        segment->header->rowCount = row + batch;
+        written += batch;
+    }
+    return true;
+}
+
+size_t DetectionLog::appendResult(const DetectionResult& result, int64_t timestampUs)
+{
+    std::vector<DetectionRecord> records;
+    records.reserve(result.detections.size());
+    for (const Detection& detection : result.detections) {
+        DetectionRecord record;
+        record.timestampUs = timestampUs;
+        record.streamId = result.streamId;
+        record.classId = static_cast<int16_t>(detection.classId);
+        record.confidence = static_cast<float>(detection.confidence);
+        record.x = static_cast<float>(detection.bbox.x);
+        record.y = static_cast<float>(detection.bbox.y);
+        record.width = static_cast<float>(detection.bbox.width);
+        record.height = static_cast<float>(detection.bbox.height);
+        records.push_back(record);
+    }
+    return append(records.data(), records.size()) ? records.size() : 0;
+}
+
+std::vector<DetectionLog::SegmentView> DetectionLog::snapshot() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<SegmentView> views;
+    views.reserve(m_segments.size());
+    for (const auto& segment : m_segments) {
+        views.push_back({segment, segment->header->rowCount});
+    }
+    return views;
+}
+
+namespace {
+// Row filter shared by the scans. "Any" filters become full ranges so the
+// predicate is branch-free and the loops vectorize.
+struct RowFilter {
+    int64_t fromUs, toUs;
+    int32_t streamLo, streamHi;
+    int16_t classLo, classHi;
+    float minConfidence;
+
+    RowFilter(const DetectionQuery& query, int classId)
+        : fromUs(query.fromUs)
+        , toUs(query.toUs)
+        , streamLo(query.streamId == kAnyStream ? std::numeric_limits<int32_t>::min() : query.streamId)
+        , streamHi(query.streamId == kAnyStream ? std::numeric_limits<int32_t>::max() : query.streamId)
+        , classLo(static_cast<int16_t>(classId == kAnyClass ? std::numeric_limits<int16_t>::min() : classId))
+        , classHi(static_cast<int16_t>(classId == kAnyClass ? std::numeric_limits<int16_t>::max() : classId))
+        , minConfidence(query.minConfidence)
+    {
+    }
+};
+
+// Calls scan(begin, end) for each run of rows whose block may hold matches
+template <typename SegmentType, typename Scan>
+void forEachCandidateBlock(const SegmentType& segment, uint64_t rows, const RowFilter& filter, uint32_t blockRows, Scan scan)
+{
+    for (uint64_t begin = 0; begin < rows; begin += blockRows) {
+        uint64_t end = std::min<uint64_t>(begin + blockRows, rows);
+        // The index of a block still being filled may be mid-update; scan it instead
+        if (end - begin == blockRows) {
+            const auto& block = segment.blocks[begin / blockRows];
+            if (block.maxUs < filter.fromUs || block.minUs >= filter.toUs) {
+                continue;
+            }
+        }
+        scan(static_cast<size_t>(begin), static_cast<size_t>(end));
+    }
+}
+}
+
+uint64_t DetectionLog::count(const DetectionQuery& query, int classId) const
+{
+    RowFilter filter(query, classId);
+    uint64_t total = 0;
+
+    for (const SegmentView& view : snapshot()) {
+        const Segment& segment = *view.segment;
+        forEachCandidateBlock(segment, view.rows, filter, kBlockRows,
+            [&](size_t begin, size_t end) {
+                const int64_t* timestamps = segment.timestamps;
+                const int32_t* streams = segment.streams;
+                const int16_t* classes = segment.classes;
+                const float* confidences = segment.confidences;
+                uint64_t matches = 0;
+                for (size_t i = begin; i < end; ++i) {
+                    matches += static_cast<uint64_t>(
+                        (timestamps[i] >= filter.fromUs) & (timestamps[i] < filter.toUs) &
+                        (streams[i] >= filter.streamLo) & (streams[i] <= filter.streamHi) &
+                        (classes[i] >= filter.classLo) & (classes[i] <= filter.classHi) &
+                        (confidences[i] >= filter.minConfidence));
+                }
+                total += matches;
+            });
+    }
+    return total;
+}
+
+std::vector<WindowAggregate> DetectionLog::aggregate(const DetectionQuery& query) const
+{
+    std::vector<WindowAggregate> windows;
+    if (query.toUs <= query.fromUs) {
+        return windows;
+    }
+
+    // Open-ended ranges cannot be cut into windows
+    bool bucketed = query.windowUs > 0 &&
+                    query.fromUs != std::numeric_limits<int64_t>::min() &&
+                    query.toUs != std::numeric_limits<int64_t>::max();
+    int64_t windowUs = bucketed ? query.windowUs : 0;
+    int64_t windowCount = 1;
+    if (bucketed) {
+        int64_t span = query.toUs - query.fromUs;
+        windowCount = span / windowUs + (span % windowUs != 0 ? 1 : 0);
+        if (windowCount > kMaxWindows) {
+            return windows;
+        }
+    }
+
+    windows.resize(static_cast<size_t>(windowCount));
+    for (int64_t i = 0; i < windowCount; ++i) {
+        windows[static_cast<size_t>(i)].startUs = bucketed ? query.fromUs + i * windowUs : query.fromUs;
+    }
+
+    RowFilter filter(query, kAnyClass);
+    filter.classLo = 0;     // Unknown classes (-1) cannot be aggregated by id
+    std::vector<uint8_t> matches(kBlockRows);
+
+    for (const SegmentView& view : snapshot()) {
+        const Segment& segment = *view.segment;
+        forEachCandidateBlock(segment, view.rows, filter, kBlockRows,
+            [&](size_t begin, size_t end) {
+                const int64_t* timestamps = segment.timestamps;
+                const int32_t* streams = segment.streams;
+                const int16_t* classes = segment.classes;
+                const float* confidences = segment.confidences;
+
+                // Vectorized filter pass, then a scatter over the matching rows only
+                uint8_t* match = matches.data();
+                size_t any = 0;
+                for (size_t i = begin; i < end; ++i) {
+                    uint8_t hit = static_cast<uint8_t>(
+                        (timestamps[i] >= filter.fromUs) & (timestamps[i] < filter.toUs) &
+                        (streams[i] >= filter.streamLo) & (streams[i] <= filter.streamHi) &
+                        (classes[i] >= filter.classLo) & (confidences[i] >= filter.minConfidence));
+                    match[i - begin] = hit;
+                    any += hit;
+                }
+                if (any == 0) {
+                    return;
+                }
+
+                for (size_t i = begin; i < end; ++i) {
+                    if (!match[i - begin]) {
+                        continue;
+                    }
+                    size_t window = bucketed ? static_cast<size_t>((timestamps[i] - query.fromUs) / windowUs) : 0;
+                    std::vector<ClassAggregate>& classAggregates = windows[window].classes;
+                    size_t classId = static_cast<size_t>(classes[i]);
+                    if (classId >= classAggregates.size()) {
+                        classAggregates.resize(classId + 1);
+                    }
+                    ClassAggregate& aggregate = classAggregates[classId];
+                    aggregate.count++;
+                    aggregate.confidenceSum += confidences[i];
+                    aggregate.areaSum += static_cast<double>(segment.width[i]) * segment.height[i];
+                }
+            });
+    }
+    return windows;
+}
+
+DetectionLogStats DetectionLog::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    DetectionLogStats stats;
+    stats.rows = 0;
+    stats.segments = m_segments.size();
+    stats.bytesMapped = 0;
+    for (const auto& segment : m_segments) {
+        stats.rows += segment->header->rowCount;
+        stats.bytesMapped += segment->file.size();
+    }
+    return stats;
+}
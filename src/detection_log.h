@@ -0,0 +1,108 @@
+#ifndef DETECTION_LOG_H
+#define DETECTION_LOG_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <limits>
+#include "detection_client.h"
+
+const int kAnyStream = std::numeric_limits<int32_t>::min();
+const int kAnyClass = -1;
+
+// One detection as stored in the log
+struct DetectionRecord {
+    int64_t timestampUs;    // Microseconds since the Unix epoch
+    int32_t streamId;
+    int16_t classId;
+    float confidence;
+    float x, y, width, height;   // Source image pixels
+};
+
+struct DetectionQuery {
+    int64_t fromUs = std::numeric_limits<int64_t>::min();   // Inclusive
+    int64_t toUs = std::numeric_limits<int64_t>::max();     // Exclusive
+    int streamId = kAnyStream;
+    float minConfidence = 0.0f;
+    // Window length for aggregate(); 0, or an open-ended range, gives a single window
+    int64_t windowUs = 0;
+};
+
+struct ClassAggregate {
+    uint64_t count = 0;
+    double confidenceSum = 0.0;
+    double areaSum = 0.0;
+
+    double meanConfidence() const { return count ? confidenceSum / static_cast<double>(count) : 0.0; }
+    double meanArea() const { return count ? areaSum / static_cast<double>(count) : 0.0; }
+};
+
+struct WindowAggregate {
+    int64_t startUs;
+    std::vector<ClassAggregate> classes;    // Indexed by class id
+};
+
+struct DetectionLogStats {
+    uint64_t rows;
+    size_t segments;
+    uint64_t bytesMapped;
+};
+
+// Append-only, memory-mapped, columnar store of detections. Rows go into
+// fixed-capacity segment files, one contiguous array per column, so queries
+// scan only the columns they need. Each block of rows keeps its min/max
+// timestamp as a sparse index; time-window queries skip blocks outside the
+// window without touching their data.
+//
+// Appends are serialized internally. Queries run concurrently with appends
+// and see the rows present when they started.
+class DetectionLog {
+public:
+    static constexpr uint32_t kDefaultSegmentRows = 1u << 20;
+    static constexpr uint32_t kBlockRows = 4096;
+
+    explicit DetectionLog(const std::string& directory, uint32_t segmentRows = kDefaultSegmentRows);
+    ~DetectionLog();
+
+    DetectionLog(const DetectionLog&) = delete;
+    DetectionLog& operator=(const DetectionLog&) = delete;
+
+    // Maps existing segments; appends continue after the last stored row
+    bool open();
+    void close();
+    void flush();
+
+    bool append(const DetectionRecord& record);
+    bool append(const DetectionRecord* records, size_t count);
+    // Logs every detection of a result; returns the number of rows written
+    size_t appendResult(const DetectionResult& result, int64_t timestampUs);
+
+    uint64_t count(const DetectionQuery& query, int classId = kAnyClass) const;
+    // Per-class counts, mean confidence and mean box area for each window
+    // in [fromUs, toUs); empty windows are included
+    std::vector<WindowAggregate> aggregate(const DetectionQuery& query) const;
+
+    DetectionLogStats getStats() const;
+
+    static int64_t nowUs();
+
+private:
+    struct Segment;
+    struct SegmentView {
+        std::shared_ptr<Segment> segment;
+        uint64_t rows;
+    };
+
+    bool openSegment(size_t index);
+    std::vector<SegmentView> snapshot() const;
+
+    std::string m_directory;
+    uint32_t m_segmentRows;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::shared_ptr<Segment>> m_segments;
+};
+
+#endif // DETECTION_LOG_H
@@ -0,0 +1,419 @@
+#include "detection_scheduler.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+const size_t kLatencyWindow = 128;
+const size_t kRateWindow = 32;
+}
+
+DetectionScheduler::DetectionScheduler(BatchExecutor executor, int workerCount, size_t maxBatchSize)
+    : m_executor(executor)
+    , m_maxBatchSize(std::max<size_t>(1, maxBatchSize))
+    , m_interactiveBatchLimit(m_maxBatchSize)
+    , m_virtualTime{0.0, 0.0, 0.0}
+    , m_starvationLimit{Clock::duration::max(), std::chrono::seconds(2), std::chrono::seconds(10)}
+    , m_pendingJobs(0)
+    , m_shutdown(false)
+{
+    for (int i = 0; i < std::max(1, workerCount); ++i) {
+        m_workers.emplace_back(&DetectionScheduler::workerLoop, this, i);
+    }
+}
+
+DetectionScheduler::~DetectionScheduler()
+{
+    shutdown();
+}
+
+void DetectionScheduler::shutdown()
+{
+    std::vector<std::deque<Job>> discarded;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_shutdown) {
+            return;
+        }
+        m_shutdown = true;
+        // Pending jobs are dropped; their callbacks are destroyed outside the lock
+        for (auto& entry : m_streams) {
+            discarded.push_back(std::move(entry.second.queue));
+            entry.second.queue.clear();
+        }
+        m_pendingJobs = 0;
+    }
+    m_workAvailable.notify_all();
+
+    // Workers finish the batch they are running, then exit
+    for (std::thread& worker : m_workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void DetectionScheduler::addStream(int streamId, double weight, size_t queueDepth, DetectionPriority priority)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stream& stream = m_streams[streamId];
+    stream = Stream();
+    stream.priority = priority;
+    stream.weight = weight > 0.0 ? weight : 1.0;
+    stream.queueDepth = std::max<size_t>(1, queueDepth);
+    stream.pass = m_virtualTime[static_cast<int>(priority)];
+}
+
+void DetectionScheduler::setStarvationLimit(DetectionPriority priority, std::chrono::milliseconds limit)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_starvationLimit[static_cast<int>(priority)] = limit == std::chrono::milliseconds::max()
+        ? Clock::duration::max() : std::chrono::duration_cast<Clock::duration>(limit);
+}
+
+void DetectionScheduler::setInteractiveBatchLimit(size_t limit)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_interactiveBatchLimit = limit == 0 ? m_maxBatchSize : std::min(limit, m_maxBatchSize);
+}
+
+void DetectionScheduler::removeStream(int streamId)
+{
+    std::deque<Job> discarded;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_streams.find(streamId);
+        if (it == m_streams.end()) {
+            return;
+        }
+        m_pendingJobs -= it->second.queue.size();
+        discarded.swap(it->second.queue);
+        m_streams.erase(it);
+    }
+}
+
+CancellationHandle DetectionScheduler::submit(int streamId, const DetectionRequest& request,
+                                              CompletionCallback onComplete, ErrorCallback onError)
+{
+    std::deque<Job> discarded;
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_streams.find(streamId);
+        if (m_shutdown || it == m_streams.end()) {
+            return CancellationHandle();
+        }
+
+        Stream& stream = it->second;
+        if (stream.queue.empty()) {
+            // A stream returning from idle does not get credit for the time it was away
+            double& virtualTime = m_virtualTime[static_cast<int>(stream.priority)];
+            stream.pass = std::max(stream.pass, virtualTime);
+        }
+
+        // Latest wins: a live frame that could not be served in time is stale
+        while (stream.queue.size() >= stream.queueDepth) {
+            discarded.push_back(std::move(stream.queue.front()));
+            stream.queue.pop_front();
+            stream.dropped++;
+            m_pendingJobs--;
+        }
+
+        stream.queue.push_back({streamId, request, std::move(onComplete), std::move(onError), Clock::now(), cancelled});
+        stream.submitted++;
+        m_pendingJobs++;
+    }
+
+    m_workAvailable.notify_one();
+    return CancellationHandle(cancelled);
+}
+
+DetectionScheduler::Stream* DetectionScheduler::pickStream(int priorityClass)
+{
+    // Stride scheduling within the class: smallest pass goes first
+    Stream* next = nullptr;
+    for (auto& entry : m_streams) {
+        Stream& stream = entry.second;
+        if (static_cast<int>(stream.priority) == priorityClass && !stream.queue.empty() &&
+            (!next || stream.pass < next->pass)) {
+            next = &stream;
+        }
+    }
+    return next;
+}
+
+DetectionScheduler::Stream* DetectionScheduler::pickStarvingStream(Clock::time_point now)
+{
+    // The job that has overrun its class's limit by the most
+    Stream* starving = nullptr;
+    Clock::duration worstOverrun = Clock::duration::zero();
+    for (auto& entry : m_streams) {
+        Stream& stream = entry.second;
+        if (stream.queue.empty()) {
+            continue;
+        }
+        Clock::duration limit = m_starvationLimit[static_cast<int>(stream.priority)];
+        Clock::duration waited = now - stream.queue.front().submitTime;
+        if (waited > limit && (!starving || waited - limit > worstOverrun)) {
+            starving = &stream;
+            worstOverrun = waited - limit;
+        }
+    }
+    return starving;
+}
+
+void DetectionScheduler::removeStaleJobs(Clock::time_point now, std::vector<Job>& expired, std::vector<Job>& cancelled)
+{
+    // Cancelled and expired requests never reach a worker
+    for (auto& entry : m_streams) {
+        Stream& stream = entry.second;
+        std::deque<Job> live;
+        for (Job& job : stream.queue) {
+            if (job.cancelled->load()) {
+                stream.cancelled++;
+                cancelled.push_back(std::move(job));
+            } else if (now >= job.request.deadline) {
+                stream.timedOut++;
+                expired.push_back(std::move(job));
+            } else {
+                live.push_back(std::move(job));
+            }
+        }
+        m_pendingJobs -= stream.queue.size() - live.size();
+        stream.queue.swap(live);
+    }
+}
+
+void DetectionScheduler::collectBatch(std::vector<Job>& batch)
+{
+    Clock::time_point now = Clock::now();
+    int batchClass = -1;
+
+    const int interactive = static_cast<int>(DetectionPriority::Interactive);
+
+    // A still arriving while this batch runs waits for all of it, so other
+    // classes send smaller batches while stills may arrive
+    size_t sharedLimit = m_maxBatchSize;
+    for (const auto& entry : m_streams) {
+        if (entry.second.priority == DetectionPriority::Interactive) {
+            sharedLimit = m_interactiveBatchLimit;
+            break;
+        }
+    }
+
+    while (m_pendingJobs > 0) {
+        size_t limit = batchClass < 0 || batchClass == interactive ? m_maxBatchSize : sharedLimit;
+        if (batch.size() >= limit) {
+            break;
+        }
+        // Interactive work always goes first and is never batched with other
+        // classes, so it waits at most for one in-flight batch to finish
+        Stream* next = nullptr;
+        if (batchClass < 0 || batchClass == interactive) {
+            next = pickStream(interactive);
+        }
+        if (!next && batchClass != interactive) {
+            next = pickStarvingStream(now);
+            if (next) {
+                next->promoted++;
+            }
+        }
+        for (int priorityClass = interactive + 1; priorityClass < kPriorityClassCount && !next; ++priorityClass) {
+            if (batchClass < 0 || batchClass == priorityClass) {
+                next = pickStream(priorityClass);
+            }
+        }
+        if (!next) {
+            break;
+        }
+
+        int priorityClass = static_cast<int>(next->priority);
+        if (batchClass < 0) {
+            batchClass = priorityClass;
+        }
+
+        m_virtualTime[priorityClass] = next->pass;
+        next->waits.push_back(std::chrono::duration<double, std::milli>(now - next->queue.front().submitTime).count());
+        if (next->waits.size() > kLatencyWindow) {
+            next->waits.pop_front();
+        }
+        batch.push_back(std::move(next->queue.front()));
+        next->queue.pop_front();
+        next->pass += 1.0 / next->weight;
+        m_pendingJobs--;
+    }
+}
+
+void DetectionScheduler::workerLoop(int workerIndex)
+{
+    // Reused across batches so a steady stream does not reallocate them
+    std::vector<Job> batch;
+    std::vector<Job> expired;
+    std::vector<Job> cancelled;
+    std::vector<DetectionRequest> requests;
+    std::vector<DetectionResult> results;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workAvailable.wait(lock, [this]() { return m_shutdown || m_pendingJobs > 0; });
+            if (m_shutdown) {
+                return;
+            }
+            removeStaleJobs(Clock::now(), expired, cancelled);
+            collectBatch(batch);
+        }
+
+        // Callbacks run and are destroyed outside the lock
+        for (Job& job : expired) {
+            if (job.onError) job.onError("Deadline exceeded before dispatch");
+        }
+        expired.clear();
+        cancelled.clear();
+
+        if (batch.empty()) {
+            continue;
+        }
+
+        // The jobs keep everything but the request, which the executor needs
+        requests.clear();
+        for (Job& job : batch) {
+            requests.push_back(std::move(job.request));
+        }
+
+        results.clear();
+        std::string failure;
+        try {
+            results = m_executor(workerIndex, requests);
+            if (results.size() != batch.size()) {
+                failure = "Worker returned " + std::to_string(results.size()) +
+                          " results for a batch of " + std::to_string(batch.size());
+            }
+        } catch (const std::exception& e) {
+            failure = "Exception: " + std::string(e.what());
+        }
+
+        Clock::time_point finished = Clock::now();
+        for (size_t i = 0; i < batch.size(); ++i) {
+            Job& job = batch[i];
+            bool answered = failure.empty();
+            Outcome outcome = Outcome::Failed;
+            if (job.cancelled->load()) {
+                outcome = Outcome::Cancelled;
+            } else if ((answered && results[i].timedOut) || finished >= requests[i].deadline) {
+                outcome = Outcome::TimedOut;
+            } else if (answered && results[i].success) {
+                outcome = Outcome::Completed;
+            }
+            recordCompletion(job, outcome, batch.size());
+
+            switch (outcome) {
+            case Outcome::Completed:
+                results[i].streamId = job.streamId;
+                if (job.onComplete) job.onComplete(results[i]);
+                break;
+            case Outcome::Failed:
+                if (job.onError) job.onError(answered ? results[i].errorMessage : failure);
+                break;
+            case Outcome::TimedOut:
+                // A late result is discarded even when it succeeded
+                if (job.onError) {
+                    job.onError(answered && results[i].timedOut ? results[i].errorMessage
+                                                                : "Deadline exceeded; result discarded");
+                }
+                break;
+            case Outcome::Cancelled:
+                break;
+            }
+        }
+        batch.clear();
+    }
+}
+
+void DetectionScheduler::recordCompletion(const Job& job, Outcome outcome, size_t batchSize)
+{
+    Clock::time_point now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_streams.find(job.streamId);
+    if (it == m_streams.end()) {
+        return;
+    }
+
+    Stream& stream = it->second;
+    switch (outcome) {
+    case Outcome::Completed: stream.completed++; break;
+    case Outcome::Failed: stream.failed++; break;
+    case Outcome::TimedOut: stream.timedOut++; break;
+    case Outcome::Cancelled: stream.cancelled++; return;
+    }
+    stream.batchedItems++;
+    stream.batchSizeSum += batchSize;
+
+    stream.latencies.push_back(std::chrono::duration<double, std::milli>(now - job.submitTime).count());
+    if (stream.latencies.size() > kLatencyWindow) {
+        stream.latencies.pop_front();
+    }
+    stream.completionTimes.push_back(now);
+    if (stream.completionTimes.size() > kRateWindow) {
+        stream.completionTimes.pop_front();
+    }
+}
+
+size_t DetectionScheduler::getQueueDepth(int streamId) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_streams.find(streamId);
+    return it == m_streams.end() ? 0 : it->second.queue.size();
+}
+
+std::vector<StreamStats> DetectionScheduler::getStreamStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<StreamStats> all;
+
+    for (const auto& entry : m_streams) {
+        const Stream& stream = entry.second;
+
+        StreamStats stats;
+        stats.streamId = entry.first;
+        stats.weight = stream.weight;
+        stats.priority = stream.priority;
+        stats.submitted = stream.submitted;
+        stats.completed = stream.completed;
+        stats.failed = stream.failed;
+        stats.timedOut = stream.timedOut;
+        stats.cancelled = stream.cancelled;
+        stats.dropped = stream.dropped;
+        stats.promoted = stream.promoted;
+        stats.queued = stream.queue.size();
+        stats.fps = 0.0;
+        stats.meanLatencyMs = 0.0;
+        stats.p95LatencyMs = 0.0;
+        stats.meanWaitMs = 0.0;
+        stats.maxWaitMs = 0.0;
+        stats.meanBatchSize = stream.batchedItems > 0
+            ? static_cast<double>(stream.batchSizeSum) / static_cast<double>(stream.batchedItems) : 0.0;
+
+        if (stream.completionTimes.size() >= 2) {
+            double span = std::chrono::duration<double>(stream.completionTimes.back() - stream.completionTimes.front()).count();
+            if (span > 0.0) {
+                stats.fps = static_cast<double>(stream.completionTimes.size() - 1) / span;
+            }
+        }
+
+        if (!stream.latencies.empty()) {
+            std::vector<double> sorted(stream.latencies.begin(), stream.latencies.end());
+            std::sort(sorted.begin(), sorted.end());
+            stats.meanLatencyMs = std::accumulate(sorted.begin(), sorted.end(), 0.0) / static_cast<double>(sorted.size());
+            stats.p95LatencyMs = sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)];
+        }
+        if (!stream.waits.empty()) {
+            stats.meanWaitMs = std::accumulate(stream.waits.begin(), stream.waits.end(), 0.0) /
+                               static_cast<double>(stream.waits.size());
+            stats.maxWaitMs = *std::max_element(stream.waits.begin(), stream.waits.end());
+        }
+
+        all.push_back(stats);
+    }
+
+    return all;
+}
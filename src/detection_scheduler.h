@@ -0,0 +1,176 @@
+#ifndef DETECTION_SCHEDULER_H
+#define DETECTION_SCHEDULER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include "detection_client.h"
+
+// Lower value = served first
+enum class DetectionPriority {
+    Interactive = 0,   // An operator is waiting on this result
+    Streaming = 1,     // Live camera frames
+    Bulk = 2,          // Offline batches; only capacity left over
+};
+
+const int kPriorityClassCount = 3;
+
+struct StreamStats {
+    int streamId;
+    double weight;
+    DetectionPriority priority;
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t failed;
+    uint64_t timedOut;       // Deadline passed in the queue or while running
+    uint64_t cancelled;
+    uint64_t dropped;        // Frames replaced by a newer one before dispatch
+    uint64_t promoted;       // Jobs served early by starvation protection
+    size_t queued;
+    double fps;              // Completed results per second over the recent window
+    double meanLatencyMs;    // Submit to completion
+    double p95LatencyMs;
+    double meanBatchSize;
+    double meanWaitMs;       // Submit to dispatch to a worker
+    double maxWaitMs;
+};
+
+// Returned by DetectionScheduler::submit(). Cancelling drops the request if it
+// is still queued and discards its result if a worker is already running it;
+// no callback is invoked either way. Empty when the submission was rejected.
+class CancellationHandle {
+public:
+    CancellationHandle() {}
+
+    void cancel() { if (m_cancelled) m_cancelled->store(true); }
+    bool isCancelled() const { return m_cancelled && m_cancelled->load(); }
+    explicit operator bool() const { return m_cancelled != nullptr; }
+
+private:
+    friend class DetectionScheduler;
+    explicit CancellationHandle(std::shared_ptr<std::atomic<bool>> cancelled) : m_cancelled(cancelled) {}
+
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+// Shares a fixed set of detection workers between many streams. Each stream
+// gets a bounded latest-wins queue and a priority class. Workers always serve
+// the highest backlogged class; within a class they pick streams by stride
+// scheduling so service is proportional to stream weight. Frames of one class
+// that are ready at the same time are sent together as one batch. A job that
+// has waited longer than its class's starvation limit is served next
+// regardless of class.
+//
+// While an interactive stream is registered, batches of the other classes
+// are capped (setInteractiveBatchLimit), so a still never waits behind a
+// long batch of frames.
+//
+// A request whose deadline passes while queued is removed before dispatch;
+// one that finishes after its deadline has its result discarded. Both report
+// a timeout through the error callback.
+class DetectionScheduler {
+public:
+    using CompletionCallback = DetectionClient::CompletionCallback;
+    using ErrorCallback = DetectionClient::ErrorCallback;
+    // Runs one batch synchronously on the given worker; returns one result per request
+    using BatchExecutor = std::function<std::vector<DetectionResult>(int workerIndex,
+                                                                     const std::vector<DetectionRequest>& batch)>;
+
+    DetectionScheduler(BatchExecutor executor, int workerCount, size_t maxBatchSize);
+    ~DetectionScheduler();
+
+    DetectionScheduler(const DetectionScheduler&) = delete;
+    DetectionScheduler& operator=(const DetectionScheduler&) = delete;
+
+    void addStream(int streamId, double weight, size_t queueDepth = 1,
+                   DetectionPriority priority = DetectionPriority::Streaming);
+    void setStarvationLimit(DetectionPriority priority, std::chrono::milliseconds limit);
+    // Largest streaming or bulk batch while an interactive stream is
+    // registered; with 1 a still waits for at most one frame's inference.
+    // 0 = the scheduler's batch size.
+    void setInteractiveBatchLimit(size_t limit);
+    void removeStream(int streamId);
+
+    // Queues a request for the stream. When the stream's queue is full the
+    // oldest pending request is discarded without invoking its callbacks.
+    CancellationHandle submit(int streamId, const DetectionRequest& request,
+                              CompletionCallback onComplete, ErrorCallback onError);
+
+    size_t getQueueDepth(int streamId) const;
+    std::vector<StreamStats> getStreamStats() const;
+    int getWorkerCount() const { return static_cast<int>(m_workers.size()); }
+
+    void shutdown();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job {
+        int streamId;
+        DetectionRequest request;
+        CompletionCallback onComplete;
+        ErrorCallback onError;
+        Clock::time_point submitTime;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+    };
+
+    enum class Outcome {
+        Completed,
+        Failed,
+        TimedOut,
+        Cancelled,
+    };
+
+    struct Stream {
+        DetectionPriority priority;
+        double weight;
+        size_t queueDepth;
+        double pass;
+        std::deque<Job> queue;
+
+        uint64_t submitted;
+        uint64_t completed;
+        uint64_t failed;
+        uint64_t timedOut;
+        uint64_t cancelled;
+        uint64_t dropped;
+        uint64_t promoted;
+        uint64_t batchedItems;
+        uint64_t batchSizeSum;
+        std::deque<Clock::time_point> completionTimes;
+        std::deque<double> latencies;
+        std::deque<double> waits;
+    };
+
+    void workerLoop(int workerIndex);
+    void removeStaleJobs(Clock::time_point now, std::vector<Job>& expired, std::vector<Job>& cancelled);
+    void collectBatch(std::vector<Job>& batch);
+    Stream* pickStream(int priorityClass);
+    Stream* pickStarvingStream(Clock::time_point now);
+    void recordCompletion(const Job& job, Outcome outcome, size_t batchSize);
+
+    BatchExecutor m_executor;
+    size_t m_maxBatchSize;
+    size_t m_interactiveBatchLimit;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::map<int, Stream> m_streams;
+    double m_virtualTime[kPriorityClassCount];
+    Clock::duration m_starvationLimit[kPriorityClassCount];
+    size_t m_pendingJobs;
+    bool m_shutdown;
+
+    std::vector<std::thread> m_workers;
+};
+
+#endif // DETECTION_SCHEDULER_H
@@ -0,0 +1,89 @@
+#include "frame_arena.h"
+#include <algorithm>
+
+void* FrameArena::OverflowResource::do_allocate(size_t bytes, size_t alignment)
+{
+    this->bytes += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void FrameArena::OverflowResource::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+FrameArena::FrameArena(size_t initialBytes)
+    : m_buffer(std::max<size_t>(initialBytes, 1))
+{
+    m_resource.emplace(m_buffer.data(), m_buffer.size(), &m_overflow);
+}
+
+void FrameArena::reset()
+{
+    // Destroying the resource returns its overflow blocks to the heap
+    m_resource.reset();
+
+    // Grow so the frame that overflowed would have fitted
+    if (m_overflow.bytes > 0) {
+        m_buffer.resize(m_buffer.size() + m_overflow.bytes);
+        m_overflow.bytes = 0;
+    }
+    m_resource.emplace(m_buffer.data(), m_buffer.size(), &m_overflow);
+}
+
+struct ArenaPool::State {
+    size_t arenaBytes;
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<FrameArena>> idle;
+    size_t arenas = 0;
+    uint64_t leases = 0;
+    uint64_t overflows = 0;
+    size_t largestArena = 0;
+};
+
+void ArenaPool::Return::operator()(FrameArena* arena) const
+{
+    std::unique_ptr<FrameArena> owned(arena);
+    bool overflowed = owned->overflowBytes() > 0;
+    owned->reset();
+
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    if (overflowed) {
+        m_state->overflows++;
+    }
+    m_state->largestArena = std::max(m_state->largestArena, owned->capacity());
+    m_state->idle.push_back(std::move(owned));
+}
+
+ArenaPool::ArenaPool(size_t arenaBytes)
+    : m_state(std::make_shared<State>())
+{
+    m_state->arenaBytes = arenaBytes;
+}
+
+ArenaPool::Lease ArenaPool::acquire()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        m_state->leases++;
+        if (!m_state->idle.empty()) {
+            FrameArena* arena = m_state->idle.back().release();
+            m_state->idle.pop_back();
+            return Lease(arena, Return(m_state));
+        }
+        m_state->arenas++;
+    }
+    return Lease(new FrameArena(m_state->arenaBytes), Return(m_state));
+}
+
+ArenaPoolStats ArenaPool::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    ArenaPoolStats stats;
+    stats.arenas = m_state->arenas;
+    stats.idle = m_state->idle.size();
+    stats.leases = m_state->leases;
+    stats.overflows = m_state->overflows;
+    stats.largestArena = std::max(m_state->largestArena, m_state->arenaBytes);
+    return stats;
+}
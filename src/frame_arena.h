@@ -0,0 +1,91 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+// Monotonic memory for the transient data of one frame or batch: request
+// JSON, inline image bytes, base64 text. Allocation bumps a pointer and
+// nothing is freed until reset(), which drops everything in one step. The
+// buffer is kept across resets, so a recycled arena only touches the heap
+// when a frame outgrows it, and then grows to fit the next time.
+class FrameArena {
+public:
+    explicit FrameArena(size_t initialBytes);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    std::pmr::memory_resource* resource() { return &*m_resource; }
+
+    // Everything allocated from resource() is gone after this
+    void reset();
+
+    size_t capacity() const { return m_buffer.size(); }
+    // Bytes that did not fit the buffer since the last reset
+    size_t overflowBytes() const { return m_overflow.bytes; }
+
+private:
+    // Heap fallback that remembers how much it handed out
+    class OverflowResource : public std::pmr::memory_resource {
+    public:
+        size_t bytes = 0;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    std::vector<std::byte> m_buffer;
+    OverflowResource m_overflow;
+    std::optional<std::pmr::monotonic_buffer_resource> m_resource;
+};
+
+struct ArenaPoolStats {
+    size_t arenas;          // Created so far
+    size_t idle;
+    uint64_t leases;
+    uint64_t overflows;     // Leases whose frame outgrew the arena
+    size_t largestArena;    // Bytes
+};
+
+// Recycles arenas between frames. Leases return their arena (reset) to the
+// pool when destroyed and may outlive the pool itself.
+class ArenaPool {
+    struct State;
+
+public:
+    class Return {
+    public:
+        Return() = default;
+        explicit Return(std::shared_ptr<State> state) : m_state(std::move(state)) {}
+        void operator()(FrameArena* arena) const;
+
+    private:
+        std::shared_ptr<State> m_state;
+    };
+
+    using Lease = std::unique_ptr<FrameArena, Return>;
+
+    explicit ArenaPool(size_t arenaBytes = kDefaultArenaBytes);
+
+    ArenaPool(const ArenaPool&) = delete;
+    ArenaPool& operator=(const ArenaPool&) = delete;
+
+    // Never fails: a new arena is made when none is idle
+    Lease acquire();
+    ArenaPoolStats getStats() const;
+
+    static constexpr size_t kDefaultArenaBytes = 64 * 1024;
+
+private:
+    std::shared_ptr<State> m_state;
+};
+
+#endif // FRAME_ARENA_H
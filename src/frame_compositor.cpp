@@ -0,0 +1,188 @@
+#include "frame_compositor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+const int kBoxThickness = 2;
+const uint32_t kBorderColor = 0xFF000000;
+
+// BGRA pixels read as little-endian words: 0xAARRGGBB. Same colours as the GDI overlay.
+const uint32_t kClassColors[] = {
+    0xFFFF0000,     // Red
+    0xFF00FF00,     // Green
+    0xFF0000FF,     // Blue
+    0xFFFFFF00,     // Yellow
+    0xFFFF00FF,     // Magenta
+    0xFF00FFFF,     // Cyan
+    0xFFFF8000,     // Orange
+    0xFF8000FF,     // Purple
+};
+
+uint32_t classColor(const Detection& detection)
+{
+    size_t colors = sizeof(kClassColors) / sizeof(kClassColors[0]);
+    size_t index = detection.classId >= 0 ? static_cast<size_t>(detection.classId)
+                                          : std::hash<std::string>()(detection.className);
+    return kClassColors[index % colors];
+}
+
+void fillRect(uint32_t* pixels, int width, int height, int x1, int y1, int x2, int y2, uint32_t color)
+{
+    x1 = std::clamp(x1, 0, width);
+    x2 = std::clamp(x2, 0, width);
+    y1 = std::clamp(y1, 0, height);
+    y2 = std::clamp(y2, 0, height);
+    if (x2 <= x1) {
+        return;
+    }
+    for (int y = y1; y < y2; ++y) {
+        uint32_t* row = pixels + static_cast<size_t>(y) * width;
+        std::fill(row + x1, row + x2, color);
+    }
+}
+}
+
+FrameCompositor::FrameCompositor()
+    : m_composeMsSum(0.0)
+    , m_lastComposeMs(0.0)
+    , m_hasFrame(false)
+    , m_sequence(0)
+    , m_frames(0)
+    , m_outputWidth(0)
+    , m_outputHeight(0)
+{
+}
+
+void FrameCompositor::setOutputSize(int width, int height)
+{
+    std::lock_guard<std::mutex> lock(m_frontMutex);
+    m_outputWidth = std::max(width, 0);
+    m_outputHeight = std::max(height, 0);
+}
+
+void FrameCompositor::compose(const ImageView& frame, const std::vector<Detection>& detections)
+{
+    if (!frame.pixels || frame.width <= 0 || frame.height <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_composeMutex);
+    int width;
+    int height;
+    {
+        std::lock_guard<std::mutex> frontLock(m_frontMutex);
+        width = m_outputWidth;
+        height = m_outputHeight;
+    }
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    Clock::time_point start = Clock::now();
+    if (m_back.width != width || m_back.height != height) {
+        m_back.pixels.assign(static_cast<size_t>(width) * height, kBorderColor);
+        m_back.width = width;
+        m_back.height = height;
+    }
+
+    // Fit with the aspect ratio kept, centred, the rest of the output black
+    double scale = std::min(static_cast<double>(width) / frame.width, static_cast<double>(height) / frame.height);
+    int fitWidth = std::clamp(static_cast<int>(std::lround(frame.width * scale)), 1, width);
+    int fitHeight = std::clamp(static_cast<int>(std::lround(frame.height * scale)), 1, height);
+    int left = (width - fitWidth) / 2;
+    int top = (height - fitHeight) / 2;
+
+    uint32_t* pixels = m_back.pixels.data();
+    fillRect(pixels, width, height, 0, 0, width, top, kBorderColor);
+    fillRect(pixels, width, height, 0, top + fitHeight, width, height, kBorderColor);
+    fillRect(pixels, width, height, 0, top, left, top + fitHeight, kBorderColor);
+    fillRect(pixels, width, height, left + fitWidth, top, width, top + fitHeight, kBorderColor);
+
+    m_scaler.scale(frame, reinterpret_cast<uint8_t*>(pixels + static_cast<size_t>(top) * width + left),
+                   fitWidth, fitHeight, width * 4);
+
+    double scaleX = static_cast<double>(fitWidth) / frame.width;
+    double scaleY = static_cast<double>(fitHeight) / frame.height;
+    for (const Detection& detection : detections) {
+        const BoundingBox& box = detection.bbox;
+        int x1 = left + static_cast<int>(std::lround(box.x * scaleX));
+        int y1 = top + static_cast<int>(std::lround(box.y * scaleY));
+        int x2 = left + static_cast<int>(std::lround((box.x + box.width) * scaleX));
+        int y2 = top + static_cast<int>(std::lround((box.y + box.height) * scaleY));
+        drawBox(m_back, x1, y1, x2, y2, classColor(detection));
+    }
+
+    double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    m_composeMsSum += elapsedMs;
+    m_lastComposeMs = elapsedMs;
+
+    // Only the swap waits for a draw in progress
+    std::lock_guard<std::mutex> frontLock(m_frontMutex);
+    std::swap(m_front, m_back);
+    m_hasFrame = true;
+    m_sequence++;
+    m_frames++;
+}
+
+void FrameCompositor::drawBox(Buffer& buffer, int x1, int y1, int x2, int y2, uint32_t color)
+{
+    if (buffer.width < kBoxThickness || buffer.height < kBoxThickness) {
+        return;
+    }
+    // Kept inside the output so a box on the frame's edge stays visible
+    x1 = std::clamp(x1, 0, buffer.width - kBoxThickness);
+    y1 = std::clamp(y1, 0, buffer.height - kBoxThickness);
+    x2 = std::clamp(x2, x1 + kBoxThickness, buffer.width);
+    y2 = std::clamp(y2, y1 + kBoxThickness, buffer.height);
+
+    uint32_t* pixels = buffer.pixels.data();
+    fillRect(pixels, buffer.width, buffer.height, x1, y1, x2, y1 + kBoxThickness, color);
+    fillRect(pixels, buffer.width, buffer.height, x1, y2 - kBoxThickness, x2, y2, color);
+    fillRect(pixels, buffer.width, buffer.height, x1, y1, x1 + kBoxThickness, y2, color);
+    fillRect(pixels, buffer.width, buffer.height, x2 - kBoxThickness, y1, x2, y2, color);
+}
+
+bool FrameCompositor::drawFront(const std::function<void(const ImageView& image)>& draw) const
+{
+    std::lock_guard<std::mutex> lock(m_frontMutex);
+    if (!m_hasFrame) {
+        return false;
+    }
+    ImageView image;
+    image.pixels = reinterpret_cast<const uint8_t*>(m_front.pixels.data());
+    image.width = m_front.width;
+    image.height = m_front.height;
+    image.stride = m_front.width * 4;
+    draw(image);
+    return true;
+}
+
+void FrameCompositor::clear()
+{
+    std::lock_guard<std::mutex> lock(m_frontMutex);
+    m_hasFrame = false;
+    m_sequence++;
+}
+
+uint64_t FrameCompositor::getSequence() const
+{
+    std::lock_guard<std::mutex> lock(m_frontMutex);
+    return m_sequence;
+}
+
+CompositorStats FrameCompositor::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_composeMutex);
+    std::lock_guard<std::mutex> frontLock(m_frontMutex);
+    CompositorStats stats;
+    stats.frames = m_frames;
+    stats.outputWidth = m_outputWidth;
+    stats.outputHeight = m_outputHeight;
+    stats.meanComposeMs = m_frames > 0 ? m_composeMsSum / static_cast<double>(m_frames) : 0.0;
+    stats.lastComposeMs = m_lastComposeMs;
+    stats.scaler = m_scaler.getStats();
+    return stats;
+}
@@ -0,0 +1,74 @@
+#ifndef FRAME_COMPOSITOR_H
+#define FRAME_COMPOSITOR_H
+
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+#include "image_scaler.h"
+#include "detection_client.h"
+
+struct CompositorStats {
+    uint64_t frames;
+    int outputWidth;
+    int outputHeight;
+    double meanComposeMs;
+    double lastComposeMs;
+    ImageScalerStats scaler;
+};
+
+// Renders frames for display: fitted into the output size with their aspect
+// ratio kept, detection boxes drawn on top. Frames are composed into a back
+// buffer that is swapped with the front buffer when done, so the display
+// only ever reads a finished frame and never waits for a composition.
+class FrameCompositor {
+public:
+    FrameCompositor();
+
+    FrameCompositor(const FrameCompositor&) = delete;
+    FrameCompositor& operator=(const FrameCompositor&) = delete;
+
+    // Takes effect with the next frame; 0 x 0 stops composition
+    void setOutputSize(int width, int height);
+
+    // Boxes are in the frame's pixels. Safe to call from several threads;
+    // compositions are serialised.
+    void compose(const ImageView& frame, const std::vector<Detection>& detections);
+
+    // Calls draw with the newest composed frame, which stays untouched until
+    // draw returns. Returns false before the first frame and after clear().
+    bool drawFront(const std::function<void(const ImageView& image)>& draw) const;
+
+    // Drops the front buffer, e.g. when the feed stops
+    void clear();
+
+    // Changes with every composed frame and clear()
+    uint64_t getSequence() const;
+
+    CompositorStats getStats() const;
+
+private:
+    struct Buffer {
+        std::vector<uint32_t> pixels;   // BGRA
+        int width = 0;
+        int height = 0;
+    };
+
+    static void drawBox(Buffer& buffer, int x1, int y1, int x2, int y2, uint32_t color);
+
+    mutable std::mutex m_composeMutex;  // Held while the back buffer is written
+    ImageScaler m_scaler;
+    Buffer m_back;
+    double m_composeMsSum;
+    double m_lastComposeMs;
+
+    mutable std::mutex m_frontMutex;
+    Buffer m_front;
+    bool m_hasFrame;
+    uint64_t m_sequence;
+    uint64_t m_frames;
+    int m_outputWidth;
+    int m_outputHeight;
+};
+
+#endif // FRAME_COMPOSITOR_H
@@ -0,0 +1,132 @@
+#include "frame_pacer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+const double kMinRate = 0.01;
+}
+
+FramePacer::FramePacer(double fps)
+    : m_stopped(false)
+    , m_started(false)
+    , m_rate(std::max(kMinRate, fps))
+    , m_period(periodFor(fps))
+    , m_ticks(0)
+    , m_droppedDeadlines(0)
+    , m_jitterMean(0.0)
+    , m_jitterM2(0.0)
+    , m_jitterMax(0.0)
+{
+}
+
+FramePacer::Clock::duration FramePacer::periodFor(double fps) const
+{
+    std::chrono::duration<double> seconds(1.0 / std::max(kMinRate, fps));
+    return std::chrono::duration_cast<Clock::duration>(seconds);
+}
+
+void FramePacer::setRate(double fps)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_rate = std::max(kMinRate, fps);
+    Clock::duration period = periodFor(fps);
+    // Callers may repeat the current rate on every frame; that must leave
+    // the grid, and any deadlines already missed, alone
+    if (period == m_period) {
+        return;
+    }
+    Clock::duration oldPeriod = m_period;
+    m_period = period;
+
+    if (m_started) {
+        // The next deadline moves to one new period after the slot before
+        // it, so the change applies to the very next frame; deadlines missed
+        // meanwhile are still dropped and counted by waitForNextFrame
+        m_nextDeadline = m_nextDeadline - oldPeriod + m_period;
+    }
+    m_wakeup.notify_all();
+}
+
+double FramePacer::getRate() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_rate;
+}
+
+void FramePacer::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = false;
+    m_started = false;
+    m_ticks = 0;
+    m_droppedDeadlines = 0;
+    m_jitterMean = 0.0;
+    m_jitterM2 = 0.0;
+    m_jitterMax = 0.0;
+}
+
+void FramePacer::stop()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+    m_wakeup.notify_all();
+}
+
+bool FramePacer::waitForNextFrame()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (!m_started) {
+        m_started = true;
+        m_nextDeadline = Clock::now();
+    }
+
+    while (!m_stopped) {
+        Clock::time_point now = Clock::now();
+
+        if (now < m_nextDeadline) {
+            m_wakeup.wait_until(lock, m_nextDeadline);
+            continue;
+        }
+
+        // Deadlines missed by more than half a period are dropped; the grid
+        // itself never moves, so the long-run rate stays exact
+        Clock::duration lateness = now - m_nextDeadline;
+        if (lateness > m_period / 2) {
+            auto missed = (lateness - m_period / 2) / m_period + 1;
+            m_nextDeadline += missed * m_period;
+            m_droppedDeadlines += static_cast<uint64_t>(missed);
+            continue;
+        }
+
+        recordJitter(std::chrono::duration<double, std::milli>(lateness).count());
+        m_ticks++;
+        m_nextDeadline += m_period;
+        return true;
+    }
+
+    return false;
+}
+
+void FramePacer::recordJitter(double jitterMs)
+{
+    // Welford's running mean/variance
+    double count = static_cast<double>(m_ticks + 1);
+    double delta = jitterMs - m_jitterMean;
+    m_jitterMean += delta / count;
+    m_jitterM2 += delta * (jitterMs - m_jitterMean);
+    m_jitterMax = std::max(m_jitterMax, jitterMs);
+}
+
+FramePacerStats FramePacer::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FramePacerStats stats;
+    stats.rate = m_rate;
+    stats.ticks = m_ticks;
+    stats.droppedDeadlines = m_droppedDeadlines;
+    stats.meanJitterMs = m_jitterMean;
+    stats.stddevJitterMs = m_ticks > 1 ? std::sqrt(m_jitterM2 / static_cast<double>(m_ticks - 1)) : 0.0;
+    stats.maxJitterMs = m_jitterMax;
+    return stats;
+}
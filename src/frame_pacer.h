@@ -0,0 +1,59 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+struct FramePacerStats {
+    double rate;
+    uint64_t ticks;             // Deadlines that were served
+    uint64_t droppedDeadlines;  // Deadlines that passed while the previous frame was still running
+    double meanJitterMs;        // Wake-up lateness relative to the deadline
+    double stddevJitterMs;
+    double maxJitterMs;
+};
+
+// Paces a loop against absolute deadlines on a fixed grid (start + k * period),
+// so a slow iteration never shifts the schedule. Deadlines that are already
+// in the past when the loop comes back are dropped instead of fired late.
+class FramePacer {
+public:
+    explicit FramePacer(double fps);
+
+    // Safe to call from any thread; a pending wait picks up the new period
+    void setRate(double fps);
+    double getRate() const;
+
+    // Starts a new grid at the current time and clears the stop flag
+    void reset();
+
+    // Blocks until the next deadline. Returns false once stop() is called.
+    bool waitForNextFrame();
+    void stop();
+
+    FramePacerStats getStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::duration periodFor(double fps) const;
+    void recordJitter(double jitterMs);
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    bool m_stopped;
+    bool m_started;
+    double m_rate;
+    Clock::duration m_period;
+    Clock::time_point m_nextDeadline;
+
+    uint64_t m_ticks;
+    uint64_t m_droppedDeadlines;
+    double m_jitterMean;
+    double m_jitterM2;
+    double m_jitterMax;
+};
+
+#endif // FRAME_PACER_H
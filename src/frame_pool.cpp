@@ -0,0 +1,120 @@
+#include "frame_pool.h"
+#include <mutex>
+#include <vector>
+#include <filesystem>
+#include <algorithm>
+
+struct FramePool::State {
+    std::mutex mutex;
+    std::vector<FrameSlot> slots;
+    std::vector<bool> leased;
+    std::vector<uint64_t> slotBytes;
+    FramePoolStats stats;
+
+    ~State()
+    {
+        // Leases may outlive the pool, so slot files go away with the last one
+        for (const FrameSlot& slot : slots) {
+            std::error_code ec;
+            std::filesystem::remove(slot.path, ec);
+        }
+    }
+
+    void release(int index)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        leased[index] = false;
+        stats.bytesInUse -= slotBytes[index];
+        stats.inUse--;
+        stats.releases++;
+    }
+};
+
+FramePool::FramePool(const std::string& directory, size_t slotCount, uint64_t byteBudget)
+    : m_state(std::make_shared<State>())
+{
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+
+    for (size_t i = 0; i < slotCount; ++i) {
+        std::filesystem::path path = std::filesystem::path(directory) / ("slot_" + std::to_string(i) + ".jpg");
+        m_state->slots.push_back({static_cast<int>(i), path.string()});
+    }
+    m_state->leased.assign(slotCount, false);
+    m_state->slotBytes.assign(slotCount, 0);
+    m_state->stats = FramePoolStats();
+    m_state->stats.slotCount = slotCount;
+    m_state->stats.byteBudget = byteBudget;
+}
+
+FramePool::~FramePool()
+{
+}
+
+FrameLease FramePool::acquire()
+{
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    FramePoolStats& stats = m_state->stats;
+
+    auto it = std::find(m_state->leased.begin(), m_state->leased.end(), false);
+    if (it == m_state->leased.end()) {
+        stats.exhausted++;
+        return nullptr;
+    }
+
+    // Estimate the next frame from the largest one seen so far
+    uint64_t expected = *std::max_element(m_state->slotBytes.begin(), m_state->slotBytes.end());
+    if (stats.byteBudget > 0 && stats.bytesInUse + expected > stats.byteBudget) {
+        stats.budgetRejections++;
+        return nullptr;
+    }
+
+    int index = static_cast<int>(it - m_state->leased.begin());
+    m_state->leased[index] = true;
+    stats.bytesInUse += m_state->slotBytes[index];
+    stats.inUse++;
+    stats.peakInUse = std::max(stats.peakInUse, stats.inUse);
+    stats.leases++;
+
+    std::shared_ptr<State> state = m_state;
+    return FrameLease(new FrameSlot(m_state->slots[index]), [state](const FrameSlot* slot) {
+        state->release(slot->index);
+        delete slot;
+    });
+}
+
+void FramePool::commit(const FrameLease& lease)
+{
+    if (!lease) {
+        return;
+    }
+
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(lease->path, ec);
+    if (ec) {
+        size = 0;
+    }
+
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    m_state->stats.bytesInUse -= m_state->slotBytes[lease->index];
+    m_state->slotBytes[lease->index] = size;
+    m_state->stats.bytesInUse += size;
+}
+
+FramePoolStats FramePool::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    return m_state->stats;
+}
+
+void FramePool::purgeDirectory(const std::string& directory, const std::string& prefix)
+{
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        if (name.compare(0, prefix.size(), prefix) == 0) {
+            std::error_code removeEc;
+            std::filesystem::remove(it->path(), removeEc);
+        }
+    }
+}
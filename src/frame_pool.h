@@ -0,0 +1,56 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+struct FrameSlot {
+    int index;
+    std::string path;
+};
+
+// A lease keeps its slot out of circulation until the last reference is
+// dropped. Holders release explicitly with reset() once their request is done.
+using FrameLease = std::shared_ptr<const FrameSlot>;
+
+struct FramePoolStats {
+    size_t slotCount;
+    size_t inUse;
+    size_t peakInUse;
+    uint64_t byteBudget;
+    uint64_t bytesInUse;
+    uint64_t leases;
+    uint64_t releases;
+    uint64_t exhausted;         // acquire() found no free slot
+    uint64_t budgetRejections;  // acquire() would have exceeded the byte budget
+};
+
+// Fixed set of reusable frame files. Slot files are overwritten in place, so
+// the number and total size of frames on disk stays bounded for the whole session.
+class FramePool {
+public:
+    FramePool(const std::string& directory, size_t slotCount, uint64_t byteBudget);
+    ~FramePool();
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // Returns nullptr when every slot is leased or the byte budget is spent
+    FrameLease acquire();
+
+    // Records the size of the frame just written into a leased slot
+    void commit(const FrameLease& lease);
+
+    FramePoolStats getStats() const;
+
+    // Deletes files in the directory that start with prefix (leftovers of older runs)
+    static void purgeDirectory(const std::string& directory, const std::string& prefix);
+
+private:
+    struct State;
+    std::shared_ptr<State> m_state;
+};
+
+#endif // FRAME_POOL_H
@@ -1,13 +1,55 @@
 #include "image_processor.h"
 #include <map>
+#include <cstring>
+#include <gdiplus.h>
 
 ImageProcessor::ImageProcessor()
     : m_colorIndex(0)
+    , m_gdiplusToken(0)
 {
+    Gdiplus::GdiplusStartupInput startupInput;
+    Gdiplus::GdiplusStartup(&m_gdiplusToken, &startupInput, NULL);
 }
 
 ImageProcessor::~ImageProcessor()
 {
+    if (m_gdiplusToken) {
+        Gdiplus::GdiplusShutdown(m_gdiplusToken);
+    }
+}
+
+bool ImageProcessor::loadPixels(const std::string& imagePath, std::vector<uint8_t>& pixels, int& width, int& height)
+{
+    if (!m_gdiplusToken) {
+        return false;
+    }
+
+    int size = MultiByteToWideChar(CP_UTF8, 0, imagePath.c_str(), -1, NULL, 0);
+    std::wstring path(size, 0);
+    MultiByteToWideChar(CP_UTF8, 0, imagePath.c_str(), -1, &path[0], size);
+
+    // The file stays open only while the bitmap exists, so the slot can be rewritten afterwards
+    Gdiplus::Bitmap bitmap(path.c_str());
+    if (bitmap.GetLastStatus() != Gdiplus::Ok) {
+        return false;
+    }
+
+    Gdiplus::Rect rect(0, 0, bitmap.GetWidth(), bitmap.GetHeight());
+    Gdiplus::BitmapData data;
+    if (bitmap.LockBits(&rect, Gdiplus::ImageLockModeRead, PixelFormat32bppARGB, &data) != Gdiplus::Ok) {
+        return false;
+    }
+
+    width = static_cast<int>(data.Width);
+    height = static_cast<int>(data.Height);
+    size_t rowBytes = static_cast<size_t>(width) * 4;
+    pixels.resize(rowBytes * height);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = static_cast<const uint8_t*>(data.Scan0) + static_cast<ptrdiff_t>(y) * data.Stride;
+        std::memcpy(&pixels[rowBytes * y], row, rowBytes);
+    }
+    bitmap.UnlockBits(&data);
+    return true;
 }
 
 HBITMAP ImageProcessor::drawBoundingBoxes(const std::string& imagePath, 
@@ -3,6 +3,8 @@
 
 #include <windows.h>
 #include <string>
+#include <vector>
+#include <cstdint>
 #include "detection_client.h"
 
 class ImageProcessor {
@@ -20,12 +22,17 @@ public:
                              bool showLabels = true,
                              bool showConfidence = true);
 
+    // Decodes an image file (JPEG, PNG, BMP, ...) into top-down BGRA pixels.
+    // Safe to call from several threads.
+    bool loadPixels(const std::string& imagePath, std::vector<uint8_t>& pixels, int& width, int& height);
+
 private:
     COLORREF getClassColor(const std::string& className);
     void drawBoundingBox(HDC hdc, const Detection& detection,
                         bool showLabels, bool showConfidence);
 
     int m_colorIndex;
+    ULONG_PTR m_gdiplusToken;
 };
 
 #endif // IMAGE_PROCESSOR_H
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include "image_scaler.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_SCALER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+// Display sizes change rarely; a few cover the cameras and still images in use
+const size_t kMaxCachedSizes = 4;
+
+uint8_t toByte(float value)
+{
+    int rounded = static_cast<int>(value + 0.5f);
+    return static_cast<uint8_t>(rounded < 0 ? 0 : (rounded > 255 ? 255 : rounded));
+}
+}
+
+ImageScaler::ImageScaler()
+    : m_simd(hasSimd())
+    , m_stats()
+{
+    m_stats.simd = m_simd;
+}
+
+bool ImageScaler::hasSimd()
+{
+#ifdef IMAGE_SCALER_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ImageScaler::setSimdEnabled(bool enabled)
+{
+    m_simd = enabled && hasSimd();
+    m_stats.simd = m_simd;
+}
+
+ImageScalerStats ImageScaler::getStats() const
+{
+    ImageScalerStats stats = m_stats;
+    stats.cachedSizes = m_cache.size();
+    return stats;
+}
+
+ImageScaler::Taps ImageScaler::buildTaps(int sourceSize, int size)
+{
+    std::vector<int> first(size);
+    std::vector<std::vector<float>> weights(size);
+    double ratio = static_cast<double>(sourceSize) / size;
+
+    for (int i = 0; i < size; ++i) {
+        if (ratio >= 1.0) {
+            // Area: every source pixel weighs by how much of it the output pixel covers
+            double begin = i * ratio;
+            double end = (i + 1) * ratio;
+            int firstPixel = static_cast<int>(begin);
+            int lastPixel = std::min(sourceSize - 1, static_cast<int>(std::ceil(end)) - 1);
+            first[i] = firstPixel;
+            for (int j = firstPixel; j <= lastPixel; ++j) {
+                double covered = std::min<double>(end, j + 1) - std::max<double>(begin, j);
+                weights[i].push_back(static_cast<float>(std::max(covered, 0.0) / ratio));
+            }
+        } else if (sourceSize == 1) {
+            first[i] = 0;
+            weights[i].push_back(1.0f);
+        } else {
+            // Bilinear between the two source pixels around the output pixel's centre
+            double center = (i + 0.5) * ratio - 0.5;
+            int left = std::clamp(static_cast<int>(std::floor(center)), 0, sourceSize - 2);
+            double fraction = std::clamp(center - left, 0.0, 1.0);
+            first[i] = left;
+            weights[i].push_back(static_cast<float>(1.0 - fraction));
+            weights[i].push_back(static_cast<float>(fraction));
+        }
+    }
+
+    Taps taps;
+    taps.count = 1;
+    for (const std::vector<float>& pixel : weights) {
+        taps.count = std::max(taps.count, static_cast<int>(pixel.size()));
+    }
+    taps.count = std::min(taps.count, sourceSize);
+
+    // Pad to the common count; near the far edge the window moves back instead
+    taps.first.resize(size);
+    taps.weights.assign(static_cast<size_t>(size) * taps.count, 0.0f);
+    for (int i = 0; i < size; ++i) {
+        int start = std::min(first[i], sourceSize - taps.count);
+        taps.first[i] = start;
+        float sum = 0.0f;
+        for (float weight : weights[i]) {
+            sum += weight;
+        }
+        for (size_t k = 0; k < weights[i].size(); ++k) {
+            taps.weights[static_cast<size_t>(i) * taps.count + (first[i] - start) + k] = weights[i][k] / sum;
+        }
+    }
+    return taps;
+}
+
+const ImageScaler::Coefficients& ImageScaler::coefficientsFor(int sourceWidth, int sourceHeight, int width,
+                                                              int height)
+{
+    auto it = std::find_if(m_cache.begin(), m_cache.end(), [&](const std::unique_ptr<Coefficients>& entry) {
+        return entry->sourceWidth == sourceWidth && entry->sourceHeight == sourceHeight &&
+               entry->width == width && entry->height == height;
+    });
+    if (it != m_cache.end()) {
+        std::rotate(m_cache.begin(), it, it + 1);
+        return *m_cache.front();
+    }
+
+    auto coefficients = std::make_unique<Coefficients>();
+    coefficients->sourceWidth = sourceWidth;
+    coefficients->sourceHeight = sourceHeight;
+    coefficients->width = width;
+    coefficients->height = height;
+    coefficients->horizontal = buildTaps(sourceWidth, width);
+    coefficients->vertical = buildTaps(sourceHeight, height);
+    m_stats.coefficientBuilds++;
+
+    m_cache.insert(m_cache.begin(), std::move(coefficients));
+    if (m_cache.size() > kMaxCachedSizes) {
+        m_cache.pop_back();
+    }
+    return *m_cache.front();
+}
+
+void ImageScaler::scale(const ImageView& source, uint8_t* destination, int width, int height, int stride)
+{
+    if (source.width <= 0 || source.height <= 0 || width <= 0 || height <= 0) {
+        return;
+    }
+
+    const Coefficients& coefficients = coefficientsFor(source.width, source.height, width, height);
+    m_row.resize(static_cast<size_t>(source.width) * 4);
+
+    // Rows first: the filtered row stays in cache while the columns are blended
+    for (int y = 0; y < height; ++y) {
+        blendRows(source, coefficients.vertical, y);
+        blendColumns(coefficients.horizontal, destination + static_cast<size_t>(y) * stride, width);
+    }
+    m_stats.images++;
+}
+
+void ImageScaler::blendRows(const ImageView& source, const Taps& vertical, int y)
+{
+    const float* weights = &vertical.weights[static_cast<size_t>(y) * vertical.count];
+    int values = source.width * 4;
+    float* row = m_row.data();
+    bool started = false;
+
+    for (int t = 0; t < vertical.count; ++t) {
+        float weight = weights[t];
+        if (weight == 0.0f) {
+            continue;
+        }
+        const uint8_t* pixels = source.pixels + static_cast<size_t>(vertical.first[y] + t) * source.stride;
+        int i = 0;
+#ifdef IMAGE_SCALER_SSE2
+        if (m_simd) {
+            // Sixteen channel values per step: widen bytes to floats, then multiply-add
+            const __m128i zero = _mm_setzero_si128();
+            const __m128 w = _mm_set1_ps(weight);
+            for (; i + 16 <= values; i += 16) {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+                __m128i low = _mm_unpacklo_epi8(bytes, zero);
+                __m128i high = _mm_unpackhi_epi8(bytes, zero);
+                __m128 p0 = _mm_mul_ps(w, _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)));
+                __m128 p1 = _mm_mul_ps(w, _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)));
+                __m128 p2 = _mm_mul_ps(w, _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)));
+                __m128 p3 = _mm_mul_ps(w, _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)));
+                if (started) {
+                    p0 = _mm_add_ps(p0, _mm_loadu_ps(row + i));
+                    p1 = _mm_add_ps(p1, _mm_loadu_ps(row + i + 4));
+                    p2 = _mm_add_ps(p2, _mm_loadu_ps(row + i + 8));
+                    p3 = _mm_add_ps(p3, _mm_loadu_ps(row + i + 12));
+                }
+                _mm_storeu_ps(row + i, p0);
+                _mm_storeu_ps(row + i + 4, p1);
+                _mm_storeu_ps(row + i + 8, p2);
+                _mm_storeu_ps(row + i + 12, p3);
+            }
+        }
+#endif
+        if (started) {
+            for (; i < values; ++i) {
+                row[i] += weight * pixels[i];
+            }
+        } else {
+            for (; i < values; ++i) {
+                row[i] = weight * pixels[i];
+            }
+        }
+        started = true;
+    }
+}
+
+void ImageScaler::blendColumns(const Taps& horizontal, uint8_t* out, int width)
+{
+    const float* row = m_row.data();
+    int x = 0;
+#ifdef IMAGE_SCALER_SSE2
+    if (m_simd) {
+        // One pixel's four channels per register; four pixels packed to bytes per store
+        for (; x + 4 <= width; x += 4) {
+            __m128i pixels[4];
+            for (int p = 0; p < 4; ++p) {
+                const float* weights = &horizontal.weights[static_cast<size_t>(x + p) * horizontal.count];
+                const float* taps = row + static_cast<size_t>(horizontal.first[x + p]) * 4;
+                __m128 sum = _mm_mul_ps(_mm_set1_ps(weights[0]), _mm_loadu_ps(taps));
+                for (int t = 1; t < horizontal.count; ++t) {
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(taps + t * 4)));
+                }
+                pixels[p] = _mm_cvtps_epi32(sum);
+            }
+            __m128i words = _mm_packs_epi32(pixels[0], pixels[1]);
+            __m128i moreWords = _mm_packs_epi32(pixels[2], pixels[3]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + static_cast<size_t>(x) * 4),
+                             _mm_packus_epi16(words, moreWords));
+        }
+    }
+#endif
+    for (; x < width; ++x) {
+        const float* weights = &horizontal.weights[static_cast<size_t>(x) * horizontal.count];
+        const float* taps = row + static_cast<size_t>(horizontal.first[x]) * 4;
+        for (int c = 0; c < 4; ++c) {
+            float sum = 0.0f;
+            for (int t = 0; t < horizontal.count; ++t) {
+                sum += weights[t] * taps[t * 4 + c];
+            }
+            out[static_cast<size_t>(x) * 4 + c] = toByte(sum);
+        }
+    }
+}
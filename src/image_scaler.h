@@ -0,0 +1,78 @@
+#ifndef IMAGE_SCALER_H
+#define IMAGE_SCALER_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+// 32-bit BGRA pixels (the Win32 DIB layout), rows stride bytes apart, top row first
+struct ImageView {
+    const uint8_t* pixels;
+    int width;
+    int height;
+    int stride;
+};
+
+struct ImageScalerStats {
+    uint64_t images;
+    uint64_t coefficientBuilds;     // Cache misses
+    size_t cachedSizes;
+    bool simd;                      // SSE2 path in use
+};
+
+// Resizes BGRA images. Each axis is filtered on its own: a shrinking axis
+// averages the source area every output pixel covers, a growing one
+// interpolates bilinearly. The filter taps of a source/destination size pair
+// are computed once and kept, so a stream of equally sized frames only runs
+// the inner loops, which use SSE2 where the target has it.
+//
+// Not thread-safe; give each thread its own scaler.
+class ImageScaler {
+public:
+    ImageScaler();
+
+    ImageScaler(const ImageScaler&) = delete;
+    ImageScaler& operator=(const ImageScaler&) = delete;
+
+    // Writes width x height pixels to destination; both sizes must be positive
+    void scale(const ImageView& source, uint8_t* destination, int width, int height, int stride);
+
+    // Falls back to the portable loops; for comparison in benchmarks
+    void setSimdEnabled(bool enabled);
+
+    ImageScalerStats getStats() const;
+
+    static bool hasSimd();
+
+private:
+    // Per output pixel along one axis: the first source pixel and a fixed
+    // number of weights, zero-padded, so the inner loops do not branch
+    struct Taps {
+        std::vector<int> first;
+        std::vector<float> weights;
+        int count;
+    };
+
+    struct Coefficients {
+        int sourceWidth;
+        int sourceHeight;
+        int width;
+        int height;
+        Taps horizontal;
+        Taps vertical;
+    };
+
+    static Taps buildTaps(int sourceSize, int size);
+    const Coefficients& coefficientsFor(int sourceWidth, int sourceHeight, int width, int height);
+
+    void blendRows(const ImageView& source, const Taps& vertical, int y);
+    void blendColumns(const Taps& horizontal, uint8_t* row, int width);
+
+    std::vector<std::unique_ptr<Coefficients>> m_cache;     // Most recently used first
+    std::vector<float> m_row;       // One source row, vertically filtered
+    bool m_simd;
+    ImageScalerStats m_stats;
+};
+
+#endif // IMAGE_SCALER_H
@@ -0,0 +1,396 @@
+#include "jpeg_encoder.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Coefficient order in the stream: natural index of each zigzag position
+const uint8_t kZigzag[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// ITU T.81 Annex K tables, natural order
+const uint8_t kLumaQuant[64] = {
+    16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55,
+    14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62,
+    18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99,
+};
+const uint8_t kChromaQuant[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+};
+
+// Huffman tables as stored in DHT: code counts per length 1-16, then symbols
+const uint8_t kLumaDcCounts[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+const uint8_t kLumaDcSymbols[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+const uint8_t kChromaDcCounts[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+const uint8_t kChromaDcSymbols[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+const uint8_t kLumaAcCounts[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+const uint8_t kLumaAcSymbols[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa,
+};
+const uint8_t kChromaAcCounts[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+const uint8_t kChromaAcSymbols[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa,
+};
+
+// Output scale of each AAN DCT coefficient, times sqrt(8)
+const float kAanScales[8] = {
+    1.0f * 2.828427125f, 1.387039845f * 2.828427125f, 1.306562965f * 2.828427125f, 1.175875602f * 2.828427125f,
+    1.0f * 2.828427125f, 0.785694958f * 2.828427125f, 0.541196100f * 2.828427125f, 0.275899379f * 2.828427125f,
+};
+
+void scaleQuantTable(const uint8_t* base, int quality, uint8_t* out, float* scales)
+{
+    // IJG quality scaling
+    int factor = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    for (int i = 0; i < 64; ++i) {
+        out[i] = static_cast<uint8_t>(std::clamp((base[i] * factor + 50) / 100, 1, 255));
+    }
+    for (int row = 0; row < 8; ++row) {
+        for (int col = 0; col < 8; ++col) {
+            scales[row * 8 + col] = 1.0f / (out[row * 8 + col] * kAanScales[row] * kAanScales[col]);
+        }
+    }
+}
+
+// Arai-Agui-Nakajima forward DCT of 8 values spaced by stride, in place
+void dct8(float* d, int stride)
+{
+    float* d0 = d;
+    float* d1 = d + stride;
+    float* d2 = d + stride * 2;
+    float* d3 = d + stride * 3;
+    float* d4 = d + stride * 4;
+    float* d5 = d + stride * 5;
+    float* d6 = d + stride * 6;
+    float* d7 = d + stride * 7;
+
+    float tmp0 = *d0 + *d7;
+    float tmp7 = *d0 - *d7;
+    float tmp1 = *d1 + *d6;
+    float tmp6 = *d1 - *d6;
+    float tmp2 = *d2 + *d5;
+    float tmp5 = *d2 - *d5;
+    float tmp3 = *d3 + *d4;
+    float tmp4 = *d3 - *d4;
+
+    float tmp10 = tmp0 + tmp3;
+    float tmp13 = tmp0 - tmp3;
+    float tmp11 = tmp1 + tmp2;
+    float tmp12 = tmp1 - tmp2;
+    *d0 = tmp10 + tmp11;
+    *d4 = tmp10 - tmp11;
+    float z1 = (tmp12 + tmp13) * 0.707106781f;
+    *d2 = tmp13 + z1;
+    *d6 = tmp13 - z1;
+
+    tmp10 = tmp4 + tmp5;
+    tmp11 = tmp5 + tmp6;
+    tmp12 = tmp6 + tmp7;
+    float z5 = (tmp10 - tmp12) * 0.382683433f;
+    float z2 = tmp10 * 0.541196100f + z5;
+    float z4 = tmp12 * 1.306562965f + z5;
+    float z3 = tmp11 * 0.707106781f;
+    float z11 = tmp7 + z3;
+    float z13 = tmp7 - z3;
+    *d5 = z13 + z2;
+    *d3 = z13 - z2;
+    *d1 = z11 + z4;
+    *d7 = z11 - z4;
+}
+
+void putByte(std::string& out, int value)
+{
+    out.push_back(static_cast<char>(value));
+}
+
+void putWord(std::string& out, int value)
+{
+    out.push_back(static_cast<char>(value >> 8));
+    out.push_back(static_cast<char>(value & 0xFF));
+}
+
+void putHuffmanTable(std::string& out, int classAndId, const uint8_t (&counts)[16], const uint8_t* symbols)
+{
+    putByte(out, classAndId);
+    int total = 0;
+    for (uint8_t count : counts) {
+        putByte(out, count);
+        total += count;
+    }
+    out.append(reinterpret_cast<const char*>(symbols), total);
+}
+
+// Code and length of every symbol, indexed by symbol
+struct HuffmanTable {
+    uint16_t codes[256];
+    uint8_t lengths[256];
+};
+
+HuffmanTable makeTable(const uint8_t (&counts)[16], const uint8_t* symbols)
+{
+    // Canonical codes: consecutive within a length, doubled for the next
+    HuffmanTable table = HuffmanTable();
+    uint16_t code = 0;
+    int k = 0;
+    for (int length = 1; length <= 16; ++length) {
+        for (int i = 0; i < counts[length - 1]; ++i, ++k) {
+            table.codes[symbols[k]] = code++;
+            table.lengths[symbols[k]] = static_cast<uint8_t>(length);
+        }
+        code <<= 1;
+    }
+    return table;
+}
+
+struct HuffmanTables {
+    HuffmanTable lumaDc = makeTable(kLumaDcCounts, kLumaDcSymbols);
+    HuffmanTable lumaAc = makeTable(kLumaAcCounts, kLumaAcSymbols);
+    HuffmanTable chromaDc = makeTable(kChromaDcCounts, kChromaDcSymbols);
+    HuffmanTable chromaAc = makeTable(kChromaAcCounts, kChromaAcSymbols);
+};
+
+const HuffmanTables& huffmanTables()
+{
+    static const HuffmanTables tables;
+    return tables;
+}
+
+// Entropy-coded bits, with 0xFF bytes stuffed as the format requires
+class BitWriter {
+public:
+    explicit BitWriter(std::string& out) : m_out(out), m_buffer(0), m_count(0) {}
+
+    void write(uint32_t code, int length)
+    {
+        m_count += length;
+        m_buffer |= code << (24 - m_count);
+        while (m_count >= 8) {
+            int byte = (m_buffer >> 16) & 0xFF;
+            m_out.push_back(static_cast<char>(byte));
+            if (byte == 0xFF) {
+                m_out.push_back(0);
+            }
+            m_buffer <<= 8;
+            m_count -= 8;
+        }
+    }
+
+    void write(const HuffmanTable& table, int symbol) { write(table.codes[symbol], table.lengths[symbol]); }
+
+    // Pads the last byte with one bits
+    void flush() { write(0x7F, 7); }
+
+private:
+    std::string& m_out;
+    uint32_t m_buffer;
+    int m_count;
+};
+
+// Magnitude category of a coefficient and its bits as stored after the code
+int valueBits(int value, uint32_t& bits)
+{
+    int magnitude = value < 0 ? -value : value;
+    int length = 0;
+    while (magnitude) {
+        magnitude >>= 1;
+        length++;
+    }
+    bits = static_cast<uint32_t>(value < 0 ? value - 1 : value) & ((1u << length) - 1);
+    return length;
+}
+
+// Transforms, quantises and writes one 8x8 block of level-shifted samples
+void encodeBlock(float* block, const float* scales, int& previousDc, const HuffmanTable& dc,
+                 const HuffmanTable& ac, BitWriter& writer)
+{
+    for (int row = 0; row < 8; ++row) {
+        dct8(block + row * 8, 1);
+    }
+    for (int col = 0; col < 8; ++col) {
+        dct8(block + col, 8);
+    }
+
+    int coefficients[64];
+    for (int i = 0; i < 64; ++i) {
+        float value = block[kZigzag[i]] * scales[kZigzag[i]];
+        coefficients[i] = static_cast<int>(value < 0 ? value - 0.5f : value + 0.5f);
+    }
+
+    uint32_t bits;
+    int difference = coefficients[0] - previousDc;
+    previousDc = coefficients[0];
+    int length = valueBits(difference, bits);
+    writer.write(dc, length);
+    writer.write(bits, length);
+
+    int last = 63;
+    while (last > 0 && coefficients[last] == 0) {
+        last--;
+    }
+    for (int i = 1; i <= last; ++i) {
+        int zeros = 0;
+        while (coefficients[i] == 0) {
+            zeros++;
+            i++;
+        }
+        // Runs of sixteen zeros have their own symbol
+        for (; zeros >= 16; zeros -= 16) {
+            writer.write(ac, 0xF0);
+        }
+        length = valueBits(coefficients[i], bits);
+        writer.write(ac, (zeros << 4) + length);
+        writer.write(bits, length);
+    }
+    if (last != 63) {
+        writer.write(ac, 0x00);     // End of block
+    }
+}
+}
+
+JpegEncoder::JpegEncoder(int quality)
+    : m_quality(0)
+{
+    setQuality(quality);
+}
+
+void JpegEncoder::setQuality(int quality)
+{
+    m_quality = std::clamp(quality, 1, 100);
+    scaleQuantTable(kLumaQuant, m_quality, m_lumaQuant, m_lumaScales);
+    scaleQuantTable(kChromaQuant, m_quality, m_chromaQuant, m_chromaScales);
+}
+
+bool JpegEncoder::encode(const ImageView& image, std::string& out) const
+{
+    out.clear();
+    if (!image.pixels || image.width <= 0 || image.height <= 0 || image.width > 65535 || image.height > 65535) {
+        return false;
+    }
+
+    putWord(out, 0xFFD8);   // Start of image
+    putWord(out, 0xFFE0);   // JFIF header, no thumbnail
+    putWord(out, 16);
+    out.append("JFIF\0", 5);
+    putWord(out, 0x0101);
+    putByte(out, 0);
+    putWord(out, 1);
+    putWord(out, 1);
+    putWord(out, 0);
+
+    putWord(out, 0xFFDB);   // Quantisation tables, zigzag order
+    putWord(out, 2 + 2 * 65);
+    putByte(out, 0);
+    for (int i = 0; i < 64; ++i) putByte(out, m_lumaQuant[kZigzag[i]]);
+    putByte(out, 1);
+    for (int i = 0; i < 64; ++i) putByte(out, m_chromaQuant[kZigzag[i]]);
+
+    putWord(out, 0xFFC0);   // Baseline frame: Y at 2x2, Cb and Cr at 1x1
+    putWord(out, 17);
+    putByte(out, 8);
+    putWord(out, image.height);
+    putWord(out, image.width);
+    putByte(out, 3);
+    const int components[3][3] = {{1, 0x22, 0}, {2, 0x11, 1}, {3, 0x11, 1}};
+    for (const auto& component : components) {
+        putByte(out, component[0]);
+        putByte(out, component[1]);
+        putByte(out, component[2]);
+    }
+
+    putWord(out, 0xFFC4);   // Huffman tables
+    putWord(out, 2 + 4 * 17 + 12 + 12 + 162 + 162);
+    putHuffmanTable(out, 0x00, kLumaDcCounts, kLumaDcSymbols);
+    putHuffmanTable(out, 0x10, kLumaAcCounts, kLumaAcSymbols);
+    putHuffmanTable(out, 0x01, kChromaDcCounts, kChromaDcSymbols);
+    putHuffmanTable(out, 0x11, kChromaAcCounts, kChromaAcSymbols);
+
+    putWord(out, 0xFFDA);   // Start of scan
+    putWord(out, 12);
+    putByte(out, 3);
+    putWord(out, 0x0100);
+    putWord(out, 0x0211);
+    putWord(out, 0x0311);
+    putByte(out, 0);
+    putByte(out, 63);
+    putByte(out, 0);
+
+    const HuffmanTables& tables = huffmanTables();
+    BitWriter writer(out);
+    int previousY = 0;
+    int previousCb = 0;
+    int previousCr = 0;
+    float y[256];
+    float cb[256];
+    float cr[256];
+    float block[64];
+
+    // 16x16 macroblocks; edges repeat the last row and column
+    for (int top = 0; top < image.height; top += 16) {
+        for (int left = 0; left < image.width; left += 16) {
+            for (int row = 0; row < 16; ++row) {
+                int sourceY = std::min(top + row, image.height - 1);
+                const uint8_t* line = image.pixels + static_cast<size_t>(sourceY) * image.stride;
+                for (int col = 0; col < 16; ++col) {
+                    const uint8_t* pixel = line + std::min(left + col, image.width - 1) * 4;
+                    float b = pixel[0];
+                    float g = pixel[1];
+                    float r = pixel[2];
+                    int i = row * 16 + col;
+                    y[i] = 0.299f * r + 0.587f * g + 0.114f * b - 128.0f;
+                    cb[i] = -0.168736f * r - 0.331264f * g + 0.5f * b;
+                    cr[i] = 0.5f * r - 0.418688f * g - 0.081312f * b;
+                }
+            }
+
+            for (int quadrant = 0; quadrant < 4; ++quadrant) {
+                int offset = (quadrant >> 1) * 8 * 16 + (quadrant & 1) * 8;
+                for (int row = 0; row < 8; ++row) {
+                    std::copy(y + offset + row * 16, y + offset + row * 16 + 8, block + row * 8);
+                }
+                encodeBlock(block, m_lumaScales, previousY, tables.lumaDc, tables.lumaAc, writer);
+            }
+
+            for (float* plane : {cb, cr}) {
+                for (int row = 0; row < 8; ++row) {
+                    for (int col = 0; col < 8; ++col) {
+                        const float* source = plane + row * 2 * 16 + col * 2;
+                        block[row * 8 + col] = 0.25f * (source[0] + source[1] + source[16] + source[17]);
+                    }
+                }
+                int& previous = plane == cb ? previousCb : previousCr;
+                encodeBlock(block, m_chromaScales, previous, tables.chromaDc, tables.chromaAc, writer);
+            }
+        }
+    }
+    writer.flush();
+    putWord(out, 0xFFD9);   // End of image
+    return true;
+}
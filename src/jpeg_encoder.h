@@ -0,0 +1,30 @@
+#ifndef JPEG_ENCODER_H
+#define JPEG_ENCODER_H
+
+#include <string>
+#include <cstdint>
+#include "image_scaler.h"
+
+// Baseline JPEG (JFIF, 4:2:0 chroma, standard Huffman tables) from BGRA
+// pixels, for the preview stream. Tables are built once per quality, and
+// the output string keeps its capacity when reused.
+class JpegEncoder {
+public:
+    explicit JpegEncoder(int quality = 75);
+
+    // 1 (smallest) to 100 (best)
+    void setQuality(int quality);
+    int getQuality() const { return m_quality; }
+
+    // Replaces out with the encoded image; false for an empty image
+    bool encode(const ImageView& image, std::string& out) const;
+
+private:
+    int m_quality;
+    uint8_t m_lumaQuant[64];        // Natural order
+    uint8_t m_chromaQuant[64];
+    float m_lumaScales[64];         // Quantisation folded into the DCT's output scaling
+    float m_chromaScales[64];
+};
+
+#endif // JPEG_ENCODER_H
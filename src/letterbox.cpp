@@ -0,0 +1,45 @@
+#include "letterbox.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+int toSourcePixel(double inputCoord, double pad, double scale, int limit)
+{
+    double source = (inputCoord - pad) / scale;
+    return std::clamp(static_cast<int>(std::lround(source)), 0, limit);
+}
+}
+
+BoundingBox mapToSource(const LetterboxTransform& transform, double x, double y, double width, double height)
+{
+    if (!transform.isValid()) {
+        return {static_cast<int>(std::lround(x)) + transform.offsetX, static_cast<int>(std::lround(y)) + transform.offsetY,
+                static_cast<int>(std::lround(width)), static_cast<int>(std::lround(height))};
+    }
+
+    // Map both corners, not origin plus size, so rounding never drifts the far edge
+    int x1 = toSourcePixel(x, transform.padX, transform.scaleX, transform.sourceWidth);
+    int y1 = toSourcePixel(y, transform.padY, transform.scaleY, transform.sourceHeight);
+    int x2 = toSourcePixel(x + width, transform.padX, transform.scaleX, transform.sourceWidth);
+    int y2 = toSourcePixel(y + height, transform.padY, transform.scaleY, transform.sourceHeight);
+    return {x1 + transform.offsetX, y1 + transform.offsetY, x2 - x1, y2 - y1};
+}
+
+double intersectionOverUnion(const BoundingBox& a, const BoundingBox& b)
+{
+    int x1 = std::max(a.x, b.x);
+    int y1 = std::max(a.y, b.y);
+    int x2 = std::min(a.x + a.width, b.x + b.width);
+    int y2 = std::min(a.y + a.height, b.y + b.height);
+    if (x2 <= x1 || y2 <= y1) {
+        return 0.0;
+    }
+    double intersection = static_cast<double>(x2 - x1) * (y2 - y1);
+    double unionArea = static_cast<double>(a.width) * a.height + static_cast<double>(b.width) * b.height - intersection;
+    return unionArea > 0.0 ? intersection / unionArea : 0.0;
+}
+
+std::string inferenceSizeLabel(int inferenceSize)
+{
+    return inferenceSize == kInferenceSizeAuto ? "auto" : std::to_string(inferenceSize);
+}
@@ -0,0 +1,44 @@
+#ifndef LETTERBOX_H
+#define LETTERBOX_H
+
+#include <string>
+
+// Model input sizes; the worker letterboxes each image to the requested one
+const int kInferenceSizeAuto = 0;        // Smallest standard size covering the source
+const int kDefaultInferenceSize = 640;
+const int kInferenceSizes[] = {320, 416, 512, 640, 1280};
+
+struct BoundingBox {
+    int x, y, width, height;
+};
+
+// How the worker fitted a source image into the model input: scaled with the
+// aspect ratio kept, then padded on each side to a multiple of the model
+// stride. Scale is per axis because the scaled size is rounded to pixels.
+// When only a region of the image was inferred, the source is that region
+// and offset is its top-left corner in the full image.
+struct LetterboxTransform {
+    int sourceWidth = 0;
+    int sourceHeight = 0;
+    int offsetX = 0;
+    int offsetY = 0;
+    int inputWidth = 0;
+    int inputHeight = 0;
+    double scaleX = 1.0;
+    double scaleY = 1.0;
+    double padX = 0.0;
+    double padY = 0.0;
+
+    bool isValid() const { return sourceWidth > 0 && sourceHeight > 0 && scaleX > 0.0 && scaleY > 0.0; }
+};
+
+// Maps a box in model input pixels back to full image pixels, clipped to the source
+BoundingBox mapToSource(const LetterboxTransform& transform, double x, double y, double width, double height);
+
+// Intersection over union of two boxes; 0 when they do not overlap
+double intersectionOverUnion(const BoundingBox& a, const BoundingBox& b);
+
+// Shortest label for a requested size: "auto" or the number
+std::string inferenceSizeLabel(int inferenceSize);
+
+#endif // LETTERBOX_H
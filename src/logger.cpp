@@ -0,0 +1,339 @@
+#include "logger.h"
+#include "worker_protocol.h"
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+namespace {
+const int64_t kRateWindowUs = 1000000;
+// The writer wakes on its own this often; errors and a half-full queue wake it at once
+const auto kWriterInterval = std::chrono::milliseconds(50);
+const size_t kBatchBytes = 64 * 1024;
+
+std::atomic<uint32_t> g_nextThread(1);
+
+uint32_t currentThread()
+{
+    thread_local uint32_t id = g_nextThread.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+int64_t nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string lowercase(const char* text)
+{
+    std::string result = text ? text : "";
+    std::transform(result.begin(), result.end(), result.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return result;
+}
+
+const char* baseName(const char* path)
+{
+    const char* name = path;
+    for (const char* p = path; *p; ++p) {
+        if (*p == '/' || *p == '\\') {
+            name = p + 1;
+        }
+    }
+    return name;
+}
+
+// "2026-10-19 14:03:07.123", local time
+void appendTime(std::string& out, int64_t timeUs, char separator)
+{
+    std::time_t seconds = static_cast<std::time_t>(timeUs / 1000000);
+    std::tm local = {};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    char text[80];
+    std::snprintf(text, sizeof(text), "%04d-%02d-%02d%c%02d:%02d:%02d.%03d", local.tm_year + 1900,
+                  local.tm_mon + 1, local.tm_mday, separator, local.tm_hour, local.tm_min, local.tm_sec,
+                  static_cast<int>(timeUs / 1000 % 1000));
+    out += text;
+}
+}
+
+LogConfig LogConfig::fromEnvironment()
+{
+    LogConfig config;
+    if (const char* level = std::getenv("YOLO_LOG_LEVEL")) {
+        Logger::parseLevel(level, config.minLevel);
+    }
+    if (const char* path = std::getenv("YOLO_LOG_FILE")) {
+        config.path = path;
+    }
+    if (const char* format = std::getenv("YOLO_LOG_FORMAT")) {
+        config.format = lowercase(format) == "json" ? LogFormat::Json : LogFormat::Text;
+    }
+    if (const char* rate = std::getenv("YOLO_LOG_RATE")) {
+        config.perSitePerSecond = static_cast<uint32_t>(std::max(0, std::atoi(rate)));
+    }
+    return config;
+}
+
+Logger::Logger(const LogConfig& config)
+    : m_enqueue(0)
+    , m_dequeue(0)
+    , m_minLevel(config.minLevel)
+    , m_format(config.format)
+    , m_perSitePerSecond(config.perSitePerSecond)
+    , m_output(stderr)
+    , m_ownsOutput(false)
+    , m_written(0)
+    , m_rateLimited(0)
+    , m_dropped(0)
+    , m_stopping(false)
+{
+    size_t capacity = 2;
+    while (capacity < config.capacity) {
+        capacity *= 2;
+    }
+    m_slots.reset(new Slot[capacity]);
+    for (size_t i = 0; i < capacity; ++i) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    m_mask = capacity - 1;
+
+    if (!config.path.empty()) {
+        if (std::FILE* file = std::fopen(config.path.c_str(), "a")) {
+            m_output = file;
+            m_ownsOutput = true;
+        }
+    }
+    m_writer = std::thread(&Logger::writerLoop, this);
+}
+
+Logger::~Logger()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_writer.join();
+    if (m_ownsOutput) {
+        std::fclose(m_output);
+    }
+}
+
+Logger& Logger::global()
+{
+    static Logger logger(LogConfig::fromEnvironment());
+    return logger;
+}
+
+const char* Logger::levelName(LogLevel level)
+{
+    switch (level) {
+    case LogLevel::Debug: return "debug";
+    case LogLevel::Info: return "info";
+    case LogLevel::Warning: return "warning";
+    case LogLevel::Error: return "error";
+    case LogLevel::Off: return "off";
+    }
+    return "unknown";
+}
+
+bool Logger::parseLevel(const std::string& text, LogLevel& level)
+{
+    std::string name = lowercase(text.c_str());
+    for (LogLevel candidate : {LogLevel::Debug, LogLevel::Info, LogLevel::Warning, LogLevel::Error, LogLevel::Off}) {
+        if (name == levelName(candidate)) {
+            level = candidate;
+            return true;
+        }
+    }
+    if (name == "warn") {
+        level = LogLevel::Warning;
+        return true;
+    }
+    return false;
+}
+
+// Fixed one-second windows per site; a race at a window boundary can let a
+// record or two more through, which is fine for a log
+bool Logger::allow(LogSite& site, int64_t now)
+{
+    int64_t start = site.windowStart.load(std::memory_order_relaxed);
+    if (now - start >= kRateWindowUs || now < start) {
+        if (site.windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+            site.windowCount.store(0, std::memory_order_relaxed);
+        }
+    }
+    if (site.windowCount.fetch_add(1, std::memory_order_relaxed) < m_perSitePerSecond) {
+        return true;
+    }
+    site.suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void Logger::write(LogSite& site, LogLevel level, int streamId, uint64_t frame, const char* format, ...)
+{
+    int64_t now = nowUs();
+    if (m_perSitePerSecond > 0 && !allow(site, now)) {
+        m_rateLimited.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Claim a slot (bounded MPMC queue after Vyukov; a slot's sequence says
+    // whether it is free for this lap or still holds the previous one)
+    size_t position = m_enqueue.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &m_slots[position & m_mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t lag = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (lag == 0) {
+            if (m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (lag < 0) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            position = m_enqueue.load(std::memory_order_relaxed);
+        }
+    }
+
+    Record& record = slot->record;
+    record.time = now;
+    record.site = &site;
+    record.streamId = streamId;
+    record.frame = frame;
+    record.thread = currentThread();
+    record.suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+    record.level = level;
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(record.message, kMessageBytes, format, args);
+    va_end(args);
+    slot->sequence.store(position + 1, std::memory_order_release);
+
+    if (level >= LogLevel::Error || position - m_dequeue.load(std::memory_order_relaxed) >= (m_mask + 1) / 2) {
+        m_wake.notify_one();
+    }
+}
+
+void Logger::flush()
+{
+    size_t target = m_enqueue.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_wake.notify_one();
+    m_drained.wait(lock, [this, target]() {
+        return m_stopping || m_dequeue.load(std::memory_order_acquire) >= target;
+    });
+}
+
+LoggerStats Logger::getStats() const
+{
+    LoggerStats stats;
+    stats.written = m_written.load(std::memory_order_relaxed);
+    stats.rateLimited = m_rateLimited.load(std::memory_order_relaxed);
+    stats.dropped = m_dropped.load(std::memory_order_relaxed);
+    size_t enqueued = m_enqueue.load(std::memory_order_relaxed);
+    size_t dequeued = m_dequeue.load(std::memory_order_relaxed);
+    stats.queued = enqueued > dequeued ? enqueued - dequeued : 0;
+    return stats;
+}
+
+void Logger::writerLoop()
+{
+    std::string batch;
+    batch.reserve(kBatchBytes + 1024);
+    size_t position = m_dequeue.load(std::memory_order_relaxed);
+    for (;;) {
+        // Take every published record, in order; one still being filled in
+        // stops the batch until its producer finishes
+        size_t count = 0;
+        batch.clear();
+        while (batch.size() < kBatchBytes) {
+            Slot& slot = m_slots[position & m_mask];
+            if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+                break;
+            }
+            if (m_format == LogFormat::Json) {
+                appendJson(batch, slot.record);
+            } else {
+                appendText(batch, slot.record);
+            }
+            slot.sequence.store(position + m_mask + 1, std::memory_order_release);
+            position++;
+            count++;
+        }
+
+        if (count > 0) {
+            std::fwrite(batch.data(), 1, batch.size(), m_output);
+            std::fflush(m_output);
+            m_written.fetch_add(count, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_dequeue.store(position, std::memory_order_release);
+            }
+            m_drained.notify_all();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_stopping && m_enqueue.load(std::memory_order_acquire) == position) {
+            break;
+        }
+        m_wake.wait_for(lock, kWriterInterval);
+    }
+    m_drained.notify_all();
+}
+
+void Logger::appendText(std::string& out, const Record& record) const
+{
+    static const char* const kTags[] = {"DEBUG", "INFO ", "WARN ", "ERROR", "OFF  "};
+    appendTime(out, record.time, ' ');
+    out += ' ';
+    out += kTags[static_cast<int>(record.level)];
+    out += " [t" + std::to_string(record.thread);
+    if (record.streamId >= 0) {
+        out += " stream " + std::to_string(record.streamId);
+    }
+    if (record.frame > 0) {
+        out += " frame " + std::to_string(record.frame);
+    }
+    out += "] ";
+    out += baseName(record.site->file);
+    out += ':' + std::to_string(record.site->line) + ": ";
+    out += record.message;
+    if (record.suppressed > 0) {
+        out += " (" + std::to_string(record.suppressed) + " more from here suppressed)";
+    }
+    out += '\n';
+}
+
+void Logger::appendJson(std::string& out, const Record& record) const
+{
+    out += "{\"time\":\"";
+    appendTime(out, record.time, 'T');
+    out += "\",\"level\":\"";
+    out += levelName(record.level);
+    out += "\",\"thread\":" + std::to_string(record.thread);
+    if (record.streamId >= 0) {
+        out += ",\"stream\":" + std::to_string(record.streamId);
+    }
+    if (record.frame > 0) {
+        out += ",\"frame\":" + std::to_string(record.frame);
+    }
+    out += ",\"site\":\"" + escapeJson(baseName(record.site->file)) + ':' + std::to_string(record.site->line);
+    out += "\",\"message\":\"" + escapeJson(record.message) + '"';
+    if (record.suppressed > 0) {
+        out += ",\"suppressed\":" + std::to_string(record.suppressed);
+    }
+    out += "}\n";
+}
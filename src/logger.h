@@ -0,0 +1,146 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+
+enum class LogLevel : uint8_t {
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off
+};
+
+enum class LogFormat {
+    Text,
+    Json            // One object per line
+};
+
+struct LogConfig {
+    LogLevel minLevel = LogLevel::Info;
+    LogFormat format = LogFormat::Text;
+    std::string path;               // Appended to; empty = stderr
+    size_t capacity = 4096;         // Queued records, rounded up to a power of two
+    uint32_t perSitePerSecond = 20; // Records one call site may log each second; 0 = unlimited
+
+    // YOLO_LOG_LEVEL (debug, info, warning, error, off), YOLO_LOG_FILE,
+    // YOLO_LOG_FORMAT (text, json), YOLO_LOG_RATE over the defaults
+    static LogConfig fromEnvironment();
+};
+
+struct LoggerStats {
+    uint64_t written;
+    uint64_t rateLimited;   // Dropped by a call site's rate limit
+    uint64_t dropped;       // Queue full; the caller never waits for the writer
+    size_t queued;
+};
+
+// State of one logging call site; the YOLO_LOG macros keep one per site
+struct LogSite {
+    const char* file;
+    int line;
+    std::atomic<int64_t> windowStart{0};    // Microseconds
+    std::atomic<uint32_t> windowCount{0};
+    std::atomic<uint32_t> suppressed{0};    // Reported with the site's next record
+};
+
+// Logging that keeps I/O off the calling thread. A call checks the level,
+// applies its site's rate limit, formats into a slot of a lock-free
+// multi-producer ring and returns; a background thread writes the records
+// out in batches. When the ring is full the record is counted and dropped
+// rather than blocking a capture or worker thread. Records carry the
+// stream and frame sequence they concern.
+class Logger {
+public:
+    explicit Logger(const LogConfig& config = LogConfig());
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // Configured from the environment on first use
+    static Logger& global();
+
+    bool enabled(LogLevel level) const
+    {
+        return level >= m_minLevel.load(std::memory_order_relaxed);
+    }
+    void setLevel(LogLevel level) { m_minLevel.store(level, std::memory_order_relaxed); }
+
+    // streamId < 0 and frame 0 mean none
+    void write(LogSite& site, LogLevel level, int streamId, uint64_t frame, const char* format, ...)
+#if defined(__GNUC__)
+        __attribute__((format(printf, 6, 7)))
+#endif
+        ;
+
+    // Returns once everything logged before the call is written
+    void flush();
+
+    LoggerStats getStats() const;
+
+    static const char* levelName(LogLevel level);
+    static bool parseLevel(const std::string& text, LogLevel& level);
+
+private:
+    static const size_t kMessageBytes = 232;
+
+    struct Record {
+        int64_t time;           // Microseconds since the epoch
+        const LogSite* site;
+        int streamId;
+        uint64_t frame;
+        uint32_t thread;
+        uint32_t suppressed;
+        LogLevel level;
+        char message[kMessageBytes];
+    };
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Record record;
+    };
+
+    bool allow(LogSite& site, int64_t now);
+    void writerLoop();
+    void appendText(std::string& out, const Record& record) const;
+    void appendJson(std::string& out, const Record& record) const;
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_enqueue;
+    alignas(64) std::atomic<size_t> m_dequeue;
+    alignas(64) std::atomic<LogLevel> m_minLevel;
+    LogFormat m_format;
+    uint32_t m_perSitePerSecond;
+    std::FILE* m_output;
+    bool m_ownsOutput;
+
+    std::atomic<uint64_t> m_written;
+    std::atomic<uint64_t> m_rateLimited;
+    std::atomic<uint64_t> m_dropped;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;         // Writer: records waiting
+    std::condition_variable m_drained;      // flush(): records written
+    bool m_stopping;
+    std::thread m_writer;
+};
+
+#define YOLO_LOG_FRAME(level, streamId, frame, ...)                                  \
+    do {                                                                             \
+        if (Logger::global().enabled(level)) {                                       \
+            static LogSite yoloLogSite{__FILE__, __LINE__};                          \
+            Logger::global().write(yoloLogSite, level, streamId, frame, __VA_ARGS__); \
+        }                                                                            \
+    } while (0)
+
+#define YOLO_LOG(level, ...) YOLO_LOG_FRAME(level, -1, 0, __VA_ARGS__)
+
+#endif // LOGGER_H
@@ -3,6 +3,8 @@
 #include <commctrl.h>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <ctime>
 #include "resource.h"
 
 #define ID_OPEN_BUTTON 1001
@@ -15,6 +17,111 @@
 #define ID_PROGRESS_BAR 1008
 #define ID_IMAGE_STATIC 1009
 #define ID_FPS_EDIT 1010
+#define ID_ADAPTIVE_CHECK 1011
+#define ID_AUTO_MODEL_CHECK 1012
+#define ID_SLO_EDIT 1013
+#define ID_CAMERAS_EDIT 1014
+#define ID_INPUT_SIZE_COMBO 1015
+#define ID_RECORD_CHECK 1016
+#define ID_CASCADE_CHECK 1017
+#define ID_ROI_EDIT 1018
+
+#define ID_RESULTS_TIMER 1
+
+namespace {
+// Worker processes shared by all cameras; each holds one copy of the model
+const int kDetectionWorkers = 1;
+const size_t kMaxBatchSize = 8;
+const double kModelBudgetMb = 1024;
+// With remote workers: scheduler threads per endpoint, so one batch uploads while another runs
+const int kBatchesPerRemoteWorker = 2;
+
+// Detections are kept in a columnar log; small segments keep the files modest
+const uint32_t kDetectionLogSegmentRows = 1u << 16;
+
+// Still images opened by the operator go through their own interactive stream
+const int kStillImageStream = -1;
+// Camera batches while stills may arrive: an opened still waits for at most
+// this many frames' inference, not a full batch
+const size_t kMaxBatchWithStills = 1;
+// Live results do not overwrite a still image's results for this long
+const auto kStillResultHold = std::chrono::seconds(5);
+// A live frame not yet inferred after this long is dropped; with adaptive
+// rate control the limit is twice the latency SLO
+const auto kLiveFrameMaxAge = std::chrono::milliseconds(2000);
+
+// The image area shows the first camera's frames
+const int kDisplayedStream = 0;
+
+// Every camera can be watched in a browser at http://127.0.0.1:8090/;
+// YOLO_PREVIEW_PORT picks another port, 0 turns the preview off
+const int kPreviewPort = 8090;
+const int kPreviewMaxWidth = 960;
+const int kPreviewQuality = 70;
+
+DetectionResult MakeFailedResult(int streamId, const std::string& error)
+{
+    DetectionResult result;
+    result.success = false;
+    result.processingTime = 0;
+    result.errorMessage = error;
+    result.streamId = streamId;
+    return result;
+}
+
+// One timer tick per display refresh; VREFRESH reports 0 or 1 when unknown
+UINT GetRefreshIntervalMs(HWND hwnd)
+{
+    HDC hdc = GetDC(hwnd);
+    int refreshHz = hdc ? GetDeviceCaps(hdc, VREFRESH) : 0;
+    if (hdc) {
+        ReleaseDC(hwnd, hdc);
+    }
+    if (refreshHz <= 1) {
+        refreshHz = 60;
+    }
+    int intervalMs = 1000 / refreshHz;
+    return static_cast<UINT>(intervalMs > 0 ? intervalMs : 1);
+}
+
+struct CameraSpec {
+    int device;
+    double weight;
+    int inferenceSize;
+};
+
+// Parses "0,1:2,2:1:320" into device[:weight[:input size]] entries; weight
+// defaults to 1 and the input size to the one selected in the UI
+std::vector<CameraSpec> ParseCameraList(const std::wstring& text, int defaultInferenceSize)
+{
+    std::vector<CameraSpec> cameras;
+    std::wstringstream stream(text);
+    std::wstring item;
+    while (std::getline(stream, item, L',')) {
+        if (item.find_first_of(L"0123456789") == std::wstring::npos) {
+            continue;
+        }
+        std::wstringstream fields(item);
+        std::wstring device, weight, size;
+        std::getline(fields, device, L':');
+        std::getline(fields, weight, L':');
+        std::getline(fields, size, L':');
+
+        CameraSpec camera;
+        camera.device = _wtoi(device.c_str());
+        camera.weight = weight.empty() ? 1.0 : _wtof(weight.c_str());
+        if (camera.weight <= 0.0) camera.weight = 1.0;
+        camera.inferenceSize = defaultInferenceSize;
+        if (size == L"auto") {
+            camera.inferenceSize = kInferenceSizeAuto;
+        } else if (_wtoi(size.c_str()) > 0) {
+            camera.inferenceSize = _wtoi(size.c_str());
+        }
+        cameras.push_back(camera);
+    }
+    return cameras;
+}
+}
 
 MainWindow::MainWindow(HINSTANCE hInstance)
     : m_hInstance(hInstance)
@@ -29,20 +136,108 @@ MainWindow::MainWindow(HINSTANCE hInstance)
     , m_hStatusStatic(NULL)
     , m_hProgressBar(NULL)
     , m_hFpsEdit(NULL)
+    , m_hAdaptiveCheck(NULL)
+    , m_hAutoModelCheck(NULL)
+    , m_hSloEdit(NULL)
+    , m_hCamerasEdit(NULL)
+    , m_hInputSizeCombo(NULL)
+    , m_hRecordCheck(NULL)
+    , m_hCascadeCheck(NULL)
+    , m_hRoiEdit(NULL)
     , m_detectionClient(nullptr)
     , m_imageProcessor(nullptr)
-    , m_webcamCapture(nullptr)
+    , m_scheduler(nullptr)
     , m_hCurrentBitmap(NULL)
     , m_isProcessing(false)
     , m_isWebcamActive(false)
+    , m_isAdaptive(false)
+    , m_stillWidth(0)
+    , m_stillHeight(0)
+    , m_shownSequence(0)
     , m_confidenceThreshold(0.5)
     , m_iouThreshold(0.45)
     , m_selectedModel("yolov5s")
-    , m_webcamFps(5)
+    , m_inferenceSize(kDefaultInferenceSize)
+    , m_webcamFps(5.0)
 {
     m_detectionClient = new DetectionClient();
     m_imageProcessor = new ImageProcessor();
-    m_webcamCapture = new WebcamCapture();
+    m_compositor = std::make_unique<FrameCompositor>();
+
+    // Every result is appended to the detection log for later time/class queries
+    char tempPath[MAX_PATH];
+    GetTempPathA(MAX_PATH, tempPath);
+    m_detectionLog = std::make_unique<DetectionLog>(std::string(tempPath) + "yolo_detection_log\\",
+                                                    kDetectionLogSegmentRows);
+    if (!m_detectionLog->open()) {
+        m_detectionLog.reset();
+    }
+
+    // Workers keep recently used models resident within the budget, so
+    // switching models in the combo box is served from memory when possible
+    WorkerConfig workerConfig;
+    workerConfig.modelBudgetMb = kModelBudgetMb;
+    workerConfig.preloadModels.push_back(m_selectedModel);
+
+    // YOLO_WARM_STANDBY=1 keeps a spare worker with the model loaded, so a
+    // worker that crashes or hangs is replaced without a cold start
+    char warmStandby[8];
+    DWORD standbyLength = GetEnvironmentVariableA("YOLO_WARM_STANDBY", warmStandby, sizeof(warmStandby));
+    workerConfig.warmStandby = standbyLength > 0 && standbyLength < sizeof(warmStandby) && atoi(warmStandby) > 0;
+
+    // YOLO_REMOTE_WORKERS=host:port,host:port sends detection to TCP workers
+    // (detection_server.py --serve --listen) instead of a local process
+    char remoteWorkers[1024];
+    DWORD remoteLength = GetEnvironmentVariableA("YOLO_REMOTE_WORKERS", remoteWorkers, sizeof(remoteWorkers));
+    std::vector<WorkerEndpoint> endpoints;
+    if (remoteLength > 0 && remoteLength < sizeof(remoteWorkers)) {
+        endpoints = WorkerBalancer::parseEndpoints(remoteWorkers);
+    }
+
+    DetectionScheduler::BatchExecutor executor;
+    int schedulerWorkers = kDetectionWorkers;
+    if (!endpoints.empty()) {
+        m_balancer = std::make_unique<WorkerBalancer>(endpoints);
+        executor = [this](int workerIndex, const std::vector<DetectionRequest>& batch) {
+            return m_balancer->runBatch(workerIndex, batch);
+        };
+        schedulerWorkers = kBatchesPerRemoteWorker * static_cast<int>(endpoints.size());
+    } else {
+        // Local workers get cores of their own and one torch thread per
+        // core, so they do not oversubscribe the machine or each other;
+        // capture threads go to the cores left over
+        m_threadPlan = planThreadBudget(CpuTopology::detect(), kDetectionWorkers);
+        workerConfig.threadBudgets = m_threadPlan.workers;
+        m_detectionClient->setWorkerCount(kDetectionWorkers);
+        executor = [this](int workerIndex, const std::vector<DetectionRequest>& batch) {
+            return m_detectionClient->runBatch(workerIndex, batch);
+        };
+    }
+    m_detectionClient->setWorkerConfig(workerConfig);
+
+    // Frames of cameras with regions of interest are cropped to them before
+    // they reach the workers. In cascade mode frames try the small model
+    // first and only uncertain ones reach the large model; disabled it
+    // passes batches straight through.
+    m_roi = std::make_unique<RoiExecutor>(executor);
+    m_cascade = std::make_unique<CascadeExecutor>(
+        [this](int workerIndex, const std::vector<DetectionRequest>& batch) {
+            return m_roi->runBatch(workerIndex, batch);
+        });
+    m_scheduler = new DetectionScheduler(
+        [this](int workerIndex, const std::vector<DetectionRequest>& batch) {
+            return m_cascade->runBatch(workerIndex, batch);
+        },
+        schedulerWorkers, kMaxBatchSize);
+    m_scheduler->addStream(kStillImageStream, 1.0, 4, DetectionPriority::Interactive);
+    m_scheduler->setInteractiveBatchLimit(kMaxBatchWithStills);
+
+    char previewPort[16];
+    DWORD previewLength = GetEnvironmentVariableA("YOLO_PREVIEW_PORT", previewPort, sizeof(previewPort));
+    int port = previewLength > 0 && previewLength < sizeof(previewPort) ? atoi(previewPort) : kPreviewPort;
+    if (port > 0) {
+        m_preview.start(port);
+    }
 }
 
 MainWindow::~MainWindow()
@@ -50,9 +245,14 @@ MainWindow::~MainWindow()
     if (m_hCurrentBitmap) {
         DeleteObject(m_hCurrentBitmap);
     }
+    // Stop captures, then let the scheduler finish in-flight batches before the client goes away
+    for (const auto& camera : m_cameras) {
+        camera->capture->stopCapture();
+    }
+    delete m_scheduler;
+    m_cameras.clear();
     delete m_detectionClient;
     delete m_imageProcessor;
-    delete m_webcamCapture;
 }
 
 bool MainWindow::Create()
@@ -112,6 +312,13 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
     switch (uMsg) {
     case WM_CREATE:
         CreateControls();
+        SetTimer(m_hwnd, ID_RESULTS_TIMER, GetRefreshIntervalMs(m_hwnd), NULL);
+        return 0;
+
+    case WM_TIMER:
+        if (wParam == ID_RESULTS_TIMER) {
+            DrainMailboxes();
+        }
         return 0;
 
     case WM_COMMAND:
@@ -126,6 +333,21 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
                 OnStartWebcam();
             }
             break;
+        case ID_MODEL_COMBO:
+            if (HIWORD(wParam) == CBN_SELCHANGE) {
+                OnModelChanged();
+            }
+            break;
+        case ID_INPUT_SIZE_COMBO:
+            if (HIWORD(wParam) == CBN_SELCHANGE) {
+                OnInputSizeChanged();
+            }
+            break;
+        case ID_CASCADE_CHECK:
+            if (HIWORD(wParam) == BN_CLICKED) {
+                OnCascadeToggled();
+            }
+            break;
         }
         return 0;
 
@@ -133,7 +355,15 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
         ResizeControls();
         return 0;
 
+    case WM_DRAWITEM:
+        if (wParam == ID_IMAGE_STATIC) {
+            PaintImageDisplay(*reinterpret_cast<const DRAWITEMSTRUCT*>(lParam));
+            return TRUE;
+        }
+        break;
+
     case WM_DESTROY:
+        KillTimer(m_hwnd, ID_RESULTS_TIMER);
         if (m_isWebcamActive) {
             OnStopWebcam();
         }
@@ -228,15 +458,111 @@ void MainWindow::CreateControls()
 
     m_hFpsEdit = CreateWindow(
         L"EDIT", L"5",
-        WS_CHILD | WS_VISIBLE | WS_BORDER | ES_NUMBER,
+        WS_CHILD | WS_VISIBLE | WS_BORDER,
         60, 140, 60, 20,
         m_hwnd, (HMENU)ID_FPS_EDIT, m_hInstance, NULL
     );
 
-    // Image Display Area
+    // Adaptive rate control
+    m_hAdaptiveCheck = CreateWindow(
+        L"BUTTON", L"Adaptive FPS",
+        WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX,
+        10, 170, 120, 20,
+        m_hwnd, (HMENU)ID_ADAPTIVE_CHECK, m_hInstance, NULL
+    );
+
+    m_hAutoModelCheck = CreateWindow(
+        L"BUTTON", L"Auto model",
+        WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX,
+        140, 170, 120, 20,
+        m_hwnd, (HMENU)ID_AUTO_MODEL_CHECK, m_hInstance, NULL
+    );
+
+    CreateWindow(L"STATIC", L"SLO (ms):",
+        WS_VISIBLE | WS_CHILD,
+        10, 200, 70, 20,
+        m_hwnd, NULL, m_hInstance, NULL
+    );
+
+    m_hSloEdit = CreateWindow(
+        L"EDIT", L"1000",
+        WS_CHILD | WS_VISIBLE | WS_BORDER | ES_NUMBER,
+        90, 200, 60, 20,
+        m_hwnd, (HMENU)ID_SLO_EDIT, m_hInstance, NULL
+    );
+
+    // Camera list: device ids with optional scheduling weights
+    CreateWindow(L"STATIC", L"Cameras:",
+        WS_VISIBLE | WS_CHILD,
+        10, 230, 70, 20,
+        m_hwnd, NULL, m_hInstance, NULL
+    );
+
+    m_hCamerasEdit = CreateWindow(
+        L"EDIT", L"0",
+        WS_CHILD | WS_VISIBLE | WS_BORDER,
+        90, 230, 120, 20,
+        m_hwnd, (HMENU)ID_CAMERAS_EDIT, m_hInstance, NULL
+    );
+
+    // Model input size; smaller inputs cost a fraction of the compute
+    CreateWindow(L"STATIC", L"Input size:",
+        WS_VISIBLE | WS_CHILD,
+        10, 260, 75, 20,
+        m_hwnd, NULL, m_hInstance, NULL
+    );
+
+    m_hInputSizeCombo = CreateWindow(
+        WC_COMBOBOX, L"",
+        CBS_DROPDOWNLIST | CBS_HASSTRINGS | WS_CHILD | WS_VISIBLE,
+        90, 260, 100, 200,
+        m_hwnd, (HMENU)ID_INPUT_SIZE_COMBO, m_hInstance, NULL
+    );
+
+    SendMessage(m_hInputSizeCombo, CB_ADDSTRING, 0, (LPARAM)L"auto");
+    for (int size : kInferenceSizes) {
+        SendMessage(m_hInputSizeCombo, CB_ADDSTRING, 0, (LPARAM)std::to_wstring(size).c_str());
+        if (size == kDefaultInferenceSize) {
+            SendMessage(m_hInputSizeCombo, CB_SETCURSEL, SendMessage(m_hInputSizeCombo, CB_GETCOUNT, 0, 0) - 1, 0);
+        }
+    }
+
+    // Records frames and results of the next webcam session for replay
+    m_hRecordCheck = CreateWindow(
+        L"BUTTON", L"Record session",
+        WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX,
+        10, 290, 140, 20,
+        m_hwnd, (HMENU)ID_RECORD_CHECK, m_hInstance, NULL
+    );
+
+    // Regions of interest per camera device, in fractions of the frame:
+    // "0: x y w h" for a rectangle, "0: x1 y1 x2 y2 x3 y3 ..." for a polygon,
+    // entries separated by ';'
+    CreateWindow(L"STATIC", L"ROI:",
+        WS_VISIBLE | WS_CHILD,
+        10, 320, 70, 20,
+        m_hwnd, NULL, m_hInstance, NULL
+    );
+
+    m_hRoiEdit = CreateWindow(
+        L"EDIT", L"",
+        WS_CHILD | WS_VISIBLE | WS_BORDER | ES_AUTOHSCROLL,
+        90, 320, 180, 20,
+        m_hwnd, (HMENU)ID_ROI_EDIT, m_hInstance, NULL
+    );
+
+    // Small model first, large model only for uncertain frames
+    m_hCascadeCheck = CreateWindow(
+        L"BUTTON", L"Cascade",
+        WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX,
+        160, 290, 110, 20,
+        m_hwnd, (HMENU)ID_CASCADE_CHECK, m_hInstance, NULL
+    );
+
+    // Image Display Area; painted from the compositor, its text shows while there is no frame
     m_hImageStatic = CreateWindow(
         L"STATIC", L"No image loaded\nClick 'Open Image' for static detection\nor 'Start Webcam' for real-time detection",
-        WS_CHILD | WS_VISIBLE | SS_CENTER | SS_SUNKEN,
+        WS_CHILD | WS_VISIBLE | SS_OWNERDRAW | SS_SUNKEN,
         280, 10, 600, 400,
         m_hwnd, (HMENU)ID_IMAGE_STATIC, m_hInstance, NULL
     );
@@ -279,10 +605,6 @@ void MainWindow::OnOpenImage()
         return;
     }
 
-    if (m_isWebcamActive) {
-        OnStopWebcam();
-    }
-
     OPENFILENAME ofn;
     wchar_t szFile[260] = { 0 };
 
@@ -324,18 +646,62 @@ void MainWindow::OnOpenImage()
         request.iouThreshold = m_iouThreshold;
         request.modelName = m_selectedModel;
         request.saveAnnotated = false;
-
-        // Start detection
-        m_detectionClient->detectObjects(request, 
-            [this](const DetectionResult& result) { OnDetectionComplete(result); },
-            [this](const std::string& error) { 
-                std::wstring werror(error.begin(), error.end());
-                OnDetectionError(werror); 
+        request.streamId = kStillImageStream;
+        request.inferenceSize = m_inferenceSize;
+
+        // Interactive priority: served ahead of live frames, no need to stop the webcam
+        m_scheduler->submit(kStillImageStream, request,
+            [this](const DetectionResult& result) {
+                if (m_detectionLog) m_detectionLog->appendResult(result, DetectionLog::nowUs());
+                m_stillResults.post(result);
+            },
+            [this](const std::string& error) {
+                m_stillResults.post(MakeFailedResult(kStillImageStream, error));
             }
         );
     }
 }
 
+void MainWindow::OnModelChanged()
+{
+    int index = (int)SendMessage(m_hModelCombo, CB_GETCURSEL, 0, 0);
+    wchar_t modelText[32] = { 0 };
+    if (index == CB_ERR || SendMessage(m_hModelCombo, CB_GETLBTEXTLEN, index, 0) >= 32) {
+        return;
+    }
+    SendMessage(m_hModelCombo, CB_GETLBTEXT, index, (LPARAM)modelText);
+
+    // Takes effect with the next request; the worker serves it from memory if resident
+    std::wstring model(modelText);
+    m_selectedModel = std::string(model.begin(), model.end());
+}
+
+void MainWindow::OnInputSizeChanged()
+{
+    int index = (int)SendMessage(m_hInputSizeCombo, CB_GETCURSEL, 0, 0);
+    wchar_t sizeText[16] = { 0 };
+    if (index == CB_ERR || SendMessage(m_hInputSizeCombo, CB_GETLBTEXTLEN, index, 0) >= 16) {
+        return;
+    }
+    SendMessage(m_hInputSizeCombo, CB_GETLBTEXT, index, (LPARAM)sizeText);
+
+    // Applies to still images and to cameras started afterwards without their own size
+    m_inferenceSize = wcscmp(sizeText, L"auto") == 0 ? kInferenceSizeAuto : _wtoi(sizeText);
+}
+
+void MainWindow::OnCascadeToggled()
+{
+    // Takes effect with the next batch and overrides the selected model while on
+    bool enabled = SendMessage(m_hCascadeCheck, BM_GETCHECK, 0, 0) == BST_CHECKED;
+    m_cascade->setEnabled(enabled);
+    m_cascade->resetStats();
+
+    CascadeConfig config = m_cascade->getConfig();
+    std::string models = config.smallModel + " -> " + config.largeModel;
+    SetWindowText(m_hStatusStatic, enabled ? (L"Cascade: " + std::wstring(models.begin(), models.end())).c_str()
+                                           : L"Cascade off");
+}
+
 void MainWindow::OnStartWebcam()
 {
     if (m_isWebcamActive) {
@@ -345,32 +711,101 @@ void MainWindow::OnStartWebcam()
     // Get FPS setting
     wchar_t fpsText[10];
     GetWindowText(m_hFpsEdit, fpsText, 10);
-    m_webcamFps = _wtoi(fpsText);
-    if (m_webcamFps < 1) m_webcamFps = 1;
+    m_webcamFps = _wtof(fpsText);
+    if (m_webcamFps < 0.1) m_webcamFps = 0.1;
     if (m_webcamFps > 10) m_webcamFps = 10;
 
-    // Initialize webcam
-    if (!m_webcamCapture->initialize(0)) {
-        MessageBox(m_hwnd, L"Failed to initialize webcam. Please check if camera is connected and not in use by another application.", 
-                   L"Webcam Error", MB_OK | MB_ICONERROR);
-        return;
+    // Configure the closed-loop rate controller; the FPS box becomes the starting point
+    m_isAdaptive = SendMessage(m_hAdaptiveCheck, BM_GETCHECK, 0, 0) == BST_CHECKED;
+    AdaptiveControllerConfig config;
+    if (m_isAdaptive) {
+        wchar_t sloText[10];
+        GetWindowText(m_hSloEdit, sloText, 10);
+        int slo = _wtoi(sloText);
+        config.latencySloMs = slo > 0 ? slo : 1000;
+        config.adaptModel = SendMessage(m_hAutoModelCheck, BM_GETCHECK, 0, 0) == BST_CHECKED;
     }
 
-    m_webcamCapture->setFrameRate(m_webcamFps);
-    
-    // Start webcam capture
-    m_webcamCapture->startCapture(
-        [this](const std::string& framePath) { OnWebcamFrame(framePath); },
-        [this](const std::string& error) { OnWebcamError(error); }
-    );
+    wchar_t camerasText[128];
+    GetWindowText(m_hCamerasEdit, camerasText, 128);
+    std::vector<CameraSpec> devices = ParseCameraList(camerasText, m_inferenceSize);
+    if (devices.empty()) {
+        devices.push_back({0, 1.0, m_inferenceSize});
+    }
+
+    // Initialize every camera before starting any of them
+    std::vector<std::shared_ptr<CameraStream>> cameras;
+    for (size_t i = 0; i < devices.size(); ++i) {
+        auto camera = std::make_shared<CameraStream>();
+        camera->streamId = static_cast<int>(i);
+        camera->deviceId = devices[i].device;
+        camera->weight = devices[i].weight;
+        camera->inferenceSize = devices[i].inferenceSize;
+        camera->maxFrameAge = m_isAdaptive
+            ? std::chrono::milliseconds(static_cast<long long>(2 * config.latencySloMs)) : kLiveFrameMaxAge;
+        camera->capture = std::make_unique<WebcamCapture>();
+        camera->controller = std::make_unique<AdaptiveRateController>(config);
+        camera->controller->reset(static_cast<int>(m_webcamFps + 0.5), m_selectedModel);
+
+        if (!camera->capture->initialize(camera->deviceId)) {
+            std::wstring message = L"Failed to initialize camera " + std::to_wstring(camera->deviceId) +
+                L". Please check if camera is connected and not in use by another application.";
+            MessageBox(m_hwnd, message.c_str(), L"Webcam Error", MB_OK | MB_ICONERROR);
+            return;
+        }
+
+        camera->capture->setFrameRate(m_webcamFps);
+        camera->capture->setCpuAffinity(m_threadPlan.captureCpus);
+        camera->previewEncoder.setQuality(kPreviewQuality);
+        cameras.push_back(camera);
+    }
+
+    // One recording per session, named by start time
+    if (SendMessage(m_hRecordCheck, BM_GETCHECK, 0, 0) == BST_CHECKED) {
+        char tempPath[MAX_PATH];
+        GetTempPathA(MAX_PATH, tempPath);
+        std::string directory = std::string(tempPath) + "yolo_recordings\\";
+        CreateDirectoryA(directory.c_str(), NULL);
+        auto recorder = std::make_shared<RecordingWriter>();
+        if (recorder->open(directory + "session_" + std::to_string(time(nullptr)) + ".yrec")) {
+            std::atomic_store(&m_recorder, recorder);
+        } else {
+            MessageBox(m_hwnd, L"Could not create the session recording; continuing without it.",
+                       L"Recording", MB_OK | MB_ICONWARNING);
+        }
+    }
+
+    wchar_t roiText[512];
+    GetWindowText(m_hRoiEdit, roiText, 512);
+    std::wstring roiWide(roiText);
+    std::map<int, RoiMask> masks = RoiMask::parse(std::string(roiWide.begin(), roiWide.end()));
+
+    m_cameras = cameras;
+    for (const auto& camera : m_cameras) {
+        m_scheduler->addStream(camera->streamId, camera->weight);
+        auto mask = masks.find(camera->deviceId);
+        if (mask != masks.end()) {
+            m_roi->setMask(camera->streamId, mask->second);
+        }
+
+        // The capture thread is joined before the camera is destroyed, so a weak
+        // reference is enough here and avoids a camera -> capture -> camera cycle
+        std::weak_ptr<CameraStream> weakCamera = camera;
+        camera->capture->startCapture(
+            [this, weakCamera](const FrameLease& frame) {
+                if (auto camera = weakCamera.lock()) {
+                    OnWebcamFrame(camera, frame);
+                }
+            },
+            [this](const std::string& error) { m_captureErrors.post(error); }
+        );
+    }
 
     m_isWebcamActive = true;
     SetWindowText(m_hWebcamButton, L"Stop Webcam");
     SetWindowText(m_hStatusStatic, L"Webcam active - Real-time detection running");
+    m_compositor->clear();
     SetWindowText(m_hImageStatic, L"Webcam feed active\nReal-time detection in progress...");
-    
-    // Disable image button while webcam is active
-    EnableWindow(m_hOpenButton, FALSE);
 }
 
 void MainWindow::OnStopWebcam()
@@ -379,55 +814,144 @@ void MainWindow::OnStopWebcam()
         return;
     }
 
-    m_webcamCapture->stopCapture();
+    for (const auto& camera : m_cameras) {
+        camera->capture->stopCapture();
+        m_scheduler->removeStream(camera->streamId);
+        m_preview.removeStream(camera->streamId);
+        // The capture thread is gone, so the handle is no longer written
+        camera->inFlight.cancel();
+    }
+    // Requests still in flight keep their camera alive through their callbacks
+    m_cameras.clear();
+    m_roi->clearMasks();
     m_isWebcamActive = false;
+    // Results still in flight hold the recorder; it closes with the last of them
+    std::atomic_store(&m_recorder, std::shared_ptr<RecordingWriter>());
     
     SetWindowText(m_hWebcamButton, L"Start Webcam");
     SetWindowText(m_hStatusStatic, L"Webcam stopped");
+    m_compositor->clear();
     SetWindowText(m_hImageStatic, L"Webcam stopped\nClick 'Start Webcam' to resume real-time detection");
-    
-    // Re-enable image button
-    EnableWindow(m_hOpenButton, TRUE);
-    
-    ShowWindow(m_hProgressBar, SW_HIDE);
 }
 
-void MainWindow::OnWebcamFrame(const std::string& framePath)
+void MainWindow::OnWebcamFrame(const std::shared_ptr<CameraStream>& camera, const FrameLease& frame)
 {
     if (!m_isWebcamActive) {
         return;
     }
 
-    // Skip if already processing (to maintain frame rate)
-    if (m_isProcessing) {
-        return;
+    // Shown at camera rate with the newest boxes, without waiting for this frame's result.
+    // The preview is composed and encoded once per frame however many browsers
+    // watch it, and not at all while none do.
+    bool display = camera->streamId == kDisplayedStream;
+    bool preview = m_preview.getViewerCount(camera->streamId) > 0;
+    int width = 0;
+    int height = 0;
+    if ((display || preview) && m_imageProcessor->loadPixels(frame->path, camera->framePixels, width, height)) {
+        ImageView pixels = {camera->framePixels.data(), width, height, width * 4};
+        {
+            std::lock_guard<std::mutex> lock(camera->overlayMutex);
+            if (display) {
+                m_compositor->compose(pixels, camera->overlay);
+            }
+            if (preview) {
+                int previewWidth = std::min<int>(width, kPreviewMaxWidth);
+                camera->preview.setOutputSize(previewWidth, std::max<int>(1, height * previewWidth / width));
+                camera->preview.compose(pixels, camera->overlay);
+            }
+        }
+        if (preview) {
+            auto jpeg = std::make_shared<std::string>();
+            camera->preview.drawFront([&](const ImageView& image) {
+                camera->previewEncoder.encode(image, *jpeg);
+            });
+            m_preview.publish(camera->streamId, std::move(jpeg));
+        }
     }
 
-    m_isProcessing = true;
-
     // Create detection request
     DetectionRequest request;
-    request.imagePath = framePath;
+    request.imagePath = frame->path;
     request.confidenceThreshold = m_confidenceThreshold;
     request.iouThreshold = m_iouThreshold;
-    request.modelName = m_selectedModel;
+    request.modelName = m_isAdaptive ? camera->controller->getCurrentModel() : m_selectedModel;
     request.saveAnnotated = false;
+    request.streamId = camera->streamId;
+    request.inferenceSize = camera->inferenceSize;
+    request.deadline = std::chrono::steady_clock::now() + camera->maxFrameAge;
+
+    // The scheduler keeps only the newest frame per camera. The callbacks hold
+    // the frame lease, so the slot returns to the pool once the request is done
+    // or replaced by a newer frame.
+    // When recording, the frame is stored before it is submitted and its result
+    // is stored under the same sequence number once it arrives
+    std::shared_ptr<RecordingWriter> recorder = std::atomic_load(&m_recorder);
+    uint64_t sequence = camera->frameSequence++;
+    if (recorder) {
+        recorder->writeFrameFile(camera->streamId, sequence, frame->path);
+    }
 
-    // Start detection
-    m_detectionClient->detectObjects(request, 
-        [this](const DetectionResult& result) { 
-            OnDetectionComplete(result);
-            m_isProcessing = false;
+    auto submitted = std::chrono::steady_clock::now();
+    auto deadline = request.deadline;
+    camera->inFlight = m_scheduler->submit(camera->streamId, request,
+        [this, camera, frame, submitted, recorder, sequence](const DetectionResult& result) { 
+            auto latency = std::chrono::steady_clock::now() - submitted;
+            UpdateAdaptiveController(*camera, std::chrono::duration<double, std::milli>(latency).count());
+            if (m_detectionLog) m_detectionLog->appendResult(result, DetectionLog::nowUs());
+            if (recorder) recorder->writeResult(camera->streamId, sequence, result);
+            {
+                std::lock_guard<std::mutex> lock(camera->overlayMutex);
+                camera->overlay = result.detections;
+            }
+            m_liveResults.post(result);
         },
-        [this](const std::string& error) { 
-            m_isProcessing = false;
-            // Don't show error dialog for webcam frames, just log
-            std::wstring status = L"Frame detection error (continuing...)";
-            SetWindowText(m_hStatusStatic, status.c_str());
+        [this, camera, frame, submitted, deadline](const std::string& error) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                // A stale frame is not an error to show, but the controller must
+                // still see how late it was or it would never slow down
+                UpdateAdaptiveController(*camera, std::chrono::duration<double, std::milli>(now - submitted).count());
+                return;
+            }
+            m_liveResults.post(MakeFailedResult(camera->streamId, error));
         }
     );
 }
 
+void MainWindow::DrainMailboxes()
+{
+    // Only the newest result of each kind is rendered; older ones were coalesced
+    DetectionResult result;
+    if (m_stillResults.take(result)) {
+        if (result.success) {
+            OnDetectionComplete(result);
+        } else {
+            OnDetectionError(std::wstring(result.errorMessage.begin(), result.errorMessage.end()));
+        }
+    }
+
+    if (m_liveResults.take(result) && m_isWebcamActive) {
+        if (result.success) {
+            OnDetectionComplete(result);
+        } else {
+            // Don't show error dialog for webcam frames, just report
+            SetWindowText(m_hStatusStatic, L"Frame detection error (continuing...)");
+        }
+    }
+
+    // Repaint only when a new frame was composed; the paint is a single blit
+    uint64_t sequence = m_compositor->getSequence();
+    if (sequence != m_shownSequence) {
+        m_shownSequence = sequence;
+        InvalidateRect(m_hImageStatic, NULL, FALSE);
+    }
+
+    std::string error;
+    if (m_captureErrors.take(error)) {
+        OnWebcamError(error);
+    }
+}
+
 void MainWindow::OnWebcamError(const std::string& error)
 {
     std::wstring werror(error.begin(), error.end());
@@ -435,18 +959,36 @@ void MainWindow::OnWebcamError(const std::string& error)
     OnStopWebcam();
 }
 
+void MainWindow::UpdateAdaptiveController(CameraStream& camera, double latencyMs)
+{
+    if (!m_isAdaptive) {
+        return;
+    }
+
+    // A frame already waiting behind this one means the camera outpaces its share
+    int queueDepth = static_cast<int>(m_scheduler->getQueueDepth(camera.streamId));
+    camera.controller->recordSample(latencyMs, queueDepth);
+    camera.capture->setFrameRate(camera.controller->getTargetFps());
+}
+
 void MainWindow::OnDetectionComplete(const DetectionResult& result)
 {
-    if (!m_isWebcamActive) {
+    bool isStill = result.streamId == kStillImageStream;
+    if (isStill) {
         m_isProcessing = false;
+        m_stillShownAt = std::chrono::steady_clock::now();
         ShowWindow(m_hProgressBar, SW_HIDE);
+        UpdateResultsText(result);
+        m_stillDetections = result.detections;
+        ComposeStillImage();
+    } else if (std::chrono::steady_clock::now() - m_stillShownAt > kStillResultHold) {
+        UpdateResultsText(result);
     }
     
-    UpdateResultsText(result);
-    
     std::wstringstream status;
-    if (m_isWebcamActive) {
-        status << L"Live: " << result.detections.size() << L" objects (" << result.processingTime << L"ms) - FPS: " << m_webcamFps;
+    if (!isStill) {
+        status << L"Live: camera " << result.streamId << L": " << result.detections.size() << L" objects ("
+               << result.processingTime << L"ms) - " << m_cameras.size() << L" camera(s)";
     } else {
         status << L"Detected " << result.detections.size() << L" objects in " << result.processingTime << L"ms";
     }
@@ -467,21 +1009,86 @@ void MainWindow::UpdateImageDisplay()
 {
     if (m_currentImagePath.empty()) return;
 
-    // For simplicity, just show the filename
+    // The filename shows when the image cannot be decoded
     std::wstring filename = m_currentImagePath.substr(m_currentImagePath.find_last_of(L"\\") + 1);
     SetWindowText(m_hImageStatic, (L"Image loaded: " + filename).c_str());
+
+    int size = WideCharToMultiByte(CP_UTF8, 0, m_currentImagePath.c_str(), -1, NULL, 0, NULL, NULL);
+    std::string imagePath(size, 0);
+    WideCharToMultiByte(CP_UTF8, 0, m_currentImagePath.c_str(), -1, &imagePath[0], size, NULL, NULL);
+    imagePath.pop_back();
+
+    m_stillDetections.clear();
+    if (!m_imageProcessor->loadPixels(imagePath, m_stillPixels, m_stillWidth, m_stillHeight)) {
+        m_stillPixels.clear();
+        m_compositor->clear();
+        return;
+    }
+    ComposeStillImage();
+}
+
+void MainWindow::ComposeStillImage()
+{
+    // The live feed owns the image area while it runs
+    if (m_isWebcamActive || m_stillPixels.empty()) {
+        return;
+    }
+    m_compositor->compose({m_stillPixels.data(), m_stillWidth, m_stillHeight, m_stillWidth * 4}, m_stillDetections);
+}
+
+void MainWindow::PaintImageDisplay(const DRAWITEMSTRUCT& item)
+{
+    HDC hdc = item.hDC;
+    RECT rect = item.rcItem;
+
+    // The front buffer is a finished frame and stays so until the blit returns
+    bool painted = m_compositor->drawFront([hdc, &rect](const ImageView& image) {
+        BITMAPINFO info = {};
+        info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        info.bmiHeader.biWidth = image.width;
+        info.bmiHeader.biHeight = -image.height;    // Top row first
+        info.bmiHeader.biPlanes = 1;
+        info.bmiHeader.biBitCount = 32;
+        info.bmiHeader.biCompression = BI_RGB;
+        SetDIBitsToDevice(hdc, rect.left, rect.top, image.width, image.height, 0, 0, 0, image.height,
+                          image.pixels, &info, DIB_RGB_COLORS);
+
+        // Until the next frame arrives after a resize, the frame may not cover the area
+        HBRUSH black = (HBRUSH)GetStockObject(BLACK_BRUSH);
+        RECT right = {rect.left + image.width, rect.top, rect.right, rect.bottom};
+        RECT below = {rect.left, rect.top + image.height, rect.left + image.width, rect.bottom};
+        if (right.left < right.right) FillRect(hdc, &right, black);
+        if (below.top < below.bottom) FillRect(hdc, &below, black);
+    });
+    if (painted) {
+        return;
+    }
+
+    wchar_t text[256];
+    GetWindowText(m_hImageStatic, text, 256);
+    FillRect(hdc, &rect, GetSysColorBrush(COLOR_BTNFACE));
+    SetBkMode(hdc, TRANSPARENT);
+    DrawText(hdc, text, -1, &rect, DT_CENTER | DT_WORDBREAK);
 }
 
 void MainWindow::UpdateResultsText(const DetectionResult& result)
 {
     std::wstringstream resultsText;
     
-    if (m_isWebcamActive) {
-        resultsText << L"REAL-TIME DETECTION (Frame processed in " << result.processingTime << L"ms)\r\n";
+    if (result.streamId != kStillImageStream) {
+        resultsText << L"REAL-TIME DETECTION - camera " << result.streamId
+                   << L" (Frame processed in " << result.processingTime << L"ms)\r\n";
     } else {
         resultsText << L"Detection completed in " << result.processingTime << L"ms\r\n";
+        if (result.modelLoadTime > 0) {
+            resultsText << L"Model loaded in " << result.modelLoadTime << L"ms (not resident)\r\n";
+        }
     }
     
+    if (result.letterbox.isValid()) {
+        resultsText << L"Input: " << result.letterbox.sourceWidth << L"x" << result.letterbox.sourceHeight
+                   << L" fitted to " << result.letterbox.inputWidth << L"x" << result.letterbox.inputHeight << L"\r\n";
+    }
     resultsText << L"Objects detected: " << result.detections.size() << L"\r\n\r\n";
 
     for (size_t i = 0; i < result.detections.size(); ++i) {
@@ -497,8 +1104,139 @@ void MainWindow::UpdateResultsText(const DetectionResult& result)
     }
 
     if (m_isWebcamActive) {
-        resultsText << L"\r\n--- LIVE FEED ACTIVE ---\r\n";
-        resultsText << L"FPS: " << m_webcamFps << L" | Model: " << std::wstring(m_selectedModel.begin(), m_selectedModel.end()) << L"\r\n";
+        MailboxStats mailbox = m_liveResults.getStats();
+        resultsText << L"\r\n--- LIVE FEED ACTIVE ---\r\n" << std::fixed;
+        resultsText << L"Display: " << mailbox.delivered << L" results rendered, "
+                   << mailbox.coalesced << L" coalesced\r\n";
+        CompositorStats display = m_compositor->getStats();
+        resultsText << L"Video: " << display.frames << L" frames composed at " << display.outputWidth << L"x"
+                   << display.outputHeight << L", " << std::setprecision(1) << display.meanComposeMs
+                   << L"ms each" << (display.scaler.simd ? L" (SSE2)" : L"") << L"\r\n";
+        if (m_preview.isRunning()) {
+            MjpegServerStats preview = m_preview.getStats();
+            resultsText << L"Preview: http://127.0.0.1:" << m_preview.getPort() << L"/ | " << preview.viewers
+                       << L" viewers, " << preview.framesPublished << L" frames encoded, " << preview.framesSent
+                       << L" sent, " << preview.framesSkipped << L" skipped for slow viewers\r\n";
+        }
+        for (size_t i = 0; i < m_threadPlan.workers.size(); ++i) {
+            const WorkerThreadBudget& budget = m_threadPlan.workers[i];
+            std::string cpus = budget.cpus.empty() ? "any" : formatCpuList(budget.cpus);
+            resultsText << L"Worker " << i << L" threads: " << budget.intraOpThreads << L" intra-op, "
+                       << budget.interOpThreads << L" inter-op on CPUs " << std::wstring(cpus.begin(), cpus.end());
+            if (i + 1 == m_threadPlan.workers.size() && !m_threadPlan.captureCpus.empty()) {
+                std::string capture = formatCpuList(m_threadPlan.captureCpus);
+                resultsText << L" | capture on CPUs " << std::wstring(capture.begin(), capture.end());
+            }
+            resultsText << L"\r\n";
+        }
+        if (!m_balancer) {
+            WorkerPoolStats workers = m_detectionClient->getWorkerStats();
+            resultsText << L"Workers: " << workers.exits << L" exited, " << workers.hangs << L" hung, "
+                       << workers.recoveries << L" recovered";
+            if (workers.recoveries > 0) {
+                resultsText << L" (last " << std::setprecision(0) << workers.lastRecoveryMs << L"ms, max "
+                           << workers.maxRecoveryMs << L"ms)";
+            }
+            resultsText << L", " << workers.redispatched << L" requests resent";
+            if (m_detectionClient->getWorkerConfig().warmStandby) {
+                resultsText << (workers.standbyReady ? L" | standby ready" : L" | standby loading");
+            }
+            resultsText << L"\r\n";
+        }
+        if (m_detectionLog) {
+            resultsText << L"Detection log: " << m_detectionLog->getStats().rows << L" detections stored\r\n";
+        }
+        if (m_balancer) {
+            for (const EndpointStats& endpoint : m_balancer->getStats()) {
+                resultsText << L"Worker " << std::wstring(endpoint.address.begin(), endpoint.address.end())
+                           << (endpoint.healthy ? L" up" : L" DOWN") << L" | in flight " << endpoint.outstanding
+                           << L", answered " << endpoint.completed << L", failures " << endpoint.failures
+                           << L", failovers " << endpoint.failovers << L" | round trip "
+                           << std::setprecision(0) << endpoint.meanLatencyMs << L"ms\r\n";
+            }
+        }
+        if (m_cascade->isEnabled()) {
+            CascadeConfig config = m_cascade->getConfig();
+            CascadeStats cascade = m_cascade->getStats();
+            std::string models = config.smallModel + " -> " + config.largeModel;
+            resultsText << L"Cascade " << std::wstring(models.begin(), models.end()) << L": "
+                       << std::setprecision(1) << cascade.escalationRate * 100 << L"% escalated ("
+                       << cascade.escalatedFrames << L" of " << cascade.frames << L" frames, "
+                       << cascade.escalatedCrops << L" crops; uncertain " << cascade.uncertainEscalations
+                       << L", scene changed " << cascade.countEscalations << L", failed " << cascade.escalationFailures
+                       << L") | " << cascade.fps << L" fps | per frame small " << std::setprecision(0)
+                       << cascade.meanSmallMs << L"ms, large " << cascade.meanLargeMs << L"ms\r\n";
+        }
+        if (std::shared_ptr<RecordingWriter> recorder = std::atomic_load(&m_recorder)) {
+            resultsText << L"Recording: " << recorder->getFrameCount() << L" frames, "
+                       << recorder->getResultCount() << L" results\r\n";
+        }
+
+        std::vector<StreamStats> streams = m_scheduler->getStreamStats();
+        std::vector<RoiStats> regions = m_roi->getStats();
+        for (const StreamStats& stats : streams) {
+            if (stats.streamId == kStillImageStream && stats.completed + stats.failed > 0) {
+                resultsText << L"Stills: waited " << std::setprecision(0) << stats.meanWaitMs << L"ms mean, "
+                           << stats.maxWaitMs << L"ms max for a worker\r\n";
+            }
+        }
+        for (const auto& camera : m_cameras) {
+            std::string model = m_isAdaptive ? camera->controller->getCurrentModel() : m_selectedModel;
+            if (m_cascade->isEnabled()) {
+                model = "cascade";
+            }
+            std::string sizeLabel = inferenceSizeLabel(camera->inferenceSize);
+            resultsText << L"Camera " << camera->streamId << L" (device " << camera->deviceId
+                       << L", weight " << std::setprecision(1) << camera->weight << L") | Model: "
+                       << std::wstring(model.begin(), model.end()) << L" | Input size: "
+                       << std::wstring(sizeLabel.begin(), sizeLabel.end()) << L"\r\n";
+
+            for (const StreamStats& stats : streams) {
+                if (stats.streamId != camera->streamId) continue;
+                resultsText << L"  Detection: " << std::setprecision(1) << stats.fps << L" fps | latency mean "
+                           << std::setprecision(0) << stats.meanLatencyMs << L"ms, p95 " << stats.p95LatencyMs
+                           << L"ms | batch " << std::setprecision(1) << stats.meanBatchSize
+                           << L" | done " << stats.completed << L", failed " << stats.failed
+                           << L", timed out " << stats.timedOut << L", cancelled " << stats.cancelled
+                           << L", replaced " << stats.dropped << L", promoted " << stats.promoted << L"\r\n";
+            }
+
+            if (m_detectionLog) {
+                DetectionQuery lastMinute;
+                lastMinute.toUs = DetectionLog::nowUs();
+                lastMinute.fromUs = lastMinute.toUs - 60ll * 1000000;
+                lastMinute.streamId = camera->streamId;
+                resultsText << L"  Last minute: " << m_detectionLog->count(lastMinute) << L" detections logged\r\n";
+            }
+
+            for (const RoiStats& roi : regions) {
+                if (roi.streamId != camera->streamId) continue;
+                resultsText << L"  ROI: " << roi.regions << L" region(s) | " << std::setprecision(1)
+                           << roi.inferredArea * 100 << L"% of the frame inferred in " << roi.crops << L" crops | "
+                           << roi.dropped << L" detections outside dropped\r\n";
+            }
+
+            FramePoolStats pool = camera->capture->getFramePoolStats();
+            resultsText << L"  Frame slots: " << pool.inUse << L"/" << pool.slotCount
+                       << L" in use (peak " << pool.peakInUse << L") | "
+                       << (pool.bytesInUse / 1024) << L" KB / " << (pool.byteBudget / 1024) << L" KB | "
+                       << L"exhausted " << pool.exhausted << L", over budget " << pool.budgetRejections << L"\r\n";
+
+            FramePacerStats pacing = camera->capture->getPacerStats();
+            resultsText << L"  Pacing: " << std::setprecision(1) << pacing.rate << L" fps | jitter mean "
+                       << pacing.meanJitterMs << L"ms, sd " << pacing.stddevJitterMs << L"ms, max " << pacing.maxJitterMs
+                       << L"ms | dropped deadlines " << pacing.droppedDeadlines << L"\r\n";
+
+            if (m_isAdaptive) {
+                resultsText << L"  Adaptive: smoothed latency " << std::setprecision(0)
+                           << camera->controller->getSmoothedLatency() << L"ms\r\n";
+                std::vector<ControllerDecision> decisions = camera->controller->getRecentDecisions();
+                if (!decisions.empty()) {
+                    const std::string& reason = decisions.back().reason;
+                    resultsText << L"  Last decision: " << std::wstring(reason.begin(), reason.end()) << L"\r\n";
+                }
+            }
+        }
     }
 
     SetWindowText(m_hResultsEdit, resultsText.str().c_str());
@@ -512,8 +1250,12 @@ void MainWindow::ResizeControls()
     int width = rect.right - rect.left;
     int height = rect.bottom - rect.top;
     
-    // Resize image display area
+    // Resize image display area; frames are composed at its new size from the next one on
     SetWindowPos(m_hImageStatic, NULL, 280, 10, width - 300, height - 320, SWP_NOZORDER);
+    RECT imageRect;
+    GetClientRect(m_hImageStatic, &imageRect);
+    m_compositor->setOutputSize(imageRect.right - imageRect.left, imageRect.bottom - imageRect.top);
+    ComposeStillImage();
     
     // Resize progress bar
     SetWindowPos(m_hProgressBar, NULL, 280, height - 300, width - 300, 20, SWP_NOZORDER);
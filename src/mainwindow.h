@@ -7,6 +7,39 @@
 #include "detection_client.h"
 #include "image_processor.h"
 #include "webcam_capture.h"
+#include "adaptive_controller.h"
+#include "detection_scheduler.h"
+#include "result_mailbox.h"
+#include "detection_log.h"
+#include "recording.h"
+#include "worker_balancer.h"
+#include "worker_pool.h"
+#include "cascade_executor.h"
+#include "roi_executor.h"
+#include "frame_compositor.h"
+#include "jpeg_encoder.h"
+#include "mjpeg_server.h"
+#include <memory>
+#include <atomic>
+#include <mutex>
+
+// One capture source feeding the shared detection scheduler
+struct CameraStream {
+    int streamId;
+    int deviceId;
+    double weight;
+    int inferenceSize;
+    std::atomic<uint64_t> frameSequence{0};   // Numbers recorded frames
+    std::chrono::milliseconds maxFrameAge;    // Frames older than this are not worth a result
+    CancellationHandle inFlight;              // Newest submitted frame; cancelled on stop
+    std::unique_ptr<WebcamCapture> capture;
+    std::unique_ptr<AdaptiveRateController> controller;
+    std::mutex overlayMutex;
+    std::vector<Detection> overlay;           // Newest result's boxes, drawn over live frames
+    std::vector<uint8_t> framePixels;         // Decoded frame; capture thread only
+    FrameCompositor preview;                  // Browser preview; composed only while someone watches
+    JpegEncoder previewEncoder;               // Capture thread only
+};
 
 class MainWindow {
 public:
@@ -22,14 +55,21 @@ private:
     LRESULT HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam);
 
     void CreateControls();
+    void DrainMailboxes();
     void OnOpenImage();
     void OnStartWebcam();
     void OnStopWebcam();
+    void OnModelChanged();
+    void OnInputSizeChanged();
+    void OnCascadeToggled();
     void OnDetectionComplete(const DetectionResult& result);
     void OnDetectionError(const std::wstring& error);
-    void OnWebcamFrame(const std::string& framePath);
+    void OnWebcamFrame(const std::shared_ptr<CameraStream>& camera, const FrameLease& frame);
     void OnWebcamError(const std::string& error);
+    void UpdateAdaptiveController(CameraStream& camera, double latencyMs);
     void UpdateImageDisplay();
+    void ComposeStillImage();
+    void PaintImageDisplay(const DRAWITEMSTRUCT& item);
     void UpdateResultsText(const DetectionResult& result);
     void ResizeControls();
 
@@ -47,23 +87,54 @@ private:
     HWND m_hStatusStatic;
     HWND m_hProgressBar;
     HWND m_hFpsEdit;
+    HWND m_hAdaptiveCheck;
+    HWND m_hAutoModelCheck;
+    HWND m_hSloEdit;
+    HWND m_hCamerasEdit;
+    HWND m_hInputSizeCombo;
+    HWND m_hRecordCheck;
+    HWND m_hCascadeCheck;
+    HWND m_hRoiEdit;
     
     // Backend components
     DetectionClient* m_detectionClient;
     ImageProcessor* m_imageProcessor;
-    WebcamCapture* m_webcamCapture;
+    DetectionScheduler* m_scheduler;
+    std::unique_ptr<WorkerBalancer> m_balancer;     // Set when detection runs on remote workers
+    std::unique_ptr<RoiExecutor> m_roi;             // Crops each camera's frames to its regions of interest
+    std::unique_ptr<CascadeExecutor> m_cascade;     // Between the scheduler and the workers; off by default
+    std::unique_ptr<DetectionLog> m_detectionLog;
+    std::shared_ptr<RecordingWriter> m_recorder;    // Set while a session is recorded; atomic access
+    std::vector<std::shared_ptr<CameraStream>> m_cameras;
+    std::unique_ptr<FrameCompositor> m_compositor;  // Frames with boxes, ready to blit into the image area
+    ThreadBudgetPlan m_threadPlan;                  // Local workers' threads and CPUs; empty with remote workers
+    MjpegServer m_preview;                          // Live frames with boxes for browsers on this machine
+
+    // Worker and capture threads never touch windows; they post here and the
+    // UI thread drains once per display refresh
+    LatestMailbox<DetectionResult> m_stillResults;
+    LatestMailbox<DetectionResult> m_liveResults;
+    LatestMailbox<std::string> m_captureErrors;
     
     // State
     std::wstring m_currentImagePath;
     HBITMAP m_hCurrentBitmap;
     bool m_isProcessing;
-    bool m_isWebcamActive;
+    std::atomic<bool> m_isWebcamActive;   // Read by capture threads
+    bool m_isAdaptive;
+    std::chrono::steady_clock::time_point m_stillShownAt;
+    std::vector<uint8_t> m_stillPixels;
+    int m_stillWidth;
+    int m_stillHeight;
+    std::vector<Detection> m_stillDetections;
+    uint64_t m_shownSequence;           // Compositor frame last painted
     
     // Settings
     double m_confidenceThreshold;
     double m_iouThreshold;
     std::string m_selectedModel;
-    int m_webcamFps;
+    int m_inferenceSize;
+    double m_webcamFps;
 };
 
 #endif // MAINWINDOW_H
\ No newline at end of file
@@ -0,0 +1,552 @@
+#include "mjpeg_server.h"
+#include "socket_shim.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifndef _WIN32
+#include <netdb.h>
+#include <netinet/in.h>
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+using namespace socket_shim;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+const size_t kMaxConnections = 64;
+const size_t kMaxRequestBytes = 8192;
+// Small enough that the kernel holds no more than a frame or two for a
+// slow viewer; anything it cannot take waits as a reference, not a copy
+const int kSendBufferBytes = 128 * 1024;
+// Viewers that accept nothing for this long are disconnected
+const auto kStallTimeout = std::chrono::seconds(10);
+
+struct PollEvent {
+    Socket socket;
+    bool readable;
+    bool writable;
+    bool failed;
+};
+
+std::string httpResponse(const char* status, const char* contentType, const std::string& body)
+{
+    return std::string("HTTP/1.0 ") + status + "\r\nContent-Type: " + contentType +
+           "\r\nContent-Length: " + std::to_string(body.size()) +
+           "\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n" + body;
+}
+}
+
+struct MjpegServer::Frame {
+    uint64_t sequence;                          // Per stream, from 1
+    std::string header;                         // Part boundary and headers
+    std::shared_ptr<const std::string> jpeg;
+};
+
+struct MjpegServer::Viewer {
+    Socket socket = kNoSocket;
+    std::string request;                        // Until the blank line ending the headers
+    std::string pending;                        // Response headers or a whole page, sent first
+    size_t pendingOffset = 0;
+    bool streaming = false;
+    int streamId = 0;
+    std::shared_ptr<const Frame> frame;         // Being sent; header, JPEG, then CRLF
+    size_t frameOffset = 0;
+    uint64_t lastSequence = 0;
+    bool watchingWrite = false;
+    Clock::time_point lastProgress;
+
+    bool busy() const { return pendingOffset < pending.size() || frame; }
+};
+
+// Readiness of the listening socket and every viewer. On Linux this is
+// epoll, woken through an eventfd when a frame is published; elsewhere
+// poll() over every socket, with a short timeout standing in for the wake.
+#ifdef __linux__
+class MjpegServer::Poller {
+public:
+    Poller()
+        : m_epoll(epoll_create1(EPOLL_CLOEXEC))
+        , m_wake(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    {
+        if (valid()) {
+            control(EPOLL_CTL_ADD, m_wake, false);
+        }
+    }
+
+    ~Poller()
+    {
+        if (m_epoll >= 0) ::close(m_epoll);
+        if (m_wake >= 0) ::close(m_wake);
+    }
+
+    bool valid() const { return m_epoll >= 0 && m_wake >= 0; }
+    void add(Socket socket) { control(EPOLL_CTL_ADD, socket, false); }
+    void setWritable(Socket socket, bool writable) { control(EPOLL_CTL_MOD, socket, writable); }
+    void remove(Socket socket) { epoll_ctl(m_epoll, EPOLL_CTL_DEL, socket, nullptr); }
+
+    void wake()
+    {
+        uint64_t one = 1;
+        ssize_t written = ::write(m_wake, &one, sizeof(one));
+        (void)written;
+    }
+
+    void wait(std::vector<PollEvent>& events, int timeoutMs)
+    {
+        events.clear();
+        epoll_event ready[64];
+        int count = epoll_wait(m_epoll, ready, 64, timeoutMs);
+        for (int i = 0; i < count; ++i) {
+            if (ready[i].data.fd == m_wake) {
+                uint64_t wakes;
+                ssize_t drained = ::read(m_wake, &wakes, sizeof(wakes));
+                (void)drained;
+                continue;
+            }
+            uint32_t flags = ready[i].events;
+            events.push_back({ready[i].data.fd, (flags & EPOLLIN) != 0, (flags & EPOLLOUT) != 0,
+                              (flags & (EPOLLERR | EPOLLHUP)) != 0});
+        }
+    }
+
+private:
+    void control(int operation, int socket, bool writable)
+    {
+        epoll_event event = {};
+        event.events = writable ? static_cast<uint32_t>(EPOLLIN | EPOLLOUT) : static_cast<uint32_t>(EPOLLIN);
+        event.data.fd = socket;
+        epoll_ctl(m_epoll, operation, socket, &event);
+    }
+
+    int m_epoll;
+    int m_wake;
+};
+#else
+class MjpegServer::Poller {
+public:
+    bool valid() const { return true; }
+
+    void add(Socket socket)
+    {
+        PollFd fd = {};
+        fd.fd = socket;
+        fd.events = POLLIN;
+        m_fds.push_back(fd);
+    }
+
+    void setWritable(Socket socket, bool writable)
+    {
+        for (PollFd& fd : m_fds) {
+            if (fd.fd == socket) {
+                fd.events = writable ? (POLLIN | POLLOUT) : POLLIN;
+            }
+        }
+    }
+
+    void remove(Socket socket)
+    {
+        m_fds.erase(std::remove_if(m_fds.begin(), m_fds.end(), [socket](const PollFd& fd) {
+            return fd.fd == socket;
+        }), m_fds.end());
+    }
+
+    void wake()
+    {
+    }
+
+    void wait(std::vector<PollEvent>& events, int timeoutMs)
+    {
+        events.clear();
+        if (pollSockets(m_fds.data(), m_fds.size(), std::min<int>(timeoutMs, 10)) <= 0) {
+            return;
+        }
+        for (const PollFd& fd : m_fds) {
+            if (fd.revents) {
+                events.push_back({fd.fd, (fd.revents & POLLIN) != 0, (fd.revents & POLLOUT) != 0,
+                                  (fd.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0});
+            }
+        }
+    }
+
+private:
+    std::vector<PollFd> m_fds;
+};
+#endif
+
+MjpegServer::MjpegServer()
+    : m_poller(std::make_unique<Poller>())
+    , m_listenSocket(kNoSocket)
+    , m_port(0)
+    , m_running(false)
+    , m_stats()
+{
+}
+
+MjpegServer::~MjpegServer()
+{
+    stop();
+}
+
+bool MjpegServer::start(int port, const std::string& host)
+{
+    stop();
+    ensureWinsock();
+    if (!m_poller->valid()) {
+        return false;
+    }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) {
+        return false;
+    }
+    for (addrinfo* address = addresses; address && m_listenSocket == kNoSocket; address = address->ai_next) {
+        auto socket = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (socket == kNoSocket) {
+            continue;
+        }
+#ifndef _WIN32
+        // Restarting must not wait out the previous run's TIME_WAIT connections
+        int reuse = 1;
+        setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+        if (bind(socket, address->ai_addr, static_cast<int>(address->ai_addrlen)) != 0 ||
+            listen(socket, 16) != 0 || !setNonBlocking(socket)) {
+            closeSocket(socket);
+            continue;
+        }
+        m_listenSocket = socket;
+    }
+    freeaddrinfo(addresses);
+    if (m_listenSocket == kNoSocket) {
+        return false;
+    }
+
+    sockaddr_storage bound = {};
+    socklen_t length = sizeof(bound);
+    getsockname(m_listenSocket, reinterpret_cast<sockaddr*>(&bound), &length);
+    m_port = bound.ss_family == AF_INET6 ? ntohs(reinterpret_cast<sockaddr_in6*>(&bound)->sin6_port)
+                                         : ntohs(reinterpret_cast<sockaddr_in*>(&bound)->sin_port);
+
+    m_poller->add(m_listenSocket);
+    m_running = true;
+    m_thread = std::thread(&MjpegServer::serveLoop, this);
+    return true;
+}
+
+void MjpegServer::stop()
+{
+    if (!m_thread.joinable()) {
+        return;
+    }
+    m_running = false;
+    m_poller->wake();
+    m_thread.join();
+    m_poller->remove(m_listenSocket);
+    closeSocket(m_listenSocket);
+    m_listenSocket = kNoSocket;
+    m_port = 0;
+}
+
+bool MjpegServer::isRunning() const
+{
+    return m_running;
+}
+
+int MjpegServer::getPort() const
+{
+    return m_port;
+}
+
+void MjpegServer::publish(int streamId, std::shared_ptr<const std::string> jpeg)
+{
+    if (!jpeg || jpeg->empty()) {
+        return;
+    }
+    auto frame = std::make_shared<Frame>();
+    frame->header = "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: " + std::to_string(jpeg->size()) +
+                    "\r\n\r\n";
+    frame->jpeg = std::move(jpeg);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        frame->sequence = ++m_sequences[streamId];
+        m_latest[streamId] = std::move(frame);
+        m_stats.framesPublished++;
+    }
+    if (m_running) {
+        m_poller->wake();
+    }
+}
+
+void MjpegServer::removeStream(int streamId)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_latest.erase(streamId);
+}
+
+size_t MjpegServer::getViewerCount(int streamId) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_viewerCounts.find(streamId);
+    return it != m_viewerCounts.end() ? it->second : 0;
+}
+
+MjpegServerStats MjpegServer::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void MjpegServer::serveLoop()
+{
+    std::map<Socket, Viewer> viewers;
+    std::vector<PollEvent> events;
+
+    auto closeViewer = [&](std::map<Socket, Viewer>::iterator it) {
+        if (it->second.streaming) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_viewerCounts[it->second.streamId] == 0) {
+                m_viewerCounts.erase(it->second.streamId);
+            }
+            m_stats.viewers--;
+        }
+        m_poller->remove(it->first);
+        closeSocket(it->first);
+        return viewers.erase(it);
+    };
+
+    while (m_running) {
+        m_poller->wait(events, 1000);
+
+        for (const PollEvent& event : events) {
+            if (event.socket == m_listenSocket) {
+                acceptViewers(viewers);
+                continue;
+            }
+            auto it = viewers.find(event.socket);
+            if (it == viewers.end()) {
+                continue;
+            }
+            bool keep = !event.failed;
+            if (keep && event.readable) {
+                keep = readFromViewer(it->second);
+            }
+            if (keep && event.writable) {
+                keep = sendToViewer(it->second);
+            }
+            if (!keep) {
+                closeViewer(it);
+            }
+        }
+
+        // Idle viewers pick up newly published frames; stuck ones are dropped
+        Clock::time_point now = Clock::now();
+        for (auto it = viewers.begin(); it != viewers.end();) {
+            Viewer& viewer = it->second;
+            bool keep = true;
+            if (viewer.busy() || !viewer.streaming) {
+                if (now - viewer.lastProgress > kStallTimeout) {
+                    keep = false;
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stats.viewersDropped += viewer.streaming ? 1 : 0;
+                }
+            } else {
+                keep = sendToViewer(viewer);
+            }
+            if (!keep) {
+                it = closeViewer(it);
+                continue;
+            }
+            if (viewer.busy() != viewer.watchingWrite) {
+                viewer.watchingWrite = viewer.busy();
+                m_poller->setWritable(viewer.socket, viewer.watchingWrite);
+            }
+            ++it;
+        }
+    }
+
+    for (auto it = viewers.begin(); it != viewers.end();) {
+        it = closeViewer(it);
+    }
+}
+
+void MjpegServer::acceptViewers(std::map<Socket, Viewer>& viewers)
+{
+    for (;;) {
+        auto socket = static_cast<Socket>(accept(m_listenSocket, nullptr, nullptr));
+        if (socket == kNoSocket) {
+            return;
+        }
+        if (viewers.size() >= kMaxConnections || !setNonBlocking(socket)) {
+            closeSocket(socket);
+            continue;
+        }
+        setsockopt(socket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&kSendBufferBytes),
+                   sizeof(kSendBufferBytes));
+#ifdef SO_NOSIGPIPE
+        int noSigPipe = 1;
+        setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+        Viewer& viewer = viewers[socket];
+        viewer.socket = socket;
+        viewer.lastProgress = Clock::now();
+        m_poller->add(socket);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.connections++;
+    }
+}
+
+bool MjpegServer::readFromViewer(Viewer& viewer)
+{
+    char buffer[4096];
+    for (;;) {
+        auto received = recv(viewer.socket, buffer, sizeof(buffer), 0);
+        if (received == 0) {
+            return false;
+        }
+        if (received < 0) {
+            if (interrupted()) continue;
+            break;
+        }
+        // Whatever a browser sends after its request is ignored
+        if (!viewer.streaming && viewer.pending.empty()) {
+            viewer.request.append(buffer, static_cast<size_t>(received));
+            viewer.lastProgress = Clock::now();
+        }
+    }
+    if (viewer.streaming || !viewer.pending.empty()) {
+        return wouldBlock();
+    }
+    if (viewer.request.find("\r\n\r\n") == std::string::npos) {
+        return wouldBlock() && viewer.request.size() <= kMaxRequestBytes;
+    }
+    handleRequest(viewer);
+    return sendToViewer(viewer);
+}
+
+void MjpegServer::handleRequest(Viewer& viewer)
+{
+    // Only the request line matters
+    char method[16] = {};
+    char target[1024] = {};
+    std::sscanf(viewer.request.c_str(), "%15s %1023s", method, target);
+    std::string path(target);
+    path = path.substr(0, path.find('?'));
+    viewer.request.clear();
+
+    int streamId = -1;
+    char extra = 0;
+    if (std::strcmp(method, "GET") != 0) {
+        viewer.pending = httpResponse("405 Method Not Allowed", "text/plain", "Only GET is supported\n");
+    } else if (path == "/" || path == "/index.html") {
+        std::string body = "<!DOCTYPE html>\n<html><head><title>YOLOv5 Preview</title></head>\n"
+                           "<body style=\"background:#202020;color:#e0e0e0;font-family:sans-serif\">\n";
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_latest.empty()) {
+            body += "<p>No camera is running.</p>\n";
+        }
+        for (const auto& entry : m_latest) {
+            std::string id = std::to_string(entry.first);
+            body += "<h3>Stream " + id + "</h3>\n<img src=\"/stream/" + id + "\" alt=\"Stream " + id + "\">\n";
+        }
+        body += "</body></html>\n";
+        viewer.pending = httpResponse("200 OK", "text/html; charset=utf-8", body);
+    } else if (std::sscanf(path.c_str(), "/stream/%d%c", &streamId, &extra) == 1 && streamId >= 0) {
+        viewer.pending = "HTTP/1.0 200 OK\r\n"
+                         "Content-Type: multipart/x-mixed-replace; boundary=frame\r\n"
+                         "Cache-Control: no-cache, no-store\r\nPragma: no-cache\r\nConnection: close\r\n\r\n";
+        viewer.streaming = true;
+        viewer.streamId = streamId;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_viewerCounts[streamId]++;
+        m_stats.viewers++;
+    } else {
+        viewer.pending = httpResponse("404 Not Found", "text/plain", "Not found\n");
+    }
+    viewer.pendingOffset = 0;
+}
+
+bool MjpegServer::sendToViewer(Viewer& viewer)
+{
+    static const char kPartEnd[] = "\r\n";
+    for (;;) {
+        if (!viewer.busy()) {
+            // Pages close once sent; streams move on to the newest frame,
+            // skipping whatever was published while the last one was sent
+            if (!viewer.streaming) {
+                return false;
+            }
+            std::shared_ptr<const Frame> latest;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = m_latest.find(viewer.streamId);
+                if (it == m_latest.end() || it->second->sequence == viewer.lastSequence) {
+                    return true;
+                }
+                latest = it->second;
+                if (viewer.lastSequence > 0 && latest->sequence > viewer.lastSequence + 1) {
+                    m_stats.framesSkipped += latest->sequence - viewer.lastSequence - 1;
+                }
+            }
+            viewer.lastSequence = latest->sequence;
+            viewer.frame = std::move(latest);
+            viewer.frameOffset = 0;
+        }
+
+        const char* data;
+        size_t size;
+        if (viewer.pendingOffset < viewer.pending.size()) {
+            data = viewer.pending.data() + viewer.pendingOffset;
+            size = viewer.pending.size() - viewer.pendingOffset;
+        } else {
+            const std::string& header = viewer.frame->header;
+            const std::string& jpeg = *viewer.frame->jpeg;
+            size_t offset = viewer.frameOffset;
+            if (offset < header.size()) {
+                data = header.data() + offset;
+                size = header.size() - offset;
+            } else if ((offset -= header.size()) < jpeg.size()) {
+                data = jpeg.data() + offset;
+                size = jpeg.size() - offset;
+            } else {
+                offset -= jpeg.size();
+                data = kPartEnd + offset;
+                size = 2 - offset;
+            }
+        }
+
+        auto sent = send(viewer.socket, data, static_cast<int>(std::min<size_t>(size, INT_MAX)), kSendFlags);
+        if (sent < 0) {
+            if (interrupted()) continue;
+            return wouldBlock();
+        }
+        viewer.lastProgress = Clock::now();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.bytesSent += static_cast<uint64_t>(sent);
+        if (viewer.pendingOffset < viewer.pending.size()) {
+            viewer.pendingOffset += static_cast<size_t>(sent);
+            if (viewer.pendingOffset == viewer.pending.size()) {
+                viewer.pending.clear();
+                viewer.pendingOffset = 0;
+            }
+        } else {
+            viewer.frameOffset += static_cast<size_t>(sent);
+            if (viewer.frameOffset == viewer.frame->header.size() + viewer.frame->jpeg->size() + 2) {
+                viewer.frame.reset();
+                m_stats.framesSent++;
+            }
+        }
+    }
+}
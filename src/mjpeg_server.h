@@ -0,0 +1,84 @@
+#ifndef MJPEG_SERVER_H
+#define MJPEG_SERVER_H
+
+#include <string>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+struct MjpegServerStats {
+    size_t viewers;             // Connected to a stream now
+    uint64_t connections;       // Accepted so far
+    uint64_t framesPublished;
+    uint64_t framesSent;        // Whole frames written to viewers
+    uint64_t framesSkipped;     // Replaced by a newer frame before a slow viewer got to them
+    uint64_t bytesSent;
+    uint64_t viewersDropped;    // Closed after making no progress for too long
+};
+
+// Serves each stream's latest JPEG to browsers as multipart/x-mixed-replace
+// over HTTP, at /stream/<id>, with an index of streams at /. A frame is
+// published once and every viewer sends from the same bytes, so viewers add
+// no encoding. A viewer still sending when newer frames arrive skips to the
+// newest one when it finishes, so a slow client never queues stale frames
+// and never holds up the others. One thread serves every connection with
+// non-blocking sockets, through epoll on Linux.
+class MjpegServer {
+public:
+    MjpegServer();
+    ~MjpegServer();
+
+    MjpegServer(const MjpegServer&) = delete;
+    MjpegServer& operator=(const MjpegServer&) = delete;
+
+    // Port 0 picks a free port. Loopback by default: frames are not for the network.
+    bool start(int port, const std::string& host = "127.0.0.1");
+    void stop();
+    bool isRunning() const;
+    int getPort() const;
+
+    // From any thread. The bytes are shared with the viewers, not copied.
+    void publish(int streamId, std::shared_ptr<const std::string> jpeg);
+
+    // Drops the stream from the index; its viewers wait for the next frame
+    void removeStream(int streamId);
+
+    // Lets a producer skip encoding when nobody is watching
+    size_t getViewerCount(int streamId) const;
+
+    MjpegServerStats getStats() const;
+
+private:
+#ifdef _WIN32
+    using Socket = uintptr_t;
+#else
+    using Socket = int;
+#endif
+    struct Frame;
+    struct Viewer;
+    class Poller;
+
+    void serveLoop();
+    void acceptViewers(std::map<Socket, Viewer>& viewers);
+    // False when the connection should be closed
+    bool readFromViewer(Viewer& viewer);
+    bool sendToViewer(Viewer& viewer);
+    void handleRequest(Viewer& viewer);
+
+    std::unique_ptr<Poller> m_poller;
+    Socket m_listenSocket;
+    int m_port;
+    std::atomic<bool> m_running;
+    std::thread m_thread;
+
+    mutable std::mutex m_mutex;
+    std::map<int, std::shared_ptr<const Frame>> m_latest;
+    std::map<int, uint64_t> m_sequences;    // Kept when a stream is removed, so viewers see it move on
+    std::map<int, size_t> m_viewerCounts;
+    MjpegServerStats m_stats;
+};
+
+#endif // MJPEG_SERVER_H
@@ -0,0 +1,103 @@
+#include "process_stats.h"
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+#else
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+ProcessStats sampleProcessStats()
+{
+    ProcessStats stats = ProcessStats();
+    HANDLE process = GetCurrentProcess();
+
+    PROCESS_MEMORY_COUNTERS memory;
+    if (!GetProcessMemoryInfo(process, &memory, sizeof(memory))) {
+        return stats;
+    }
+    DWORD handles = 0;
+    GetProcessHandleCount(process, &handles);
+
+    // Threads are only listed system-wide; count the ones owned by this process
+    DWORD processId = GetCurrentProcessId();
+    size_t threads = 0;
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (snapshot != INVALID_HANDLE_VALUE) {
+        THREADENTRY32 entry;
+        entry.dwSize = sizeof(entry);
+        for (BOOL more = Thread32First(snapshot, &entry); more; more = Thread32Next(snapshot, &entry)) {
+            if (entry.th32OwnerProcessID == processId) {
+                threads++;
+            }
+        }
+        CloseHandle(snapshot);
+    }
+
+    stats.valid = true;
+    stats.residentBytes = memory.WorkingSetSize;
+    stats.openHandles = handles;
+    stats.threads = threads;
+    return stats;
+}
+
+#else
+
+ProcessStats sampleProcessStats()
+{
+    ProcessStats stats = ProcessStats();
+
+    // statm: total and resident pages
+    std::ifstream statm("/proc/self/statm");
+    uint64_t totalPages = 0;
+    uint64_t residentPages = 0;
+    if (!(statm >> totalPages >> residentPages)) {
+        return stats;
+    }
+
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 8, "Threads:") == 0) {
+            std::istringstream(line.substr(8)) >> stats.threads;
+            break;
+        }
+    }
+
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it("/proc/self/fd", ec), end; !ec && it != end; it.increment(ec)) {
+        stats.openHandles++;
+    }
+    // The iterator's own descriptor was open while counting
+    if (stats.openHandles > 0) {
+        stats.openHandles--;
+    }
+
+    stats.valid = true;
+    stats.residentBytes = residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    return stats;
+}
+
+#endif
+
+uint64_t directorySize(const std::string& path)
+{
+    uint64_t bytes = 0;
+    std::error_code ec;
+    for (std::filesystem::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code sizeEc;
+        if (it->is_regular_file(sizeEc)) {
+            uint64_t size = it->file_size(sizeEc);
+            if (!sizeEc) {
+                bytes += size;
+            }
+        }
+    }
+    return bytes;
+}
@@ -0,0 +1,21 @@
+#ifndef PROCESS_STATS_H
+#define PROCESS_STATS_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Resources held by this process at one moment; what slowly leaks shows up here
+struct ProcessStats {
+    bool valid;                 // False where the platform offers no way to read them
+    uint64_t residentBytes;     // Resident set (working set on Windows)
+    size_t openHandles;         // File descriptors, or kernel handles on Windows
+    size_t threads;
+};
+
+ProcessStats sampleProcessStats();
+
+// Total size of the regular files below path; 0 when it does not exist
+uint64_t directorySize(const std::string& path);
+
+#endif // PROCESS_STATS_H
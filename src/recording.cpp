@@ -0,0 +1,341 @@
+#include "recording.h"
+#include <cstring>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+
+namespace {
+const char kRecordingMagic[8] = {'Y', 'O', 'L', 'O', 'R', 'E', 'C', '1'};
+const uint32_t kRecordingVersion = 1;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct RecordHeader {
+    uint32_t type;
+    int32_t streamId;
+    uint64_t sequence;
+    int64_t timestampUs;
+    uint32_t payloadBytes;
+    uint32_t reserved;
+};
+
+class ByteWriter {
+public:
+    template <typename T>
+    void put(const T& value)
+    {
+        m_bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void putString(const std::string& value)
+    {
+        put(static_cast<uint32_t>(value.size()));
+        m_bytes.append(value);
+    }
+
+    const std::string& bytes() const { return m_bytes; }
+
+private:
+    std::string m_bytes;
+};
+
+class ByteReader {
+public:
+    explicit ByteReader(const std::string& bytes) : m_bytes(bytes), m_pos(0), m_ok(true) {}
+
+    template <typename T>
+    T get()
+    {
+        T value = T();
+        if (m_pos + sizeof(T) > m_bytes.size()) {
+            m_ok = false;
+            return value;
+        }
+        std::memcpy(&value, m_bytes.data() + m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return value;
+    }
+
+    std::string getString()
+    {
+        uint32_t size = get<uint32_t>();
+        if (!m_ok || m_pos + size > m_bytes.size()) {
+            m_ok = false;
+            return std::string();
+        }
+        std::string value = m_bytes.substr(m_pos, size);
+        m_pos += size;
+        return value;
+    }
+
+    bool ok() const { return m_ok; }
+
+private:
+    const std::string& m_bytes;
+    size_t m_pos;
+    bool m_ok;
+};
+
+std::string encodeResult(const DetectionResult& result)
+{
+    ByteWriter writer;
+    writer.put<uint8_t>(result.success ? 1 : 0);
+    writer.put<int32_t>(result.processingTime);
+    writer.put<int32_t>(result.modelLoadTime);
+    writer.putString(result.errorMessage);
+
+    const LetterboxTransform& lb = result.letterbox;
+    writer.put<int32_t>(lb.sourceWidth);
+    writer.put<int32_t>(lb.sourceHeight);
+    writer.put<int32_t>(lb.inputWidth);
+    writer.put<int32_t>(lb.inputHeight);
+    writer.put<double>(lb.scaleX);
+    writer.put<double>(lb.scaleY);
+    writer.put<double>(lb.padX);
+    writer.put<double>(lb.padY);
+
+    writer.put<uint32_t>(static_cast<uint32_t>(result.detections.size()));
+    for (const Detection& detection : result.detections) {
+        writer.putString(detection.className);
+        writer.put<int32_t>(detection.classId);
+        writer.put<double>(detection.confidence);
+        writer.put<int32_t>(detection.bbox.x);
+        writer.put<int32_t>(detection.bbox.y);
+        writer.put<int32_t>(detection.bbox.width);
+        writer.put<int32_t>(detection.bbox.height);
+    }
+    return writer.bytes();
+}
+
+bool decodeResult(const std::string& bytes, int streamId, DetectionResult& result)
+{
+    ByteReader reader(bytes);
+    result = DetectionResult();
+    result.streamId = streamId;
+    result.success = reader.get<uint8_t>() != 0;
+    result.processingTime = reader.get<int32_t>();
+    result.modelLoadTime = reader.get<int32_t>();
+    result.errorMessage = reader.getString();
+
+    LetterboxTransform& lb = result.letterbox;
+    lb.sourceWidth = reader.get<int32_t>();
+    lb.sourceHeight = reader.get<int32_t>();
+    lb.inputWidth = reader.get<int32_t>();
+    lb.inputHeight = reader.get<int32_t>();
+    lb.scaleX = reader.get<double>();
+    lb.scaleY = reader.get<double>();
+    lb.padX = reader.get<double>();
+    lb.padY = reader.get<double>();
+
+    uint32_t count = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < count && reader.ok(); ++i) {
+        Detection detection;
+        detection.className = reader.getString();
+        detection.classId = reader.get<int32_t>();
+        detection.confidence = reader.get<double>();
+        detection.bbox.x = reader.get<int32_t>();
+        detection.bbox.y = reader.get<int32_t>();
+        detection.bbox.width = reader.get<int32_t>();
+        detection.bbox.height = reader.get<int32_t>();
+        result.detections.push_back(detection);
+    }
+    return reader.ok();
+}
+}
+
+RecordingWriter::RecordingWriter()
+    : m_frames(0)
+    , m_results(0)
+{
+}
+
+RecordingWriter::~RecordingWriter()
+{
+    close();
+}
+
+bool RecordingWriter::open(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file) {
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, kRecordingMagic, sizeof(kRecordingMagic));
+    header.version = kRecordingVersion;
+    header.reserved = 0;
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    m_start = std::chrono::steady_clock::now();
+    m_frames = 0;
+    m_results = 0;
+    return static_cast<bool>(m_file);
+}
+
+void RecordingWriter::close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+}
+
+bool RecordingWriter::isOpen() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_file.is_open();
+}
+
+bool RecordingWriter::writeFrame(int streamId, uint64_t sequence, const std::string& imageBytes)
+{
+    return writeRecord(RecordType::Frame, streamId, sequence, imageBytes);
+}
+
+bool RecordingWriter::writeFrameFile(int streamId, uint64_t sequence, const std::string& imagePath)
+{
+    std::ifstream image(imagePath, std::ios::binary);
+    if (!image) {
+        return false;
+    }
+    std::string bytes((std::istreambuf_iterator<char>(image)), std::istreambuf_iterator<char>());
+    return writeFrame(streamId, sequence, bytes);
+}
+
+bool RecordingWriter::writeResult(int streamId, uint64_t sequence, const DetectionResult& result)
+{
+    return writeRecord(RecordType::Result, streamId, sequence, encodeResult(result));
+}
+
+bool RecordingWriter::writeRecord(RecordType type, int streamId, uint64_t sequence, const std::string& payload)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.is_open()) {
+        return false;
+    }
+
+    RecordHeader header;
+    header.type = static_cast<uint32_t>(type);
+    header.streamId = streamId;
+    header.sequence = sequence;
+    header.timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - m_start).count();
+    header.payloadBytes = static_cast<uint32_t>(payload.size());
+    header.reserved = 0;
+
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    if (!m_file) {
+        return false;
+    }
+    (type == RecordType::Frame ? m_frames : m_results)++;
+    return true;
+}
+
+uint64_t RecordingWriter::getFrameCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_frames;
+}
+
+uint64_t RecordingWriter::getResultCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_results;
+}
+
+std::shared_ptr<Recording> Recording::open(const std::string& path, std::string* error)
+{
+    auto fail = [error](const std::string& message) {
+        if (error) *error = message;
+        return std::shared_ptr<Recording>();
+    };
+
+    std::shared_ptr<Recording> recording(new Recording());
+    recording->m_path = path;
+    recording->m_file.open(path, std::ios::binary);
+    if (!recording->m_file) {
+        return fail("Cannot open recording " + path);
+    }
+
+    FileHeader header;
+    if (!recording->m_file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, kRecordingMagic, sizeof(kRecordingMagic)) != 0) {
+        return fail("Not a recording: " + path);
+    }
+    if (header.version != kRecordingVersion) {
+        return fail("Unsupported recording version " + std::to_string(header.version));
+    }
+
+    // Index frames by position; results are small and decoded up front.
+    // A truncated last record (recorder killed mid-write) ends the scan.
+    std::ifstream& file = recording->m_file;
+    std::error_code ec;
+    uint64_t fileSize = std::filesystem::file_size(path, ec);
+    RecordHeader record;
+    while (file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        uint64_t offset = static_cast<uint64_t>(file.tellg());
+        if (offset + record.payloadBytes > fileSize) {
+            break;
+        }
+        if (record.type == static_cast<uint32_t>(RecordType::Frame)) {
+            file.seekg(record.payloadBytes, std::ios::cur);
+            recording->m_frames[record.streamId].push_back(
+                {record.streamId, record.sequence, record.timestampUs, offset, record.payloadBytes});
+            recording->m_frameCount++;
+        } else {
+            std::string payload(record.payloadBytes, '\0');
+            if (!file.read(&payload[0], record.payloadBytes)) {
+                break;
+            }
+            DetectionResult result;
+            if (record.type == static_cast<uint32_t>(RecordType::Result) &&
+                decodeResult(payload, record.streamId, result)) {
+                recording->m_results[{record.streamId, record.sequence}] = result;
+            }
+        }
+        recording->m_durationUs = std::max(recording->m_durationUs, record.timestampUs);
+    }
+    file.clear();
+    return recording;
+}
+
+std::vector<int> Recording::getStreamIds() const
+{
+    std::vector<int> ids;
+    for (const auto& entry : m_frames) {
+        ids.push_back(entry.first);
+    }
+    return ids;
+}
+
+const std::vector<RecordedFrame>& Recording::getFrames(int streamId) const
+{
+    static const std::vector<RecordedFrame> kNoFrames;
+    auto it = m_frames.find(streamId);
+    return it == m_frames.end() ? kNoFrames : it->second;
+}
+
+bool Recording::readFrame(const RecordedFrame& frame, std::string& imageBytes) const
+{
+    std::lock_guard<std::mutex> lock(m_readMutex);
+    imageBytes.resize(frame.bytes);
+    m_file.clear();
+    m_file.seekg(static_cast<std::streamoff>(frame.offset));
+    return frame.bytes == 0 || static_cast<bool>(m_file.read(&imageBytes[0], frame.bytes));
+}
+
+const DetectionResult* Recording::findResult(int streamId, uint64_t sequence) const
+{
+    auto it = m_results.find({streamId, sequence});
+    return it == m_results.end() ? nullptr : &it->second;
+}
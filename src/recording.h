@@ -0,0 +1,95 @@
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <cstdint>
+#include "detection_client.h"
+
+// A recording is one container file holding the raw frames of every stream
+// and the detection result produced for each of them, in arrival order:
+//
+//   file header | record header + payload | record header + payload | ...
+//
+// Frame payloads are the encoded image bytes exactly as captured; result
+// payloads are a compact binary DetectionResult. A result refers to its
+// frame by (stream, sequence). Integers are stored in host byte order.
+
+enum class RecordType : uint32_t {
+    Frame = 1,
+    Result = 2,
+};
+
+struct RecordedFrame {
+    int streamId;
+    uint64_t sequence;
+    int64_t timestampUs;    // Since the start of the recording
+    uint64_t offset;        // Payload position in the file
+    uint32_t bytes;
+};
+
+// Appends frames and results from any thread
+class RecordingWriter {
+public:
+    RecordingWriter();
+    ~RecordingWriter();
+
+    RecordingWriter(const RecordingWriter&) = delete;
+    RecordingWriter& operator=(const RecordingWriter&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    bool writeFrame(int streamId, uint64_t sequence, const std::string& imageBytes);
+    // Reads the frame from disk, e.g. a leased frame slot
+    bool writeFrameFile(int streamId, uint64_t sequence, const std::string& imagePath);
+    bool writeResult(int streamId, uint64_t sequence, const DetectionResult& result);
+
+    uint64_t getFrameCount() const;
+    uint64_t getResultCount() const;
+
+private:
+    bool writeRecord(RecordType type, int streamId, uint64_t sequence, const std::string& payload);
+
+    mutable std::mutex m_mutex;
+    std::ofstream m_file;
+    std::chrono::steady_clock::time_point m_start;
+    uint64_t m_frames;
+    uint64_t m_results;
+};
+
+// Read side: indexes a recording once, then serves frames and results
+class Recording {
+public:
+    static std::shared_ptr<Recording> open(const std::string& path, std::string* error = nullptr);
+
+    std::vector<int> getStreamIds() const;
+    // Frames of one stream in capture order
+    const std::vector<RecordedFrame>& getFrames(int streamId) const;
+    bool readFrame(const RecordedFrame& frame, std::string& imageBytes) const;
+    // Result recorded for a frame; nullptr if the frame was never answered
+    const DetectionResult* findResult(int streamId, uint64_t sequence) const;
+
+    uint64_t getFrameCount() const { return m_frameCount; }
+    uint64_t getResultCount() const { return m_results.size(); }
+    int64_t getDurationUs() const { return m_durationUs; }
+
+private:
+    Recording() : m_frameCount(0), m_durationUs(0) {}
+
+    std::string m_path;
+    mutable std::mutex m_readMutex;
+    mutable std::ifstream m_file;
+    std::map<int, std::vector<RecordedFrame>> m_frames;
+    std::map<std::pair<int, uint64_t>, DetectionResult> m_results;
+    uint64_t m_frameCount;
+    int64_t m_durationUs;
+};
+
+#endif // RECORDING_H
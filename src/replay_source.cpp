@@ -0,0 +1,220 @@
+#include "replay_source.h"
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+namespace {
+// Same slot layout as a live camera
+const size_t kFrameSlots = 4;
+const uint64_t kFrameByteBudget = 64ull * 1024 * 1024;
+// Polling interval while waiting for a free slot at maximum speed
+const auto kSlotRetryInterval = std::chrono::milliseconds(1);
+}
+
+ReplaySource::ReplaySource(std::shared_ptr<const Recording> recording, int streamId, const std::string& frameDirectory)
+    : m_recording(recording)
+    , m_streamId(streamId)
+    , m_framePool(frameDirectory, kFrameSlots, kFrameByteBudget)
+    , m_speed(1.0)
+    , m_isReplaying(false)
+    , m_stopRequested(false)
+    , m_stats()
+{
+}
+
+ReplaySource::~ReplaySource()
+{
+    stopReplay();
+}
+
+void ReplaySource::startReplay(FrameCallback onFrame, ErrorCallback onError, FinishedCallback onFinished)
+{
+    if (m_isReplaying) {
+        return;
+    }
+    if (m_replayThread.joinable()) {
+        m_replayThread.join();
+    }
+
+    m_frameCallback = onFrame;
+    m_errorCallback = onError;
+    m_finishedCallback = onFinished;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopRequested = false;
+        m_stats = ReplayStats();
+        m_stats.total = m_recording->getFrames(m_streamId).size();
+    }
+    m_isReplaying = true;
+    m_replayThread = std::thread(&ReplaySource::replayLoop, this);
+}
+
+void ReplaySource::stopReplay()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopRequested = true;
+    }
+    m_wakeup.notify_all();
+    if (m_replayThread.joinable()) {
+        m_replayThread.join();
+    }
+}
+
+void ReplaySource::waitUntilFinished()
+{
+    if (m_replayThread.joinable()) {
+        m_replayThread.join();
+    }
+}
+
+bool ReplaySource::waitUntil(std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_wakeup.wait_until(lock, deadline, [this]() { return m_stopRequested; });
+    return !m_stopRequested;
+}
+
+void ReplaySource::replayLoop()
+{
+    const std::vector<RecordedFrame>& frames = m_recording->getFrames(m_streamId);
+    auto start = std::chrono::steady_clock::now();
+    int64_t firstTimestampUs = frames.empty() ? 0 : frames.front().timestampUs;
+    std::string imageBytes;
+
+    for (const RecordedFrame& frame : frames) {
+        double speed = m_speed;
+        if (speed > 0.0) {
+            // Absolute deadlines from the recording, so slow callbacks do not accumulate drift
+            auto offset = std::chrono::duration<double, std::micro>((frame.timestampUs - firstTimestampUs) / speed);
+            if (!waitUntil(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset))) {
+                break;
+            }
+        } else if (!waitUntil(std::chrono::steady_clock::now())) {
+            break;
+        }
+
+        // At recorded speed a busy pool skips the frame, as a live camera would;
+        // at maximum speed replay waits so every frame is delivered
+        FrameLease lease = m_framePool.acquire();
+        while (!lease && speed <= 0.0 && waitUntil(std::chrono::steady_clock::now() + kSlotRetryInterval)) {
+            lease = m_framePool.acquire();
+        }
+        if (!lease) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stopRequested) {
+                break;
+            }
+            m_stats.skipped++;
+            continue;
+        }
+
+        bool written = m_recording->readFrame(frame, imageBytes);
+        if (written) {
+            std::ofstream slot(lease->path, std::ios::binary | std::ios::trunc);
+            slot.write(imageBytes.data(), static_cast<std::streamsize>(imageBytes.size()));
+            written = static_cast<bool>(slot);
+        }
+        if (!written) {
+            if (m_errorCallback) {
+                m_errorCallback("Replay could not restore frame " + std::to_string(frame.sequence) +
+                                " of stream " + std::to_string(m_streamId));
+            }
+            break;
+        }
+        m_framePool.commit(lease);
+
+        if (m_frameCallback) {
+            m_frameCallback(lease);
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.delivered++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    m_isReplaying = false;
+    if (m_finishedCallback) {
+        m_finishedCallback();
+    }
+}
+
+ReplayStats ReplaySource::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+ReplayBackend::ReplayBackend(std::shared_ptr<const Recording> recording, bool simulateLatency)
+    : m_recording(recording)
+    , m_simulateLatency(simulateLatency)
+    , m_stats()
+{
+    // Index recorded results by the content of the frame they answered
+    std::string imageBytes;
+    for (int streamId : recording->getStreamIds()) {
+        for (const RecordedFrame& frame : recording->getFrames(streamId)) {
+            const DetectionResult* result = recording->findResult(streamId, frame.sequence);
+            if (result && recording->readFrame(frame, imageBytes)) {
+                m_resultsByContent[hashContent(imageBytes)] = result;
+            }
+        }
+    }
+}
+
+uint64_t ReplayBackend::hashContent(const std::string& bytes)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : bytes) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::vector<DetectionResult> ReplayBackend::runBatch(int workerIndex, const std::vector<DetectionRequest>& batch)
+{
+    (void)workerIndex;
+    std::vector<DetectionResult> results;
+    results.reserve(batch.size());
+    int batchTimeMs = 0;
+    uint64_t hits = 0;
+
+    for (const DetectionRequest& request : batch) {
+        std::ifstream image(request.imagePath, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(image)), std::istreambuf_iterator<char>());
+
+        auto it = m_resultsByContent.find(hashContent(bytes));
+        if (it == m_resultsByContent.end()) {
+            DetectionResult missing;
+            missing.success = false;
+            missing.processingTime = 0;
+            missing.errorMessage = "No recorded result for " + request.imagePath;
+            results.push_back(missing);
+            continue;
+        }
+
+        // Recorded times are per batch, so the longest one stands for this batch
+        results.push_back(*it->second);
+        batchTimeMs = std::max(batchTimeMs, it->second->processingTime);
+        hits++;
+    }
+
+    if (m_simulateLatency && batchTimeMs > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(batchTimeMs));
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.hits += hits;
+    m_stats.misses += batch.size() - hits;
+    return results;
+}
+
+ReplayBackendStats ReplayBackend::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
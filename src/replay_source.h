@@ -0,0 +1,102 @@
+#ifndef REPLAY_SOURCE_H
+#define REPLAY_SOURCE_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include <cstdint>
+#include "frame_pool.h"
+#include "recording.h"
+
+struct ReplayStats {
+    uint64_t total;         // Frames of the stream in the recording
+    uint64_t delivered;
+    uint64_t skipped;       // No free frame slot at recorded speed
+    double elapsedSeconds;
+};
+
+// Feeds one recorded stream back through the same callback interface as
+// WebcamCapture: each frame is written into a leased frame slot and handed
+// to the frame callback.
+class ReplaySource {
+public:
+    using FrameCallback = std::function<void(const FrameLease& frame)>;
+    using ErrorCallback = std::function<void(const std::string& error)>;
+    using FinishedCallback = std::function<void()>;
+
+    ReplaySource(std::shared_ptr<const Recording> recording, int streamId, const std::string& frameDirectory);
+    ~ReplaySource();
+
+    ReplaySource(const ReplaySource&) = delete;
+    ReplaySource& operator=(const ReplaySource&) = delete;
+
+    // 1.0 keeps the recorded timing, 2.0 plays twice as fast. 0 delivers as
+    // fast as consumers release frame slots and never skips a frame.
+    void setSpeed(double speed) { m_speed = speed; }
+    double getSpeed() const { return m_speed; }
+
+    void startReplay(FrameCallback onFrame, ErrorCallback onError, FinishedCallback onFinished = nullptr);
+    void stopReplay();
+    // Blocks until every frame was delivered or the replay was stopped
+    void waitUntilFinished();
+    bool isReplaying() const { return m_isReplaying; }
+
+    int getStreamId() const { return m_streamId; }
+    ReplayStats getStats() const;
+    FramePoolStats getFramePoolStats() const { return m_framePool.getStats(); }
+
+private:
+    void replayLoop();
+    bool waitUntil(std::chrono::steady_clock::time_point deadline);
+
+    std::shared_ptr<const Recording> m_recording;
+    int m_streamId;
+    FramePool m_framePool;
+    std::atomic<double> m_speed;
+
+    FrameCallback m_frameCallback;
+    ErrorCallback m_errorCallback;
+    FinishedCallback m_finishedCallback;
+    std::thread m_replayThread;
+    std::atomic<bool> m_isReplaying;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    bool m_stopRequested;
+    ReplayStats m_stats;
+};
+
+struct ReplayBackendStats {
+    uint64_t hits;
+    uint64_t misses;    // Frame content not found in the recording
+};
+
+// Stands in for the detection workers during replay: answers each request
+// with the result recorded for the same frame, matched by frame content.
+// Usable directly as a DetectionScheduler::BatchExecutor.
+class ReplayBackend {
+public:
+    // With simulateLatency each batch takes as long as it did when recorded
+    ReplayBackend(std::shared_ptr<const Recording> recording, bool simulateLatency);
+
+    std::vector<DetectionResult> runBatch(int workerIndex, const std::vector<DetectionRequest>& batch);
+    ReplayBackendStats getStats() const;
+
+    static uint64_t hashContent(const std::string& bytes);
+
+private:
+    std::shared_ptr<const Recording> m_recording;
+    bool m_simulateLatency;
+    std::unordered_map<uint64_t, const DetectionResult*> m_resultsByContent;
+
+    mutable std::mutex m_mutex;
+    ReplayBackendStats m_stats;
+};
+
+#endif // REPLAY_SOURCE_H
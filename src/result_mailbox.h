@@ -0,0 +1,75 @@
+#ifndef RESULT_MAILBOX_H
+#define RESULT_MAILBOX_H
+
+#include <mutex>
+#include <cstdint>
+#include <utility>
+
+struct MailboxStats {
+    uint64_t posted;
+    uint64_t delivered;
+    uint64_t coalesced;     // Replaced by a newer value before anyone took them
+};
+
+// Single-slot, latest-wins handoff from worker threads to the UI thread.
+// Producers never block on the consumer: posting over an untaken value
+// replaces it, so a reader polling at display rate only ever renders the
+// newest state and bursts cost one render instead of one per value.
+template <typename T>
+class LatestMailbox {
+public:
+    LatestMailbox() : m_hasValue(false), m_posted(0), m_delivered(0), m_coalesced(0) {}
+
+    LatestMailbox(const LatestMailbox&) = delete;
+    LatestMailbox& operator=(const LatestMailbox&) = delete;
+
+    void post(T value)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_hasValue) {
+                m_coalesced++;
+            }
+            std::swap(m_value, value);
+            m_hasValue = true;
+            m_posted++;
+        }
+        // value now holds whatever was replaced; it is destroyed after the lock is released
+    }
+
+    // Moves the pending value into out; false when nothing new was posted
+    bool take(T& out)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_hasValue) {
+            return false;
+        }
+        out = std::move(m_value);
+        m_value = T();
+        m_hasValue = false;
+        m_delivered++;
+        return true;
+    }
+
+    bool hasValue() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_hasValue;
+    }
+
+    MailboxStats getStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return {m_posted, m_delivered, m_coalesced};
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    T m_value;
+    bool m_hasValue;
+    uint64_t m_posted;
+    uint64_t m_delivered;
+    uint64_t m_coalesced;
+};
+
+#endif // RESULT_MAILBOX_H
@@ -0,0 +1,244 @@
+#include "roi_executor.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Crops are inferred at a size proportional to the frame's; this keeps tiny ones usable
+const int kMinCropInputSize = 64;
+
+bool hasArea(const BoundingBox& box)
+{
+    return box.width > 0 && box.height > 0;
+}
+
+// Input size for a crop so that its pixels are scaled as the full frame's would be
+int cropInferenceSize(int frameInferenceSize, const BoundingBox& crop, int frameWidth, int frameHeight)
+{
+    if (frameInferenceSize == kInferenceSizeAuto) {
+        return kInferenceSizeAuto;   // The worker fits the standard size to the crop
+    }
+    double share = static_cast<double>(std::max(crop.width, crop.height)) / std::max(frameWidth, frameHeight);
+    return std::max(kMinCropInputSize, static_cast<int>(std::ceil(frameInferenceSize * share)));
+}
+
+DetectionResult failedResult(const std::string& message)
+{
+    DetectionResult result;
+    result.success = false;
+    result.processingTime = 0;
+    result.errorMessage = message;
+    return result;
+}
+}
+
+RoiExecutor::RoiExecutor(DetectionScheduler::BatchExecutor inner)
+    : m_inner(std::move(inner))
+{
+}
+
+void RoiExecutor::setMask(int streamId, const RoiMask& mask)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (mask.isEmpty()) {
+        m_streams.erase(streamId);
+        return;
+    }
+    Stream stream = Stream();
+    stream.mask = mask;
+    m_streams[streamId] = stream;
+}
+
+void RoiExecutor::clearMasks()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_streams.clear();
+}
+
+std::vector<DetectionResult> RoiExecutor::runBatch(int workerIndex, const std::vector<DetectionRequest>& requests)
+{
+    // Each request becomes one inner request, or one per crop
+    struct Plan {
+        bool masked;
+        bool cropped;
+        RoiMask mask;
+        int frameWidth;
+        int frameHeight;
+        size_t first;
+        size_t count;
+    };
+    std::vector<Plan> plans(requests.size());
+    std::vector<DetectionRequest> inner;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_streams.empty()) {
+            return m_inner(workerIndex, requests);
+        }
+
+        for (size_t i = 0; i < requests.size(); ++i) {
+            const DetectionRequest& request = requests[i];
+            Plan& plan = plans[i];
+            plan.masked = false;
+            plan.cropped = false;
+            plan.first = inner.size();
+            plan.count = 1;
+
+            auto it = m_streams.find(request.streamId);
+            if (it == m_streams.end()) {
+                inner.push_back(request);
+                continue;
+            }
+            Stream& stream = it->second;
+            plan.masked = true;
+            plan.mask = stream.mask;
+            plan.frameWidth = stream.frameWidth;
+            plan.frameHeight = stream.frameHeight;
+            stream.frames++;
+
+            // A request that already names a region (a cascade escalation) is left as it is
+            std::vector<BoundingBox> crops;
+            if (stream.frameWidth > 0 && !hasArea(request.crop)) {
+                crops = stream.mask.cropRegions(stream.frameWidth, stream.frameHeight);
+            }
+            double frameArea = stream.frameWidth > 0 ? static_cast<double>(stream.frameWidth) * stream.frameHeight : 0.0;
+            if (crops.empty()) {
+                inner.push_back(request);
+                stream.inferredAreaSum += hasArea(request.crop) && frameArea > 0.0
+                    ? request.crop.width * static_cast<double>(request.crop.height) / frameArea : 1.0;
+                continue;
+            }
+
+            plan.cropped = true;
+            plan.count = crops.size();
+            stream.croppedFrames++;
+            stream.crops += crops.size();
+            for (const BoundingBox& crop : crops) {
+                DetectionRequest cropRequest = request;
+                cropRequest.crop = crop;
+                cropRequest.inferenceSize = cropInferenceSize(request.inferenceSize, crop, stream.frameWidth,
+                                                              stream.frameHeight);
+                inner.push_back(cropRequest);
+                stream.inferredAreaSum += crop.width * static_cast<double>(crop.height) / frameArea;
+            }
+        }
+    }
+
+    std::vector<DetectionResult> innerResults = m_inner(workerIndex, inner);
+    if (innerResults.size() != inner.size()) {
+        return std::vector<DetectionResult>(requests.size(), failedResult(
+            "Worker returned " + std::to_string(innerResults.size()) + " results for " +
+            std::to_string(inner.size()) + " regions"));
+    }
+
+    std::vector<DetectionResult> results;
+    results.reserve(requests.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const Plan& plan = plans[i];
+        if (!plan.cropped) {
+            results.push_back(std::move(innerResults[plan.first]));
+        } else {
+            // Any failed crop fails the frame; a partial view would look like an empty scene
+            auto begin = innerResults.begin() + plan.first;
+            auto end = begin + plan.count;
+            auto failed = std::find_if(begin, end, [](const DetectionResult& crop) { return !crop.success; });
+            if (failed != end) {
+                results.push_back(*failed);
+                continue;
+            }
+
+            // Crops of neighbouring regions can overlap; one box per object
+            DetectionResult merged = *begin;
+            merged.detections.clear();
+            // Boxes are in frame pixels; the result describes the whole frame,
+            // at the scale the crops were inferred at, not the first crop
+            merged.letterbox = LetterboxTransform();
+            merged.letterbox.sourceWidth = plan.frameWidth;
+            merged.letterbox.sourceHeight = plan.frameHeight;
+            merged.letterbox.inputWidth = begin->letterbox.inputWidth;
+            merged.letterbox.inputHeight = begin->letterbox.inputHeight;
+            merged.letterbox.scaleX = begin->letterbox.scaleX;
+            merged.letterbox.scaleY = begin->letterbox.scaleY;
+            for (auto crop = begin; crop != end; ++crop) {
+                merged.processingTime = std::max(merged.processingTime, crop->processingTime);
+                merged.modelLoadTime = std::max(merged.modelLoadTime, crop->modelLoadTime);
+                for (const Detection& detection : crop->detections) {
+                    auto duplicate = std::find_if(merged.detections.begin(), merged.detections.end(),
+                        [&detection](const Detection& kept) {
+                            return kept.classId == detection.classId &&
+                                   intersectionOverUnion(kept.bbox, detection.bbox) >= 0.5;
+                        });
+                    if (duplicate == merged.detections.end()) {
+                        merged.detections.push_back(detection);
+                    } else if (detection.confidence > duplicate->confidence) {
+                        *duplicate = detection;
+                    }
+                }
+            }
+            results.push_back(std::move(merged));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const Plan& plan = plans[i];
+        DetectionResult& result = results[i];
+        if (!plan.masked || !result.success) {
+            continue;
+        }
+
+        int frameWidth = plan.frameWidth;
+        int frameHeight = plan.frameHeight;
+        auto it = m_streams.find(requests[i].streamId);
+        bool wholeFrame = !plan.cropped && !hasArea(requests[i].crop);
+        if (wholeFrame && result.letterbox.isValid()) {
+            // The full frame's size is what later frames are cropped against
+            frameWidth = result.letterbox.sourceWidth;
+            frameHeight = result.letterbox.sourceHeight;
+            if (it != m_streams.end()) {
+                it->second.frameWidth = frameWidth;
+                it->second.frameHeight = frameHeight;
+            }
+        }
+
+        size_t dropped = applyMask(plan.mask, frameWidth, frameHeight, result);
+        if (it != m_streams.end()) {
+            it->second.dropped += dropped;
+        }
+    }
+    return results;
+}
+
+size_t RoiExecutor::applyMask(const RoiMask& mask, int frameWidth, int frameHeight, DetectionResult& result)
+{
+    if (frameWidth <= 0 || frameHeight <= 0) {
+        return 0;
+    }
+
+    size_t before = result.detections.size();
+    result.detections.erase(std::remove_if(result.detections.begin(), result.detections.end(),
+        [&mask, frameWidth, frameHeight](const Detection& detection) {
+            double centerX = (detection.bbox.x + detection.bbox.width / 2.0) / frameWidth;
+            double centerY = (detection.bbox.y + detection.bbox.height / 2.0) / frameHeight;
+            return !mask.contains(centerX, centerY);
+        }),
+        result.detections.end());
+    return before - result.detections.size();
+}
+
+std::vector<RoiStats> RoiExecutor::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<RoiStats> all;
+    for (const auto& entry : m_streams) {
+        const Stream& stream = entry.second;
+        RoiStats stats;
+        stats.streamId = entry.first;
+        stats.regions = stream.mask.getRegionCount();
+        stats.frames = stream.frames;
+        stats.croppedFrames = stream.croppedFrames;
+        stats.crops = stream.crops;
+        stats.dropped = stream.dropped;
+        stats.inferredArea = stream.frames > 0 ? stream.inferredAreaSum / static_cast<double>(stream.frames) : 0.0;
+        all.push_back(stats);
+    }
+    return all;
+}
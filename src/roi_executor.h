@@ -0,0 +1,66 @@
+#ifndef ROI_EXECUTOR_H
+#define ROI_EXECUTOR_H
+
+#include <vector>
+#include <map>
+#include <mutex>
+#include <cstdint>
+#include "detection_scheduler.h"
+#include "roi_mask.h"
+
+struct RoiStats {
+    int streamId;
+    size_t regions;
+    uint64_t frames;
+    uint64_t croppedFrames;     // Inferred as crops of the mask rather than in full
+    uint64_t crops;
+    uint64_t dropped;           // Detections outside the mask
+    double inferredArea;        // Mean fraction of the frame sent to the model
+};
+
+// Restricts inference to per-stream regions of interest. Frames of a stream
+// with a mask are cut into the crops around its regions before they reach
+// the workers, detections whose centre lies outside the mask are dropped,
+// and the crops' detections are merged into one full-frame result. Wraps
+// another BatchExecutor and is itself one.
+//
+// The frame size is learned from the stream's first full-frame result, so
+// that one frame is inferred whole. Input sizes shrink with the crop, which
+// keeps compute proportional to the area of interest.
+class RoiExecutor {
+public:
+    explicit RoiExecutor(DetectionScheduler::BatchExecutor inner);
+
+    RoiExecutor(const RoiExecutor&) = delete;
+    RoiExecutor& operator=(const RoiExecutor&) = delete;
+
+    // An empty mask removes the stream's regions
+    void setMask(int streamId, const RoiMask& mask);
+    void clearMasks();
+
+    std::vector<DetectionResult> runBatch(int workerIndex, const std::vector<DetectionRequest>& requests);
+
+    std::vector<RoiStats> getStats() const;
+
+private:
+    struct Stream {
+        RoiMask mask;
+        int frameWidth;         // 0 until a full-frame result arrived
+        int frameHeight;
+        uint64_t frames;
+        uint64_t croppedFrames;
+        uint64_t crops;
+        uint64_t dropped;
+        double inferredAreaSum;
+    };
+
+    // Keeps the detections inside the mask; returns how many were removed
+    static size_t applyMask(const RoiMask& mask, int frameWidth, int frameHeight, DetectionResult& result);
+
+    DetectionScheduler::BatchExecutor m_inner;
+
+    mutable std::mutex m_mutex;
+    std::map<int, Stream> m_streams;
+};
+
+#endif // ROI_EXECUTOR_H
@@ -0,0 +1,161 @@
+#include "roi_mask.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace {
+// Regions are cropped with some context so objects on their edge are not cut off
+const double kCropMargin = 0.05;
+// Two crops are merged when one rectangle around both is at most this much
+// larger than the two apart; the extra area is cheaper than another inference
+const double kMergeSlack = 1.25;
+
+struct PixelRect {
+    int x1, y1, x2, y2;
+
+    long long area() const { return static_cast<long long>(x2 - x1) * (y2 - y1); }
+    PixelRect unite(const PixelRect& other) const
+    {
+        return {std::min(x1, other.x1), std::min(y1, other.y1), std::max(x2, other.x2), std::max(y2, other.y2)};
+    }
+};
+}
+
+void RoiMask::addRectangle(double x, double y, double width, double height)
+{
+    addPolygon({{x, y}, {x + width, y}, {x + width, y + height}, {x, y + height}});
+}
+
+void RoiMask::addPolygon(const std::vector<RoiPoint>& vertices)
+{
+    if (vertices.size() < 3) {
+        return;
+    }
+
+    Region region;
+    region.vertices = vertices;
+    region.min = vertices[0];
+    region.max = vertices[0];
+    for (const RoiPoint& point : vertices) {
+        region.min.x = std::min(region.min.x, point.x);
+        region.min.y = std::min(region.min.y, point.y);
+        region.max.x = std::max(region.max.x, point.x);
+        region.max.y = std::max(region.max.y, point.y);
+    }
+    m_regions.push_back(std::move(region));
+}
+
+bool RoiMask::contains(double x, double y) const
+{
+    if (m_regions.empty()) {
+        return true;
+    }
+
+    for (const Region& region : m_regions) {
+        if (x < region.min.x || x > region.max.x || y < region.min.y || y > region.max.y) {
+            continue;
+        }
+        // Even-odd ray casting to the right of the point
+        bool inside = false;
+        const std::vector<RoiPoint>& v = region.vertices;
+        for (size_t i = 0, j = v.size() - 1; i < v.size(); j = i++) {
+            if ((v[i].y > y) != (v[j].y > y) &&
+                x < (v[j].x - v[i].x) * (y - v[i].y) / (v[j].y - v[i].y) + v[i].x) {
+                inside = !inside;
+            }
+        }
+        if (inside) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<BoundingBox> RoiMask::cropRegions(int width, int height) const
+{
+    if (m_regions.empty() || width <= 0 || height <= 0) {
+        return {};
+    }
+
+    std::vector<PixelRect> crops;
+    for (const Region& region : m_regions) {
+        double marginX = (region.max.x - region.min.x) * kCropMargin;
+        double marginY = (region.max.y - region.min.y) * kCropMargin;
+        PixelRect rect;
+        rect.x1 = std::clamp(static_cast<int>(std::floor((region.min.x - marginX) * width)), 0, width);
+        rect.y1 = std::clamp(static_cast<int>(std::floor((region.min.y - marginY) * height)), 0, height);
+        rect.x2 = std::clamp(static_cast<int>(std::ceil((region.max.x + marginX) * width)), 0, width);
+        rect.y2 = std::clamp(static_cast<int>(std::ceil((region.max.y + marginY) * height)), 0, height);
+        if (rect.x2 > rect.x1 && rect.y2 > rect.y1) {
+            crops.push_back(rect);
+        }
+    }
+
+    // Greedily merge the pair that wastes the least until no merge pays off
+    while (crops.size() > 1) {
+        size_t bestA = 0;
+        size_t bestB = 0;
+        double bestRatio = kMergeSlack;
+        for (size_t a = 0; a < crops.size(); ++a) {
+            for (size_t b = a + 1; b < crops.size(); ++b) {
+                double separate = static_cast<double>(crops[a].area() + crops[b].area());
+                double ratio = static_cast<double>(crops[a].unite(crops[b]).area()) / separate;
+                if (ratio <= bestRatio) {
+                    bestRatio = ratio;
+                    bestA = a;
+                    bestB = b;
+                }
+            }
+        }
+        if (bestA == bestB) {
+            break;
+        }
+        crops[bestA] = crops[bestA].unite(crops[bestB]);
+        crops.erase(crops.begin() + bestB);
+    }
+
+    std::vector<BoundingBox> boxes;
+    for (const PixelRect& rect : crops) {
+        boxes.push_back({rect.x1, rect.y1, rect.x2 - rect.x1, rect.y2 - rect.y1});
+    }
+    return boxes;
+}
+
+std::map<int, RoiMask> RoiMask::parse(const std::string& text)
+{
+    std::map<int, RoiMask> masks;
+    std::stringstream stream(text);
+    std::string entry;
+    while (std::getline(stream, entry, ';')) {
+        size_t colon = entry.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::stringstream camera(entry.substr(0, colon));
+        int device = -1;
+        if (!(camera >> device) || device < 0) {
+            continue;
+        }
+
+        std::stringstream numbers(entry.substr(colon + 1));
+        std::vector<double> values;
+        double value;
+        while (numbers >> value) {
+            values.push_back(value);
+        }
+        if (!numbers.eof()) {
+            continue;   // Not a number
+        }
+
+        if (values.size() == 4 && values[2] > 0.0 && values[3] > 0.0) {
+            masks[device].addRectangle(values[0], values[1], values[2], values[3]);
+        } else if (values.size() >= 6 && values.size() % 2 == 0) {
+            std::vector<RoiPoint> vertices;
+            for (size_t i = 0; i < values.size(); i += 2) {
+                vertices.push_back({values[i], values[i + 1]});
+            }
+            masks[device].addPolygon(vertices);
+        }
+    }
+    return masks;
+}
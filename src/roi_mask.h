@@ -0,0 +1,50 @@
+#ifndef ROI_MASK_H
+#define ROI_MASK_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include "letterbox.h"
+
+// Point in frame coordinates normalised to [0, 1], so a mask does not depend
+// on the capture resolution
+struct RoiPoint {
+    double x;
+    double y;
+};
+
+// Regions of interest of one camera: rectangles and polygons. An empty mask
+// covers the whole frame.
+class RoiMask {
+public:
+    void addRectangle(double x, double y, double width, double height);
+    // At least three vertices, in order
+    void addPolygon(const std::vector<RoiPoint>& vertices);
+
+    bool isEmpty() const { return m_regions.empty(); }
+    size_t getRegionCount() const { return m_regions.size(); }
+
+    // Whether a normalised point lies in any region
+    bool contains(double x, double y) const;
+
+    // Pixel rectangles to infer for a width x height frame. Regions close
+    // together share one rectangle; distant ones get their own, so the
+    // inferred area follows the regions rather than the span between them.
+    std::vector<BoundingBox> cropRegions(int width, int height) const;
+
+    // "0: 0.1 0.2 0.3 0.4; 1: 0.5 0.5 0.9 0.5 0.7 0.9" keyed by camera: four
+    // numbers are a rectangle (x y width height), six or more an x y polygon.
+    // Malformed entries are skipped.
+    static std::map<int, RoiMask> parse(const std::string& text);
+
+private:
+    struct Region {
+        std::vector<RoiPoint> vertices;
+        RoiPoint min;
+        RoiPoint max;
+    };
+
+    std::vector<Region> m_regions;
+};
+
+#endif // ROI_MASK_H
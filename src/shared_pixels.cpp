@@ -0,0 +1,163 @@
+#include "shared_pixels.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+// Slot files start at this size and at least double when they grow
+const size_t kMinimumSlotBytes = 1 << 20;
+
+std::atomic<int> g_poolCount(0);
+
+int processId()
+{
+#ifdef _WIN32
+    return _getpid();
+#else
+    return static_cast<int>(getpid());
+#endif
+}
+}
+
+struct SharedPixelPool::State {
+    struct Slot {
+        MappedFile file;
+        std::string path;
+        int generation = 0;
+        bool leased = false;
+    };
+
+    std::string prefix;     // Directory and file name stem, unique to the pool
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Slot>> slots;
+    SharedPixelStats stats;
+
+    ~State()
+    {
+        // Leases may outlive the pool, so slot files go away with the last one
+        for (const auto& slot : slots) {
+            slot->file.close();
+            std::error_code ec;
+            std::filesystem::remove(slot->path, ec);
+        }
+    }
+
+    void release(size_t index)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        slots[index]->leased = false;
+        stats.inUse--;
+    }
+};
+
+SharedPixelPool::SharedPixelPool(const std::string& directory, size_t slotCount)
+    : m_state(std::make_shared<State>())
+{
+    std::error_code ec;
+    std::filesystem::path base = directory;
+    if (base.empty()) {
+        base = std::filesystem::is_directory("/dev/shm", ec) ? std::filesystem::path("/dev/shm")
+                                                             : std::filesystem::temp_directory_path(ec);
+    }
+    std::filesystem::create_directories(base, ec);
+    m_state->prefix = (base / ("yolo_pixels_" + std::to_string(processId()) + "_" +
+                               std::to_string(g_poolCount++) + "_")).string();
+    for (size_t i = 0; i < slotCount; ++i) {
+        m_state->slots.push_back(std::make_unique<State::Slot>());
+    }
+    m_state->stats = SharedPixelStats();
+    m_state->stats.slotCount = slotCount;
+}
+
+SharedPixelPool::~SharedPixelPool()
+{
+}
+
+PixelLease SharedPixelPool::stage(const PixelImage& image)
+{
+    size_t rowBytes = static_cast<size_t>(image.width) * bytesPerPixel(image.format);
+    size_t bytes = rowBytes * static_cast<size_t>(std::max(image.height, 0));
+    if (!image.data || bytes == 0 || image.stride < static_cast<int>(rowBytes)) {
+        return nullptr;
+    }
+
+    size_t index;
+    State::Slot* slot;
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        auto it = std::find_if(m_state->slots.begin(), m_state->slots.end(),
+                               [](const std::unique_ptr<State::Slot>& slot) { return !slot->leased; });
+        if (it == m_state->slots.end()) {
+            m_state->stats.exhausted++;
+            return nullptr;
+        }
+        index = static_cast<size_t>(it - m_state->slots.begin());
+        slot = it->get();
+        slot->leased = true;
+        m_state->stats.inUse++;
+    }
+
+    // A worker may still have the old file mapped, so a grown slot is a new
+    // file rather than the old one extended underneath it
+    if (slot->file.size() < bytes) {
+        size_t previous = slot->file.size();
+        size_t size = std::max({bytes, previous * 2, kMinimumSlotBytes});
+        size = (size + kMinimumSlotBytes - 1) / kMinimumSlotBytes * kMinimumSlotBytes;
+        slot->file.close();
+        std::error_code ec;
+        if (!slot->path.empty()) {
+            std::filesystem::remove(slot->path, ec);
+        }
+        slot->path = m_state->prefix + std::to_string(index) + "_" + std::to_string(slot->generation++) + ".bin";
+        bool mapped = slot->file.open(slot->path, size);
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        m_state->stats.mappedBytes -= previous;
+        m_state->stats.mappedBytes += mapped ? size : 0;
+        if (!mapped) {
+            slot->leased = false;
+            m_state->stats.inUse--;
+            return nullptr;
+        }
+    }
+
+    uint8_t* destination = static_cast<uint8_t*>(slot->file.data());
+    if (image.stride == static_cast<int>(rowBytes)) {
+        std::memcpy(destination, image.data, bytes);
+    } else {
+        for (int y = 0; y < image.height; ++y) {
+            std::memcpy(destination + y * rowBytes, image.data + static_cast<size_t>(y) * image.stride, rowBytes);
+        }
+    }
+
+    auto staged = new PixelImage(image);
+    staged->data = destination;
+    staged->stride = static_cast<int>(rowBytes);
+    staged->sharedPath = slot->path;
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        m_state->stats.staged++;
+        m_state->stats.bytesStaged += bytes;
+    }
+
+    std::shared_ptr<State> state = m_state;
+    return PixelLease(staged, [state, index](const PixelImage* image) {
+        state->release(index);
+        delete image;
+    });
+}
+
+SharedPixelStats SharedPixelPool::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    return m_state->stats;
+}
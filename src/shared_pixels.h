@@ -0,0 +1,47 @@
+#ifndef SHARED_PIXELS_H
+#define SHARED_PIXELS_H
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include "detection_client.h"
+
+// Keeps a staged image's slot until the last reference is dropped; the
+// request's PixelImage is a copy of *lease
+using PixelLease = std::shared_ptr<const PixelImage>;
+
+struct SharedPixelStats {
+    size_t slotCount;
+    size_t inUse;
+    uint64_t staged;
+    uint64_t bytesStaged;
+    uint64_t exhausted;     // stage() found no free slot
+    uint64_t mappedBytes;   // All slot files together
+};
+
+// Raw frames on their way to local workers. Each slot is a file mapped both
+// here and, by path, in the worker, which reads the rows where they are: a
+// frame costs one copy of its rows, with no encode, file write or decode.
+// A slot grows, under a new file name, when a larger frame arrives.
+class SharedPixelPool {
+public:
+    // Empty directory: /dev/shm where it exists, else the temp directory
+    SharedPixelPool(const std::string& directory, size_t slotCount);
+    ~SharedPixelPool();
+
+    SharedPixelPool(const SharedPixelPool&) = delete;
+    SharedPixelPool& operator=(const SharedPixelPool&) = delete;
+
+    // Copies the rows into a free slot, packed to width * bytesPerPixel per
+    // row. Null when every slot is leased or the file cannot be mapped.
+    PixelLease stage(const PixelImage& image);
+
+    SharedPixelStats getStats() const;
+
+private:
+    struct State;
+    std::shared_ptr<State> m_state;
+};
+
+#endif // SHARED_PIXELS_H
@@ -0,0 +1,79 @@
+#ifndef SOCKET_SHIM_H
+#define SOCKET_SHIM_H
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <mutex>
+#else
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#endif
+
+// The BSD socket calls are the same on both platforms apart from a few
+// names; TcpConnection and MjpegServer share these shims so each call has
+// one implementation. Internal to yolo_core.
+namespace socket_shim {
+#ifdef _WIN32
+using Socket = uintptr_t;
+const Socket kNoSocket = static_cast<Socket>(INVALID_SOCKET);
+using PollFd = WSAPOLLFD;
+inline int pollSockets(PollFd* fds, size_t count, int timeoutMs)
+{
+    return WSAPoll(fds, static_cast<ULONG>(count), timeoutMs);
+}
+inline void closeSocket(Socket socket) { closesocket(static_cast<SOCKET>(socket)); }
+inline bool setNonBlocking(Socket socket, bool enabled = true)
+{
+    u_long mode = enabled ? 1 : 0;
+    return ioctlsocket(static_cast<SOCKET>(socket), FIONBIO, &mode) == 0;
+}
+inline bool wouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+inline bool connectInProgress() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+inline bool interrupted() { return false; }
+const int kSendFlags = 0;
+
+inline void ensureWinsock()
+{
+    static std::once_flag once;
+    std::call_once(once, []() {
+        WSADATA data;
+        WSAStartup(MAKEWORD(2, 2), &data);
+    });
+}
+#else
+using Socket = int;
+const Socket kNoSocket = -1;
+using PollFd = pollfd;
+inline int pollSockets(PollFd* fds, size_t count, int timeoutMs) { return poll(fds, count, timeoutMs); }
+inline void closeSocket(Socket socket) { ::close(socket); }
+inline bool setNonBlocking(Socket socket, bool enabled = true)
+{
+    int flags = fcntl(socket, F_GETFL, 0);
+    if (flags < 0) return false;
+    return fcntl(socket, F_SETFL, enabled ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK)) == 0;
+}
+inline bool wouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+inline bool connectInProgress() { return errno == EINPROGRESS; }
+inline bool interrupted() { return errno == EINTR; }
+// A dead peer or a viewer closing its tab must surface as a failed send,
+// not kill the host
+#ifdef MSG_NOSIGNAL
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;
+#endif
+
+inline void ensureWinsock()
+{
+}
+#endif
+}
+
+#endif // SOCKET_SHIM_H
@@ -0,0 +1,190 @@
+#include "tcp_connection.h"
+#include "socket_shim.h"
+#include <algorithm>
+#include <climits>
+
+#ifndef _WIN32
+#include <csignal>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+using namespace socket_shim;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// A stuck peer that stops reading must not block a sender forever
+const auto kSendTimeout = std::chrono::seconds(30);
+
+int remainingMs(Clock::time_point deadline)
+{
+    if (deadline == Clock::time_point::max()) {
+        return -1;
+    }
+    auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now()).count();
+    return static_cast<int>(std::min<long long>(std::max<long long>(left, 0), INT_MAX));
+}
+
+// Waits until the socket is readable or writable; false on timeout or error
+bool waitForSocket(Socket socket, short events, Clock::time_point deadline)
+{
+    PollFd pfd = {};
+    pfd.fd = socket;
+    pfd.events = events;
+    int ready;
+    do {
+        ready = pollSockets(&pfd, 1, remainingMs(deadline));
+    } while (ready < 0 && interrupted());
+    return ready > 0;
+}
+}
+
+TcpConnection::TcpConnection()
+    : m_socket(kNoSocket)
+{
+}
+
+TcpConnection::~TcpConnection()
+{
+    close();
+}
+
+bool TcpConnection::connect(const std::string& host, int port, std::chrono::milliseconds timeout)
+{
+    close();
+    ensureWinsock();
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) {
+        return false;
+    }
+
+    Clock::time_point deadline = Clock::now() + timeout;
+    for (addrinfo* address = addresses; address && m_socket == kNoSocket; address = address->ai_next) {
+        auto socket = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (socket == kNoSocket) {
+            continue;
+        }
+
+        // Connect without blocking so the timeout applies, then go back to
+        // blocking I/O; reads wait in poll() against their own deadline
+        bool connected = setNonBlocking(socket, true);
+        if (connected && ::connect(socket, address->ai_addr, static_cast<int>(address->ai_addrlen)) != 0) {
+            connected = connectInProgress() && waitForSocket(socket, POLLOUT, deadline);
+            if (connected) {
+                int error = 0;
+                socklen_t length = sizeof(error);
+                getsockopt(socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length);
+                connected = error == 0;
+            }
+        }
+        if (!connected || !setNonBlocking(socket, false)) {
+            closeSocket(socket);
+            continue;
+        }
+
+        // Requests are single lines; send them as soon as they are written
+        int noDelay = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+#ifdef _WIN32
+        DWORD sendTimeout = static_cast<DWORD>(std::chrono::milliseconds(kSendTimeout).count());
+        setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&sendTimeout), sizeof(sendTimeout));
+#else
+        timeval sendTimeout = {static_cast<time_t>(std::chrono::seconds(kSendTimeout).count()), 0};
+        setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+#ifdef SO_NOSIGPIPE
+        int noSigPipe = 1;
+        setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+#endif
+        m_socket = socket;
+    }
+
+    freeaddrinfo(addresses);
+    m_readBuffer.clear();
+    return m_socket != kNoSocket;
+}
+
+void TcpConnection::close()
+{
+    if (m_socket != kNoSocket) {
+        closeSocket(m_socket);
+        m_socket = kNoSocket;
+    }
+    m_readBuffer.clear();
+}
+
+bool TcpConnection::isOpen() const
+{
+    return m_socket != kNoSocket;
+}
+
+bool TcpConnection::writeLine(std::string_view line)
+{
+    if (m_socket == kNoSocket) {
+        return false;
+    }
+    // The worker reads whole lines, so the terminator can follow separately
+    return sendAll(line.data(), line.size()) && sendAll("\n", 1);
+}
+
+bool TcpConnection::sendAll(const char* ptr, size_t remaining)
+{
+    while (remaining > 0) {
+        int chunk = static_cast<int>(std::min<size_t>(remaining, INT_MAX));
+        auto sent = send(m_socket, ptr, chunk, kSendFlags);
+        if (sent < 0) {
+            if (interrupted()) continue;
+            return false;
+        }
+        ptr += sent;
+        remaining -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+TcpConnection::ReadStatus TcpConnection::readLineUntil(std::string& line, Clock::time_point deadline)
+{
+    size_t newline;
+    while ((newline = m_readBuffer.find('\n')) == std::string::npos) {
+        ReadStatus status = readChunk(deadline);
+        if (status != ReadStatus::Line) {
+            return status;
+        }
+    }
+
+    // assign() keeps the capacity of a line string the caller reuses
+    line.assign(m_readBuffer, 0, newline);
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    m_readBuffer.erase(0, newline + 1);
+    return ReadStatus::Line;
+}
+
+TcpConnection::ReadStatus TcpConnection::readChunk(Clock::time_point deadline)
+{
+    if (m_socket == kNoSocket) {
+        return ReadStatus::Closed;
+    }
+    if (!waitForSocket(m_socket, POLLIN, deadline)) {
+        return Clock::now() >= deadline ? ReadStatus::TimedOut : ReadStatus::Closed;
+    }
+
+    char buffer[16384];
+    int received;
+    do {
+        received = static_cast<int>(recv(m_socket, buffer, sizeof(buffer), 0));
+    } while (received < 0 && interrupted());
+
+    if (received <= 0) {
+        return ReadStatus::Closed;
+    }
+    m_readBuffer.append(buffer, static_cast<size_t>(received));
+    return ReadStatus::Line;
+}
@@ -0,0 +1,45 @@
+#ifndef TCP_CONNECTION_H
+#define TCP_CONNECTION_H
+
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <cstdint>
+
+// A client TCP connection carrying newline-delimited messages, the network
+// counterpart of WorkerProcess's stdin/stdout pipes.
+class TcpConnection {
+public:
+    enum class ReadStatus {
+        Line,
+        Closed,     // Peer closed the connection, or an error
+        TimedOut,
+    };
+
+    TcpConnection();
+    ~TcpConnection();
+
+    TcpConnection(const TcpConnection&) = delete;
+    TcpConnection& operator=(const TcpConnection&) = delete;
+
+    bool connect(const std::string& host, int port, std::chrono::milliseconds timeout);
+    void close();
+    bool isOpen() const;
+
+    bool writeLine(std::string_view line);
+    ReadStatus readLineUntil(std::string& line, std::chrono::steady_clock::time_point deadline);
+
+private:
+    bool sendAll(const char* data, size_t size);
+    // Line here means more bytes were appended to the read buffer
+    ReadStatus readChunk(std::chrono::steady_clock::time_point deadline);
+
+    std::string m_readBuffer;
+#ifdef _WIN32
+    uintptr_t m_socket;
+#else
+    int m_socket;
+#endif
+};
+
+#endif // TCP_CONNECTION_H
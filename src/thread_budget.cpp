@@ -0,0 +1,266 @@
+#include "thread_budget.h"
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+// Cores left to capture, the UI and the OS, by physical core count
+int reservedCores(int cores, int workers)
+{
+    int reserved = cores >= 16 ? 2 : (cores >= 4 ? 1 : 0);
+    // Not at the cost of a worker sharing a core
+    return std::max(0, std::min(reserved, cores - workers));
+}
+
+CpuTopology oneCorePerCpu(const std::vector<int>& cpus)
+{
+    CpuTopology topology;
+    for (int cpu : cpus) {
+        topology.cores.push_back({cpu});
+    }
+    return topology;
+}
+
+std::vector<int> firstCpus(unsigned count)
+{
+    std::vector<int> cpus;
+    for (unsigned i = 0; i < std::max(count, 1u); ++i) {
+        cpus.push_back(static_cast<int>(i));
+    }
+    return cpus;
+}
+}
+
+size_t CpuTopology::logicalCpuCount() const
+{
+    size_t count = 0;
+    for (const auto& core : cores) {
+        count += core.size();
+    }
+    return count;
+}
+
+#ifdef _WIN32
+
+CpuTopology CpuTopology::detect()
+{
+    DWORD_PTR processMask = 0;
+    DWORD_PTR systemMask = 0;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask) || processMask == 0) {
+        return oneCorePerCpu(firstCpus(std::thread::hardware_concurrency()));
+    }
+
+    std::vector<int> allowed;
+    for (int cpu = 0; cpu < static_cast<int>(sizeof(DWORD_PTR) * 8); ++cpu) {
+        if (processMask & (static_cast<DWORD_PTR>(1) << cpu)) {
+            allowed.push_back(cpu);
+        }
+    }
+
+    DWORD length = 0;
+    GetLogicalProcessorInformation(NULL, &length);
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> entries(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+    if (entries.empty() || !GetLogicalProcessorInformation(entries.data(), &length)) {
+        return oneCorePerCpu(allowed);
+    }
+
+    CpuTopology topology;
+    for (const auto& entry : entries) {
+        if (entry.Relationship != RelationProcessorCore) {
+            continue;
+        }
+        std::vector<int> core;
+        for (int cpu : allowed) {
+            if (entry.ProcessorMask & (static_cast<ULONG_PTR>(1) << cpu)) {
+                core.push_back(cpu);
+            }
+        }
+        if (!core.empty()) {
+            topology.cores.push_back(core);
+        }
+    }
+    if (topology.cores.empty()) {
+        return oneCorePerCpu(allowed);
+    }
+    std::sort(topology.cores.begin(), topology.cores.end());
+    return topology;
+}
+
+bool pinCurrentThread(const std::vector<int>& cpus)
+{
+    if (cpus.empty()) {
+        return true;
+    }
+    DWORD_PTR mask = 0;
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+            mask |= static_cast<DWORD_PTR>(1) << cpu;
+        }
+    }
+    return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+}
+
+#else
+
+CpuTopology CpuTopology::detect()
+{
+    std::vector<int> allowed;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                allowed.push_back(cpu);
+            }
+        }
+    }
+    if (allowed.empty()) {
+        allowed = firstCpus(std::thread::hardware_concurrency());
+    }
+
+    // SMT siblings share a core id within their package
+    CpuTopology topology;
+    std::map<std::pair<int, int>, size_t> coreIndex;
+    for (int cpu : allowed) {
+        std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+        int package = -1;
+        int core = -1;
+        std::ifstream(base + "physical_package_id") >> package;
+        std::ifstream(base + "core_id") >> core;
+        if (package < 0 || core < 0) {
+            return oneCorePerCpu(allowed);
+        }
+        auto found = coreIndex.emplace(std::make_pair(package, core), topology.cores.size());
+        if (found.second) {
+            topology.cores.push_back({});
+        }
+        topology.cores[found.first->second].push_back(cpu);
+    }
+    return topology;
+}
+
+bool pinCurrentThread(const std::vector<int>& cpus)
+{
+    if (cpus.empty()) {
+        return true;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+#endif
+
+ThreadBudgetPlan planThreadBudget(const CpuTopology& topology, int workers)
+{
+    ThreadBudgetPlan plan;
+    if (workers <= 0) {
+        return plan;
+    }
+    plan.workers.resize(workers);
+    int cores = static_cast<int>(topology.cores.size());
+    if (cores == 0) {
+        return plan;
+    }
+
+    int available = cores - reservedCores(cores, workers);
+    for (int i = available; i < cores; ++i) {
+        const auto& core = topology.cores[i];
+        plan.captureCpus.insert(plan.captureCpus.end(), core.begin(), core.end());
+    }
+
+    // A YOLO graph is one chain of operators, so a second inter-op thread
+    // would only idle; SMT siblings add little to the convolutions, so one
+    // intra-op thread per physical core
+    if (available >= workers) {
+        int next = 0;
+        for (int w = 0; w < workers; ++w) {
+            WorkerThreadBudget& budget = plan.workers[w];
+            int share = available / workers + (w < available % workers ? 1 : 0);
+            budget.intraOpThreads = share;
+            budget.interOpThreads = 1;
+            for (int c = 0; c < share; ++c, ++next) {
+                const auto& core = topology.cores[next];
+                budget.cpus.insert(budget.cpus.end(), core.begin(), core.end());
+            }
+        }
+    } else {
+        for (int w = 0; w < workers; ++w) {
+            WorkerThreadBudget& budget = plan.workers[w];
+            budget.intraOpThreads = 1;
+            budget.interOpThreads = 1;
+            budget.cpus = topology.cores[w % available];
+        }
+    }
+    return plan;
+}
+
+std::string formatCpuList(const std::vector<int>& cpus)
+{
+    std::vector<int> sorted(cpus);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    std::string text;
+    for (size_t i = 0; i < sorted.size();) {
+        size_t end = i;
+        while (end + 1 < sorted.size() && sorted[end + 1] == sorted[end] + 1) {
+            end++;
+        }
+        if (!text.empty()) {
+            text += ',';
+        }
+        text += std::to_string(sorted[i]);
+        if (end > i) {
+            text += '-' + std::to_string(sorted[end]);
+        }
+        i = end + 1;
+    }
+    return text;
+}
+
+std::vector<int> parseCpuList(const std::string& text)
+{
+    std::vector<int> cpus;
+    std::istringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, ',')) {
+        if (part.empty()) {
+            continue;
+        }
+        int first = 0;
+        int last = 0;
+        char dash = 0;
+        std::istringstream range(part);
+        if (!(range >> first) || first < 0) {
+            return {};
+        }
+        last = first;
+        if (range >> dash) {
+            if (dash != '-' || !(range >> last) || last < first) {
+                return {};
+            }
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
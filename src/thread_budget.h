@@ -0,0 +1,44 @@
+#ifndef THREAD_BUDGET_H
+#define THREAD_BUDGET_H
+
+#include <string>
+#include <vector>
+
+// Logical CPUs this process may run on, grouped by physical core so that
+// SMT siblings stay together
+struct CpuTopology {
+    std::vector<std::vector<int>> cores;
+
+    size_t logicalCpuCount() const;
+
+    // Falls back to one core per logical CPU where the grouping is unknown
+    static CpuTopology detect();
+};
+
+// Threads and CPUs of one detection worker process
+struct WorkerThreadBudget {
+    int intraOpThreads = 0;     // Threads inside one operator; 0 = library default (one per core)
+    int interOpThreads = 0;     // Threads running independent operators; 0 = library default
+    std::vector<int> cpus;      // Empty = not pinned
+};
+
+struct ThreadBudgetPlan {
+    std::vector<WorkerThreadBudget> workers;
+    std::vector<int> captureCpus;   // For capture threads; empty = not pinned
+};
+
+// Gives each worker its own whole cores and as many intra-op threads as
+// cores, so workers never compete for a core and torch's per-operator
+// barriers do not wait on preempted threads. On four or more cores the last
+// core (two from sixteen on) is left to capture, the UI and the OS. With
+// more workers than cores, workers share cores with one thread each.
+ThreadBudgetPlan planThreadBudget(const CpuTopology& topology, int workers);
+
+// Restricts the calling thread to the CPUs; false when the OS refused
+bool pinCurrentThread(const std::vector<int>& cpus);
+
+// "0-3,8" <-> {0, 1, 2, 3, 8}
+std::string formatCpuList(const std::vector<int>& cpus);
+std::vector<int> parseCpuList(const std::string& text);
+
+#endif // THREAD_BUDGET_H
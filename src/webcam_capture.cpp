@@ -1,14 +1,22 @@
 #include "webcam_capture.h"
-#include <iostream>
+#include "thread_budget.h"
+#include "logger.h"
+#include <mmsystem.h>
 #include <sstream>
 #include <filesystem>
 #include <chrono>
 #include <thread>
 
+namespace {
+// At most this many frames are alive at once (one capturing, the rest in detection)
+const size_t kFrameSlots = 4;
+const uint64_t kFrameByteBudget = 64ull * 1024 * 1024;
+}
+
 WebcamCapture::WebcamCapture()
     : m_isCapturing(false)
     , m_deviceId(0)
-    , m_targetFps(5)  // 5 FPS for real-time detection
+    , m_pacer(5.0)  // 5 FPS for real-time detection
     , m_frameCounter(0)
 {
     // Create temp directory for frames
@@ -16,6 +24,9 @@ WebcamCapture::WebcamCapture()
     GetTempPathA(MAX_PATH, tempPath);
     m_tempDir = std::string(tempPath) + "yolo_frames\\";
     CreateDirectoryA(m_tempDir.c_str(), NULL);
+
+    // Older builds left one file per captured frame behind
+    FramePool::purgeDirectory(m_tempDir, "frame_");
 }
 
 WebcamCapture::~WebcamCapture()
@@ -25,6 +36,11 @@ WebcamCapture::~WebcamCapture()
 
 bool WebcamCapture::initialize(int deviceId)
 {
+    if (!m_framePool || deviceId != m_deviceId) {
+        // One slot directory per camera so several captures can share the temp dir
+        std::string poolDir = m_tempDir + "camera_" + std::to_string(deviceId) + "\\";
+        m_framePool = std::make_unique<FramePool>(poolDir, kFrameSlots, kFrameByteBudget);
+    }
     m_deviceId = deviceId;
     
     // Test if camera is available using Python OpenCV
@@ -33,29 +49,29 @@ bool WebcamCapture::initialize(int deviceId)
     
     // Check if test script exists
     if (!std::filesystem::exists(testScript)) {
-        std::cerr << "Test script not found: " << testScript << std::endl;
+        YOLO_LOG_FRAME(LogLevel::Error, deviceId, 0, "Test script not found: %s", testScript.c_str());
         return false;
     }
     
     // Build command with proper path handling
     std::string command = "python \"" + testScript + "\" " + std::to_string(deviceId) + " 2>nul";
     
-    std::cout << "Testing camera with command: " << command << std::endl;
+    YOLO_LOG_FRAME(LogLevel::Info, deviceId, 0, "Testing camera with command: %s", command.c_str());
     
     int result = system(command.c_str());
     
     if (result != 0) {
-        std::cerr << "Camera test failed with exit code: " << result << std::endl;
+        YOLO_LOG_FRAME(LogLevel::Warning, deviceId, 0, "Camera test failed with exit code: %d", result);
         
         // Try alternative Python commands
         std::vector<std::string> pythonCmds = {"python3", "py", "python.exe"};
         for (const auto& pythonCmd : pythonCmds) {
             std::string altCommand = pythonCmd + " \"" + testScript + "\" " + std::to_string(deviceId) + " 2>nul";
-            std::cout << "Trying alternative: " << altCommand << std::endl;
+            YOLO_LOG_FRAME(LogLevel::Info, deviceId, 0, "Trying alternative: %s", altCommand.c_str());
             
             result = system(altCommand.c_str());
             if (result == 0) {
-                std::cout << "Camera test successful with: " << pythonCmd << std::endl;
+                YOLO_LOG_FRAME(LogLevel::Info, deviceId, 0, "Camera test successful with: %s", pythonCmd.c_str());
                 return true;
             }
         }
@@ -63,13 +79,21 @@ bool WebcamCapture::initialize(int deviceId)
         return false;
     }
     
-    std::cout << "Camera test successful" << std::endl;
+    YOLO_LOG_FRAME(LogLevel::Info, deviceId, 0, "Camera test successful");
     return true;
 }
 
+FramePoolStats WebcamCapture::getFramePoolStats() const
+{
+    if (!m_framePool) {
+        return FramePoolStats();
+    }
+    return m_framePool->getStats();
+}
+
 void WebcamCapture::startCapture(FrameCallback onFrame, ErrorCallback onError)
 {
-    if (m_isCapturing) {
+    if (m_isCapturing || !m_framePool) {
         return;
     }
 
@@ -77,6 +101,10 @@ void WebcamCapture::startCapture(FrameCallback onFrame, ErrorCallback onError)
     m_errorCallback = onError;
     m_isCapturing = true;
     m_frameCounter = 0;
+    m_pacer.reset();
+
+    // Default scheduler granularity is ~15.6 ms, too coarse for frame deadlines
+    timeBeginPeriod(1);
 
     m_captureThread = std::thread(&WebcamCapture::captureLoop, this);
 }
@@ -84,50 +112,54 @@ void WebcamCapture::startCapture(FrameCallback onFrame, ErrorCallback onError)
 void WebcamCapture::stopCapture()
 {
     m_isCapturing = false;
+    m_pacer.stop();
     if (m_captureThread.joinable()) {
         m_captureThread.join();
+        timeEndPeriod(1);
     }
 }
 
 void WebcamCapture::captureLoop()
 {
-    auto frameInterval = std::chrono::milliseconds(1000 / m_targetFps);
-    auto lastFrameTime = std::chrono::steady_clock::now();
+    // Off the detection workers' cores, so their inference cannot delay a frame
+    pinCurrentThread(m_cpus);
 
-    while (m_isCapturing) {
-        auto currentTime = std::chrono::steady_clock::now();
-        
-        if (currentTime - lastFrameTime >= frameInterval) {
-            try {
-                std::string framePath = saveFrame();
-                if (!framePath.empty() && m_frameCallback) {
-                    m_frameCallback(framePath);
-                }
-                lastFrameTime = currentTime;
-            } catch (const std::exception& e) {
-                if (m_errorCallback) {
-                    m_errorCallback("Frame capture error: " + std::string(e.what()));
-                }
-                break;
+    // The pacer sleeps until absolute deadlines, so time spent in saveFrame
+    // does not push later frames back
+    while (m_isCapturing && m_pacer.waitForNextFrame()) {
+        try {
+            FrameLease frame = saveFrame();
+            if (frame && m_frameCallback) {
+                m_frameCallback(frame);
             }
+        } catch (const std::exception& e) {
+            if (m_errorCallback) {
+                m_errorCallback("Frame capture error: " + std::string(e.what()));
+            }
+            break;
         }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
 }
 
-std::string WebcamCapture::saveFrame()
+FrameLease WebcamCapture::saveFrame()
 {
     // Use Python script to capture frame
     std::string pythonDir = getPythonScriptPath();
     std::string captureScript = pythonDir + "\\capture_frame.py";
-    std::string framePath = m_tempDir + "frame_" + std::to_string(m_frameCounter++) + ".jpg";
-    
+
     // Check if capture script exists
     if (!std::filesystem::exists(captureScript)) {
-        std::cerr << "Capture script not found: " << captureScript << std::endl;
-        return "";
+        YOLO_LOG_FRAME(LogLevel::Error, m_deviceId, m_frameCounter, "Capture script not found: %s", captureScript.c_str());
+        return nullptr;
+    }
+
+    // Every slot is still held by a pending detection: skip this frame
+    FrameLease frame = m_framePool->acquire();
+    if (!frame) {
+        return nullptr;
     }
+    m_frameCounter++;
+    const std::string& framePath = frame->path;
     
     // Build command with proper error handling
     std::string command = "python \"" + captureScript + "\" " + 
@@ -135,7 +167,8 @@ std::string WebcamCapture::saveFrame()
     
     int result = system(command.c_str());
     if (result == 0 && std::filesystem::exists(framePath)) {
-        return framePath;
+        m_framePool->commit(frame);
+        return frame;
     }
     
     // Try alternative Python commands if default fails
@@ -146,12 +179,13 @@ std::string WebcamCapture::saveFrame()
         
         result = system(altCommand.c_str());
         if (result == 0 && std::filesystem::exists(framePath)) {
-            return framePath;
+            m_framePool->commit(frame);
+            return frame;
         }
     }
     
-    std::cerr << "Frame capture failed with all Python commands" << std::endl;
-    return "";
+    YOLO_LOG_FRAME(LogLevel::Warning, m_deviceId, m_frameCounter, "Frame capture failed with all Python commands");
+    return nullptr;
 }
 
 std::string WebcamCapture::getPythonScriptPath()
@@ -6,13 +6,19 @@
 #include <functional>
 #include <thread>
 #include <atomic>
+#include <memory>
+#include <vector>
+#include "frame_pool.h"
+#include "frame_pacer.h"
 
 class WebcamCapture {
 public:
     WebcamCapture();
     ~WebcamCapture();
 
-    using FrameCallback = std::function<void(const std::string& framePath)>;
+    // The callback receives a leased frame slot; keep the lease until the
+    // frame is no longer needed, drop it right away to skip the frame.
+    using FrameCallback = std::function<void(const FrameLease& frame)>;
     using ErrorCallback = std::function<void(const std::string& error)>;
 
     bool initialize(int deviceId = 0);
@@ -20,12 +26,20 @@ public:
     void stopCapture();
     bool isCapturing() const { return m_isCapturing; }
     
-    void setFrameRate(int fps) { m_targetFps = fps; }
-    int getFrameRate() const { return m_targetFps; }
+    // Fractional rates are allowed and take effect on the next frame
+    void setFrameRate(double fps) { m_pacer.setRate(fps); }
+    double getFrameRate() const { return m_pacer.getRate(); }
+    FramePacerStats getPacerStats() const { return m_pacer.getStats(); }
+
+    // CPUs for the capture thread, applied when capture starts; empty = any
+    void setCpuAffinity(const std::vector<int>& cpus) { m_cpus = cpus; }
+
+    int getDeviceId() const { return m_deviceId; }
+    FramePoolStats getFramePoolStats() const;
 
 private:
     void captureLoop();
-    std::string saveFrame();
+    FrameLease saveFrame();
     std::string getPythonScriptPath();
 
     std::atomic<bool> m_isCapturing;
@@ -34,9 +48,11 @@ private:
     ErrorCallback m_errorCallback;
     
     int m_deviceId;
-    int m_targetFps;
+    std::vector<int> m_cpus;
+    FramePacer m_pacer;
     std::string m_tempDir;
     int m_frameCounter;
+    std::unique_ptr<FramePool> m_framePool;
 };
 
 #endif // WEBCAM_CAPTURE_H
\ No newline at end of file
@@ -0,0 +1,331 @@
+#include "worker_balancer.h"
+#include "worker_protocol.h"
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+std::vector<DetectionResult> failedResults(size_t count, const std::string& message, bool timedOut)
+{
+    DetectionResult result;
+    result.success = false;
+    result.processingTime = 0;
+    result.errorMessage = message;
+    result.timedOut = timedOut;
+    return std::vector<DetectionResult>(count, result);
+}
+
+// Whole file into bytes, which keeps its allocator; false when unreadable
+bool readFile(const std::string& path, std::pmr::string& bytes)
+{
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    bool ok = std::fseek(file, 0, SEEK_END) == 0;
+    long size = ok ? std::ftell(file) : -1;
+    ok = size >= 0 && std::fseek(file, 0, SEEK_SET) == 0;
+    if (ok) {
+        bytes.resize(static_cast<size_t>(size));
+        ok = std::fread(&bytes[0], 1, bytes.size(), file) == bytes.size();
+    }
+    std::fclose(file);
+    return ok;
+}
+}
+
+WorkerBalancer::WorkerBalancer(const std::vector<WorkerEndpoint>& endpoints, const BalancerConfig& config)
+    : m_config(config)
+    , m_shutdown(false)
+{
+    for (const WorkerEndpoint& address : endpoints) {
+        Endpoint endpoint = Endpoint();
+        endpoint.address = address;
+        // Assumed up until a request or health check says otherwise
+        endpoint.healthy = true;
+        m_endpoints.push_back(std::move(endpoint));
+    }
+    m_healthThread = std::thread(&WorkerBalancer::healthLoop, this);
+}
+
+WorkerBalancer::~WorkerBalancer()
+{
+    shutdown();
+}
+
+void WorkerBalancer::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_wakeup.notify_all();
+    if (m_healthThread.joinable()) {
+        m_healthThread.join();
+    }
+}
+
+std::vector<WorkerEndpoint> WorkerBalancer::parseEndpoints(const std::string& text)
+{
+    std::vector<WorkerEndpoint> endpoints;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        size_t colon = item.rfind(':');
+        if (colon == std::string::npos || colon == 0) {
+            continue;
+        }
+        size_t start = item.find_first_not_of(' ');
+        std::string host = item.substr(start, colon - start);
+        int port = std::atoi(item.c_str() + colon + 1);
+        if (host.empty() || port <= 0 || port > 65535) {
+            continue;
+        }
+        endpoints.push_back({host, port});
+    }
+    return endpoints;
+}
+
+int WorkerBalancer::acquireEndpoint(const std::vector<bool>& tried, size_t requestCount)
+{
+    // Least outstanding requests among the healthy endpoints not tried yet
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int best = -1;
+    for (size_t i = 0; i < m_endpoints.size(); ++i) {
+        const Endpoint& endpoint = m_endpoints[i];
+        if (tried[i] || !endpoint.healthy) {
+            continue;
+        }
+        if (best < 0 || endpoint.outstanding < m_endpoints[best].outstanding) {
+            best = static_cast<int>(i);
+        }
+    }
+    if (best >= 0) {
+        m_endpoints[best].outstanding += static_cast<int>(requestCount);
+    }
+    return best;
+}
+
+std::unique_ptr<TcpConnection> WorkerBalancer::takeConnection(int index, bool& reused)
+{
+    WorkerEndpoint address;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Endpoint& endpoint = m_endpoints[index];
+        if (!endpoint.idle.empty()) {
+            std::unique_ptr<TcpConnection> connection = std::move(endpoint.idle.back());
+            endpoint.idle.pop_back();
+            reused = true;
+            return connection;
+        }
+        address = endpoint.address;
+    }
+
+    reused = false;
+    auto connection = std::make_unique<TcpConnection>();
+    if (!connection->connect(address.host, address.port, std::chrono::milliseconds(m_config.connectTimeoutMs))) {
+        return nullptr;
+    }
+    return connection;
+}
+
+void WorkerBalancer::releaseEndpoint(int index, std::unique_ptr<TcpConnection> connection, size_t requestCount,
+                                     Exchange outcome, double latencyMs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Endpoint& endpoint = m_endpoints[index];
+    endpoint.outstanding -= static_cast<int>(requestCount);
+
+    if (outcome == Exchange::Answered) {
+        endpoint.completed += requestCount;
+        endpoint.batches++;
+        endpoint.latencySumMs += latencyMs;
+        if (connection && !m_shutdown) {
+            endpoint.idle.push_back(std::move(connection));
+        }
+        return;
+    }
+
+    // Down until the health check gets an answer; pooled connections to it are suspect too
+    endpoint.failures++;
+    endpoint.healthy = false;
+    endpoint.idle.clear();
+}
+
+WorkerBalancer::Exchange WorkerBalancer::exchange(TcpConnection& connection, std::string_view line,
+                                                  size_t requestCount, std::vector<DetectionResult>& results)
+{
+    results.clear();
+    results.reserve(requestCount);
+    if (!connection.writeLine(line)) {
+        return Exchange::Failed;
+    }
+
+    // One response line per request, in request order
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(m_config.responseTimeoutMs);
+    std::string response;
+    while (results.size() < requestCount) {
+        TcpConnection::ReadStatus status = connection.readLineUntil(response, deadline);
+        if (status == TcpConnection::ReadStatus::TimedOut) {
+            return Exchange::TimedOut;
+        }
+        if (status != TcpConnection::ReadStatus::Line) {
+            return Exchange::Failed;
+        }
+        if (response.empty() || response[0] != '{') {
+            continue;
+        }
+        results.push_back(parseWorkerResponse(response));
+    }
+    return Exchange::Answered;
+}
+
+std::vector<DetectionResult> WorkerBalancer::runBatch(int workerIndex, const std::vector<DetectionRequest>& requests)
+{
+    (void)workerIndex;
+
+    // Remote workers cannot see local paths, so the image bytes go along;
+    // bytes or pixels a request already carries are used as they are. An
+    // unreadable file is sent without them and the worker reports it.
+    // Image bytes and the base64 line share one arena that is released when
+    // the batch is answered; the line is sized up front so it is built once.
+    ArenaPool::Lease arena = m_arenas.acquire();
+    std::pmr::vector<std::pmr::string> images(arena->resource());
+    std::pmr::vector<std::string_view> bytes(arena->resource());
+    images.reserve(requests.size());    // The views point into these strings
+    size_t lineSize = 16;
+    for (const DetectionRequest& request : requests) {
+        images.emplace_back();
+        if (request.imageData) {
+            bytes.push_back(*request.imageData);
+        } else if (request.pixels.data) {
+            bytes.push_back(std::string_view());
+            lineSize += (pixelSpan(request.pixels) + 2) / 3 * 4;
+        } else {
+            bytes.push_back(readFile(request.imagePath, images.back()) ? std::string_view(images.back())
+                                                                       : std::string_view());
+        }
+        lineSize += (bytes.back().size() + 2) / 3 * 4 + request.imagePath.size() + 256;
+    }
+
+    std::pmr::string line(arena->resource());
+    line.reserve(lineSize);
+    line += "{\"batch\":[";
+    for (size_t i = 0; i < requests.size(); ++i) {
+        if (i > 0) line += ",";
+        appendWorkerRequest(line, requests[i], bytes[i]);
+    }
+    line += "]}";
+
+    std::vector<bool> tried(m_endpoints.size(), false);
+    std::vector<DetectionResult> results;
+    int previous = -1;
+    while (true) {
+        int index = acquireEndpoint(tried, requests.size());
+        if (index < 0) {
+            return failedResults(requests.size(), "No healthy detection worker available", false);
+        }
+        tried[index] = true;
+        if (previous >= 0) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_endpoints[previous].failovers++;
+        }
+
+        Clock::time_point start = Clock::now();
+        bool reused = false;
+        std::unique_ptr<TcpConnection> connection = takeConnection(index, reused);
+        Exchange outcome = connection ? exchange(*connection, line, requests.size(), results) : Exchange::Failed;
+        if (outcome == Exchange::Failed && reused) {
+            // A pooled connection may have been closed by a restarted worker; try one fresh one
+            bool fresh = false;
+            connection = takeConnection(index, fresh);
+            outcome = connection ? exchange(*connection, line, requests.size(), results) : Exchange::Failed;
+        }
+        double latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (outcome != Exchange::Answered) {
+            connection.reset();
+        }
+        std::string address = m_endpoints[index].address.label();
+        releaseEndpoint(index, std::move(connection), requests.size(), outcome, latencyMs);
+
+        if (outcome == Exchange::Answered) {
+            return results;
+        }
+        if (outcome == Exchange::TimedOut) {
+            // Whatever deadline the batch had is gone; retrying elsewhere would only add load
+            return failedResults(requests.size(), "Detection worker " + address + " did not answer within " +
+                                 std::to_string(m_config.responseTimeoutMs) + " ms", true);
+        }
+        previous = index;
+    }
+}
+
+bool WorkerBalancer::checkHealth(const WorkerEndpoint& address)
+{
+    // A fresh connection each time: the worker answers status without
+    // waiting for inference, so a busy endpoint still counts as up
+    TcpConnection connection;
+    if (!connection.connect(address.host, address.port, std::chrono::milliseconds(m_config.connectTimeoutMs)) ||
+        !connection.writeLine("{\"command\":\"status\"}")) {
+        return false;
+    }
+    std::string response;
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(m_config.healthCheckTimeoutMs);
+    return connection.readLineUntil(response, deadline) == TcpConnection::ReadStatus::Line &&
+           response.find("\"success\":true") != std::string::npos;
+}
+
+void WorkerBalancer::healthLoop()
+{
+    std::vector<WorkerEndpoint> addresses;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const Endpoint& endpoint : m_endpoints) {
+            addresses.push_back(endpoint.address);
+        }
+    }
+
+    while (true) {
+        for (size_t i = 0; i < addresses.size(); ++i) {
+            bool healthy = checkHealth(addresses[i]);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_shutdown) {
+                return;
+            }
+            Endpoint& endpoint = m_endpoints[i];
+            if (!healthy && endpoint.healthy) {
+                endpoint.failures++;
+                endpoint.idle.clear();
+            }
+            endpoint.healthy = healthy;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wakeup.wait_for(lock, std::chrono::milliseconds(m_config.healthCheckIntervalMs),
+                          [this]() { return m_shutdown; });
+        if (m_shutdown) {
+            return;
+        }
+    }
+}
+
+std::vector<EndpointStats> WorkerBalancer::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<EndpointStats> all;
+    for (const Endpoint& endpoint : m_endpoints) {
+        EndpointStats stats;
+        stats.address = endpoint.address.label();
+        stats.healthy = endpoint.healthy;
+        stats.outstanding = endpoint.outstanding;
+        stats.completed = endpoint.completed;
+        stats.failures = endpoint.failures;
+        stats.failovers = endpoint.failovers;
+        stats.meanLatencyMs = endpoint.batches > 0 ? endpoint.latencySumMs / static_cast<double>(endpoint.batches) : 0.0;
+        all.push_back(stats);
+    }
+    return all;
+}
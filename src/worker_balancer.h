@@ -0,0 +1,104 @@
+#ifndef WORKER_BALANCER_H
+#define WORKER_BALANCER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+#include "detection_client.h"
+#include "tcp_connection.h"
+#include "frame_arena.h"
+
+struct WorkerEndpoint {
+    std::string host;
+    int port;
+
+    std::string label() const { return host + ":" + std::to_string(port); }
+};
+
+struct EndpointStats {
+    std::string address;
+    bool healthy;
+    int outstanding;        // Requests in flight right now
+    uint64_t completed;     // Requests answered
+    uint64_t failures;      // Connection drops, protocol errors and timeouts
+    uint64_t failovers;     // Batches moved to another endpoint after failing here
+    double meanLatencyMs;   // Batch round trip, including image upload
+};
+
+struct BalancerConfig {
+    int connectTimeoutMs = 2000;
+    int responseTimeoutMs = 60000;      // A batch with no answer by then marks the endpoint down
+    int healthCheckIntervalMs = 2000;
+    int healthCheckTimeoutMs = 2000;
+};
+
+// Spreads detection batches over remote workers started with
+// "detection_server.py --serve --listen HOST:PORT". Each batch goes to the
+// healthy endpoint with the fewest requests in flight, with images sent
+// inline. A failed endpoint is marked down and the batch fails over to the
+// next one; a background health check brings endpoints back once they
+// answer a status request again.
+class WorkerBalancer {
+public:
+    explicit WorkerBalancer(const std::vector<WorkerEndpoint>& endpoints,
+                            const BalancerConfig& config = BalancerConfig());
+    ~WorkerBalancer();
+
+    WorkerBalancer(const WorkerBalancer&) = delete;
+    WorkerBalancer& operator=(const WorkerBalancer&) = delete;
+
+    // "host:port,host:port"; malformed entries are skipped
+    static std::vector<WorkerEndpoint> parseEndpoints(const std::string& text);
+
+    // Usable as a DetectionScheduler::BatchExecutor from any number of
+    // scheduler workers at once; the worker index is not used
+    std::vector<DetectionResult> runBatch(int workerIndex, const std::vector<DetectionRequest>& requests);
+
+    std::vector<EndpointStats> getStats() const;
+    size_t getEndpointCount() const { return m_endpoints.size(); }
+
+    void shutdown();
+
+private:
+    struct Endpoint {
+        WorkerEndpoint address;
+        bool healthy;
+        int outstanding;
+        std::vector<std::unique_ptr<TcpConnection>> idle;   // Open connections ready for reuse
+        uint64_t completed;
+        uint64_t failures;
+        uint64_t failovers;
+        uint64_t batches;
+        double latencySumMs;
+    };
+
+    enum class Exchange {
+        Answered,
+        Failed,
+        TimedOut,
+    };
+
+    int acquireEndpoint(const std::vector<bool>& tried, size_t requestCount);
+    std::unique_ptr<TcpConnection> takeConnection(int index, bool& reused);
+    void releaseEndpoint(int index, std::unique_ptr<TcpConnection> connection, size_t requestCount,
+                         Exchange outcome, double latencyMs);
+    Exchange exchange(TcpConnection& connection, std::string_view line, size_t requestCount,
+                      std::vector<DetectionResult>& results);
+    bool checkHealth(const WorkerEndpoint& address);
+    void healthLoop();
+
+    BalancerConfig m_config;
+    ArenaPool m_arenas;     // Image bytes and request line of one batch per lease
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::vector<Endpoint> m_endpoints;
+    bool m_shutdown;
+    std::thread m_healthThread;
+};
+
+#endif // WORKER_BALANCER_H
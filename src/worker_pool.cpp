@@ -0,0 +1,490 @@
+#include "worker_pool.h"
+#include "worker_process.h"
+#include "worker_protocol.h"
+#include "logger.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+// Supervisor checks at half the heartbeat interval, within these bounds
+const auto kMinSuperviseInterval = std::chrono::milliseconds(50);
+const auto kMaxSuperviseInterval = std::chrono::milliseconds(500);
+
+// Status lines the worker sends between responses
+const char kHeartbeatPrefix[] = "{\"heartbeat\":";
+const char kReadyPrefix[] = "{\"ready\":";
+
+bool startsWith(const std::string& line, const char* prefix)
+{
+    return line.compare(0, std::char_traits<char>::length(prefix), prefix) == 0;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+WorkerPool::WorkerPool(const std::string& pythonExecutable, const std::string& scriptPath)
+    : m_pythonExecutable(pythonExecutable)
+    , m_scriptPath(scriptPath)
+    , m_config(std::make_shared<const WorkerConfig>())
+    , m_standbyReady(false)
+    , m_stopping(false)
+    , m_stats()
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+        m_stopping = true;
+    }
+    m_supervisorWake.notify_one();
+    if (m_supervisor.joinable()) {
+        m_supervisor.join();
+    }
+}
+
+void WorkerPool::setWorkerCount(int count)
+{
+    // Stopped once the lock is released, or when a batch still running on
+    // one lets go of it
+    std::vector<std::shared_ptr<Worker>> retired;
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+    retired.swap(m_workers);
+    for (int i = 0; i < count; ++i) {
+        m_workers.push_back(std::make_shared<Worker>());
+    }
+}
+
+void WorkerPool::setWorkerConfig(const WorkerConfig& config)
+{
+    // Started with the old settings; the supervisor builds a new one. It is
+    // stopped after the locks are released.
+    std::unique_ptr<WorkerProcess> retired;
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+    m_config = std::make_shared<const WorkerConfig>(config);
+    std::lock_guard<std::mutex> standbyLock(m_standbyMutex);
+    retired = std::move(m_standby);
+    m_standbyReady = false;
+}
+
+WorkerConfig WorkerPool::getWorkerConfig() const
+{
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+    return *m_config;
+}
+
+int WorkerPool::getWorkerCount() const
+{
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+    return static_cast<int>(m_workers.size());
+}
+
+std::vector<DetectionResult> WorkerPool::runBatch(int workerIndex, const std::vector<DetectionRequest>& requests)
+{
+    std::vector<DetectionResult> results;
+    results.reserve(requests.size());
+
+    auto failRemaining = [&results, &requests](const std::string& message, bool timedOut = false) {
+        while (results.size() < requests.size()) {
+            DetectionResult result;
+            result.success = false;
+            result.processingTime = 0;
+            result.errorMessage = message;
+            result.timedOut = timedOut;
+            results.push_back(result);
+        }
+        return results;
+    };
+
+    std::shared_ptr<Worker> slot;
+    std::shared_ptr<const WorkerConfig> settings;
+    {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+        if (workerIndex >= 0 && workerIndex < static_cast<int>(m_workers.size())) {
+            slot = m_workers[workerIndex];
+        }
+        settings = m_config;
+    }
+    if (!slot) {
+        return failRemaining("Invalid worker index " + std::to_string(workerIndex));
+    }
+
+    Worker& worker = *slot;
+    const WorkerConfig& config = *settings;
+    std::lock_guard<std::mutex> lock(worker.mutex);
+
+    // Start the worker on first use; one that died since the supervisor's
+    // last look is replaced here
+    if (!worker.process || !worker.process->isRunning()) {
+        Clock::time_point failedAt = Clock::now();
+        if (worker.started) {
+            recordFailure(workerIndex, Failure::Exited, config);
+        }
+        if (!replace(worker, config, workerIndex, failedAt)) {
+            return failRemaining("Failed to start Python worker");
+        }
+    }
+    ensureSupervisor();
+
+    for (int attempt = 0;; ++attempt) {
+        Failure failure = exchange(worker, config, requests, results.size(), results);
+        if (failure == Failure::None) {
+            return results;
+        }
+        Clock::time_point failedAt = Clock::now();
+        recordFailure(workerIndex, failure, config);
+        worker.process->terminate();
+
+        // A batch the worker could not finish in time may be what stalls it,
+        // so it is not resent; the next batch gets the replacement
+        if (failure == Failure::Unanswered) {
+            replace(worker, config, workerIndex, failedAt);
+            return failRemaining("Python worker did not answer within " +
+                                 std::to_string(config.responseTimeoutMs) + " ms; restarting it", true);
+        }
+
+        bool hung = failure == Failure::Hung;
+        if (attempt >= config.maxRedispatch || !replace(worker, config, workerIndex, failedAt)) {
+            return failRemaining(hung ? "Python worker stopped responding" : "Python worker exited unexpectedly", hung);
+        }
+        size_t unanswered = requests.size() - results.size();
+        {
+            std::lock_guard<std::mutex> statsLock(m_statsMutex);
+            m_stats.redispatched += unanswered;
+        }
+        YOLO_LOG(LogLevel::Warning, "Resending %zu request(s) to the replacement of worker %d", unanswered, workerIndex);
+    }
+}
+
+WorkerPool::Failure WorkerPool::exchange(Worker& worker, const WorkerConfig& config,
+                                         const std::vector<DetectionRequest>& requests, size_t first,
+                                         std::vector<DetectionResult>& results)
+{
+    // The request line lives in a recycled per-batch arena and is dropped
+    // with it; only the results, which outlive the batch, use the heap
+    ArenaPool::Lease arena = m_arenas.acquire();
+    std::pmr::string line(arena->resource());
+    if (first == 0) {
+        appendBatchRequest(line, requests);
+    } else {
+        appendBatchRequest(line, std::vector<DetectionRequest>(requests.begin() + first, requests.end()));
+    }
+
+    if (!worker.process->writeLine(line)) {
+        return Failure::Exited;
+    }
+
+    // One response line per request, in request order, with heartbeats in
+    // between. A worker whose heartbeats stop is hung (stopped, deadlocked,
+    // thrashing); one that keeps beating but stays silent past the response
+    // timeout is stuck in the batch (hung model load, stuck inference).
+    auto responseDeadline = Clock::now() + std::chrono::milliseconds(config.responseTimeoutMs);
+    std::string response;
+    while (results.size() < requests.size()) {
+        Clock::time_point deadline = responseDeadline;
+        if (config.heartbeatMs > 0 && worker.heard) {
+            deadline = std::min(deadline, worker.lastHeard + heartbeatTimeout(config));
+        }
+        WorkerProcess::ReadStatus status = worker.process->readLineUntil(response, deadline);
+        if (status == WorkerProcess::ReadStatus::TimedOut) {
+            return Clock::now() >= responseDeadline ? Failure::Unanswered : Failure::Hung;
+        }
+        if (status != WorkerProcess::ReadStatus::Line) {
+            return Failure::Exited;
+        }
+        if (noteStatusLine(worker, response) || response.empty() || response[0] != '{') {
+            continue;
+        }
+        results.push_back(parseWorkerResponse(response));
+    }
+    return Failure::None;
+}
+
+bool WorkerPool::noteStatusLine(Worker& worker, const std::string& line)
+{
+    worker.heard = true;
+    worker.lastHeard = Clock::now();
+    bool heartbeat = startsWith(line, kHeartbeatPrefix);
+    // A cold-started replacement has recovered once it loaded its models or
+    // answered; a heartbeat only says the interpreter is up
+    if (worker.recovering && !heartbeat) {
+        worker.recovering = false;
+        recordRecovery(worker.recoveringSince);
+    }
+    return heartbeat || startsWith(line, kReadyPrefix);
+}
+
+WorkerPool::Failure WorkerPool::checkIdle(Worker& worker, const WorkerConfig& config)
+{
+    if (!worker.process || !worker.process->isRunning()) {
+        return Failure::Exited;
+    }
+    std::string line;
+    for (;;) {
+        WorkerProcess::ReadStatus status = worker.process->readLineUntil(line, Clock::now());
+        if (status == WorkerProcess::ReadStatus::Closed) {
+            return Failure::Exited;
+        }
+        if (status == WorkerProcess::ReadStatus::TimedOut) {
+            break;
+        }
+        noteStatusLine(worker, line);
+    }
+    // Before its first heartbeat a worker is still importing; it gets as
+    // long as a batch would
+    auto limit = worker.heard ? heartbeatTimeout(config) : Clock::duration(std::chrono::milliseconds(config.responseTimeoutMs));
+    if ((config.heartbeatMs > 0 || !worker.heard) && Clock::now() - worker.lastHeard > limit) {
+        return Failure::Hung;
+    }
+    return Failure::None;
+}
+
+bool WorkerPool::replace(Worker& worker, const WorkerConfig& config, int workerIndex, Clock::time_point failedAt)
+{
+    if (worker.process) {
+        worker.process->terminate();
+    }
+    const WorkerThreadBudget& budget = threadBudget(config, workerIndex);
+
+    std::unique_ptr<WorkerProcess> spare;
+    {
+        std::lock_guard<std::mutex> lock(m_standbyMutex);
+        if (m_standby && m_standbyReady && m_standby->isRunning()) {
+            spare = std::move(m_standby);
+            m_standbyReady = false;
+        }
+    }
+
+    bool replacing = worker.started;
+    worker.started = true;
+    worker.recovering = false;
+    worker.lastHeard = Clock::now();
+    if (spare) {
+        // Started unpinned; takes over the failed worker's CPUs
+        if (!budget.cpus.empty()) {
+            spare->setAffinity(budget.cpus);
+        }
+        worker.process = std::move(spare);
+        worker.heard = true;
+        if (replacing) {
+            {
+                std::lock_guard<std::mutex> lock(m_statsMutex);
+                m_stats.promotions++;
+            }
+            YOLO_LOG(LogLevel::Info, "Standby worker took the place of worker %d", workerIndex);
+            recordRecovery(failedAt);
+        }
+        // Build the next spare
+        m_supervisorWake.notify_one();
+        return true;
+    }
+
+    if (!worker.process) {
+        worker.process = std::make_unique<WorkerProcess>();
+    }
+    worker.heard = false;
+    if (!worker.process->start(buildWorkerCommand(config, budget), budget.cpus)) {
+        YOLO_LOG(LogLevel::Error, "Failed to start Python worker %d", workerIndex);
+        return false;
+    }
+    if (replacing) {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.coldStarts++;
+        worker.recovering = true;
+        worker.recoveringSince = failedAt;
+    }
+    return true;
+}
+
+void WorkerPool::recordFailure(int workerIndex, Failure failure, const WorkerConfig& config)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        (failure == Failure::Exited ? m_stats.exits : m_stats.hangs)++;
+    }
+    if (failure == Failure::Exited) {
+        YOLO_LOG(LogLevel::Warning, "Python worker %d exited unexpectedly", workerIndex);
+    } else if (failure == Failure::Hung) {
+        YOLO_LOG(LogLevel::Warning, "Python worker %d stopped sending heartbeats; killing it", workerIndex);
+    } else {
+        YOLO_LOG(LogLevel::Warning, "Python worker %d did not answer within %d ms; restarting it",
+                 workerIndex, config.responseTimeoutMs);
+    }
+}
+
+void WorkerPool::recordRecovery(Clock::time_point failedAt)
+{
+    double ms = millisecondsSince(failedAt);
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.recoveries++;
+        m_stats.lastRecoveryMs = ms;
+        m_stats.maxRecoveryMs = std::max(m_stats.maxRecoveryMs, ms);
+    }
+    YOLO_LOG(LogLevel::Info, "Worker recovered %.0f ms after the failure", ms);
+}
+
+WorkerPoolStats WorkerPool::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_stats;
+}
+
+void WorkerPool::ensureSupervisor()
+{
+    std::call_once(m_supervisorStarted, [this]() {
+        m_supervisor = std::thread(&WorkerPool::supervise, this);
+    });
+}
+
+// Idle workers are checked here; one running a batch is watched by runBatch
+void WorkerPool::supervise()
+{
+    std::unique_lock<std::mutex> lock(m_poolMutex);
+    while (!m_stopping) {
+        // The workers and settings for this pass, like a batch's. Starting
+        // and killing workers takes seconds, so the lock is not held for it.
+        std::vector<std::shared_ptr<Worker>> workers = m_workers;
+        std::shared_ptr<const WorkerConfig> settings = m_config;
+        lock.unlock();
+
+        const WorkerConfig& config = *settings;
+        maintainStandby(config);
+        for (size_t i = 0; i < workers.size(); ++i) {
+            Worker& worker = *workers[i];
+            std::unique_lock<std::mutex> workerLock(worker.mutex, std::try_to_lock);
+            if (!workerLock || !worker.started) {
+                continue;
+            }
+            Failure failure = checkIdle(worker, config);
+            if (failure != Failure::None) {
+                Clock::time_point failedAt = Clock::now();
+                recordFailure(static_cast<int>(i), failure, config);
+                replace(worker, config, static_cast<int>(i), failedAt);
+            }
+        }
+
+        auto interval = config.heartbeatMs > 0
+            ? std::clamp<Clock::duration>(std::chrono::milliseconds(config.heartbeatMs / 2),
+                                          kMinSuperviseInterval, kMaxSuperviseInterval)
+            : Clock::duration(kMaxSuperviseInterval);
+        workers.clear();
+        lock.lock();
+        if (!m_stopping) {
+            m_supervisorWake.wait_for(lock, interval);
+        }
+    }
+}
+
+void WorkerPool::maintainStandby(const WorkerConfig& config)
+{
+    // Stopping a standby waits for it to exit; that happens once the lock
+    // is released, so a recovering batch is not kept from the spare meanwhile
+    std::unique_ptr<WorkerProcess> retired;
+    std::lock_guard<std::mutex> lock(m_standbyMutex);
+    if (!config.warmStandby) {
+        retired = std::move(m_standby);
+        m_standbyReady = false;
+        return;
+    }
+
+    Clock::time_point now = Clock::now();
+    if (!m_standby || !m_standby->isRunning()) {
+        if (m_standby) {
+            YOLO_LOG(LogLevel::Warning, "Standby worker exited; starting another");
+            retired = std::move(m_standby);
+        }
+        // Unpinned: it may replace any worker, and is moved onto that
+        // worker's CPUs when it does. Thread counts follow the first worker.
+        WorkerThreadBudget budget = threadBudget(config, 0);
+        budget.cpus.clear();
+        m_standby = std::make_unique<WorkerProcess>();
+        m_standbyReady = false;
+        m_standbyStarted = now;
+        m_standbyLastHeard = now;
+        {
+            std::lock_guard<std::mutex> statsLock(m_statsMutex);
+            m_stats.standbyReady = false;
+            m_stats.standbyLoadMs = 0.0;
+        }
+        if (!m_standby->start(buildWorkerCommand(config, budget))) {
+            m_standby.reset();
+        }
+        return;
+    }
+
+    std::string line;
+    WorkerProcess::ReadStatus status;
+    while ((status = m_standby->readLineUntil(line, Clock::now())) == WorkerProcess::ReadStatus::Line) {
+        m_standbyLastHeard = Clock::now();
+        if (!m_standbyReady && startsWith(line, kReadyPrefix)) {
+            m_standbyReady = true;
+            double loadMs = millisecondsSince(m_standbyStarted);
+            {
+                std::lock_guard<std::mutex> statsLock(m_statsMutex);
+                m_stats.standbyReady = true;
+                m_stats.standbyLoadMs = loadMs;
+            }
+            YOLO_LOG(LogLevel::Info, "Standby worker ready after %.0f ms", loadMs);
+        }
+    }
+    bool silent = m_standbyReady
+        ? config.heartbeatMs > 0 && now - m_standbyLastHeard > heartbeatTimeout(config)
+        : now - m_standbyStarted > std::chrono::milliseconds(config.responseTimeoutMs);
+    if (status == WorkerProcess::ReadStatus::Closed || silent) {
+        YOLO_LOG(LogLevel::Warning, "Standby worker %s; starting another", silent ? "stopped responding" : "exited");
+        m_standby->terminate();
+        retired = std::move(m_standby);
+        m_standbyReady = false;
+        std::lock_guard<std::mutex> statsLock(m_statsMutex);
+        m_stats.standbyReady = false;
+    }
+}
+
+WorkerPool::Clock::duration WorkerPool::heartbeatTimeout(const WorkerConfig& config)
+{
+    return std::chrono::milliseconds(config.heartbeatMs) * std::max(1, config.missedHeartbeats);
+}
+
+const WorkerThreadBudget& WorkerPool::threadBudget(const WorkerConfig& config, int workerIndex)
+{
+    static const WorkerThreadBudget kDefaults;
+    const auto& budgets = config.threadBudgets;
+    return workerIndex >= 0 && workerIndex < static_cast<int>(budgets.size()) ? budgets[workerIndex] : kDefaults;
+}
+
+std::string WorkerPool::buildWorkerCommand(const WorkerConfig& config, const WorkerThreadBudget& budget) const
+{
+    std::ostringstream command;
+    command << m_pythonExecutable << " \"" << m_scriptPath << "\" --serve";
+    command << " --model-budget-mb " << config.modelBudgetMb;
+
+    if (!config.preloadModels.empty()) {
+        command << " --preload ";
+        for (size_t i = 0; i < config.preloadModels.size(); ++i) {
+            if (i > 0) command << ",";
+            command << config.preloadModels[i];
+        }
+        // One inference per preloaded model before the worker reports ready
+        command << " --warmup";
+    }
+    if (config.heartbeatMs > 0) {
+        command << " --heartbeat-ms " << config.heartbeatMs;
+    }
+
+    // Applied by the worker before torch creates its thread pools
+    if (budget.intraOpThreads > 0) {
+        command << " --intra-op-threads " << budget.intraOpThreads;
+    }
+    if (budget.interOpThreads > 0) {
+        command << " --inter-op-threads " << budget.interOpThreads;
+    }
+    if (!budget.cpus.empty()) {
+        command << " --cpus " << formatCpuList(budget.cpus);
+    }
+    return command.str();
+}
@@ -0,0 +1,129 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include "detection_client.h"
+#include "frame_arena.h"
+
+class WorkerProcess;
+
+struct WorkerPoolStats {
+    uint64_t exits;             // Workers that died
+    uint64_t hangs;             // Killed after their heartbeats stopped
+    uint64_t promotions;        // Failed workers replaced by the warm standby
+    uint64_t coldStarts;        // Failed workers replaced by starting a new one
+    uint64_t redispatched;      // Requests resent after their worker failed
+    uint64_t recoveries;
+    double lastRecoveryMs;      // Failure detected until a worker with its models loaded took over
+    double maxRecoveryMs;
+    double standbyLoadMs;       // Start of the current standby until it was ready; 0 = not ready
+    bool standbyReady;
+};
+
+// Persistent local workers ("detection_server.py --serve"), each a child
+// process spoken to over its stdin/stdout. Workers keep the interpreter and
+// models loaded between requests and are started on first use.
+//
+// Workers are supervised: each reports a heartbeat from a thread of its own,
+// so a worker that exits or goes silent is noticed within a few heartbeats,
+// whether it is running a batch or idle. With a warm standby configured, a
+// spare worker that has loaded and warmed up the preloaded models takes the
+// failed worker's place at once (moved onto its CPUs) and a new spare is
+// built in the background; otherwise a new worker is started. Requests the
+// failed worker had not answered are sent to its replacement.
+class WorkerPool {
+public:
+    WorkerPool(const std::string& pythonExecutable, const std::string& scriptPath);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Both setters may be called while batches run: a batch keeps the
+    // worker and the settings it started with
+    void setWorkerCount(int count);
+    // Applies to workers started after the call; a standby is rebuilt
+    void setWorkerConfig(const WorkerConfig& config);
+    WorkerConfig getWorkerConfig() const;
+    int getWorkerCount() const;
+
+    // Usable as a DetectionScheduler::BatchExecutor. Each worker index must
+    // only be used by one thread at a time.
+    std::vector<DetectionResult> runBatch(int workerIndex, const std::vector<DetectionRequest>& requests);
+
+    WorkerPoolStats getStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Failure {
+        None,
+        Exited,         // Closed its output or could not be written to
+        Hung,           // Heartbeats stopped
+        Unanswered      // Heartbeats go on but the batch got no answer in time
+    };
+
+    struct Worker {
+        std::mutex mutex;                   // Held by runBatch and by the supervisor's checks
+        std::unique_ptr<WorkerProcess> process;
+        bool started = false;               // Supervised once first used
+        bool heard = false;                 // Said anything since it started
+        Clock::time_point lastHeard;
+        Clock::time_point recoveringSince;  // Failure a cold-started replacement is recovering from
+        bool recovering = false;
+    };
+
+    // The settings a batch or supervisor pass started with are passed down,
+    // so a concurrent setWorkerConfig never changes them underneath it
+    Failure exchange(Worker& worker, const WorkerConfig& config, const std::vector<DetectionRequest>& requests,
+                     size_t first, std::vector<DetectionResult>& results);
+    // True for heartbeat and ready lines, which are not responses
+    bool noteStatusLine(Worker& worker, const std::string& line);
+    Failure checkIdle(Worker& worker, const WorkerConfig& config);
+    // Promotes the standby into the worker's place or starts a new worker
+    bool replace(Worker& worker, const WorkerConfig& config, int workerIndex, Clock::time_point failedAt);
+    void recordFailure(int workerIndex, Failure failure, const WorkerConfig& config);
+    void recordRecovery(Clock::time_point failedAt);
+
+    void ensureSupervisor();
+    void supervise();
+    void maintainStandby(const WorkerConfig& config);
+
+    std::string buildWorkerCommand(const WorkerConfig& config, const WorkerThreadBudget& budget) const;
+    static const WorkerThreadBudget& threadBudget(const WorkerConfig& config, int workerIndex);
+    static Clock::duration heartbeatTimeout(const WorkerConfig& config);
+
+    std::string m_pythonExecutable;
+    std::string m_scriptPath;
+    ArenaPool m_arenas;     // One batch request line per lease
+
+    // Replaced under m_poolMutex; a batch holds on to the worker and
+    // settings it looked up, so neither goes away underneath it
+    std::vector<std::shared_ptr<Worker>> m_workers;
+    std::shared_ptr<const WorkerConfig> m_config;
+
+    // Spare worker; built by the supervisor
+    std::mutex m_standbyMutex;
+    std::unique_ptr<WorkerProcess> m_standby;
+    Clock::time_point m_standbyStarted;
+    Clock::time_point m_standbyLastHeard;
+    bool m_standbyReady;
+
+    mutable std::mutex m_poolMutex;     // The worker list and settings, against batches and the supervisor
+    std::once_flag m_supervisorStarted;
+    std::thread m_supervisor;
+    std::condition_variable m_supervisorWake;
+    bool m_stopping;
+
+    mutable std::mutex m_statsMutex;
+    WorkerPoolStats m_stats;
+};
+
+#endif // WORKER_POOL_H
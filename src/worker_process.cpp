@@ -0,0 +1,512 @@
+#include "worker_process.h"
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <csignal>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+namespace {
+const auto kShutdownGrace = std::chrono::seconds(2);
+
+using Clock = std::chrono::steady_clock;
+
+// Time left until the deadline in whole milliseconds, rounded up; -1 = no deadline
+long long remainingMs(Clock::time_point deadline)
+{
+    if (deadline == Clock::time_point::max()) {
+        return -1;
+    }
+    auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now()).count();
+    return left > 0 ? left : 0;
+}
+}
+
+bool WorkerProcess::readLine(std::string& line)
+{
+    return readLineUntil(line, Clock::time_point::max()) == ReadStatus::Line;
+}
+
+WorkerProcess::ReadStatus WorkerProcess::readLineUntil(std::string& line, Clock::time_point deadline)
+{
+    size_t newline;
+    while ((newline = m_readBuffer.find('\n')) == std::string::npos) {
+        ReadStatus status = readChunk(deadline);
+        if (status != ReadStatus::Line) {
+            return status;
+        }
+    }
+
+    // assign() keeps the capacity of a line string the caller reuses
+    line.assign(m_readBuffer, 0, newline);
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    m_readBuffer.erase(0, newline + 1);
+    return ReadStatus::Line;
+}
+
+#ifdef _WIN32
+
+WorkerProcess::WorkerProcess()
+    : m_process(NULL)
+    , m_stdinWrite(NULL)
+    , m_stdoutRead(NULL)
+{
+}
+
+WorkerProcess::~WorkerProcess()
+{
+    stop();
+}
+
+bool WorkerProcess::start(const std::string& commandLine, const std::vector<int>& cpus)
+{
+    stop();
+
+    DWORD_PTR affinity = 0;
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+            affinity |= static_cast<DWORD_PTR>(1) << cpu;
+        }
+    }
+
+    SECURITY_ATTRIBUTES sa;
+    sa.nLength = sizeof(SECURITY_ATTRIBUTES);
+    sa.lpSecurityDescriptor = NULL;
+    sa.bInheritHandle = TRUE;
+
+    HANDLE hStdinRead, hStdinWrite, hStdoutRead, hStdoutWrite;
+    if (!CreatePipe(&hStdinRead, &hStdinWrite, &sa, 0)) {
+        return false;
+    }
+    if (!CreatePipe(&hStdoutRead, &hStdoutWrite, &sa, 0)) {
+        CloseHandle(hStdinRead);
+        CloseHandle(hStdinWrite);
+        return false;
+    }
+
+    // Only the child's ends are inherited
+    SetHandleInformation(hStdinWrite, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(hStdoutRead, HANDLE_FLAG_INHERIT, 0);
+
+    // Worker logging on stderr is discarded so it cannot fill a pipe nobody reads
+    HANDLE hNul = CreateFileA("NUL", GENERIC_WRITE, FILE_SHARE_WRITE, &sa, OPEN_EXISTING, 0, NULL);
+
+    STARTUPINFOA si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    si.hStdInput = hStdinRead;
+    si.hStdOutput = hStdoutWrite;
+    si.hStdError = hNul;
+    si.dwFlags |= STARTF_USESTDHANDLES;
+
+    ZeroMemory(&pi, sizeof(pi));
+
+    std::string command = commandLine;
+    // Suspended until pinned, so no thread pool is sized before the mask is set
+    DWORD flags = CREATE_NO_WINDOW | (affinity ? CREATE_SUSPENDED : 0);
+    BOOL created = CreateProcessA(NULL, &command[0], NULL, NULL, TRUE, flags, NULL, NULL, &si, &pi);
+
+    CloseHandle(hStdinRead);
+    CloseHandle(hStdoutWrite);
+    if (hNul != INVALID_HANDLE_VALUE) {
+        CloseHandle(hNul);
+    }
+
+    if (!created) {
+        CloseHandle(hStdinWrite);
+        CloseHandle(hStdoutRead);
+        return false;
+    }
+
+    if (affinity) {
+        SetProcessAffinityMask(pi.hProcess, affinity);
+        ResumeThread(pi.hThread);
+    }
+    CloseHandle(pi.hThread);
+    m_process = pi.hProcess;
+    m_stdinWrite = hStdinWrite;
+    m_stdoutRead = hStdoutRead;
+    m_readBuffer.clear();
+    return true;
+}
+
+void WorkerProcess::stop()
+{
+    if (m_stdinWrite) {
+        // EOF on stdin asks the worker to exit on its own
+        CloseHandle(m_stdinWrite);
+        m_stdinWrite = NULL;
+    }
+
+    if (m_process) {
+        DWORD graceMs = static_cast<DWORD>(std::chrono::duration_cast<std::chrono::milliseconds>(kShutdownGrace).count());
+        if (WaitForSingleObject(m_process, graceMs) != WAIT_OBJECT_0) {
+            TerminateProcess(m_process, 1);
+            WaitForSingleObject(m_process, INFINITE);
+        }
+        CloseHandle(m_process);
+        m_process = NULL;
+    }
+
+    if (m_stdoutRead) {
+        CloseHandle(m_stdoutRead);
+        m_stdoutRead = NULL;
+    }
+}
+
+void WorkerProcess::terminate()
+{
+    if (m_process) {
+        TerminateProcess(m_process, 1);
+    }
+    stop();
+}
+
+bool WorkerProcess::isRunning()
+{
+    return m_process && WaitForSingleObject(m_process, 0) == WAIT_TIMEOUT;
+}
+
+bool WorkerProcess::setAffinity(const std::vector<int>& cpus)
+{
+    DWORD_PTR affinity = 0;
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+            affinity |= static_cast<DWORD_PTR>(1) << cpu;
+        }
+    }
+    return m_process && affinity && SetProcessAffinityMask(m_process, affinity);
+}
+
+bool WorkerProcess::writeAll(const char* ptr, size_t remaining)
+{
+    while (remaining > 0) {
+        DWORD written = 0;
+        if (!WriteFile(m_stdinWrite, ptr, static_cast<DWORD>(remaining), &written, NULL)) {
+            return false;
+        }
+        ptr += written;
+        remaining -= written;
+    }
+    return true;
+}
+
+bool WorkerProcess::writeLine(std::string_view line)
+{
+    if (!m_stdinWrite) {
+        return false;
+    }
+    // The worker reads whole lines, so the terminator can follow separately
+    return writeAll(line.data(), line.size()) && writeAll("\n", 1);
+}
+
+WorkerProcess::ReadStatus WorkerProcess::readChunk(Clock::time_point deadline)
+{
+    if (!m_stdoutRead) {
+        return ReadStatus::Closed;
+    }
+
+    // Anonymous pipes have no overlapped reads, so a deadline is kept by
+    // polling for available bytes; ReadFile then returns without blocking
+    if (deadline != Clock::time_point::max()) {
+        DWORD available = 0;
+        while (true) {
+            if (!PeekNamedPipe(m_stdoutRead, NULL, 0, NULL, &available, NULL)) {
+                return ReadStatus::Closed;
+            }
+            if (available > 0) {
+                break;
+            }
+            if (remainingMs(deadline) == 0) {
+                return ReadStatus::TimedOut;
+            }
+            Sleep(1);
+        }
+    }
+
+    char buffer[4096];
+    DWORD bytesRead = 0;
+    if (!ReadFile(m_stdoutRead, buffer, sizeof(buffer), &bytesRead, NULL) || bytesRead == 0) {
+        return ReadStatus::Closed;
+    }
+    m_readBuffer.append(buffer, bytesRead);
+    return ReadStatus::Line;
+}
+
+#else
+
+namespace {
+// A dead worker must surface as a failed write (EPIPE), not kill the host.
+// SIGPIPE is blocked for the writing thread only, so the disposition the
+// embedding application chose for the process is left alone.
+class SigPipeBlock {
+public:
+    SigPipeBlock()
+    {
+        sigemptyset(&m_pipe);
+        sigaddset(&m_pipe, SIGPIPE);
+        sigset_t pending;
+        sigpending(&pending);
+        m_wasPending = sigismember(&pending, SIGPIPE) == 1;
+        pthread_sigmask(SIG_BLOCK, &m_pipe, &m_previous);
+    }
+
+    ~SigPipeBlock() { pthread_sigmask(SIG_SETMASK, &m_previous, nullptr); }
+
+    // Takes the SIGPIPE a failed write left pending, so it is not delivered
+    // once the mask is restored; one that was pending before is kept
+    void consume()
+    {
+        if (m_wasPending) {
+            return;
+        }
+        const timespec zero = {0, 0};
+        while (sigtimedwait(&m_pipe, nullptr, &zero) < 0 && errno == EINTR) {
+        }
+    }
+
+private:
+    sigset_t m_pipe;
+    sigset_t m_previous;
+    bool m_wasPending;
+};
+}
+
+WorkerProcess::WorkerProcess()
+    : m_pid(-1)
+    , m_stdinFd(-1)
+    , m_stdoutFd(-1)
+{
+}
+
+WorkerProcess::~WorkerProcess()
+{
+    stop();
+}
+
+bool WorkerProcess::start(const std::string& commandLine, const std::vector<int>& cpus)
+{
+    stop();
+
+    // Built before fork; the child only makes system calls. Another thread
+    // may hold the allocator's lock at the fork, so the child must not allocate.
+    std::string command = "exec " + commandLine;
+    char* const shellArgs[] = {const_cast<char*>("sh"), const_cast<char*>("-c"), &command[0], nullptr};
+    cpu_set_t affinity;
+    CPU_ZERO(&affinity);
+    bool pinned = false;
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &affinity);
+            pinned = true;
+        }
+    }
+
+    int stdinPipe[2];
+    int stdoutPipe[2];
+    // Close-on-exec from creation: a worker spawned by another thread at
+    // the same moment must not inherit these ends, or EOF never arrives
+    if (pipe2(stdinPipe, O_CLOEXEC) != 0) {
+        return false;
+    }
+    if (pipe2(stdoutPipe, O_CLOEXEC) != 0) {
+        close(stdinPipe[0]);
+        close(stdinPipe[1]);
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(stdinPipe[0]);
+        close(stdinPipe[1]);
+        close(stdoutPipe[0]);
+        close(stdoutPipe[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        dup2(stdinPipe[0], STDIN_FILENO);
+        dup2(stdoutPipe[1], STDOUT_FILENO);
+        close(stdinPipe[0]);
+        close(stdinPipe[1]);
+        close(stdoutPipe[0]);
+        close(stdoutPipe[1]);
+        // Inherited across exec; a refused mask leaves the worker unpinned
+        if (pinned) {
+            sched_setaffinity(0, sizeof(affinity), &affinity);
+        }
+
+        execv("/bin/sh", shellArgs);
+        _exit(127);
+    }
+
+    close(stdinPipe[0]);
+    close(stdoutPipe[1]);
+    m_pid = pid;
+    m_stdinFd = stdinPipe[1];
+    m_stdoutFd = stdoutPipe[0];
+    m_readBuffer.clear();
+    return true;
+}
+
+void WorkerProcess::stop()
+{
+    if (m_stdinFd >= 0) {
+        // EOF on stdin asks the worker to exit on its own
+        close(m_stdinFd);
+        m_stdinFd = -1;
+    }
+
+    if (m_pid > 0) {
+        auto deadline = std::chrono::steady_clock::now() + kShutdownGrace;
+        while (waitpid(m_pid, nullptr, WNOHANG) == 0) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                kill(m_pid, SIGKILL);
+                waitpid(m_pid, nullptr, 0);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        m_pid = -1;
+    }
+
+    if (m_stdoutFd >= 0) {
+        close(m_stdoutFd);
+        m_stdoutFd = -1;
+    }
+}
+
+void WorkerProcess::terminate()
+{
+    if (m_pid > 0) {
+        kill(m_pid, SIGKILL);
+    }
+    stop();
+}
+
+bool WorkerProcess::isRunning()
+{
+    if (m_pid <= 0) {
+        return false;
+    }
+
+    pid_t result = waitpid(m_pid, nullptr, WNOHANG);
+    if (result == m_pid) {
+        // Reaped here, so stop() must not wait for it again
+        m_pid = -1;
+        return false;
+    }
+    return result == 0;
+}
+
+bool WorkerProcess::setAffinity(const std::vector<int>& cpus)
+{
+    cpu_set_t affinity;
+    CPU_ZERO(&affinity);
+    bool any = false;
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &affinity);
+            any = true;
+        }
+    }
+    if (m_pid <= 0 || !any) {
+        return false;
+    }
+
+    // The mask is per thread: move each one the worker has started so far;
+    // threads started later inherit it from their creator
+    DIR* tasks = opendir(("/proc/" + std::to_string(m_pid) + "/task").c_str());
+    if (!tasks) {
+        return sched_setaffinity(m_pid, sizeof(affinity), &affinity) == 0;
+    }
+    bool pinned = false;
+    while (dirent* entry = readdir(tasks)) {
+        if (entry->d_name[0] != '.' &&
+            sched_setaffinity(static_cast<pid_t>(std::atoi(entry->d_name)), sizeof(affinity), &affinity) == 0) {
+            pinned = true;
+        }
+    }
+    closedir(tasks);
+    return pinned;
+}
+
+bool WorkerProcess::writeLine(std::string_view line)
+{
+    if (m_stdinFd < 0) {
+        return false;
+    }
+    SigPipeBlock block;
+    // The worker reads whole lines, so the terminator can follow separately
+    bool written = writeAll(line.data(), line.size()) && writeAll("\n", 1);
+    if (!written && errno == EPIPE) {
+        block.consume();
+    }
+    return written;
+}
+
+bool WorkerProcess::writeAll(const char* ptr, size_t remaining)
+{
+    while (remaining > 0) {
+        ssize_t written = write(m_stdinFd, ptr, remaining);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        ptr += written;
+        remaining -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+WorkerProcess::ReadStatus WorkerProcess::readChunk(Clock::time_point deadline)
+{
+    if (m_stdoutFd < 0) {
+        return ReadStatus::Closed;
+    }
+
+    if (deadline != Clock::time_point::max()) {
+        pollfd pfd = {m_stdoutFd, POLLIN, 0};
+        int ready;
+        do {
+            ready = poll(&pfd, 1, static_cast<int>(std::min<long long>(remainingMs(deadline), INT_MAX)));
+        } while (ready < 0 && errno == EINTR);
+        if (ready == 0) {
+            return ReadStatus::TimedOut;
+        }
+        if (ready < 0) {
+            return ReadStatus::Closed;
+        }
+    }
+
+    char buffer[4096];
+    ssize_t bytesRead;
+    do {
+        bytesRead = read(m_stdoutFd, buffer, sizeof(buffer));
+    } while (bytesRead < 0 && errno == EINTR);
+
+    if (bytesRead <= 0) {
+        return ReadStatus::Closed;
+    }
+    m_readBuffer.append(buffer, static_cast<size_t>(bytesRead));
+    return ReadStatus::Line;
+}
+
+#endif
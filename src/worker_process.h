@@ -0,0 +1,58 @@
+#ifndef WORKER_PROCESS_H
+#define WORKER_PROCESS_H
+
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <vector>
+
+// A long-lived child process spoken to with newline-delimited messages over
+// its stdin/stdout. The child's stderr is not captured.
+class WorkerProcess {
+public:
+    WorkerProcess();
+    ~WorkerProcess();
+
+    WorkerProcess(const WorkerProcess&) = delete;
+    WorkerProcess& operator=(const WorkerProcess&) = delete;
+
+    enum class ReadStatus {
+        Line,
+        Closed,     // EOF or error
+        TimedOut,
+    };
+
+    // Empty cpus leave the child on every CPU this process may use
+    bool start(const std::string& commandLine, const std::vector<int>& cpus = {});
+    void stop();
+    // Kills the worker at once, e.g. when it stopped responding
+    void terminate();
+    bool isRunning();
+    // Moves a running worker, every thread it has, onto these CPUs
+    bool setAffinity(const std::vector<int>& cpus);
+
+    bool writeLine(std::string_view line);
+    // Blocks until a full line is available; false on EOF or error
+    bool readLine(std::string& line);
+    // Gives up when no full line has arrived by the deadline
+    ReadStatus readLineUntil(std::string& line, std::chrono::steady_clock::time_point deadline);
+
+private:
+    bool writeAll(const char* data, size_t size);
+    // Line here means more bytes were appended to the read buffer
+    ReadStatus readChunk(std::chrono::steady_clock::time_point deadline);
+
+    std::string m_readBuffer;
+
+#ifdef _WIN32
+    void* m_process;
+    void* m_stdinWrite;
+    void* m_stdoutRead;
+#else
+    int m_pid;
+    int m_stdinFd;
+    int m_stdoutFd;
+#endif
+};
+
+#endif // WORKER_PROCESS_H
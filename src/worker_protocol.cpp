@@ -0,0 +1,296 @@
+#include "worker_protocol.h"
+#include <charconv>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+const char kBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+template <typename String>
+void appendEscaped(String& out, std::string_view value)
+{
+    for (char c : value) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default: out += c; break;
+        }
+    }
+}
+
+template <typename String>
+void appendBase64(String& out, std::string_view bytes)
+{
+    size_t start = out.size();
+    out.resize(start + (bytes.size() + 2) / 3 * 4);
+    char* cursor = &out[start];
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(bytes.data());
+    size_t i = 0;
+    for (; i + 3 <= bytes.size(); i += 3) {
+        uint32_t group = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        *cursor++ = kBase64Alphabet[(group >> 18) & 63];
+        *cursor++ = kBase64Alphabet[(group >> 12) & 63];
+        *cursor++ = kBase64Alphabet[(group >> 6) & 63];
+        *cursor++ = kBase64Alphabet[group & 63];
+    }
+    if (i < bytes.size()) {
+        uint32_t group = data[i] << 16;
+        if (i + 1 < bytes.size()) {
+            group |= data[i + 1] << 8;
+        }
+        *cursor++ = kBase64Alphabet[(group >> 18) & 63];
+        *cursor++ = kBase64Alphabet[(group >> 12) & 63];
+        *cursor++ = i + 1 < bytes.size() ? kBase64Alphabet[(group >> 6) & 63] : '=';
+        *cursor++ = '=';
+    }
+}
+
+// Same text as streaming the value with default precision ("%g")
+void appendNumber(std::pmr::string& out, double value)
+{
+    char buffer[32];
+    std::to_chars_result converted = std::to_chars(buffer, buffer + sizeof(buffer), value,
+                                                   std::chars_format::general, 6);
+    out.append(buffer, converted.ptr);
+}
+
+void appendNumber(std::pmr::string& out, int value)
+{
+    char buffer[16];
+    std::to_chars_result converted = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, converted.ptr);
+}
+
+const char* pixelFormatName(PixelFormat format)
+{
+    switch (format) {
+    case PixelFormat::Rgb: return "rgb";
+    case PixelFormat::Bgra: return "bgra";
+    case PixelFormat::Rgba: return "rgba";
+    case PixelFormat::Gray: return "gray";
+    default: return "bgr";
+    }
+}
+
+// Position of "key": at or after from, just past the colon; npos when missing
+size_t findKey(std::string_view json, const char* key, size_t from)
+{
+    // Keys are short protocol names, so the needle fits on the stack
+    char needle[48];
+    size_t keyLength = std::strlen(key);
+    if (keyLength + 3 > sizeof(needle)) {
+        return std::string_view::npos;
+    }
+    needle[0] = '"';
+    std::memcpy(needle + 1, key, keyLength);
+    needle[keyLength + 1] = '"';
+    needle[keyLength + 2] = ':';
+
+    size_t pos = json.find(std::string_view(needle, keyLength + 3), from);
+    return pos == std::string_view::npos ? pos : pos + keyLength + 3;
+}
+
+// Value of the first "key": at or after from; 0 when missing. The response
+// line is followed by a terminator or other non-numeric text, so strtod
+// stops inside it.
+double extractNumber(std::string_view json, const char* key, size_t from)
+{
+    size_t pos = findKey(json, key, from);
+    if (pos == std::string_view::npos) {
+        return 0.0;
+    }
+    return std::strtod(json.data() + pos, nullptr);
+}
+}
+
+std::string escapeJson(const std::string& value)
+{
+    std::string escaped;
+    escaped.reserve(value.size() + 8);
+    appendEscaped(escaped, value);
+    return escaped;
+}
+
+std::string encodeBase64(const std::string& bytes)
+{
+    std::string encoded;
+    appendBase64(encoded, bytes);
+    return encoded;
+}
+
+size_t pixelSpan(const PixelImage& pixels)
+{
+    if (pixels.width <= 0 || pixels.height <= 0) {
+        return 0;
+    }
+    return static_cast<size_t>(pixels.stride) * (pixels.height - 1) +
+           static_cast<size_t>(pixels.width) * bytesPerPixel(pixels.format);
+}
+
+void appendWorkerRequest(std::pmr::string& out, const DetectionRequest& request, std::string_view imageData)
+{
+    out += "{\"image_path\":\"";
+    appendEscaped(out, request.imagePath);
+    out += "\",";
+    if (imageData.data()) {
+        out += "\"image_data\":\"";
+        appendBase64(out, imageData);
+        out += "\",";
+    }
+    if (request.pixels.data) {
+        // A staged image is mapped by the worker; otherwise the rows go inline
+        const PixelImage& pixels = request.pixels;
+        out += "\"pixels\":{\"width\":";
+        appendNumber(out, pixels.width);
+        out += ",\"height\":";
+        appendNumber(out, pixels.height);
+        out += ",\"stride\":";
+        appendNumber(out, pixels.stride);
+        out += ",\"format\":\"";
+        out += pixelFormatName(pixels.format);
+        if (!pixels.sharedPath.empty()) {
+            out += "\",\"shm\":\"";
+            appendEscaped(out, pixels.sharedPath);
+        } else {
+            out += "\",\"data\":\"";
+            appendBase64(out, std::string_view(reinterpret_cast<const char*>(pixels.data), pixelSpan(pixels)));
+        }
+        out += "\"},";
+    }
+    out += "\"confidence_threshold\":";
+    appendNumber(out, request.confidenceThreshold);
+    out += ",\"iou_threshold\":";
+    appendNumber(out, request.iouThreshold);
+    out += ",\"model_name\":\"";
+    appendEscaped(out, request.modelName);
+    out += "\",\"inference_size\":";
+    appendNumber(out, request.inferenceSize);
+    out += ",\"save_annotated\":";
+    out += request.saveAnnotated ? "true" : "false";
+    if (request.crop.width > 0 && request.crop.height > 0) {
+        out += ",\"crop\":[";
+        appendNumber(out, request.crop.x);
+        out += ",";
+        appendNumber(out, request.crop.y);
+        out += ",";
+        appendNumber(out, request.crop.width);
+        out += ",";
+        appendNumber(out, request.crop.height);
+        out += "]";
+    }
+    out += "}";
+}
+
+void appendBatchRequest(std::pmr::string& out, const std::vector<DetectionRequest>& requests)
+{
+    out += "{\"batch\":[";
+    for (size_t i = 0; i < requests.size(); ++i) {
+        if (i > 0) out += ",";
+        const DetectionRequest& request = requests[i];
+        appendWorkerRequest(out, request, request.imageData ? std::string_view(*request.imageData) : std::string_view());
+    }
+    out += "]}";
+}
+
+std::string createWorkerRequest(const DetectionRequest& request, const std::string* imageData)
+{
+    std::pmr::string json;
+    appendWorkerRequest(json, request, imageData ? std::string_view(*imageData) : std::string_view());
+    return std::string(json);
+}
+
+DetectionResult parseWorkerResponse(std::string_view response)
+{
+    DetectionResult result;
+    result.success = false;
+    result.processingTime = 0;
+
+    // Simple JSON parsing (for a full implementation, use a JSON library)
+    if (response.find("\"success\":true") != std::string_view::npos) {
+        result.success = true;
+        
+        // Extract processing time
+        size_t timePos = findKey(response, "processing_time", 0);
+        if (timePos != std::string_view::npos) {
+            result.processingTime = std::atoi(response.data() + timePos);
+        }
+
+        size_t loadPos = findKey(response, "model_load_ms", 0);
+        if (loadPos != std::string_view::npos) {
+            result.modelLoadTime = std::atoi(response.data() + loadPos);
+        }
+
+        // Boxes arrive in model input pixels; the letterbox maps them back
+        size_t letterboxPos = response.find("\"letterbox\":{");
+        if (letterboxPos != std::string_view::npos) {
+            LetterboxTransform& lb = result.letterbox;
+            lb.sourceWidth = static_cast<int>(extractNumber(response, "source_width", letterboxPos));
+            lb.sourceHeight = static_cast<int>(extractNumber(response, "source_height", letterboxPos));
+            lb.inputWidth = static_cast<int>(extractNumber(response, "input_width", letterboxPos));
+            lb.inputHeight = static_cast<int>(extractNumber(response, "input_height", letterboxPos));
+            lb.scaleX = extractNumber(response, "scale_x", letterboxPos);
+            lb.scaleY = extractNumber(response, "scale_y", letterboxPos);
+            lb.padX = extractNumber(response, "pad_x", letterboxPos);
+            lb.padY = extractNumber(response, "pad_y", letterboxPos);
+            lb.offsetX = static_cast<int>(extractNumber(response, "crop_x", letterboxPos));
+            lb.offsetY = static_cast<int>(extractNumber(response, "crop_y", letterboxPos));
+        }
+
+        // Extract detections (simplified parsing)
+        size_t detectionsPos = response.find("\"detections\":[");
+        if (detectionsPos != std::string_view::npos) {
+            // Counted first so the vector is allocated once
+            size_t count = 0;
+            for (size_t pos = detectionsPos; (pos = response.find("{\"class\":", pos + 1)) != std::string_view::npos;) {
+                count++;
+            }
+            result.detections.reserve(count);
+
+            size_t pos = detectionsPos;
+            while ((pos = response.find("{\"class\":", pos + 1)) != std::string_view::npos) {
+                result.detections.emplace_back();
+                Detection& detection = result.detections.back();
+
+                // Extract class name
+                size_t classStart = response.find("\"class\":\"", pos) + 9;
+                size_t classEnd = response.find("\"", classStart);
+                detection.className.assign(response.data() + classStart, classEnd - classStart);
+                detection.classId = static_cast<int>(extractNumber(response, "class_id", pos));
+                detection.confidence = extractNumber(response, "confidence", pos);
+                detection.bbox = {0, 0, 0, 0};
+
+                // [x, y, width, height]
+                size_t bboxPos = response.find("\"bbox\":[", pos);
+                size_t nextPos = response.find("{\"class\":", pos + 1);
+                if (bboxPos != std::string_view::npos && bboxPos < nextPos) {
+                    const char* cursor = response.data() + bboxPos + 8;
+                    double box[4] = {0.0, 0.0, 0.0, 0.0};
+                    for (double& value : box) {
+                        char* end = nullptr;
+                        value = std::strtod(cursor, &end);
+                        cursor = *end == ',' ? end + 1 : end;
+                    }
+                    detection.bbox = mapToSource(result.letterbox, box[0], box[1], box[2], box[3]);
+                }
+            }
+        }
+    } else {
+        // Extract error message
+        size_t errorPos = response.find("\"error\":\"");
+        if (errorPos != std::string_view::npos) {
+            errorPos += 9;
+            size_t endPos = response.find("\"", errorPos);
+            if (endPos != std::string_view::npos) {
+                result.errorMessage.assign(response.data() + errorPos, endPos - errorPos);
+            }
+        } else {
+            result.errorMessage = "Unknown error occurred";
+        }
+    }
+
+    return result;
+}
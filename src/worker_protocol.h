@@ -0,0 +1,32 @@
+#ifndef WORKER_PROTOCOL_H
+#define WORKER_PROTOCOL_H
+
+#include <string>
+#include <string_view>
+#include <memory_resource>
+#include <vector>
+#include "detection_client.h"
+
+// Newline-delimited JSON spoken with python/detection_server.py, whether the
+// worker is a local child process or a remote one over TCP.
+
+std::string escapeJson(const std::string& value);
+std::string encodeBase64(const std::string& bytes);
+
+// Bytes from the first pixel to the last: rows of stride, the last one unpadded
+size_t pixelSpan(const PixelImage& pixels);
+
+// One request object appended to out. With imageData the encoded image
+// travels inline, so a worker on another machine does not need access to
+// imagePath; raw pixels go as the path of the file they were staged in, or
+// inline. Nothing else is allocated, so with out backed by a FrameArena
+// building a request stays off the heap.
+void appendWorkerRequest(std::pmr::string& out, const DetectionRequest& request,
+                         std::string_view imageData = std::string_view());
+// {"batch":[...]}; images already in memory travel inline, the rest are read by path
+void appendBatchRequest(std::pmr::string& out, const std::vector<DetectionRequest>& requests);
+
+std::string createWorkerRequest(const DetectionRequest& request, const std::string* imageData = nullptr);
+DetectionResult parseWorkerResponse(std::string_view response);
+
+#endif // WORKER_PROTOCOL_H
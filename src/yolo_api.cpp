@@ -0,0 +1,336 @@
+#include "yolo_api.h"
+#include "detection_scheduler.h"
+#include "worker_pool.h"
+#include "worker_balancer.h"
+#include "shared_pixels.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace {
+const int kDefaultMaxBatch = 8;
+const int kDefaultMaxPending = 16;
+// With remote workers: scheduler threads per endpoint, so one batch uploads while another runs
+const int kBatchesPerRemoteWorker = 2;
+const int kStream = 0;
+
+// Directory of this library, where the Python scripts are looked for
+std::filesystem::path libraryDirectory()
+{
+#ifdef _WIN32
+    HMODULE module = NULL;
+    wchar_t path[MAX_PATH];
+    if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                           reinterpret_cast<LPCWSTR>(&libraryDirectory), &module) &&
+        GetModuleFileNameW(module, path, MAX_PATH) > 0) {
+        return std::filesystem::path(path).parent_path();
+    }
+#else
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void*>(&libraryDirectory), &info) && info.dli_fname) {
+        std::error_code ec;
+        return std::filesystem::absolute(info.dli_fname, ec).parent_path();
+    }
+#endif
+    return std::filesystem::current_path();
+}
+
+std::string findScript()
+{
+    std::filesystem::path directory = libraryDirectory();
+    for (const std::filesystem::path& candidate : {directory / ".." / "python" / "detection_server.py",
+                                                   directory / "python" / "detection_server.py",
+                                                   std::filesystem::path("python") / "detection_server.py"}) {
+        std::error_code ec;
+        if (std::filesystem::exists(candidate, ec)) {
+            return candidate.lexically_normal().string();
+        }
+    }
+    return (directory / ".." / "python" / "detection_server.py").lexically_normal().string();
+}
+
+// The caller's struct may be older and shorter than ours: copy what it has
+template <typename Struct>
+Struct readVersioned(const Struct* given, const Struct& defaults)
+{
+    Struct result = defaults;
+    if (given && given->struct_size >= sizeof(uint32_t)) {
+        std::memcpy(&result, given, std::min<size_t>(given->struct_size, sizeof(Struct)));
+    }
+    result.struct_size = sizeof(Struct);
+    return result;
+}
+
+bool validImage(const yolo_image* image)
+{
+    if (!image || !image->pixels || image->width <= 0 || image->height <= 0 ||
+        image->format < YOLO_PIXEL_BGR8 || image->format > YOLO_PIXEL_GRAY8) {
+        return false;
+    }
+    int bytes = bytesPerPixel(static_cast<PixelFormat>(image->format));
+    return image->stride >= 0 && static_cast<int64_t>(image->stride) >= static_cast<int64_t>(image->width) * bytes;
+}
+
+void copyDetections(const DetectionResult& result, yolo_detection* detections, int32_t capacity)
+{
+    int32_t count = static_cast<int32_t>(std::min<size_t>(result.detections.size(), std::max<int32_t>(capacity, 0)));
+    for (int32_t i = 0; i < count; ++i) {
+        const Detection& source = result.detections[i];
+        yolo_detection& target = detections[i];
+        target.x = static_cast<float>(source.bbox.x);
+        target.y = static_cast<float>(source.bbox.y);
+        target.width = static_cast<float>(source.bbox.width);
+        target.height = static_cast<float>(source.bbox.height);
+        target.confidence = static_cast<float>(source.confidence);
+        target.class_id = source.classId;
+        size_t length = std::min<size_t>(source.className.size(), sizeof(target.class_name) - 1);
+        std::memcpy(target.class_name, source.className.data(), length);
+        target.class_name[length] = '\0';
+    }
+}
+}
+
+struct yolo_detector {
+    std::string model;
+    size_t maxPending = kDefaultMaxPending;
+    std::unique_ptr<WorkerPool> pool;
+    std::unique_ptr<WorkerBalancer> balancer;
+    std::unique_ptr<SharedPixelPool> staging;       // Local workers map the frames from here
+    std::unique_ptr<DetectionScheduler> scheduler;
+
+    std::mutex mutex;
+    std::condition_variable idle;
+    size_t pending = 0;
+    bool closing = false;
+
+    void finished()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending--;
+        idle.notify_all();
+    }
+};
+
+int32_t yolo_api_version(void)
+{
+    return YOLO_API_VERSION;
+}
+
+const char* yolo_status_string(yolo_status status)
+{
+    switch (status) {
+    case YOLO_OK: return "ok";
+    case YOLO_ERROR_INVALID_ARGUMENT: return "invalid argument";
+    case YOLO_ERROR_BUSY: return "too many requests outstanding";
+    case YOLO_ERROR_TIMEOUT: return "timed out";
+    case YOLO_ERROR_DETECTION: return "detection failed";
+    case YOLO_ERROR_SHUTDOWN: return "detector is shutting down";
+    }
+    return "unknown status";
+}
+
+yolo_status yolo_create(const yolo_config* config, yolo_detector** detector)
+{
+    if (!detector) {
+        return YOLO_ERROR_INVALID_ARGUMENT;
+    }
+    *detector = nullptr;
+    yolo_config defaults = {};
+    yolo_config settings = readVersioned(config, defaults);
+
+    auto created = std::unique_ptr<yolo_detector>(new (std::nothrow) yolo_detector());
+    if (!created) {
+        return YOLO_ERROR_DETECTION;
+    }
+    created->model = settings.model ? settings.model : "yolov5s";
+    created->maxPending = settings.max_pending > 0 ? settings.max_pending : kDefaultMaxPending;
+    int maxBatch = settings.max_batch > 0 ? settings.max_batch : kDefaultMaxBatch;
+
+    try {
+        DetectionScheduler::BatchExecutor executor;
+        int schedulerWorkers;
+        std::vector<WorkerEndpoint> endpoints;
+        if (settings.remote_workers) {
+            endpoints = WorkerBalancer::parseEndpoints(settings.remote_workers);
+            if (endpoints.empty()) {
+                return YOLO_ERROR_INVALID_ARGUMENT;
+            }
+        }
+        if (!endpoints.empty()) {
+            created->balancer = std::make_unique<WorkerBalancer>(endpoints);
+            WorkerBalancer* balancer = created->balancer.get();
+            executor = [balancer](int workerIndex, const std::vector<DetectionRequest>& batch) {
+                return balancer->runBatch(workerIndex, batch);
+            };
+            schedulerWorkers = kBatchesPerRemoteWorker * static_cast<int>(endpoints.size());
+        } else {
+#ifdef _WIN32
+            std::string python = settings.python_executable ? settings.python_executable : "python";
+#else
+            std::string python = settings.python_executable ? settings.python_executable : "python3";
+#endif
+            std::string script = settings.script_path ? settings.script_path : findScript();
+            created->pool = std::make_unique<WorkerPool>(python, script);
+            WorkerConfig workerConfig;
+            workerConfig.preloadModels.push_back(created->model);
+            created->pool->setWorkerConfig(workerConfig);
+            created->pool->setWorkerCount(settings.workers > 0 ? settings.workers : 1);
+            // Every outstanding request may hold a staged frame
+            created->staging = std::make_unique<SharedPixelPool>("", created->maxPending);
+            WorkerPool* pool = created->pool.get();
+            executor = [pool](int workerIndex, const std::vector<DetectionRequest>& batch) {
+                return pool->runBatch(workerIndex, batch);
+            };
+            schedulerWorkers = pool->getWorkerCount();
+        }
+
+        // The queue holds every outstanding request, so the scheduler never
+        // drops one and every accepted request gets its callback
+        created->scheduler = std::make_unique<DetectionScheduler>(executor, schedulerWorkers, maxBatch);
+        created->scheduler->addStream(kStream, 1.0, created->maxPending, DetectionPriority::Interactive);
+    } catch (const std::exception&) {
+        return YOLO_ERROR_DETECTION;
+    }
+
+    *detector = created.release();
+    return YOLO_OK;
+}
+
+void yolo_destroy(yolo_detector* detector)
+{
+    if (!detector) {
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(detector->mutex);
+        detector->closing = true;
+        detector->idle.wait(lock, [detector]() { return detector->pending == 0; });
+    }
+    // Joins the scheduler threads, so no callback is still running
+    detector->scheduler->shutdown();
+    if (detector->balancer) {
+        detector->balancer->shutdown();
+    }
+    delete detector;
+}
+
+yolo_status yolo_detect_async(yolo_detector* detector, const yolo_image* image, const yolo_options* options,
+                              yolo_detection* detections, int32_t capacity, yolo_callback callback,
+                              void* user_data)
+{
+    if (!detector || !validImage(image) || !callback || capacity < 0 || (capacity > 0 && !detections)) {
+        return YOLO_ERROR_INVALID_ARGUMENT;
+    }
+    yolo_options defaults = {};
+    defaults.confidence_threshold = 0.5f;
+    defaults.iou_threshold = 0.45f;
+    yolo_options settings = readVersioned(options, defaults);
+
+    {
+        std::lock_guard<std::mutex> lock(detector->mutex);
+        if (detector->closing) {
+            return YOLO_ERROR_SHUTDOWN;
+        }
+        if (detector->pending >= detector->maxPending) {
+            return YOLO_ERROR_BUSY;
+        }
+        detector->pending++;
+    }
+
+    DetectionRequest request;
+    request.confidenceThreshold = settings.confidence_threshold;
+    request.iouThreshold = settings.iou_threshold;
+    request.modelName = settings.model ? settings.model : detector->model;
+    request.saveAnnotated = false;
+    request.streamId = kStream;
+    request.inferenceSize = settings.inference_size == 0 ? kDefaultInferenceSize
+                          : settings.inference_size < 0 ? kInferenceSizeAuto : settings.inference_size;
+    if (settings.timeout_ms > 0) {
+        request.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(settings.timeout_ms);
+    }
+    request.pixels.data = static_cast<const uint8_t*>(image->pixels);
+    request.pixels.width = image->width;
+    request.pixels.height = image->height;
+    request.pixels.stride = image->stride;
+    request.pixels.format = static_cast<PixelFormat>(image->format);
+
+    // Local workers read the rows from a staged slot; remote ones get them
+    // inline, read from the caller's buffer when the batch is sent
+    PixelLease staged;
+    if (detector->staging) {
+        staged = detector->staging->stage(request.pixels);
+        if (!staged) {
+            detector->finished();
+            return YOLO_ERROR_DETECTION;
+        }
+        request.pixels = *staged;
+    }
+
+    // The slot and the pending count are released before the callback, so
+    // the callback may submit the next request. Both callbacks share the one
+    // lease: the scheduler keeps the unused callback alive for a while.
+    auto lease = std::make_shared<PixelLease>(std::move(staged));
+    auto deadline = request.deadline;
+    CancellationHandle handle = detector->scheduler->submit(kStream, request,
+        [detector, lease, detections, capacity, callback, user_data](const DetectionResult& result) {
+            copyDetections(result, detections, capacity);
+            lease->reset();
+            detector->finished();
+            callback(user_data, YOLO_OK, static_cast<int32_t>(result.detections.size()), "");
+        },
+        [detector, lease, deadline, callback, user_data](const std::string& error) {
+            yolo_status status = std::chrono::steady_clock::now() >= deadline ? YOLO_ERROR_TIMEOUT
+                                                                              : YOLO_ERROR_DETECTION;
+            lease->reset();
+            detector->finished();
+            callback(user_data, status, 0, error.c_str());
+        });
+    if (!handle) {
+        detector->finished();
+        return YOLO_ERROR_SHUTDOWN;
+    }
+    return YOLO_OK;
+}
+
+yolo_status yolo_detect(yolo_detector* detector, const yolo_image* image, const yolo_options* options,
+                        yolo_detection* detections, int32_t capacity, int32_t* count)
+{
+    struct Waiter {
+        std::mutex mutex;
+        std::condition_variable done;
+        bool finished = false;
+        yolo_status status = YOLO_OK;
+        int32_t count = 0;
+    } waiter;
+
+    yolo_status status = yolo_detect_async(detector, image, options, detections, capacity,
+        [](void* userData, yolo_status status, int32_t count, const char*) {
+            Waiter& waiter = *static_cast<Waiter*>(userData);
+            std::lock_guard<std::mutex> lock(waiter.mutex);
+            waiter.status = status;
+            waiter.count = count;
+            waiter.finished = true;
+            waiter.done.notify_one();
+        }, &waiter);
+    if (status != YOLO_OK) {
+        return status;
+    }
+
+    std::unique_lock<std::mutex> lock(waiter.mutex);
+    waiter.done.wait(lock, [&waiter]() { return waiter.finished; });
+    if (count) {
+        *count = waiter.count;
+    }
+    return waiter.status;
+}
@@ -0,0 +1,133 @@
+#ifndef YOLO_API_H
+#define YOLO_API_H
+
+/*
+ * C interface to the detection pipeline, for other programs to run YOLOv5
+ * detection in-process through the yolo_detector shared library. Images are
+ * passed as the caller's pixel buffers and results come back in the caller's
+ * arrays; nothing crosses the interface that needs freeing.
+ *
+ * Structs that carry a struct_size may grow at the end in later versions;
+ * set struct_size = sizeof(the struct) so the library knows which fields
+ * the caller has. Every function is safe to call from any thread.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifdef YOLO_API_BUILD
+#define YOLO_API __declspec(dllexport)
+#else
+#define YOLO_API __declspec(dllimport)
+#endif
+#else
+#define YOLO_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define YOLO_API_VERSION 1
+
+typedef enum yolo_status {
+    YOLO_OK = 0,
+    YOLO_ERROR_INVALID_ARGUMENT = 1,
+    YOLO_ERROR_BUSY = 2,            /* max_pending requests are outstanding; retry after one completes */
+    YOLO_ERROR_TIMEOUT = 3,         /* No result before timeout_ms */
+    YOLO_ERROR_DETECTION = 4,       /* The worker could not start, read the image or run the model */
+    YOLO_ERROR_SHUTDOWN = 5         /* The detector is being destroyed */
+} yolo_status;
+
+typedef enum yolo_pixel_format {
+    YOLO_PIXEL_BGR8 = 0,
+    YOLO_PIXEL_RGB8 = 1,
+    YOLO_PIXEL_BGRA8 = 2,
+    YOLO_PIXEL_RGBA8 = 3,
+    YOLO_PIXEL_GRAY8 = 4
+} yolo_pixel_format;
+
+/* Caller-owned pixels, top row first. The library keeps no copy of its own:
+ * local workers get the rows written once into memory they map, remote
+ * workers get them encoded straight into the request. The buffer must stay
+ * unchanged until yolo_detect() returns or the async callback runs. */
+typedef struct yolo_image {
+    const void* pixels;
+    int32_t width;
+    int32_t height;
+    int32_t stride;                 /* Bytes from one row to the next */
+    int32_t format;                 /* yolo_pixel_format */
+} yolo_image;
+
+/* Box in the image's pixels */
+typedef struct yolo_detection {
+    float x;
+    float y;
+    float width;
+    float height;
+    float confidence;
+    int32_t class_id;
+    char class_name[32];            /* Nul-terminated, truncated if longer */
+} yolo_detection;
+
+typedef struct yolo_config {
+    uint32_t struct_size;
+    /* Local workers: "python3" (Windows: "python") and detection_server.py
+     * found next to the library (../python/ or python/) when null */
+    const char* python_executable;
+    const char* script_path;
+    int32_t workers;                /* Local worker processes; 0 = 1 */
+    /* "host:port,host:port": run on remote workers (detection_server.py
+     * --serve --listen) instead of local ones; pixels are sent inline */
+    const char* remote_workers;
+    const char* model;              /* Default model and the one preloaded; null = "yolov5s" */
+    int32_t max_batch;              /* Requests inferred together; 0 = 8 */
+    int32_t max_pending;            /* Outstanding requests before YOLO_ERROR_BUSY; 0 = 16 */
+} yolo_config;
+
+/* Per request; a null pointer uses the defaults shown */
+typedef struct yolo_options {
+    uint32_t struct_size;
+    float confidence_threshold;     /* 0.5 */
+    float iou_threshold;            /* 0.45 */
+    int32_t inference_size;         /* Longest model input side; 0 = 640, -1 = follow the image */
+    const char* model;              /* Null = the detector's model */
+    int32_t timeout_ms;             /* 0 = none */
+} yolo_options;
+
+typedef struct yolo_detector yolo_detector;
+
+/* Called once per yolo_detect_async() that returned YOLO_OK, on a library
+ * thread, after the detections were written. count is the number found,
+ * which may exceed the capacity given; only capacity entries are written.
+ * message is only valid during the call. */
+typedef void (*yolo_callback)(void* user_data, yolo_status status, int32_t count, const char* message);
+
+YOLO_API int32_t yolo_api_version(void);
+YOLO_API const char* yolo_status_string(yolo_status status);
+
+/* Null config = defaults. Workers start on the first request. */
+YOLO_API yolo_status yolo_create(const yolo_config* config, yolo_detector** detector);
+
+/* Waits for outstanding requests, whose callbacks run with their results,
+ * then stops the workers. Must not be called from a callback. */
+YOLO_API void yolo_destroy(yolo_detector* detector);
+
+/* Blocks until the image is inferred. count receives the number found;
+ * up to capacity detections are written to detections. Must not be called
+ * from a callback. */
+YOLO_API yolo_status yolo_detect(yolo_detector* detector, const yolo_image* image, const yolo_options* options,
+                                 yolo_detection* detections, int32_t capacity, int32_t* count);
+
+/* Returns at once. The image and the detections array must stay valid until
+ * the callback runs; it is not called when this returns an error. */
+YOLO_API yolo_status yolo_detect_async(yolo_detector* detector, const yolo_image* image,
+                                       const yolo_options* options, yolo_detection* detections,
+                                       int32_t capacity, yolo_callback callback, void* user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* YOLO_API_H */
@@ -0,0 +1,72 @@
+// FramePacer: repeating the current rate leaves the grid and the count of
+// missed deadlines alone, and a new rate re-anchors on the grid. Timing is
+// on a 100 ms period with generous bounds. Exits non-zero on the first failure.
+#include "frame_pacer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            std::exit(1);                                                             \
+        }                                                                             \
+    } while (0)
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void testSameRateAfterOverrun()
+{
+    FramePacer pacer(10.0);
+    CHECK(pacer.waitForNextFrame());
+    Clock::time_point start = Clock::now();     // Deadline 0
+    CHECK(pacer.waitForNextFrame());            // 100 ms
+    CHECK(msSince(start) >= 95.0);
+
+    // Overrun past the 200 and 300 ms slots, then repeat the rate as the
+    // adaptive controller does on every result
+    std::this_thread::sleep_until(start + std::chrono::milliseconds(380));
+    pacer.setRate(10.0);
+    CHECK(pacer.waitForNextFrame());
+    double ticked = msSince(start);
+    std::printf("same rate: ticked at %.0f ms, %llu dropped\n", ticked,
+                static_cast<unsigned long long>(pacer.getStats().droppedDeadlines));
+    CHECK(ticked >= 395.0 && ticked < 480.0);   // The 400 ms slot, not at once
+    CHECK(pacer.getStats().droppedDeadlines == 2);
+}
+
+void testNewRateReanchors()
+{
+    FramePacer pacer(10.0);
+    CHECK(pacer.waitForNextFrame());
+    Clock::time_point start = Clock::now();
+    CHECK(pacer.waitForNextFrame());            // 100 ms
+
+    // Next deadline moves from 200 ms to one new period after 100 ms
+    pacer.setRate(5.0);
+    CHECK(pacer.waitForNextFrame());
+    double ticked = msSince(start);
+    std::printf("new rate: ticked at %.0f ms\n", ticked);
+    CHECK(ticked >= 295.0 && ticked < 380.0);
+    CHECK(pacer.waitForNextFrame());            // 500 ms
+    ticked = msSince(start);
+    CHECK(ticked >= 495.0 && ticked < 580.0);
+    CHECK(pacer.getStats().droppedDeadlines == 0);
+}
+}
+
+int main()
+{
+    testSameRateAfterOverrun();
+    testNewRateReanchors();
+    std::printf("frame_pacer: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,120 @@
+// LatestMailbox: latest-wins replacement, empty takes, and concurrent
+// producers against one consumer. Exits non-zero on the first failure.
+#include "result_mailbox.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <thread>
+#include <vector>
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            std::exit(1);                                                             \
+        }                                                                             \
+    } while (0)
+
+namespace {
+const int kProducers = 4;
+const uint64_t kPostsPerProducer = 200000;
+const uint64_t kProducerStride = 1ull << 32;   // Value = producer * stride + sequence
+
+void testEmptyTake()
+{
+    LatestMailbox<int> mailbox;
+    int value = -1;
+    CHECK(!mailbox.hasValue());
+    CHECK(!mailbox.take(value));
+    CHECK(value == -1);
+
+    mailbox.post(7);
+    CHECK(mailbox.take(value));
+    CHECK(value == 7);
+    // Taken once; nothing new since
+    CHECK(!mailbox.take(value));
+    MailboxStats stats = mailbox.getStats();
+    CHECK(stats.posted == 1 && stats.delivered == 1 && stats.coalesced == 0);
+}
+
+void testPostReplaces()
+{
+    LatestMailbox<int> mailbox;
+    mailbox.post(1);
+    mailbox.post(2);
+    CHECK(mailbox.getStats().coalesced == 1);
+    mailbox.post(3);
+    CHECK(mailbox.getStats().coalesced == 2);
+
+    int value = 0;
+    CHECK(mailbox.take(value));
+    CHECK(value == 3);
+    CHECK(!mailbox.take(value));
+    MailboxStats stats = mailbox.getStats();
+    CHECK(stats.posted == 3 && stats.delivered == 1 && stats.coalesced == 2);
+}
+
+void testConcurrentProducers()
+{
+    LatestMailbox<uint64_t> mailbox;
+    std::atomic<int> running(kProducers);
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&mailbox, &running, p]() {
+            for (uint64_t i = 1; i <= kPostsPerProducer; ++i) {
+                mailbox.post(p * kProducerStride + i);
+            }
+            running--;
+        });
+    }
+
+    // Each producer's values are taken in the order it posted them, and no
+    // value is taken twice
+    std::set<uint64_t> taken;
+    std::vector<uint64_t> lastSequence(kProducers, 0);
+    auto takeOne = [&]() {
+        uint64_t value = 0;
+        if (!mailbox.take(value)) {
+            return false;
+        }
+        CHECK(taken.insert(value).second);
+        int producer = static_cast<int>(value / kProducerStride);
+        uint64_t sequence = value % kProducerStride;
+        CHECK(producer >= 0 && producer < kProducers);
+        CHECK(sequence > lastSequence[producer]);
+        lastSequence[producer] = sequence;
+        return true;
+    };
+    while (running > 0) {
+        takeOne();
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    takeOne();
+
+    // The newest value is never lost: one posted after the rest is the one taken
+    const uint64_t newest = kProducers * kProducerStride + 1;
+    mailbox.post(newest);
+    uint64_t value = 0;
+    CHECK(mailbox.take(value));
+    CHECK(value == newest);
+    CHECK(!mailbox.take(value));
+
+    MailboxStats stats = mailbox.getStats();
+    CHECK(stats.posted == kProducers * kPostsPerProducer + 1);
+    CHECK(stats.delivered == taken.size() + 1);
+    CHECK(stats.posted == stats.delivered + stats.coalesced);
+}
+}
+
+int main()
+{
+    testEmptyTake();
+    testPostReplaces();
+    testConcurrentProducers();
+    std::printf("result_mailbox: all checks passed\n");
+    return 0;
+}